@@ -12,6 +12,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
 #include "esp_timer.h"
 #include "esp_lcd_panel_ops.h"
 #include "esp_lcd_panel_rgb.h"
@@ -24,6 +25,8 @@
 #include "esp_rom_sys.h"
 #include "lvgl.h"
 #include "ui/ui.h"
+#include "ui/components/ui_comp_digits.h"
+#include "include/task_config.h"
 
 #define I2C_MASTER_SCL_IO           9       /*!< GPIO number used for I2C master clock */
 #define I2C_MASTER_SDA_IO           8       /*!< GPIO number used for I2C master data  */
@@ -87,7 +90,7 @@ esp_lcd_touch_handle_t tp = NULL;
 #define EXAMPLE_LVGL_TASK_MAX_DELAY_MS 500
 #define EXAMPLE_LVGL_TASK_MIN_DELAY_MS 1
 #define EXAMPLE_LVGL_TASK_STACK_SIZE   (4 * 1024)
-#define EXAMPLE_LVGL_TASK_PRIORITY     2
+#define EXAMPLE_LVGL_TASK_PRIORITY     TASK_LVGL_PRIORITY
 
 // Global handle for the I2C master bus
 static i2c_master_bus_handle_t g_i2c_bus_handle = NULL;
@@ -103,6 +106,57 @@ SemaphoreHandle_t sem_vsync_end;
 SemaphoreHandle_t sem_gui_ready;
 #endif
 
+#if CONFIG_EXAMPLE_DOUBLE_FB
+// Given at every VSYNC: after it the panel scans out the frame buffer passed last to
+// esp_lcd_panel_draw_bitmap(), so LVGL may draw into the other one
+static SemaphoreHandle_t sem_fb_swapped = NULL;
+// A frame buffer was handed to the panel; the next VSYNC completes the flush
+static volatile bool fb_swap_pending = false;
+#endif
+
+#if !CONFIG_EXAMPLE_LVGL_SYNC_FLUSH
+// Asynchronous flush: flush_cb returns at once and the flush completes later (VSYNC
+// or flush task), while LVGL keeps drawing. Given when a flush completed.
+static SemaphoreHandle_t sem_flush_done = NULL;
+#define EXAMPLE_LVGL_FLUSH_WAIT_MS     50    // Re-check period while LVGL waits for a flush
+#if !CONFIG_EXAMPLE_DOUBLE_FB
+// Partial draw buffers are copied into the frame buffer by the flush task
+typedef struct {
+    lv_disp_drv_t *drv;
+    lv_area_t area;
+    lv_color_t *color_map;
+    bool last;                   // Last area of the frame
+} example_flush_job_t;
+
+static QueueHandle_t flush_queue = NULL;
+#define EXAMPLE_FLUSH_TASK_STACK_SIZE  (3 * 1024)
+#define EXAMPLE_FLUSH_TASK_PRIORITY    TASK_LVGL_FLUSH_PRIORITY
+#endif
+#endif // !CONFIG_EXAMPLE_LVGL_SYNC_FLUSH
+
+// Frame statistics, logged every DISPLAY_FRAME_STATS_PERIOD_MS
+#define DISPLAY_FRAME_STATS_PERIOD_MS  10000
+typedef struct {
+    uint32_t frames;
+    uint64_t render_us;          // render_start_cb to the last flush: drawing only
+    uint32_t render_max_us;
+    uint64_t refresh_ms;         // Whole refresh as LVGL measures it (sync copy, draw, swap)
+    uint64_t rendered_px;
+    uint64_t fb_bytes;           // Estimated frame buffer (PSRAM) traffic
+    uint32_t last_px;
+    int64_t render_start_us;
+    uint64_t lvgl_busy_us;       // Time in lv_timer_handler(), LVGL lock held
+    uint64_t lvgl_wait_us;       // Part of it blocked on the panel (VSYNC, flush)
+} display_frame_stats_t;
+
+static display_frame_stats_t frame_stats;
+
+#if CONFIG_EXAMPLE_LVGL_SYNC_FLUSH
+#define EXAMPLE_LVGL_FLUSH_MODE        "sync"
+#else
+#define EXAMPLE_LVGL_FLUSH_MODE        "async"
+#endif
+
 extern void example_lvgl_demo_ui(lv_disp_t *disp);
 
 static bool example_on_vsync_event(esp_lcd_panel_handle_t panel, const esp_lcd_rgb_panel_event_data_t *event_data, void *user_data)
@@ -112,24 +166,187 @@ static bool example_on_vsync_event(esp_lcd_panel_handle_t panel, const esp_lcd_r
     if (xSemaphoreTakeFromISR(sem_gui_ready, &high_task_awoken) == pdTRUE) {
         xSemaphoreGiveFromISR(sem_vsync_end, &high_task_awoken);
     }
+#endif
+#if CONFIG_EXAMPLE_DOUBLE_FB
+    xSemaphoreGiveFromISR(sem_fb_swapped, &high_task_awoken);
+#if !CONFIG_EXAMPLE_LVGL_SYNC_FLUSH
+    if (fb_swap_pending) {
+        fb_swap_pending = false;
+        lv_disp_flush_ready((lv_disp_drv_t *)user_data);
+        xSemaphoreGiveFromISR(sem_flush_done, &high_task_awoken);
+    }
+#endif
 #endif
     return high_task_awoken == pdTRUE;
 }
 
+// Called by LVGL before it draws the invalidated areas of a frame
+static void example_lvgl_render_start_cb(lv_disp_drv_t *drv)
+{
+    frame_stats.render_start_us = esp_timer_get_time();
+}
+
+#if !CONFIG_EXAMPLE_LVGL_SYNC_FLUSH
+// Called by LVGL while it waits for a flush to complete: sleep instead of spinning
+static void example_lvgl_wait_cb(lv_disp_drv_t *drv)
+{
+    int64_t start = esp_timer_get_time();
+    xSemaphoreTake(sem_flush_done, pdMS_TO_TICKS(EXAMPLE_LVGL_FLUSH_WAIT_MS));
+    frame_stats.lvgl_wait_us += esp_timer_get_time() - start;
+}
+#endif
+
+#if CONFIG_EXAMPLE_DOUBLE_FB && !CONFIG_EXAMPLE_LVGL_SYNC_FLUSH
+// LVGL's refresh timer. In direct mode LVGL copies the previous frame's areas into the
+// buffer it draws next before it checks for a pending flush, so hold the refresh until
+// the swap is done. Other LVGL timers keep running meanwhile.
+static void example_lvgl_refr_timer_cb(lv_timer_t *timer)
+{
+    lv_disp_t *disp = (lv_disp_t *)timer->user_data;
+    while (disp->driver->draw_buf->flushing) {
+        example_lvgl_wait_cb(disp->driver);
+    }
+    _lv_disp_refr_timer(timer);
+}
+#endif
+
+#if !CONFIG_EXAMPLE_DOUBLE_FB && !CONFIG_EXAMPLE_LVGL_SYNC_FLUSH
+// Copies rendered areas into the frame buffer while LVGL draws the next one into the
+// other draw buffer
+static void example_lvgl_flush_task(void *arg)
+{
+    esp_lcd_panel_handle_t panel_handle = (esp_lcd_panel_handle_t)arg;
+    example_flush_job_t job;
+    bool frame_start = true;
+
+    while (1) {
+        xQueueReceive(flush_queue, &job, portMAX_DELAY);
+#if CONFIG_EXAMPLE_AVOID_TEAR_EFFECT_WITH_SEM
+        // Start copying a frame right after VSYNC, once per frame
+        if (frame_start) {
+            xSemaphoreGive(sem_gui_ready);
+            xSemaphoreTake(sem_vsync_end, portMAX_DELAY);
+        }
+#endif
+        esp_lcd_panel_draw_bitmap(panel_handle, job.area.x1, job.area.y1, job.area.x2 + 1, job.area.y2 + 1,
+                                  job.color_map);
+        frame_start = job.last;
+        lv_disp_flush_ready(job.drv);
+        xSemaphoreGive(sem_flush_done);
+    }
+}
+#endif
+
 static void example_lvgl_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
 {
+    if (lv_disp_flush_is_last(drv) && frame_stats.render_start_us) {
+        uint32_t render_us = (uint32_t)(esp_timer_get_time() - frame_stats.render_start_us);
+        frame_stats.render_us += render_us;
+        if (render_us > frame_stats.render_max_us) {
+            frame_stats.render_max_us = render_us;
+        }
+        frame_stats.render_start_us = 0;
+    }
+#if CONFIG_EXAMPLE_DOUBLE_FB
+    // LVGL drew straight into a frame buffer (only the invalidated areas in direct mode).
+    // Nothing to copy: once the frame is complete, show it.
+    if (!lv_disp_flush_is_last(drv)) {
+        lv_disp_flush_ready(drv);
+        return;
+    }
+    esp_lcd_panel_handle_t panel_handle = (esp_lcd_panel_handle_t) drv->user_data;
+    esp_lcd_panel_draw_bitmap(panel_handle, 0, 0, drv->hor_res, drv->ver_res, color_map);
+#if CONFIG_EXAMPLE_LVGL_SYNC_FLUSH
+    if (drv->direct_mode) {
+        // LVGL swaps buffers and copies this frame's areas into the other buffer
+        // (the one on screen until now) before drawing the next frame: wait until
+        // the panel has switched. A VSYNC that came before draw_bitmap does not count.
+        int64_t start = esp_timer_get_time();
+        xSemaphoreTake(sem_fb_swapped, 0);
+        xSemaphoreTake(sem_fb_swapped, portMAX_DELAY);
+        frame_stats.lvgl_wait_us += esp_timer_get_time() - start;
+    }
+    lv_disp_flush_ready(drv);
+#else
+    // Completed by the next VSYNC (set after draw_bitmap, so an earlier VSYNC cannot)
+    fb_swap_pending = true;
+#endif
+#elif CONFIG_EXAMPLE_LVGL_SYNC_FLUSH
     esp_lcd_panel_handle_t panel_handle = (esp_lcd_panel_handle_t) drv->user_data;
-    int offsetx1 = area->x1;
-    int offsetx2 = area->x2;
-    int offsety1 = area->y1;
-    int offsety2 = area->y2;
 #if CONFIG_EXAMPLE_AVOID_TEAR_EFFECT_WITH_SEM
+    int64_t start = esp_timer_get_time();
     xSemaphoreGive(sem_gui_ready);
     xSemaphoreTake(sem_vsync_end, portMAX_DELAY);
+    frame_stats.lvgl_wait_us += esp_timer_get_time() - start;
 #endif
     // pass the draw buffer to the driver
-    esp_lcd_panel_draw_bitmap(panel_handle, offsetx1, offsety1, offsetx2 + 1, offsety2 + 1, color_map);
+    esp_lcd_panel_draw_bitmap(panel_handle, area->x1, area->y1, area->x2 + 1, area->y2 + 1, color_map);
     lv_disp_flush_ready(drv);
+#else
+    // Hand the area to the flush task; LVGL draws the next one into the other buffer
+    example_flush_job_t job = {
+        .drv = drv,
+        .area = *area,
+        .color_map = color_map,
+        .last = lv_disp_flush_is_last(drv),
+    };
+    xQueueSend(flush_queue, &job, portMAX_DELAY);
+#endif
+}
+
+// Called by LVGL after a refresh that redrew something
+static void example_lvgl_monitor_cb(lv_disp_drv_t *drv, uint32_t time, uint32_t px)
+{
+    frame_stats.frames++;
+    frame_stats.refresh_ms += time;
+    frame_stats.rendered_px += px;
+    // Drawing writes every rendered pixel. In direct mode the next refresh also copies
+    // these areas from the shown buffer to the other one (read + write, an upper bound:
+    // parts that get redrawn anyway are not copied).
+    frame_stats.fb_bytes += (uint64_t)px * sizeof(lv_color_t);
+    if (drv->direct_mode) {
+        frame_stats.fb_bytes += (uint64_t)frame_stats.last_px * sizeof(lv_color_t) * 2;
+    }
+    frame_stats.last_px = px;
+
+    ui_updates_frame_rendered();
+}
+
+// Log the frame statistics of the last period. With CONFIG_EXAMPLE_FRAME_BENCH the double
+// frame buffer refresh mode is switched each period, to compare both on the same UI.
+static void example_lvgl_frame_stats_cb(lv_timer_t *timer)
+{
+    lv_disp_t *disp = (lv_disp_t *)timer->user_data;
+    lv_disp_drv_t *drv = disp->driver;
+    uint32_t frames = frame_stats.frames;
+
+    if (frames) {
+        ESP_LOGI(DISPLAY_TAG, "%s, %s flush: %lu fps, render avg %lu us max %lu us, refresh avg %lu ms, "
+                 "%lu px/frame, frame buffer traffic ~%lu KB/s",
+                 drv->full_refresh ? "full refresh" : (drv->direct_mode ? "direct (dirty areas)" : "partial"),
+                 EXAMPLE_LVGL_FLUSH_MODE,
+                 (unsigned long)(frames * 1000 / DISPLAY_FRAME_STATS_PERIOD_MS),
+                 (unsigned long)(frame_stats.render_us / frames),
+                 (unsigned long)frame_stats.render_max_us,
+                 (unsigned long)(frame_stats.refresh_ms / frames),
+                 (unsigned long)(frame_stats.rendered_px / frames),
+                 (unsigned long)(frame_stats.fb_bytes * 1000 / DISPLAY_FRAME_STATS_PERIOD_MS / 1024));
+        // LVGL task load: lock held (UI updates from other tasks wait) and CPU actually used
+        ESP_LOGI(DISPLAY_TAG, "LVGL task: lock held %lu%%, CPU %lu%%, blocked on panel %lu ms",
+                 (unsigned long)(frame_stats.lvgl_busy_us / (DISPLAY_FRAME_STATS_PERIOD_MS * 10)),
+                 (unsigned long)((frame_stats.lvgl_busy_us - frame_stats.lvgl_wait_us) / (DISPLAY_FRAME_STATS_PERIOD_MS * 10)),
+                 (unsigned long)(frame_stats.lvgl_wait_us / 1000));
+    }
+    memset(&frame_stats, 0, sizeof(frame_stats));
+
+#if CONFIG_EXAMPLE_DOUBLE_FB && CONFIG_EXAMPLE_FRAME_BENCH
+    // Both buffers must hold the same image before direct mode draws only the changes:
+    // the full redraw below gives the buffer LVGL draws next the whole screen, and its
+    // areas are copied to the other one on the frame after.
+    drv->full_refresh = !drv->full_refresh;
+    drv->direct_mode = !drv->full_refresh;
+    lv_obj_invalidate(lv_disp_get_scr_act(disp));
+#endif
 }
 
 static void example_increase_lvgl_tick(void *arg)
@@ -158,7 +375,9 @@ static void example_lvgl_port_task(void *arg)
     while (1) {
         // Lock the mutex due to the LVGL APIs are not thread-safe
         if (example_lvgl_lock(-1)) {
+            int64_t start = esp_timer_get_time();
             task_delay_ms = lv_timer_handler();
+            frame_stats.lvgl_busy_us += esp_timer_get_time() - start;
             // Release the mutex
             example_lvgl_unlock();
         }
@@ -246,6 +465,14 @@ void display(void)
     sem_gui_ready = xSemaphoreCreateBinary();
     assert(sem_gui_ready);
 #endif
+#if CONFIG_EXAMPLE_DOUBLE_FB
+    sem_fb_swapped = xSemaphoreCreateBinary();
+    assert(sem_fb_swapped);
+#endif
+#if !CONFIG_EXAMPLE_LVGL_SYNC_FLUSH
+    sem_flush_done = xSemaphoreCreateBinary();
+    assert(sem_flush_done);
+#endif
 
 #if EXAMPLE_PIN_NUM_BK_LIGHT >= 0
     ESP_LOGI(DISPLAY_TAG, "Turn off LCD backlight");
@@ -416,6 +643,15 @@ void display(void)
     ESP_LOGI(DISPLAY_TAG, "Allocate separate LVGL draw buffers from PSRAM");
     buf1 = heap_caps_malloc(EXAMPLE_LCD_H_RES * 100 * sizeof(lv_color_t), MALLOC_CAP_SPIRAM);
     assert(buf1);
+#if !CONFIG_EXAMPLE_LVGL_SYNC_FLUSH
+    // Second buffer: LVGL draws into one while the flush task copies the other
+    buf2 = heap_caps_malloc(EXAMPLE_LCD_H_RES * 100 * sizeof(lv_color_t), MALLOC_CAP_SPIRAM);
+    assert(buf2);
+    flush_queue = xQueueCreate(1, sizeof(example_flush_job_t));
+    assert(flush_queue);
+    xTaskCreatePinnedToCore(example_lvgl_flush_task, "LVGL flush", EXAMPLE_FLUSH_TASK_STACK_SIZE, panel_handle,
+                            EXAMPLE_FLUSH_TASK_PRIORITY, NULL, TASK_CORE_RENDER);
+#endif
     // initialize LVGL draw buffers
     lv_disp_draw_buf_init(&disp_buf, buf1, buf2, EXAMPLE_LCD_H_RES * 100);
 #endif // CONFIG_EXAMPLE_DOUBLE_FB
@@ -425,12 +661,25 @@ void display(void)
     disp_drv.hor_res = EXAMPLE_LCD_H_RES;
     disp_drv.ver_res = EXAMPLE_LCD_V_RES;
     disp_drv.flush_cb = example_lvgl_flush_cb;
+    disp_drv.render_start_cb = example_lvgl_render_start_cb;
+#if !CONFIG_EXAMPLE_LVGL_SYNC_FLUSH
+    disp_drv.wait_cb = example_lvgl_wait_cb;
+#endif
+    disp_drv.monitor_cb = example_lvgl_monitor_cb;
     disp_drv.draw_buf = &disp_buf;
     disp_drv.user_data = panel_handle;
-#if CONFIG_EXAMPLE_DOUBLE_FB
-    disp_drv.full_refresh = true; // the full_refresh mode can maintain the synchronization between the two frame buffers
+#if CONFIG_EXAMPLE_DOUBLE_FB_FULL_REFRESH
+    disp_drv.full_refresh = true; // Redraw the whole frame into each buffer
+#elif CONFIG_EXAMPLE_DOUBLE_FB
+    // Draw only the invalidated areas, straight into the frame buffers. LVGL keeps the two
+    // buffers in sync by copying the previous frame's areas before drawing (see flush_cb).
+    disp_drv.direct_mode = true;
 #endif
     lv_disp_t *disp = lv_disp_drv_register(&disp_drv);
+#if CONFIG_EXAMPLE_DOUBLE_FB && !CONFIG_EXAMPLE_LVGL_SYNC_FLUSH
+    lv_timer_set_cb(disp->refr_timer, example_lvgl_refr_timer_cb);
+#endif
+    lv_timer_create(example_lvgl_frame_stats_cb, DISPLAY_FRAME_STATS_PERIOD_MS, disp);
 
     ESP_LOGI(DISPLAY_TAG, "Install LVGL tick timer");
     // Tick interface for LVGL (using esp_timer to generate 2ms periodic event)
@@ -461,7 +710,8 @@ void display(void)
     lvgl_mux = xSemaphoreCreateRecursiveMutex();
     assert(lvgl_mux);
     ESP_LOGI(DISPLAY_TAG, "Create LVGL task");
-    xTaskCreate(example_lvgl_port_task, "LVGL", EXAMPLE_LVGL_TASK_STACK_SIZE, NULL, EXAMPLE_LVGL_TASK_PRIORITY, NULL);
+    xTaskCreatePinnedToCore(example_lvgl_port_task, "LVGL", EXAMPLE_LVGL_TASK_STACK_SIZE, NULL,
+                            EXAMPLE_LVGL_TASK_PRIORITY, NULL, TASK_CORE_RENDER);
 
     ESP_LOGI(DISPLAY_TAG, "Display LVGL Scatter Chart");
     
@@ -469,6 +719,9 @@ void display(void)
     if (example_lvgl_lock(-1)) {
 
         ui_init(); // Initialize UI
+#if CONFIG_EXAMPLE_DIGITS_BENCH
+        ui_digits_benchmark(10000, NULL);
+#endif
         
         // Initialize screen manager for swipe gestures and navigation
         extern void ui_screen_manager_init(void);
@@ -0,0 +1,75 @@
+#ifndef SD_LOG_FILE_H
+#define SD_LOG_FILE_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Pre-allocated log files for long logging sessions.
+ *
+ * The whole file is allocated as one contiguous cluster chain when it is created and
+ * then overwritten front to back in whole sectors. Writes never allocate clusters or
+ * update the FAT, so their latency stays flat however long the session runs; the
+ * allocation cost is paid once in sd_log_file_create(). Closing the file truncates it
+ * to the bytes written. After a power loss the file keeps its full size and the unwritten
+ * tail holds whatever was on the card before, so the format written into it has to
+ * record its own length (see sd_log_file_rewrite()).
+ */
+
+#define SD_LOG_FILE_SECTOR 512
+
+typedef struct {
+    int fd;
+    uint32_t size;          // Bytes allocated
+    uint32_t written;       // Bytes written from the start of the file
+    bool preallocated;      // false if no contiguous space was found: the file grows per write
+} sd_log_file_t;
+
+/**
+ * @brief Creates (or replaces) a log file of size bytes on a mounted FAT volume.
+ *
+ * @param file  File state, initialised here.
+ * @param path  Full path; its first component is the mount point (e.g. "/sdcard/logs/x.bin").
+ * @param size  Bytes to allocate, a multiple of SD_LOG_FILE_SECTOR.
+ * @return ESP_OK, also when contiguous allocation failed and the file was created empty
+ *         (file->preallocated is false), or an error code if it could not be created.
+ */
+esp_err_t sd_log_file_create(sd_log_file_t *file, const char *path, uint32_t size);
+
+/**
+ * @brief Appends len bytes at file->written.
+ *
+ * @param len A multiple of SD_LOG_FILE_SECTOR, so writes stay sector aligned.
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if the data does not fit in the allocated size,
+ *         ESP_FAIL if the write failed.
+ */
+esp_err_t sd_log_file_write(sd_log_file_t *file, const void *data, size_t len);
+
+/**
+ * @brief Overwrites data that was already written, e.g. a header with the current length.
+ *
+ * @param offset Sector aligned offset; offset + len must not exceed file->written.
+ */
+esp_err_t sd_log_file_rewrite(sd_log_file_t *file, uint32_t offset, const void *data, size_t len);
+
+/**
+ * @brief Flushes written data to the card.
+ */
+esp_err_t sd_log_file_sync(sd_log_file_t *file);
+
+/**
+ * @brief Truncates the file to the bytes written and closes it.
+ */
+esp_err_t sd_log_file_close(sd_log_file_t *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SD_LOG_FILE_H
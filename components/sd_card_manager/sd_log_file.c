@@ -0,0 +1,97 @@
+/*
+ * Pre-allocated log files, see include/sd_log_file.h
+ * Kept free of the SPI/SDMMC driver (plain file descriptors on the mounted volume) so it
+ * also builds on the host.
+ */
+
+#include "include/sd_log_file.h"
+#include "esp_log.h"
+#include "esp_vfs_fat.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char *TAG = "SD_LOG_FILE";
+
+esp_err_t sd_log_file_create(sd_log_file_t *file, const char *path, uint32_t size) {
+    if (!file || !path || path[0] != '/' || size == 0 || size % SD_LOG_FILE_SECTOR != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Mount point: the first path component
+    char base_path[16];
+    const char *end = strchr(path + 1, '/');
+    size_t base_len = end ? (size_t)(end - path) : 0;
+    if (base_len == 0 || base_len >= sizeof(base_path)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(base_path, path, base_len);
+    base_path[base_len] = '\0';
+
+    memset(file, 0, sizeof(*file));
+    file->fd = -1;
+    file->size = size;
+
+    // f_expand() only works on an empty file
+    unlink(path);
+    esp_err_t ret = esp_vfs_fat_create_contiguous_file(base_path, path, size, true);
+    if (ret == ESP_OK) {
+        file->preallocated = true;
+        file->fd = open(path, O_WRONLY);
+    } else {
+        // Fragmented or nearly full card: still log, with the allocation cost per write
+        ESP_LOGW(TAG, "No contiguous %lu KB for %s (%s), allocating while writing",
+                 (unsigned long)(size / 1024), path, esp_err_to_name(ret));
+        file->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    }
+    if (file->fd < 0) {
+        ESP_LOGE(TAG, "Cannot open %s", path);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t sd_log_file_write(sd_log_file_t *file, const void *data, size_t len) {
+    if (!file || file->fd < 0 || len % SD_LOG_FILE_SECTOR != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len > file->size - file->written) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (write(file->fd, data, len) != (ssize_t)len) {
+        return ESP_FAIL;
+    }
+    file->written += len;
+    return ESP_OK;
+}
+
+esp_err_t sd_log_file_rewrite(sd_log_file_t *file, uint32_t offset, const void *data, size_t len) {
+    if (!file || file->fd < 0 || offset % SD_LOG_FILE_SECTOR != 0 || len > file->written ||
+        offset > file->written - len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return pwrite(file->fd, data, len, offset) == (ssize_t)len ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t sd_log_file_sync(sd_log_file_t *file) {
+    if (!file || file->fd < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return fsync(file->fd) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t sd_log_file_close(sd_log_file_t *file) {
+    if (!file || file->fd < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Release the allocated but unused clusters
+    esp_err_t ret = ESP_OK;
+    if (file->preallocated && file->written < file->size && ftruncate(file->fd, file->written) != 0) {
+        ret = ESP_FAIL;
+    }
+    if (close(file->fd) != 0) {
+        ret = ESP_FAIL;
+    }
+    file->fd = -1;
+    return ret;
+}
@@ -0,0 +1,400 @@
+// CAN pipeline benchmark: synthetic bus traffic through the decoder, the fan-out, the statistics
+// and the sniffer, the way canbus_task() and the Screen3 refresh run them. Prints one JSON line
+// for the traffic and one per stage: frames/s of CPU time, p50/p99/max time per frame and
+// the heap allocations made while running. Fails if the steady state allocates or the
+// sniffer queue drops frames.
+//   bench_can_pipeline [-n frames] [-s rate scale] [-j jitter %] [-p stream file] [-r trace] [-i interface]
+// Stream file lines: "<id> <period ms> <dlc> [burst]" (see can_traffic.h).
+// A trace (binary, candump or ASC, see can_replay.h) replaces the synthetic traffic: its
+// frames are replayed at full speed, in full batches, up to -n frames.
+// A SocketCAN interface takes live frames instead (e.g. cangen -g 0 vcan0) until -n frames
+// or a second without traffic; fails if the socket buffer overflowed. Bus load is rated at
+// the bit rate of the traffic profile.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sdkconfig.h"
+#include "can_traffic.h"
+#include "ecu_data.h"
+#include "include/can_parser.h"
+#include "include/can_fanout.h"
+#include "include/can_sniffer.h"
+#include "include/can_stats.h"
+#include "include/can_replay.h"
+#include "can_transport_socketcan.h"
+#include "esp_timer.h"
+
+#define LIVE_WAIT_MS    10000   // For the first frame of a live interface
+#define LIVE_IDLE_MS    1000    // Without frames after that: the sender stopped
+#include "include/dbc_loader.h"
+
+typedef struct {
+    const char *name;
+    const char *unit;       // What frames counts: "frame", or "read" for the store reads
+    uint32_t *samples;      // ns per unit
+    size_t count;
+    size_t capacity;
+    uint64_t frames;
+    uint64_t total_ns;
+    uint32_t allocs;
+    uint64_t alloc_bytes;
+} stage_t;
+
+enum { STAGE_CAN_TASK, STAGE_DECODE, STAGE_FANOUT, STAGE_STATS, STAGE_STORE_READ, STAGE_SNIFFER_POLL, STAGE_SNIFFER_FORMAT, STAGE_COUNT };
+
+static stage_t s_stages[STAGE_COUNT] = {
+    [STAGE_CAN_TASK]       = { .name = "can_task" },        // Decode, fan-out and statistics of a batch, per frame
+    [STAGE_DECODE]         = { .name = "decode" },          // parse_can_frame() incl. the ECU data store write
+    [STAGE_FANOUT]         = { .name = "fanout" },          // can_fanout_publish() of a batch, per frame
+    [STAGE_STATS]          = { .name = "stats" },           // can_stats_add() of a batch, per frame
+    [STAGE_STORE_READ]     = { .name = "store_read", .unit = "read" }, // UI side ecu_data_get_snapshot(), once per batch
+    [STAGE_SNIFFER_POLL]   = { .name = "sniffer_poll" },    // can_sniffer_poll(), per frame taken
+    [STAGE_SNIFFER_FORMAT] = { .name = "sniffer_format" },  // can_sniffer_format_frame() of every frame
+};
+
+// ---- Allocation counting: the static libraries are linked with --wrap=malloc,... ----
+static stage_t *s_alloc_stage = NULL;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static void count_alloc(size_t size)
+{
+    if (s_alloc_stage) {
+        s_alloc_stage->allocs++;
+        s_alloc_stage->alloc_bytes += size;
+    }
+}
+
+void *__wrap_malloc(size_t size)
+{
+    count_alloc(size);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    count_alloc(n * size);
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    count_alloc(size);
+    return __real_realloc(ptr, size);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void stage_init(stage_t *stage, size_t capacity)
+{
+    stage->samples = __real_malloc(capacity * sizeof(uint32_t));
+    stage->capacity = stage->samples ? capacity : 0;
+}
+
+static void stage_add(stage_t *stage, uint64_t ns, uint32_t frames)
+{
+    stage->frames += frames;
+    stage->total_ns += ns;
+    if (stage->count < stage->capacity) {
+        stage->samples[stage->count++] = (uint32_t)(frames ? ns / frames : ns);
+    }
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint32_t percentile(const stage_t *stage, double p)
+{
+    if (stage->count == 0) return 0;
+    size_t index = (size_t)(p * (stage->count - 1) + 0.5);
+    return stage->samples[index];
+}
+
+static void stage_print(stage_t *stage)
+{
+    qsort(stage->samples, stage->count, sizeof(uint32_t), compare_u32);
+    printf("{\"stage\":\"%s\",\"unit\":\"%s\",\"frames\":%llu,\"samples\":%zu,\"frames_per_s\":%.0f,"
+           "\"p50_ns\":%u,\"p99_ns\":%u,\"max_ns\":%u,\"allocs\":%u,\"alloc_bytes\":%llu}\n",
+           stage->name, stage->unit ? stage->unit : "frame", (unsigned long long)stage->frames, stage->count,
+           stage->total_ns ? stage->frames * 1e9 / stage->total_ns : 0.0,
+           percentile(stage, 0.50), percentile(stage, 0.99),
+           stage->count ? stage->samples[stage->count - 1] : 0,
+           stage->allocs, (unsigned long long)stage->alloc_bytes);
+}
+
+// The next batch of a trace, stamped with the time of each frame in the trace: the first
+// call anchors the replay at 0, later ones pass a clock far ahead so every frame is due.
+static size_t next_from_trace(can_replay_t *replay, can_frame_t *frames, size_t max)
+{
+    size_t count = 0;
+    int64_t now_us = replay->anchored ? INT64_MAX / 2 : 0;
+    return can_replay_receive_batch(replay, frames, max, &count, now_us, NULL) == ESP_OK ? count : 0;
+}
+
+// The next batch of a live transport; 0 once it was quiet for too long or failed
+static size_t next_from_transport(can_transport_t *transport, can_frame_t *frames, size_t max, bool started)
+{
+    int64_t limit_us = (started ? LIVE_IDLE_MS : LIVE_WAIT_MS) * 1000LL;
+    int64_t start = esp_timer_get_time();
+    size_t count = 0;
+    while (can_transport_receive_batch(transport, frames, max, &count, pdMS_TO_TICKS(100)) == ESP_ERR_TIMEOUT) {
+        if (esp_timer_get_time() - start >= limit_us) {
+            return 0;
+        }
+    }
+    return count;
+}
+
+static char *read_file(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *text = size >= 0 ? malloc(size + 1) : NULL;
+    if (text) {
+        text[fread(text, 1, size, f)] = '\0';
+    }
+    fclose(f);
+    return text;
+}
+
+// Everything queued for the sniffer: poll it and format each frame as the terminal would
+static void run_sniffer(void)
+{
+    static can_frame_t visible[CAN_SNIFFER_RING_SIZE];
+    char row[256];
+
+    s_alloc_stage = &s_stages[STAGE_SNIFFER_POLL];
+    uint64_t start = now_ns();
+    size_t taken = can_sniffer_poll();
+    uint64_t poll_ns = now_ns() - start;
+    if (taken) stage_add(&s_stages[STAGE_SNIFFER_POLL], poll_ns, taken);
+
+    size_t count = can_sniffer_snapshot(visible, taken < CAN_SNIFFER_RING_SIZE ? taken : CAN_SNIFFER_RING_SIZE);
+    s_alloc_stage = &s_stages[STAGE_SNIFFER_FORMAT];
+    for (size_t i = 0; i < count; i++) {
+        start = now_ns();
+        can_sniffer_format_frame(&visible[i], row, sizeof(row));
+        stage_add(&s_stages[STAGE_SNIFFER_FORMAT], now_ns() - start, 1);
+    }
+    s_alloc_stage = NULL;
+}
+
+int main(int argc, char **argv)
+{
+    can_traffic_config_t config;
+    can_traffic_config_vw_powertrain(&config);
+    static can_traffic_stream_t file_streams[CAN_TRAFFIC_MAX_STREAMS];
+    uint32_t frames = 200000;
+    const char *trace = NULL;
+    const char *interface = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:j:p:r:i:")) != -1) {
+        switch (opt) {
+        case 'n': frames = (uint32_t)atoi(optarg); break;
+        case 's': config.rate_scale = (float)atof(optarg); break;
+        case 'j': config.jitter_pct = (uint8_t)atoi(optarg); break;
+        case 'p': {
+            char *text = read_file(optarg);
+            esp_err_t ret = text ? can_traffic_parse_streams(text, file_streams, CAN_TRAFFIC_MAX_STREAMS,
+                                                             &config.stream_count) : ESP_ERR_NOT_FOUND;
+            free(text);
+            if (ret != ESP_OK) {
+                printf("FAIL: cannot read streams from %s: %s\n", optarg, esp_err_to_name(ret));
+                return 1;
+            }
+            config.streams = file_streams;
+            config.name = optarg;
+            break;
+        }
+        case 'r': trace = optarg; break;
+        case 'i': interface = optarg; break;
+        default:
+            printf("usage: %s [-n frames] [-s rate scale] [-j jitter %%] [-p stream file] [-r trace] [-i interface]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+    if (frames < 1000) frames = 1000;
+
+    can_traffic_t traffic;
+    if (can_traffic_init(&traffic, &config) != ESP_OK) {
+        printf("FAIL: invalid traffic configuration\n");
+        return 1;
+    }
+    static can_replay_t replay;
+    if (trace) {
+        can_replay_config_t replay_config = { .format = CAN_REPLAY_FORMAT_AUTO, .speed = 1.0f };
+        esp_err_t ret = can_replay_open(&replay, trace, &replay_config);
+        if (ret != ESP_OK) {
+            printf("FAIL: cannot replay %s: %s\n", trace, esp_err_to_name(ret));
+            return 1;
+        }
+    }
+    static can_transport_t live;
+    if (interface) {
+        esp_err_t ret = can_transport_socketcan_open(&live, interface);
+        if (ret != ESP_OK || can_transport_start(&live) != ESP_OK) {
+            printf("FAIL: cannot receive from %s: %s\n", interface, esp_err_to_name(ret));
+            return 1;
+        }
+    }
+    // Frames of the sample DBC get decoded into the DBC COMMENTS column
+    if (can_parser_init() != ESP_OK || dbc_loader_load_file(HOST_DBC_DIR "/sample_vw.dbc") != ESP_OK ||
+        can_sniffer_init() != ESP_OK || can_stats_init(config.bitrate) != ESP_OK) {
+        printf("FAIL: cannot set up the parser, the sample DBC, the sniffer or the statistics\n");
+        return 1;
+    }
+    ecu_data_init();
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        stage_init(&s_stages[i], frames);
+    }
+
+    static can_frame_t batch[CONFIG_CANBUS_RX_BATCH_SIZE];
+    ecu_data_t snapshot;
+    int64_t next_poll_us = CAN_SNIFFER_POLL_MS * 1000;
+    int64_t bus_us = 0;
+    int64_t origin_us = 0;      // Live frames carry the time they were received
+
+    uint32_t done = 0;
+    while (done < frames) {
+        size_t count = frames - done < CONFIG_CANBUS_RX_BATCH_SIZE ? frames - done : CONFIG_CANBUS_RX_BATCH_SIZE;
+        if (interface) {
+            count = next_from_transport(&live, batch, count, done > 0);
+            if (count == 0) {
+                break;
+            }
+            if (done == 0) {
+                origin_us = batch[0].timestamp_us;
+                next_poll_us += origin_us;
+            }
+        } else if (trace) {
+            count = next_from_trace(&replay, batch, count);
+            if (count == 0) {
+                break;
+            }
+        } else {
+            can_traffic_next(&traffic, batch, count);
+        }
+        bus_us = batch[count - 1].timestamp_us - origin_us;
+
+        // CAN task: decode every frame of the batch, then one fan-out publish
+        uint64_t batch_start = now_ns();
+        s_alloc_stage = &s_stages[STAGE_DECODE];
+        for (size_t i = 0; i < count; i++) {
+            uint64_t start = now_ns();
+            parse_can_frame(&batch[i]);
+            stage_add(&s_stages[STAGE_DECODE], now_ns() - start, 1);
+        }
+        s_alloc_stage = &s_stages[STAGE_FANOUT];
+        uint64_t start = now_ns();
+        can_fanout_publish(batch, count);
+        uint64_t end = now_ns();
+        stage_add(&s_stages[STAGE_FANOUT], end - start, count);
+        s_alloc_stage = &s_stages[STAGE_STATS];
+        start = end;
+        can_stats_add(batch, count);
+        end = now_ns();
+        stage_add(&s_stages[STAGE_STATS], end - start, count);
+        stage_add(&s_stages[STAGE_CAN_TASK], end - batch_start, count);
+
+        // UI task reads the store once per batch (an upper bound of its wake-ups)
+        s_alloc_stage = &s_stages[STAGE_STORE_READ];
+        start = now_ns();
+        ecu_data_get_snapshot(&snapshot, NULL);
+        stage_add(&s_stages[STAGE_STORE_READ], now_ns() - start, 1);
+        s_alloc_stage = NULL;
+
+        // Sniffer drains its queue every CAN_SNIFFER_POLL_MS of bus time
+        if (bus_us + origin_us >= next_poll_us) {
+            run_sniffer();
+            next_poll_us += CAN_SNIFFER_POLL_MS * 1000;
+        }
+        done += count;
+    }
+    run_sniffer();
+
+    double bus_load = can_traffic_bus_load(&config);
+    uint32_t live_missed = 0;
+    if (trace || interface) {
+        const char *source = interface ? interface : trace;
+        if (interface) {
+            can_transport_stats_t live_stats;
+            can_transport_get_stats(&live, &live_stats);
+            can_transport_close(&live);
+            live_missed = live_stats.rx_missed;
+            printf("{\"transport\":\"%s\",\"interface\":\"%s\",\"frames\":%u,\"batches\":%u,\"max_batch\":%u,"
+                   "\"rx_missed\":%u,\"bus_errors\":%u,\"skipped\":%u}\n",
+                   live_stats.name, interface, (unsigned)live_stats.frames_received, (unsigned)live_stats.batches,
+                   (unsigned)live_stats.max_batch, (unsigned)live_stats.rx_missed, (unsigned)live_stats.bus_errors,
+                   (unsigned)live_stats.skipped);
+        } else {
+            can_replay_stats_t replay_stats;
+            can_replay_get_stats(&replay, &replay_stats);
+            can_replay_close(&replay);
+            printf("{\"replay\":\"%s\",\"format\":\"%s\",\"frames\":%u,\"skipped\":%u,\"recorder_lost\":%u}\n",
+                   trace, can_replay_format_name(replay_stats.format), (unsigned)replay_stats.frames,
+                   (unsigned)replay_stats.skipped, (unsigned)replay_stats.recorder_lost);
+        }
+        if (done == 0) {
+            printf("FAIL: no frames from %s\n", source);
+            return 1;
+        }
+        // Bus figures of the recording or the live run: its duration and the counted bits on the wire
+        can_stats_bus_t bus;
+        can_stats_snapshot(&bus, NULL, 0, 0);
+        frames = done;
+        bus_us = bus_us > 0 ? bus_us : 1;
+        bus_load = (double)bus.bits * 1e6 / bus_us / config.bitrate;
+        config.name = source;
+        config.stream_count = bus.ids;
+    }
+
+    printf("{\"traffic\":\"%s\",\"streams\":%zu,\"frames\":%u,\"bus_s\":%.3f,\"bus_frames_per_s\":%.0f,"
+           "\"bus_load_pct\":%.1f,\"rate_scale\":%.2f,\"jitter_pct\":%u,\"batch\":%d}\n",
+           config.name, config.stream_count, frames, bus_us / 1e6, frames * 1e6 / bus_us,
+           100 * bus_load, config.rate_scale, config.jitter_pct,
+           CONFIG_CANBUS_RX_BATCH_SIZE);
+
+    uint32_t allocs = 0;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        stage_print(&s_stages[i]);
+        allocs += s_stages[i].allocs;
+    }
+
+    int failures = 0;
+    if (allocs != 0) {
+        printf("FAIL: %u heap allocations while processing frames\n", allocs);
+        failures++;
+    }
+    if (live_missed != 0) {
+        printf("FAIL: the socket buffer of %s dropped %u frames\n", interface, (unsigned)live_missed);
+        failures++;
+    }
+    if (can_sniffer_dropped() != 0) {
+        printf("FAIL: sniffer queue dropped %u frames\n", (unsigned)can_sniffer_dropped());
+        failures++;
+    }
+    // The CAN task has a whole core on the device; on the host it must at least keep up with the bus
+    double can_task_fps = s_stages[STAGE_CAN_TASK].frames * 1e9 / s_stages[STAGE_CAN_TASK].total_ns;
+    if (can_task_fps < frames * 1e6 / bus_us) {
+        printf("FAIL: CAN task processes %.0f frames/s, the bus delivers %.0f\n", can_task_fps, frames * 1e6 / bus_us);
+        failures++;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+// Bus-load replay benchmark for the CAN receive path.
+// A bus thread delivers back-to-back frames at 500 kbit/s (100% bus load) into the
+// simulated TWAI RX queue while the consumer runs either the batch drain used by
+// canbus_task() or the old receive-one-then-sleep loop. Fails if the batch drain
+// loses frames.
+//   bench_can_rx [seconds]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "include/canbus.h"
+#include "include/can_parser.h"
+
+#define BUS_BITRATE         500000
+#define BUS_FRAME_DLC       8
+
+// Data frame with 11-bit ID incl. interframe space, without stuff bits (shortest frame = most frames/s)
+#define STD_FRAME_BITS(dlc) (47 + 8 * (dlc))
+
+typedef enum {
+    CONSUMER_BATCH,
+    CONSUMER_LEGACY,   // twai_receive() one frame, then vTaskDelay(10 ms)
+} consumer_mode_t;
+
+typedef struct {
+    double seconds;
+    volatile bool done;
+    uint32_t delivered;
+    uint32_t offered;
+} bus_ctx_t;
+
+// IDs of the built-in VW signals, replayed round robin
+static const uint32_t s_replay_ids[] = { 0x280, 0x288, 0x390, 0x394, 0x488, 0x580 };
+
+static void *bus_thread(void *arg)
+{
+    bus_ctx_t *ctx = arg;
+    const double frame_us = STD_FRAME_BITS(BUS_FRAME_DLC) * 1e6 / BUS_BITRATE;
+    const int64_t start = esp_timer_get_time();
+    const uint32_t total = (uint32_t)(ctx->seconds * 1e6 / frame_us);
+    uint32_t seed = 1;
+
+    while (ctx->offered < total) {
+        // Deliver every frame whose end of frame has passed on the bus
+        int64_t now = esp_timer_get_time() - start;
+        while (ctx->offered < total && ctx->offered * frame_us <= (double)now) {
+            twai_message_t msg = {0};
+            msg.identifier = s_replay_ids[ctx->offered % (sizeof(s_replay_ids) / sizeof(s_replay_ids[0]))];
+            msg.data_length_code = BUS_FRAME_DLC;
+            for (int i = 0; i < BUS_FRAME_DLC; i++) {
+                seed = seed * 1103515245u + 12345u;
+                msg.data[i] = (uint8_t)(seed >> 16);
+            }
+            if (twai_sim_deliver(&msg)) ctx->delivered++;
+            ctx->offered++;
+        }
+        struct timespec ts = { .tv_sec = 0, .tv_nsec = 50000 };
+        nanosleep(&ts, NULL);
+    }
+    ctx->done = true;
+    return NULL;
+}
+
+static int run(consumer_mode_t mode, double seconds)
+{
+    twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT(0, 0, TWAI_MODE_LISTEN_ONLY);
+    twai_timing_config_t t_config = TWAI_TIMING_CONFIG_500KBITS();
+    twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+    g_config.rx_queue_len = CONFIG_CANBUS_RX_QUEUE_LEN;
+    if (twai_driver_install(&g_config, &t_config, &f_config) != ESP_OK || twai_start() != ESP_OK) {
+        printf("Failed to start simulated TWAI driver\n");
+        return -1;
+    }
+
+    bus_ctx_t ctx = { .seconds = seconds };
+    pthread_t bus;
+    pthread_create(&bus, NULL, bus_thread, &ctx);
+
+    static can_frame_t batch[CONFIG_CANBUS_RX_BATCH_SIZE];
+    uint32_t received = 0;
+    const int64_t start = esp_timer_get_time();
+
+    while (1) {
+        bool bus_done = ctx.done;
+        if (mode == CONSUMER_BATCH) {
+            size_t count = 0;
+            if (canbus_receive_batch(batch, CONFIG_CANBUS_RX_BATCH_SIZE, &count, pdMS_TO_TICKS(100)) == ESP_OK) {
+                for (size_t i = 0; i < count; i++) parse_can_frame(&batch[i]);
+                received += count;
+                continue;
+            }
+        } else {
+            twai_message_t msg;
+            if (twai_receive(&msg, pdMS_TO_TICKS(100)) == ESP_OK) {
+                parse_can_message(&msg);
+                received++;
+                vTaskDelay(pdMS_TO_TICKS(10));
+                continue;
+            }
+        }
+        if (bus_done) break;
+    }
+    const int64_t elapsed_us = esp_timer_get_time() - start;
+    pthread_join(bus, NULL);
+
+    canbus_stats_t after;
+    canbus_get_stats(&after);
+    twai_stop();
+    twai_driver_uninstall();
+
+    const double frame_us = STD_FRAME_BITS(BUS_FRAME_DLC) * 1e6 / BUS_BITRATE;
+    printf("{\"mode\":\"%s\",\"bus_load_pct\":100,\"bitrate\":%d,\"frames_per_s\":%.0f,"
+           "\"offered\":%u,\"received\":%u,\"rx_missed\":%u,\"max_batch\":%u,\"elapsed_ms\":%.1f}\n",
+           mode == CONSUMER_BATCH ? "batch" : "legacy", BUS_BITRATE, 1e6 / frame_us,
+           ctx.offered, received, after.rx_missed, mode == CONSUMER_BATCH ? after.max_batch : 1,
+           elapsed_us / 1000.0);
+
+    return (int)after.rx_missed;
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    if (seconds <= 0) seconds = 2.0;
+
+    if (can_parser_init() != ESP_OK) return 1;
+    ecu_data_init();
+
+    // Reference: the old loop, limited to one frame per 10 ms tick
+    int legacy_missed = run(CONSUMER_LEGACY, seconds < 1.0 ? seconds : 1.0);
+    int batch_missed = run(CONSUMER_BATCH, seconds);
+
+    if (batch_missed != 0) {
+        printf("FAIL: batch receive lost %d frames at 100%% bus load\n", batch_missed);
+        return 1;
+    }
+    printf("Batch receive kept up with 100%% bus load (old loop lost %d frames)\n", legacy_missed);
+    return 0;
+}
@@ -0,0 +1,164 @@
+// Sniffer cost benchmark: CPU time per 1000 frames for the old terminal update
+// (format every frame, rebuild the 4 KB text with strncat/strstr/strlen) versus the
+// frame ring (push every frame, format only the visible rows every refresh period).
+// The old path is measured without lv_textarea_set_text(), so its real cost was higher.
+//   bench_can_sniffer [frames]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "include/can_sniffer.h"
+#include "include/can_fanout.h"
+#include "include/dbc_loader.h"
+
+#define BUS_FRAMES_PER_S    4500   // 500 kbit/s, 100% load, 8 byte frames
+#define REFRESH_MS          100    // Default Screen3 update speed
+#define VISIBLE_ROWS        26
+
+static const uint32_t s_replay_ids[] = { 0x280, 0x288, 0x390, 0x394, 0x488, 0x580 };
+
+static double thread_cpu_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void make_frame(can_frame_t *frame, uint32_t n)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->timestamp_us = (int64_t)n * 1000000 / BUS_FRAMES_PER_S;
+    frame->id = s_replay_ids[n % (sizeof(s_replay_ids) / sizeof(s_replay_ids[0]))];
+    frame->dlc = 8;
+    memcpy(frame->data, &n, sizeof(n));   // Sequence number in bytes 0..3
+    frame->data[4] = 0xA5;
+    frame->data[5] = (uint8_t)(n * 7);
+}
+
+// ---- Old ui_add_can_message(): copy of the removed code without the LVGL calls ----
+static char s_legacy_text[4096];
+
+static void legacy_add_message(const char *message)
+{
+    const char *current_text = s_legacy_text;
+    char new_text[4096];
+
+    const char *header = strstr(current_text, "\n");
+    if (header) {
+        int header_len = (header - current_text) + 1;
+        strncpy(new_text, current_text, header_len);
+        new_text[header_len] = '\0';
+        strncat(new_text, message, sizeof(new_text) - strlen(new_text) - 1);
+        strncat(new_text, "\n", sizeof(new_text) - strlen(new_text) - 1);
+        strncat(new_text, header + 1, sizeof(new_text) - strlen(new_text) - 1);
+    } else {
+        new_text[0] = '\0'; // Not reached: the header is always present
+    }
+
+    if (strlen(new_text) > 4000) {
+        char *first_line_end = strstr(new_text, "\n");
+        if (first_line_end) {
+            char header_buf[100];
+            int header_len = first_line_end - new_text + 1;
+            strncpy(header_buf, new_text, header_len);
+            header_buf[header_len] = '\0';
+
+            char *truncated_body = new_text + strlen(new_text) - 3000;
+            char *first_msg_in_trunc = strstr(truncated_body, "\n");
+            if (first_msg_in_trunc) truncated_body = first_msg_in_trunc + 1;
+
+            snprintf(new_text, sizeof(new_text), "%s%s", header_buf, truncated_body);
+        }
+    }
+    // lv_textarea_set_text() copied the text once more and relaid out the label
+    memcpy(s_legacy_text, new_text, strlen(new_text) + 1);
+}
+
+static double run_legacy(uint32_t frames)
+{
+    snprintf(s_legacy_text, sizeof(s_legacy_text), "%s\n", CAN_SNIFFER_HEADER);
+    char row[256];
+    can_frame_t frame;
+
+    double start = thread_cpu_us();
+    for (uint32_t n = 0; n < frames; n++) {
+        make_frame(&frame, n);
+        can_sniffer_format_frame(&frame, row, sizeof(row));
+        legacy_add_message(row);
+    }
+    return thread_cpu_us() - start;
+}
+
+// ---- Ring: what canbus_task() (publish) and the Screen3 refresh timer (poll, render) do ----
+static size_t render_visible_rows(char *text, size_t size)
+{
+    static can_frame_t visible[VISIBLE_ROWS];
+    size_t count = can_sniffer_snapshot(visible, VISIBLE_ROWS);
+    size_t len = snprintf(text, size, "%s", CAN_SNIFFER_HEADER);
+    char row[256];
+    for (size_t i = 0; i < count; i++) {
+        size_t row_len = can_sniffer_format_frame(&visible[i], row, sizeof(row));
+        if (len + 1 + row_len >= size) break;
+        text[len++] = '\n';
+        memcpy(&text[len], row, row_len + 1);
+        len += row_len;
+    }
+    return count;
+}
+
+static double run_ring(uint32_t frames, uint32_t *renders)
+{
+    static char text[4096];
+    const uint32_t frames_per_poll = BUS_FRAMES_PER_S * CAN_SNIFFER_POLL_MS / 1000;
+    const uint32_t frames_per_refresh = BUS_FRAMES_PER_S * REFRESH_MS / 1000;
+    can_frame_t frame;
+
+    can_sniffer_clear();
+    *renders = 0;
+    double start = thread_cpu_us();
+    for (uint32_t n = 0; n < frames; n++) {
+        make_frame(&frame, n);
+        can_fanout_publish(&frame, 1);
+        if ((n + 1) % frames_per_poll == 0) {
+            can_sniffer_poll();
+        }
+        if ((n + 1) % frames_per_refresh == 0) {
+            render_visible_rows(text, sizeof(text));
+            (*renders)++;
+        }
+    }
+    return thread_cpu_us() - start;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = argc > 1 ? (uint32_t)atoi(argv[1]) : 100000;
+    if (frames < 1000) frames = 1000;
+
+    // Frames of the sample DBC get decoded into the DBC COMMENTS column
+    if (dbc_loader_load_file(HOST_DBC_DIR "/sample_vw.dbc") != ESP_OK || can_sniffer_init() != ESP_OK) {
+        printf("FAIL: cannot load sample DBC or subscribe the sniffer\n");
+        return 1;
+    }
+
+    double legacy_us = run_legacy(frames);
+    uint32_t renders = 0;
+    double ring_us = run_ring(frames, &renders);
+
+    printf("{\"mode\":\"legacy\",\"frames\":%u,\"cpu_us_per_1000_frames\":%.1f}\n",
+           frames, legacy_us * 1000 / frames);
+    printf("{\"mode\":\"ring\",\"frames\":%u,\"renders\":%u,\"refresh_ms\":%d,\"bus_frames_per_s\":%d,"
+           "\"cpu_us_per_1000_frames\":%.1f}\n",
+           frames, renders, REFRESH_MS, BUS_FRAMES_PER_S, ring_us * 1000 / frames);
+
+    if (can_sniffer_dropped() != 0) {
+        printf("FAIL: sniffer queue dropped %u frames\n", (unsigned)can_sniffer_dropped());
+        return 1;
+    }
+    if (ring_us >= legacy_us) {
+        printf("FAIL: frame ring is not cheaper than the text rebuild\n");
+        return 1;
+    }
+    printf("Frame ring: %.1fx less CPU per frame than the text rebuild\n", legacy_us / ring_us);
+    return 0;
+}
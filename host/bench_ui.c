@@ -0,0 +1,191 @@
+// UI frame time benchmark: every screen on the headless 800x480 display, fed by a
+// synthetic ECU signal sweep at the 20 Hz gauge update rate and by the raw frames of a
+// synthetic powertrain bus (sniffer and statistics of Screen 3). Prints one JSON line per
+// screen: render time per frame, redrawn pixels per frame and heap use. Then the gauge
+// value rendering benchmark of the digit atlas (CONFIG_EXAMPLE_DIGITS_BENCH on the target),
+// and a check that a value settling within the deadband still reaches its label.
+//   bench_ui [frames per screen]
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lvgl.h"
+#include "ui.h"
+#include "ui_updates.h"
+#include "ecu_data.h"
+#include "esp_timer.h"
+#include "host_ui.h"
+#include "can_traffic.h"
+#include "include/can_fanout.h"
+#include "include/can_stats.h"
+#include "components/ui_comp_digits.h"
+
+#define UPDATE_PERIOD_MS    50      // UI task wake-up period with a busy bus
+#define DIGITS_BENCH_UPDATES    10000
+
+// Gauge screens must not redraw more than this share of the screen per frame
+#define MAX_GAUGE_FRAME_SHARE   0.5
+
+typedef struct {
+    float min;
+    float max;
+    float period_s;     // One full sweep, different per signal so frames differ
+} signal_sweep_t;
+
+static const signal_sweep_t s_sweeps[ECU_SIG_COUNT] = {
+    [ECU_SIG_ENGINE_RPM]     = { 800, 7000, 6.0f },
+    [ECU_SIG_TPS_POSITION]   = { 0, 100, 3.0f },
+    [ECU_SIG_ABS_PEDAL_POS]  = { 0, 100, 3.5f },
+    [ECU_SIG_MAP_KPA]        = { 30, 250, 5.0f },
+    [ECU_SIG_WG_SET_PERCENT] = { 0, 100, 4.0f },
+    [ECU_SIG_WG_POS_PERCENT] = { 0, 100, 4.5f },
+    [ECU_SIG_BOV_PERCENT]    = { 0, 100, 2.5f },
+    [ECU_SIG_TCU_TQ_REQ_NM]  = { 0, 500, 7.0f },
+    [ECU_SIG_TCU_TQ_ACT_NM]  = { 0, 500, 7.5f },
+    [ECU_SIG_ENG_TRG_NM]     = { 0, 500, 8.0f },
+    [ECU_SIG_ENG_ACT_NM]     = { 0, 500, 8.5f },
+    [ECU_SIG_LIMIT_TQ_NM]    = { 0, 500, 9.0f },
+};
+
+// Publish all signals the way the CAN task does, values following a triangle sweep
+static void feed_signals(uint32_t step)
+{
+    float t = step * UPDATE_PERIOD_MS / 1000.0f;
+    ecu_data_t *data = ecu_data_write_begin();
+    for (int sig = 0; sig < ECU_SIG_COUNT; sig++) {
+        const signal_sweep_t *sweep = &s_sweeps[sig];
+        float phase = fmodf(t / sweep->period_s, 1.0f);
+        float pos = phase < 0.5f ? phase * 2 : (1 - phase) * 2;
+        *ecu_data_field(data, (ecu_signal_t)sig) = sweep->min + pos * (sweep->max - sweep->min);
+    }
+    ecu_data_mark_updated((1UL << ECU_SIG_COUNT) - 1, esp_timer_get_time());
+    ecu_data_write_end();
+}
+
+static can_traffic_t s_traffic;
+
+// Hand the frames of one update period to the fan-out and the bus statistics, as the CAN task does
+static void feed_frames(uint32_t step)
+{
+    static can_frame_t batch[32];
+    int64_t until_us = (int64_t)(step + 1) * UPDATE_PERIOD_MS * 1000;
+    while (s_traffic.bus_us < until_us) {
+        size_t count = can_traffic_next(&s_traffic, batch, sizeof(batch) / sizeof(batch[0]));
+        can_fanout_publish(batch, count);
+        can_stats_add(batch, count);
+    }
+}
+
+// Set one signal and redraw, returns 0 if the label shows expected
+static int settle(ecu_signal_t signal, float value, lv_obj_t *label, const char *expected)
+{
+    ecu_data_t *data = ecu_data_write_begin();
+    *ecu_data_field(data, signal) = value;
+    ecu_data_mark_updated(1UL << signal, esp_timer_get_time());
+    ecu_data_write_end();
+    update_all_gauges();
+    if (strcmp(lv_label_get_text(label), expected) != 0) {
+        printf("FAIL: signal %d at %g shows \"%s\", expected \"%s\"\n", (int)signal, value,
+               lv_label_get_text(label), expected);
+        return 1;
+    }
+    return 0;
+}
+
+static void run_frame(uint32_t step)
+{
+    feed_signals(step);
+    feed_frames(step);
+    update_all_gauges();
+    host_ui_advance_ms(UPDATE_PERIOD_MS);
+    lv_timer_handler();
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = argc > 1 ? (uint32_t)atoi(argv[1]) : 1000;
+    if (frames < 10) frames = 10;
+
+    lv_init();
+    if (!host_ui_display_create()) {
+        printf("FAIL: cannot allocate the frame buffers\n");
+        return 1;
+    }
+    ecu_data_init();
+    can_traffic_config_t traffic_config;
+    can_traffic_config_vw_powertrain(&traffic_config);
+    if (can_traffic_init(&s_traffic, &traffic_config) != ESP_OK || can_stats_init(traffic_config.bitrate) != ESP_OK) {
+        printf("FAIL: cannot set up the synthetic bus\n");
+        return 1;
+    }
+    ui_init();
+    ui_set_global_demo_mode(false);
+
+    lv_obj_t *screens[] = { ui_Screen1, ui_Screen2, ui_Screen3, ui_Screen4, ui_Screen5, ui_Screen6 };
+    const double screen_px = (double)HOST_UI_HOR_RES * HOST_UI_VER_RES;
+    host_ui_frame_stats_t stats;
+    host_ui_heap_t heap;
+    uint32_t step = 0;
+    int failures = 0;
+
+    for (int i = 0; i < (int)(sizeof(screens) / sizeof(screens[0])); i++) {
+        // First frame of the screen: full redraw, image caches and atlases built
+        host_ui_heap_reset_peak();
+        host_ui_frame_stats_take(&stats);
+        lv_scr_load(screens[i]);
+        run_frame(step++);
+        host_ui_frame_stats_take(&stats);
+        double first_us = stats.render_ns / 1e3;
+
+        for (uint32_t n = 0; n < frames; n++) {
+            run_frame(step++);
+        }
+        host_ui_frame_stats_take(&stats);
+        host_ui_heap_get(&heap);
+
+        uint32_t drawn = stats.frames ? stats.frames : 1;
+        double px_per_frame = (double)stats.px / drawn;
+        printf("{\"screen\":%d,\"frames\":%u,\"drawn_frames\":%u,\"first_frame_us\":%.0f,"
+               "\"render_avg_us\":%.1f,\"render_max_us\":%.1f,\"px_per_frame\":%.0f,"
+               "\"screen_share\":%.3f,\"lvgl_heap_bytes\":%zu,\"lvgl_heap_peak_bytes\":%zu,"
+               "\"process_heap_bytes\":%zu}\n",
+               i + 1, frames, stats.frames, first_us,
+               stats.render_ns / 1e3 / drawn, stats.max_render_ns / 1e3, px_per_frame,
+               px_per_frame / screen_px, heap.lvgl_bytes, heap.lvgl_peak_bytes, heap.process_bytes);
+
+        // Screens 1, 4 and 5 show gauges bound to ECU signals (Screen2's have no CAN source
+        // yet): every frame must draw, but only the changed parts
+        bool gauges = screens[i] == ui_Screen1 || screens[i] == ui_Screen4 || screens[i] == ui_Screen5;
+        if (gauges && stats.frames < frames / 2) {
+            printf("FAIL: screen %d redrew only %u of %u frames\n", i + 1, stats.frames, frames);
+            failures++;
+        }
+        // Screen 3 shows the sniffer terminal of the frames fed above
+        if (screens[i] == ui_Screen3 && stats.frames == 0) {
+            printf("FAIL: screen 3 did not redraw with CAN frames arriving\n");
+            failures++;
+        }
+        if (gauges && px_per_frame > screen_px * MAX_GAUGE_FRAME_SHARE) {
+            printf("FAIL: screen %d redraws %.0f%% of the screen per frame\n", i + 1,
+                   100 * px_per_frame / screen_px);
+            failures++;
+        }
+    }
+
+    // Steps smaller than the deadband (25 rpm, 0.2 %) after a redraw
+    lv_scr_load(ui_Screen1);
+    failures += settle(ECU_SIG_ENGINE_RPM, 3000.0f, ui_Label_RPM_Value, "3000");
+    failures += settle(ECU_SIG_ENGINE_RPM, 3010.0f, ui_Label_RPM_Value, "3010");
+    failures += settle(ECU_SIG_TPS_POSITION, 50.0f, ui_Label_TPS_Value, "50.0");
+    failures += settle(ECU_SIG_TPS_POSITION, 50.1f, ui_Label_TPS_Value, "50.1");
+
+    ui_digits_bench_t digits;
+    if (!ui_digits_benchmark(DIGITS_BENCH_UPDATES, &digits)) {
+        printf("FAIL: digits benchmark did not run\n");
+        failures++;
+    } else {
+        printf("{\"bench\":\"digits\",\"updates\":%u,\"atlas_us_per_update\":%.2f,\"label_us_per_update\":%.2f}\n",
+               (unsigned)digits.updates, digits.atlas_us, digits.label_us);
+    }
+    return failures ? 1 : 0;
+}
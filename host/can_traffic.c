@@ -0,0 +1,215 @@
+// Synthetic CAN bus traffic generator, see can_traffic.h
+#include <stdlib.h>
+#include <string.h>
+#include "can_traffic.h"
+#include "include/can_decoder.h"
+
+#define STD_ID_MAX      0x7FF
+
+// Engine (Motor_x), gearbox, brake, cluster and airbag messages with their usual periods
+static const can_traffic_stream_t s_vw_powertrain[] = {
+    { 0x050, 20000, 4, 1 },                                 // Airbag_1
+    { 0x1A0, 10000, 8, 1 },                                 // Bremse_1
+    { 0x280, 10000, 8, 1 },                                 // Motor_1: RPM, pedal, torque
+    { 0x288, 20000, 8, 1 },                                 // Motor_2: torque limit
+    { 0x320, 20000, 8, 1 },                                 // Kombi_1
+    { 0x380, 10000, 8, 1 },                                 // Motor_3
+    { 0x390, 20000, 8, 1 },                                 // Wastegate
+    { 0x394, 20000, 8, 1 },                                 // Blow-off valve
+    { 0x420, 200000, 8, 1 },                                // Kombi_2
+    { 0x480, 20000, 8, 1 },                                 // Motor_5
+    { 0x488, 10000, 8, 1 },                                 // Getriebe_1: TCU torque
+    { 0x4A0, 10000, 8, 1 },                                 // Bremse_3: wheel speeds
+    { 0x570, 1000000, 4, 1 },                               // Bordnetz_1
+    { 0x580, 20000, 8, 1 },                                 // MAP
+    { 0x5A0, 20000, 8, 1 },                                 // Bremse_2
+    { 0x18FEF1E5 | CAN_DECODER_ID_EXT_FLAG, 100000, 4, 1 }, // Ext_Status (29-bit)
+    { 0x7E8, 500000, 8, 16 },                               // Diagnostic multi-frame response
+};
+
+void can_traffic_config_vw_powertrain(can_traffic_config_t *config)
+{
+    memset(config, 0, sizeof(*config));
+    config->name = "vw_powertrain";
+    config->streams = s_vw_powertrain;
+    config->stream_count = sizeof(s_vw_powertrain) / sizeof(s_vw_powertrain[0]);
+    config->bitrate = 500000;
+    config->rate_scale = 1.0f;
+    config->jitter_pct = 5;
+    config->seed = 1;
+}
+
+esp_err_t can_traffic_parse_streams(const char *text, can_traffic_stream_t *streams,
+                                    size_t max_streams, size_t *count)
+{
+    if (!text || !streams || !count) return ESP_ERR_INVALID_ARG;
+
+    *count = 0;
+    while (*text) {
+        const char *line_end = strchr(text, '\n');
+        size_t len = line_end ? (size_t)(line_end - text) : strlen(text);
+        char line[128];
+        if (len >= sizeof(line)) return ESP_ERR_INVALID_SIZE;
+        memcpy(line, text, len);
+        line[len] = '\0';
+        text += line_end ? len + 1 : len;
+
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        char *p = line;
+        char *end;
+        unsigned long id = strtoul(p, &end, 0);
+        if (end == p) {
+            // Blank line
+            while (*p == ' ' || *p == '\t' || *p == '\r') p++;
+            if (*p) return ESP_ERR_INVALID_ARG;
+            continue;
+        }
+        p = end;
+        float period_ms = strtof(p, &end);
+        if (end == p || period_ms <= 0) return ESP_ERR_INVALID_ARG;
+        p = end;
+        unsigned long dlc = strtoul(p, &end, 0);
+        if (end == p || dlc > 8) return ESP_ERR_INVALID_ARG;
+        p = end;
+        unsigned long burst = strtoul(p, &end, 0);
+        if (end == p) burst = 1;
+        if (burst < 1 || burst > 255 || id > 0x1FFFFFFF) return ESP_ERR_INVALID_ARG;
+
+        if (*count >= max_streams) return ESP_ERR_NO_MEM;
+        streams[*count] = (can_traffic_stream_t) {
+            .id = id > STD_ID_MAX ? (uint32_t)id | CAN_DECODER_ID_EXT_FLAG : (uint32_t)id,
+            .period_us = (uint32_t)(period_ms * 1000),
+            .dlc = (uint8_t)dlc,
+            .burst = (uint8_t)burst,
+        };
+        (*count)++;
+    }
+    return *count ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+uint32_t can_traffic_frame_bits(uint32_t id, uint8_t dlc)
+{
+    return ((id & CAN_DECODER_ID_EXT_FLAG) ? 67 : 47) + 8 * dlc;
+}
+
+static uint32_t next_random(uint32_t *rng)
+{
+    *rng = *rng * 1103515245u + 12345u;
+    return *rng >> 16;
+}
+
+static int64_t scaled_period_us(const can_traffic_t *traffic, size_t stream)
+{
+    double period = traffic->config.streams[stream].period_us / traffic->config.rate_scale;
+    return period < 1 ? 1 : (int64_t)period;
+}
+
+// Next send time after a period: the period plus up to +-jitter_pct
+static int64_t next_due(can_traffic_t *traffic, size_t stream, int64_t from_us)
+{
+    int64_t period = scaled_period_us(traffic, stream);
+    int64_t jitter = period * traffic->config.jitter_pct / 100;
+    if (jitter > 0) {
+        period += (int64_t)(next_random(&traffic->rng) % (2 * jitter + 1)) - jitter;
+    }
+    return from_us + (period < 1 ? 1 : period);
+}
+
+esp_err_t can_traffic_init(can_traffic_t *traffic, const can_traffic_config_t *config)
+{
+    if (!traffic || !config || !config->streams || config->stream_count == 0 ||
+        config->stream_count > CAN_TRAFFIC_MAX_STREAMS || config->bitrate == 0 || config->rate_scale <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(traffic, 0, sizeof(*traffic));
+    traffic->config = *config;
+    traffic->rng = config->seed ? config->seed : 1;
+    for (size_t i = 0; i < config->stream_count; i++) {
+        // ECUs do not start in phase
+        traffic->next_due_us[i] = next_random(&traffic->rng) % scaled_period_us(traffic, i);
+        for (int b = 0; b < 8; b++) {
+            traffic->data[i][b] = (uint8_t)next_random(&traffic->rng);
+        }
+    }
+    return ESP_OK;
+}
+
+// The stream that wins arbitration: the lowest ID among those pending when the bus gets free
+static size_t arbitrate(const can_traffic_t *traffic, int64_t *start_us)
+{
+    int64_t bus_free = traffic->bus_us;
+    int64_t earliest = INT64_MAX;
+    for (size_t i = 0; i < traffic->config.stream_count; i++) {
+        if (traffic->next_due_us[i] < earliest) earliest = traffic->next_due_us[i];
+    }
+    *start_us = earliest > bus_free ? earliest : bus_free;
+
+    size_t winner = 0;
+    uint32_t winner_id = UINT32_MAX;
+    for (size_t i = 0; i < traffic->config.stream_count; i++) {
+        if (traffic->next_due_us[i] > *start_us) continue;
+        // Base ID bits decide; 29-bit frames lose against the 11-bit ID they share a base with
+        uint32_t raw = traffic->config.streams[i].id;
+        uint32_t key = (raw & CAN_DECODER_ID_EXT_FLAG) ? (((raw & 0x1FFFFFFF) >> 18) << 1) | 1 : raw << 1;
+        if (key < winner_id) {
+            winner_id = key;
+            winner = i;
+        }
+    }
+    return winner;
+}
+
+size_t can_traffic_next(can_traffic_t *traffic, can_frame_t *frames, size_t max_frames)
+{
+    if (!traffic || !frames) return 0;
+
+    for (size_t n = 0; n < max_frames; n++) {
+        int64_t start_us;
+        size_t s = arbitrate(traffic, &start_us);
+        const can_traffic_stream_t *stream = &traffic->config.streams[s];
+
+        uint8_t *data = traffic->data[s];
+        data[next_random(&traffic->rng) % 8] += (uint8_t)(next_random(&traffic->rng) % 5) - 2;
+
+        uint32_t bits = can_traffic_frame_bits(stream->id, stream->dlc);
+        traffic->bus_us = start_us + ((int64_t)bits * 1000000 + traffic->config.bitrate - 1) / traffic->config.bitrate;
+
+        can_frame_t *frame = &frames[n];
+        memset(frame, 0, sizeof(*frame));
+        frame->timestamp_us = traffic->bus_us;
+        frame->id = stream->id;
+        frame->dlc = stream->dlc;
+        memcpy(frame->data, data, stream->dlc);
+        traffic->frames++;
+
+        // Remaining frames of a burst are due right away, then the next period starts. Periods
+        // count from the send time: on an overloaded bus a message is late, not queued twice.
+        if (traffic->burst_left[s] == 0 && stream->burst > 1) {
+            traffic->burst_left[s] = stream->burst;
+        }
+        if (traffic->burst_left[s] > 1) {
+            traffic->burst_left[s]--;
+            traffic->next_due_us[s] = traffic->bus_us;
+        } else {
+            traffic->burst_left[s] = 0;
+            traffic->next_due_us[s] = next_due(traffic, s, start_us);
+        }
+    }
+    return max_frames;
+}
+
+float can_traffic_bus_load(const can_traffic_config_t *config)
+{
+    if (!config || !config->streams || config->bitrate == 0) return 0.0f;
+
+    double bits_per_s = 0;
+    for (size_t i = 0; i < config->stream_count; i++) {
+        const can_traffic_stream_t *stream = &config->streams[i];
+        double rate = 1e6 / stream->period_us * config->rate_scale;
+        bits_per_s += rate * (stream->burst > 1 ? stream->burst : 1) * can_traffic_frame_bits(stream->id, stream->dlc);
+    }
+    return (float)(bits_per_s / config->bitrate);
+}
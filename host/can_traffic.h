@@ -0,0 +1,61 @@
+// Synthetic CAN bus traffic for the host benchmarks: cyclic messages with period jitter
+// and back-to-back bursts, serialised on a virtual bus with ID arbitration.
+#ifndef CAN_TRAFFIC_H
+#define CAN_TRAFFIC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "include/can_frame.h"
+
+#define CAN_TRAFFIC_MAX_STREAMS     32
+
+// One message on the bus
+typedef struct {
+    uint32_t id;            // CAN_DECODER_ID_EXT_FLAG set for 29-bit IDs
+    uint32_t period_us;
+    uint8_t dlc;
+    uint8_t burst;          // Frames sent back to back every period (e.g. ISO-TP responses), 0/1 = one
+} can_traffic_stream_t;
+
+typedef struct {
+    const char *name;
+    const can_traffic_stream_t *streams;
+    size_t stream_count;
+    uint32_t bitrate;
+    float rate_scale;       // All rates multiplied by this
+    uint8_t jitter_pct;     // Each period deviates randomly by up to this much
+    uint32_t seed;
+} can_traffic_config_t;
+
+typedef struct {
+    can_traffic_config_t config;
+    int64_t next_due_us[CAN_TRAFFIC_MAX_STREAMS];
+    uint8_t burst_left[CAN_TRAFFIC_MAX_STREAMS];
+    uint8_t data[CAN_TRAFFIC_MAX_STREAMS][8];   // Payload, drifts a little with every frame
+    int64_t bus_us;         // End of the last frame on the bus
+    uint32_t rng;
+    uint32_t frames;
+} can_traffic_t;
+
+// Powertrain bus of a VW PQ35/46 car at 500 kbit/s: engine, gearbox, brake and cluster
+// messages, one 29-bit status message and a diagnostic response burst every 500 ms
+void can_traffic_config_vw_powertrain(can_traffic_config_t *config);
+
+// Read streams from text, one per line: "<id> <period ms> <dlc> [burst]", '#' comments.
+// IDs above 0x7FF are 29-bit.
+esp_err_t can_traffic_parse_streams(const char *text, can_traffic_stream_t *streams,
+                                    size_t max_streams, size_t *count);
+
+esp_err_t can_traffic_init(can_traffic_t *traffic, const can_traffic_config_t *config);
+
+// Next frames in bus order; timestamp_us is the end of frame in bus time (starts at 0)
+size_t can_traffic_next(can_traffic_t *traffic, can_frame_t *frames, size_t max_frames);
+
+// Share of the bus the configuration occupies, 1.0 = saturated (stuff bits not counted)
+float can_traffic_bus_load(const can_traffic_config_t *config);
+
+// Bits of a data frame incl. interframe space, without stuff bits
+uint32_t can_traffic_frame_bits(uint32_t id, uint8_t dlc);
+
+#endif // CAN_TRAFFIC_H
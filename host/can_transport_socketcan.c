@@ -0,0 +1,201 @@
+// SocketCAN transport, see can_transport_socketcan.h
+#define _GNU_SOURCE     // recvmmsg()
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/error.h>
+#include <linux/can/raw.h>
+#include "can_transport_socketcan.h"
+#include "include/can_decoder.h"
+#include "esp_timer.h"
+
+#define SOCKET_RCVBUF   (1024 * 1024)   // A few 100 ms of a saturated 1 Mbit/s bus
+#define BATCH_MAX       64              // Frames per recvmmsg()
+
+#ifndef SO_RXQ_OVFL
+#define SO_RXQ_OVFL     40
+#endif
+
+typedef struct {
+    int fd;
+    bool running;
+    uint32_t dropped;           // Socket buffer overflows, from SO_RXQ_OVFL
+    uint32_t error_frames;
+    uint32_t skipped;
+    struct canfd_frame frames[BATCH_MAX];
+    struct iovec iov[BATCH_MAX];
+    struct mmsghdr messages[BATCH_MAX];
+    char control[BATCH_MAX][CMSG_SPACE(sizeof(uint32_t))];
+} socketcan_t;
+
+static esp_err_t socketcan_start(can_transport_t *transport)
+{
+    ((socketcan_t *)transport->ctx)->running = true;
+    return ESP_OK;
+}
+
+static esp_err_t socketcan_stop(can_transport_t *transport)
+{
+    ((socketcan_t *)transport->ctx)->running = false;
+    return ESP_OK;
+}
+
+// Classic frame of the socket, false for error and CAN FD frames
+static bool frame_from_socket(socketcan_t *socketcan, can_frame_t *frame, const struct canfd_frame *raw,
+                              size_t len, int64_t timestamp_us)
+{
+    if (raw->can_id & CAN_ERR_FLAG) {
+        socketcan->error_frames++;
+        return false;
+    }
+    if (len != CAN_MTU) {
+        socketcan->skipped++;
+        return false;
+    }
+    frame->timestamp_us = timestamp_us;
+    if (raw->can_id & CAN_EFF_FLAG) {
+        frame->id = (raw->can_id & CAN_EFF_MASK) | CAN_DECODER_ID_EXT_FLAG;
+    } else {
+        frame->id = raw->can_id & CAN_SFF_MASK;
+    }
+    frame->dlc = raw->len > 8 ? 8 : raw->len;
+    frame->flags = raw->can_id & CAN_RTR_FLAG ? CAN_FRAME_FLAG_RTR : 0;
+    memcpy(frame->data, raw->data, sizeof(frame->data));
+    return true;
+}
+
+static esp_err_t socketcan_receive_batch(can_transport_t *transport, can_frame_t *frames, size_t max_frames,
+                                         size_t *count, TickType_t wait_ticks)
+{
+    socketcan_t *socketcan = transport->ctx;
+    if (!socketcan->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    int64_t deadline = esp_timer_get_time() + (int64_t)wait_ticks * portTICK_PERIOD_MS * 1000;
+    size_t n = 0;
+    while (n == 0) {
+        // Block for the first frame only, then take whatever else is queued
+        int64_t left_us = deadline - esp_timer_get_time();
+        struct pollfd pfd = { .fd = socketcan->fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, left_us > 0 ? (int)((left_us + 999) / 1000) : 0);
+        if (ready < 0 && errno != EINTR) {
+            return ESP_FAIL;
+        }
+        if (ready <= 0) {
+            if (esp_timer_get_time() >= deadline) {
+                return ESP_ERR_TIMEOUT;
+            }
+            continue;
+        }
+
+        while (n < max_frames) {
+            unsigned int want = max_frames - n < BATCH_MAX ? (unsigned int)(max_frames - n) : BATCH_MAX;
+            for (unsigned int i = 0; i < want; i++) {
+                socketcan->messages[i].msg_hdr.msg_controllen = sizeof(socketcan->control[i]);
+            }
+            int received = recvmmsg(socketcan->fd, socketcan->messages, want, MSG_DONTWAIT, NULL);
+            if (received <= 0) {
+                if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    return ESP_FAIL;
+                }
+                break;
+            }
+            int64_t now = esp_timer_get_time();
+            for (int i = 0; i < received; i++) {
+                struct msghdr *header = &socketcan->messages[i].msg_hdr;
+                for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(header); cmsg; cmsg = CMSG_NXTHDR(header, cmsg)) {
+                    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+                        memcpy(&socketcan->dropped, CMSG_DATA(cmsg), sizeof(socketcan->dropped));
+                    }
+                }
+                if (frame_from_socket(socketcan, &frames[n], &socketcan->frames[i],
+                                      socketcan->messages[i].msg_len, now)) {
+                    n++;
+                }
+            }
+            if ((unsigned int)received < want) {
+                break;
+            }
+        }
+    }
+    *count = n;
+    return ESP_OK;
+}
+
+static esp_err_t socketcan_get_stats(can_transport_t *transport, can_transport_stats_t *stats)
+{
+    socketcan_t *socketcan = transport->ctx;
+    stats->rx_missed = socketcan->dropped;
+    stats->bus_errors = socketcan->error_frames;
+    stats->skipped = socketcan->skipped;
+    stats->state = socketcan->running ? CAN_TRANSPORT_STATE_RUNNING : CAN_TRANSPORT_STATE_STOPPED;
+    return ESP_OK;
+}
+
+static void socketcan_close(can_transport_t *transport)
+{
+    socketcan_t *socketcan = transport->ctx;
+    close(socketcan->fd);
+    free(socketcan);
+}
+
+static const can_transport_ops_t s_socketcan_ops = {
+    .name = "socketcan",
+    .start = socketcan_start,
+    .stop = socketcan_stop,
+    .receive_batch = socketcan_receive_batch,
+    .get_stats = socketcan_get_stats,
+    .close = socketcan_close,
+};
+
+esp_err_t can_transport_socketcan_open(can_transport_t *transport, const char *interface)
+{
+    if (!transport || !interface || strlen(interface) >= IFNAMSIZ) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(transport, 0, sizeof(*transport));
+    int fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (fd < 0) {
+        return errno == EAFNOSUPPORT || errno == EPROTONOSUPPORT ? ESP_ERR_NOT_SUPPORTED : ESP_FAIL;
+    }
+    struct ifreq ifr = { 0 };
+    strcpy(ifr.ifr_name, interface);
+    if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0) {
+        close(fd);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Error frames are counted, CAN FD frames only to be skipped; a larger buffer rides out
+    // scheduling gaps of the receiving thread
+    int on = 1, rcvbuf = SOCKET_RCVBUF;
+    can_err_mask_t err_mask = CAN_ERR_MASK;
+    setsockopt(fd, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &err_mask, sizeof(err_mask));
+    setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &on, sizeof(on));
+    setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    struct sockaddr_can addr = { .can_family = AF_CAN, .can_ifindex = ifr.ifr_ifindex };
+    socketcan_t *socketcan = calloc(1, sizeof(*socketcan));
+    if (!socketcan || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        free(socketcan);
+        close(fd);
+        return socketcan ? ESP_FAIL : ESP_ERR_NO_MEM;
+    }
+    socketcan->fd = fd;
+    for (int i = 0; i < BATCH_MAX; i++) {
+        socketcan->iov[i].iov_base = &socketcan->frames[i];
+        socketcan->iov[i].iov_len = sizeof(socketcan->frames[i]);
+        socketcan->messages[i].msg_hdr.msg_iov = &socketcan->iov[i];
+        socketcan->messages[i].msg_hdr.msg_iovlen = 1;
+        socketcan->messages[i].msg_hdr.msg_control = socketcan->control[i];
+    }
+    transport->ops = &s_socketcan_ops;
+    transport->ctx = socketcan;
+    return ESP_OK;
+}
@@ -0,0 +1,14 @@
+// SocketCAN transport for the Linux build: a raw CAN socket on a real or virtual interface
+// (ip link add dev vcan0 type vcan; ip link set up vcan0), fed by cangen, canplayer or a car.
+#ifndef CAN_TRANSPORT_SOCKETCAN_H
+#define CAN_TRANSPORT_SOCKETCAN_H
+
+#include "include/can_transport.h"
+
+// Bind a raw socket to the interface. ESP_ERR_NOT_FOUND if there is no such interface,
+// ESP_ERR_NOT_SUPPORTED if the kernel has no CAN sockets, ESP_FAIL otherwise.
+// Socket buffer overflows count as rx_missed, error frames as bus_errors, CAN FD frames as
+// skipped. Frames are timestamped when they are taken from the socket, like TWAI frames.
+esp_err_t can_transport_socketcan_open(can_transport_t *transport, const char *interface);
+
+#endif // CAN_TRANSPORT_SOCKETCAN_H
@@ -0,0 +1,9 @@
+// Host build shim: esp_timer_get_time() on the monotonic clock
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
+
+#endif // HOST_ESP_TIMER_H
@@ -0,0 +1,12 @@
+// Host build shim: the SD card is not mounted on the host, see shims/ui_shims.c.
+// Paths on the host file system stand in for files on the card.
+#ifndef HOST_ESP_VFS_FAT_H
+#define HOST_ESP_VFS_FAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+esp_err_t esp_vfs_fat_create_contiguous_file(const char *base_path, const char *full_path, uint64_t size, bool alloc_now);
+
+#endif // HOST_ESP_VFS_FAT_H
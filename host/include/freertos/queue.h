@@ -0,0 +1,9 @@
+// Host build shim: queue handle type for headers that declare queues
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *QueueHandle_t;
+
+#endif // HOST_FREERTOS_QUEUE_H
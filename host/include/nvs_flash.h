@@ -0,0 +1,7 @@
+// Host build shim: NVS is not used by the host build, the header only has to exist
+#ifndef HOST_NVS_FLASH_H
+#define HOST_NVS_FLASH_H
+
+#include "nvs.h"
+
+#endif // HOST_NVS_FLASH_H
@@ -0,0 +1,14 @@
+// Host build shim: configuration values the shared sources depend on
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+
+#define CONFIG_FREERTOS_HZ 100
+#define CONFIG_CANBUS_RX_QUEUE_LEN 64
+#define CONFIG_CANBUS_RX_BATCH_SIZE 32
+#define CONFIG_CAN_LOG_QUEUE_SIZE 512
+#define CONFIG_CAN_LOG_FILE_MAX_MB 64
+#define CONFIG_CAN_LOG_FILE_MAX_S 900
+#define CONFIG_CAN_LOG_SYNC_MS 2000
+#define CONFIG_EXAMPLE_GAUGE_CACHE_BACKGROUND 1
+
+#endif // HOST_SDKCONFIG_H
@@ -0,0 +1,5 @@
+// Host build shim: the SD card is not mounted on the host, see shims/ui_shims.c
+#ifndef HOST_SDMMC_CMD_H
+#define HOST_SDMMC_CMD_H
+
+#endif // HOST_SDMMC_CMD_H
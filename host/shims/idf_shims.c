@@ -0,0 +1,183 @@
+// Host implementations of the ESP-IDF / FreeRTOS calls used by the shared sources
+#include <pthread.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_vfs_fat.h"
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    pthread_mutex_t *mutex = malloc(sizeof(pthread_mutex_t));
+    if (mutex) pthread_mutex_init(mutex, NULL);
+    return mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    (void)ticks;
+    return pthread_mutex_lock((pthread_mutex_t *)sem) == 0 ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return pthread_mutex_unlock((pthread_mutex_t *)sem) == 0 ? pdTRUE : pdFALSE;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    int64_t us = (int64_t)ticks * portTICK_PERIOD_MS * 1000;
+    struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t value;
+    TaskFunction_t fn;
+    void *arg;
+} host_task_t;
+
+static __thread host_task_t *s_current_task = NULL;
+
+static host_task_t *host_task_new(void)
+{
+    host_task_t *task = calloc(1, sizeof(host_task_t));
+    if (!task) return NULL;
+    pthread_mutex_init(&task->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&task->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    return task;
+}
+
+static void *host_task_main(void *arg)
+{
+    s_current_task = arg;
+    s_current_task->fn(s_current_task->arg);
+    return NULL;
+}
+
+// The task state is never freed: a handle may still be notified after the task ended
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_size, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle)
+{
+    (void)name;
+    (void)stack_size;
+    (void)priority;
+    host_task_t *task = host_task_new();
+    if (!task) return pdFALSE;
+    task->fn = fn;
+    task->arg = arg;
+
+    pthread_t thread;
+    if (handle) *handle = task;
+    if (pthread_create(&thread, NULL, host_task_main, task) != 0) return pdFALSE;
+    pthread_detach(thread);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_size, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    (void)core;
+    return xTaskCreate(fn, name, stack_size, arg, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL || task == s_current_task) {
+        pthread_exit(NULL);
+    }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (!s_current_task) s_current_task = host_task_new();
+    return s_current_task;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t handle, uint32_t value, eNotifyAction action)
+{
+    host_task_t *task = handle;
+    if (!task) return pdFALSE;
+    pthread_mutex_lock(&task->lock);
+    switch (action) {
+    case eSetBits: task->value |= value; break;
+    case eIncrement: task->value++; break;
+    case eSetValueWithOverwrite: task->value = value; break;
+    default: break;
+    }
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    host_task_t *task = xTaskGetCurrentTaskHandle();
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    int64_t ns = deadline.tv_nsec + (int64_t)ticks * portTICK_PERIOD_MS * 1000000;
+    deadline.tv_sec += ns / 1000000000;
+    deadline.tv_nsec = ns % 1000000000;
+
+    pthread_mutex_lock(&task->lock);
+    while (task->value == 0 && ticks != 0) {
+        int ret = ticks == portMAX_DELAY ? pthread_cond_wait(&task->cond, &task->lock)
+                                         : pthread_cond_timedwait(&task->cond, &task->lock, &deadline);
+        if (ret == ETIMEDOUT) break;
+    }
+    uint32_t value = task->value;
+    if (value) task->value = clear_on_exit ? 0 : value - 1;
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+// f_expand() on the card; the host file system decides about contiguity
+esp_err_t esp_vfs_fat_create_contiguous_file(const char *base_path, const char *full_path, uint64_t size, bool alloc_now)
+{
+    (void)base_path;
+    (void)alloc_now;
+    int fd = open(full_path, O_WRONLY | O_CREAT | O_EXCL, 0666);
+    if (fd < 0) return ESP_FAIL;
+    int ret = posix_fallocate(fd, 0, (off_t)size);
+    close(fd);
+    return ret == 0 ? ESP_OK : ESP_ERR_NO_MEM;
+}
@@ -0,0 +1,125 @@
+// Host TWAI driver: a bounded RX queue filled by twai_sim_deliver() from a bus thread.
+// Overflow is counted as rx_missed_count, like the driver does when its queue is full.
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "driver/twai.h"
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_not_empty;
+static twai_message_t *s_queue = NULL;
+static uint32_t s_queue_len = 0;
+static uint32_t s_head = 0;
+static uint32_t s_count = 0;
+static twai_state_t s_state = TWAI_STATE_STOPPED;
+static uint32_t s_rx_missed = 0;
+static bool s_installed = false;
+
+esp_err_t twai_driver_install(const twai_general_config_t *g_config, const twai_timing_config_t *t_config,
+                              const twai_filter_config_t *f_config)
+{
+    (void)t_config;
+    (void)f_config;
+    if (!g_config || g_config->rx_queue_len == 0) return ESP_ERR_INVALID_ARG;
+    if (s_installed) return ESP_ERR_INVALID_STATE;
+
+    s_queue = calloc(g_config->rx_queue_len, sizeof(twai_message_t));
+    if (!s_queue) return ESP_ERR_NO_MEM;
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s_not_empty, &attr);
+    pthread_condattr_destroy(&attr);
+
+    s_queue_len = g_config->rx_queue_len;
+    s_head = s_count = s_rx_missed = 0;
+    s_state = TWAI_STATE_STOPPED;
+    s_installed = true;
+    return ESP_OK;
+}
+
+esp_err_t twai_driver_uninstall(void)
+{
+    if (!s_installed) return ESP_ERR_INVALID_STATE;
+    pthread_cond_destroy(&s_not_empty);
+    free(s_queue);
+    s_queue = NULL;
+    s_installed = false;
+    return ESP_OK;
+}
+
+esp_err_t twai_start(void)
+{
+    if (!s_installed) return ESP_ERR_INVALID_STATE;
+    s_state = TWAI_STATE_RUNNING;
+    return ESP_OK;
+}
+
+esp_err_t twai_stop(void)
+{
+    if (!s_installed) return ESP_ERR_INVALID_STATE;
+    s_state = TWAI_STATE_STOPPED;
+    return ESP_OK;
+}
+
+bool twai_sim_deliver(const twai_message_t *message)
+{
+    bool queued = false;
+    pthread_mutex_lock(&s_lock);
+    if (s_state == TWAI_STATE_RUNNING) {
+        if (s_count < s_queue_len) {
+            s_queue[(s_head + s_count) % s_queue_len] = *message;
+            s_count++;
+            queued = true;
+            pthread_cond_signal(&s_not_empty);
+        } else {
+            s_rx_missed++;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return queued;
+}
+
+esp_err_t twai_receive(twai_message_t *message, TickType_t ticks_to_wait)
+{
+    if (!s_installed) return ESP_ERR_INVALID_STATE;
+
+    pthread_mutex_lock(&s_lock);
+    if (s_count == 0 && ticks_to_wait > 0) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        int64_t ns = (int64_t)ticks_to_wait * portTICK_PERIOD_MS * 1000000LL + deadline.tv_nsec;
+        deadline.tv_sec += ns / 1000000000LL;
+        deadline.tv_nsec = ns % 1000000000LL;
+        while (s_count == 0) {
+            if (pthread_cond_timedwait(&s_not_empty, &s_lock, &deadline) == ETIMEDOUT) break;
+        }
+    }
+
+    esp_err_t ret = ESP_ERR_TIMEOUT;
+    if (s_count > 0) {
+        *message = s_queue[s_head];
+        s_head = (s_head + 1) % s_queue_len;
+        s_count--;
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ret;
+}
+
+esp_err_t twai_get_status_info(twai_status_info_t *status_info)
+{
+    if (!s_installed) return ESP_ERR_INVALID_STATE;
+    if (!status_info) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&s_lock);
+    memset(status_info, 0, sizeof(*status_info));
+    status_info->state = s_state;
+    status_info->msgs_to_rx = s_count;
+    status_info->rx_missed_count = s_rx_missed;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
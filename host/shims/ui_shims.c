@@ -0,0 +1,21 @@
+// Host implementations of the board services the UI calls: no SD card, no background task
+#include <stddef.h>
+#include "esp_err.h"
+#include "background_task.h"
+#include "sd_card.h"
+
+esp_err_t s_example_write_file(const char *path, char *data)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t s_example_read_file(const char *path)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+
+// No background task on the host; the caller keeps task->data and frees it
+esp_err_t background_task_add(background_task_t *task)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
@@ -0,0 +1,264 @@
+// Host test for the table-driven CAN decoder against the parse_can_message() switch it
+// replaced: random frames of all six VW IDs must decode to the same values, including the
+// Motorola 16-bit RPM and MAP layouts. Frames shorter than a signal leave its field alone.
+// Then times both paths over the same frames.
+//   test_can_decoder [frames, default 1000000]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "include/can_parser.h"
+#include "include/can_decoder.h"
+#include "include/ecu_data.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while (0)
+
+#define MAX_TORQUE_NM   500.0f
+
+static const uint32_t s_ids[] = { 0x280, 0x580, 0x390, 0x394, 0x488, 0x288 };
+#define ID_COUNT (sizeof(s_ids) / sizeof(s_ids[0]))
+
+// ---- Reference: the baseline parse_can_message() switch, writing into ecu_data ----
+
+static void legacy_parse(uint32_t identifier, const uint8_t *data, ecu_data_t *ecu_data)
+{
+    float raw_value_percent = 0.0f;
+
+    switch (identifier) {
+        case 0x280: // RPM, TPS, Pedal Pos, Target Torque, Actual Torque
+            ecu_data->engine_rpm = ((data[2] << 8) | data[3]) * 0.25f;
+            ecu_data->tps_position = data[7] * 0.3937f;
+            ecu_data->abs_pedal_pos = data[4] * 0.4f;
+
+            // Torque values are first calculated as %, then converted to Nm
+            raw_value_percent = data[5] * 0.3937f;
+            ecu_data->eng_trg_nm = (raw_value_percent / 100.0f) * MAX_TORQUE_NM;
+            break;
+
+        case 0x580: // MAP
+            // Formula: raw * 0.01 = kPa
+            ecu_data->map_kpa = ((data[2] << 8) | data[3]) * 0.01f;
+            break;
+
+        case 0x390: // Wastegate
+            ecu_data->wg_set_percent = data[1] / 2.0f;
+            ecu_data->wg_pos_percent = data[2] / 2.0f;
+            break;
+
+        case 0x394: // Blow-Off Valve
+            ecu_data->bov_percent = (data[0] / 255.0f) * 50.0f;
+            break;
+
+        case 0x488: // TCU Torque
+            raw_value_percent = data[1] * 0.39f;
+            ecu_data->tcu_tq_req_nm = (raw_value_percent / 100.0f) * MAX_TORQUE_NM;
+
+            raw_value_percent = data[2] * 0.39f;
+            ecu_data->tcu_tq_act_nm = (raw_value_percent / 100.0f) * MAX_TORQUE_NM;
+            break;
+
+        case 0x288: // Torque Limit
+            raw_value_percent = data[5] * 0.4f;
+            ecu_data->limit_tq_nm = (raw_value_percent / 100.0f) * MAX_TORQUE_NM;
+            break;
+
+        default:
+            // Unhandled CAN ID
+            break;
+    }
+}
+
+static uint32_t s_rng = 12345;
+
+static uint32_t next_random(void)
+{
+    s_rng = s_rng * 1103515245U + 12345U;
+    return s_rng >> 8;
+}
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Same value up to float rounding: the table scales in one multiplication where the switch
+// divided and multiplied in steps
+static bool same_signals(const ecu_data_t *a, const ecu_data_t *b)
+{
+    const float *fa = &a->engine_rpm;
+    const float *fb = &b->engine_rpm;
+    for (int i = 0; i < ECU_SIG_COUNT; i++) {
+        if (fabsf(fa[i] - fb[i]) > 1e-5f * fmaxf(1.0f, fabsf(fa[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_layouts(void)
+{
+    // Motorola 16-bit values in bytes 2 (high) and 3 (low)
+    const uint8_t data[8] = { 0x00, 0x00, 0xAB, 0xCD, 0x00, 0x00, 0x00, 0x00 };
+    ecu_data_t ecu;
+    memset(&ecu, 0, sizeof(ecu));
+    CHECK(can_decoder_decode(0x280, data, 8, &ecu) == (1U << ECU_SIG_ENGINE_RPM | 1U << ECU_SIG_ABS_PEDAL_POS |
+                                                       1U << ECU_SIG_ENG_TRG_NM | 1U << ECU_SIG_TPS_POSITION));
+    CHECK(ecu.engine_rpm == 0xABCD * 0.25f);
+    CHECK(can_decoder_decode(0x580, data, 8, &ecu) == 1U << ECU_SIG_MAP_KPA);
+    CHECK(fabsf(ecu.map_kpa - 0xABCD * 0.01f) < 1e-3f);
+
+    // Unknown and extended IDs write nothing
+    ecu_data_t before = ecu;
+    CHECK(can_decoder_decode(0x281, data, 8, &ecu) == 0);
+    CHECK(can_decoder_decode(0x280 | CAN_DECODER_ID_EXT_FLAG, data, 8, &ecu) == 0);
+    CHECK(memcmp(&before, &ecu, sizeof(ecu)) == 0);
+
+    // The parser skips the ECU data write for them: the published sequence stays put
+    CHECK(can_decoder_has_id(0x280) && !can_decoder_has_id(0x281));
+    CHECK(!can_decoder_has_id(0x280 | CAN_DECODER_ID_EXT_FLAG));
+    can_frame_t frame = { .id = 0x281, .dlc = 8 };
+    uint32_t seq = ecu_data_get_sequence();
+    CHECK(parse_can_frame(&frame) == 0 && ecu_data_get_sequence() == seq);
+    frame.id = 0x580;
+    CHECK(parse_can_frame(&frame) == 1U << ECU_SIG_MAP_KPA && ecu_data_get_sequence() == seq + 2);
+}
+
+// The switch read all 8 bytes whatever the DLC; the table skips signals past the DLC
+static void test_short_dlc(void)
+{
+    const uint8_t data[8] = { 0x11, 0x22, 0xAB, 0xCD, 0x33, 0x44, 0x55, 0x66 };
+    ecu_data_t ecu;
+    memset(&ecu, 0, sizeof(ecu));
+    ecu.engine_rpm = 1234.0f;
+
+    // RPM is in bytes 2 and 3: a 3-byte frame keeps the previous value
+    uint32_t updated = can_decoder_decode(0x280, data, 3, &ecu);
+    CHECK(!(updated & 1U << ECU_SIG_ENGINE_RPM) && ecu.engine_rpm == 1234.0f);
+    updated = can_decoder_decode(0x280, data, 4, &ecu);
+    CHECK((updated & 1U << ECU_SIG_ENGINE_RPM) && ecu.engine_rpm == 0xABCD * 0.25f);
+    CHECK(can_decoder_decode(0x280, data, 0, &ecu) == 0);
+
+    // Whatever a short frame decodes matches the full frame
+    uint32_t mismatches = 0;
+    for (size_t n = 0; n < ID_COUNT; n++) {
+        ecu_data_t full;
+        memset(&full, 0, sizeof(full));
+        uint32_t full_mask = can_decoder_decode(s_ids[n], data, 8, &full);
+        uint32_t prev_mask = 0;
+        for (uint8_t dlc = 0; dlc <= 8; dlc++) {
+            ecu_data_t part;
+            memset(&part, 0, sizeof(part));
+            uint32_t mask = can_decoder_decode(s_ids[n], data, dlc, &part);
+            mismatches += (mask & ~full_mask) != 0 || (prev_mask & ~mask) != 0;
+            for (int sig = 0; sig < ECU_SIG_COUNT; sig++) {
+                if (mask & 1U << sig) {
+                    mismatches += *ecu_data_field(&part, (ecu_signal_t)sig) != *ecu_data_field(&full, (ecu_signal_t)sig);
+                }
+            }
+            prev_mask = mask;
+        }
+        mismatches += prev_mask != full_mask;
+    }
+    CHECK(mismatches == 0);
+}
+
+static void test_equivalence(uint32_t frames)
+{
+    uint32_t mismatches = 0;
+    for (uint32_t n = 0; n < frames; n++) {
+        uint32_t id = s_ids[n % ID_COUNT];
+        uint8_t data[8];
+        for (int i = 0; i < 8; i++) {
+            data[i] = (uint8_t)next_random();
+        }
+        ecu_data_t legacy, table;
+        memset(&legacy, 0, sizeof(legacy));
+        memset(&table, 0, sizeof(table));
+        legacy_parse(id, data, &legacy);
+        can_decoder_decode(id, data, 8, &table);
+        if (!same_signals(&legacy, &table)) {
+            if (mismatches++ < 5) {
+                printf("mismatch for ID 0x%03X data %02X %02X %02X %02X %02X %02X %02X %02X\n", (unsigned)id,
+                       data[0], data[1], data[2], data[3], data[4], data[5], data[6], data[7]);
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+    printf("{\"test\":\"equivalence\",\"frames\":%u,\"ids\":%zu,\"mismatches\":%u}\n",
+           (unsigned)frames, ID_COUNT, (unsigned)mismatches);
+}
+
+// Both paths over the same random frames; the checksum keeps the decodes from being optimized away
+static void bench(uint32_t frames)
+{
+    uint8_t (*data)[8] = malloc((size_t)frames * 8);
+    uint32_t *ids = malloc((size_t)frames * sizeof(uint32_t));
+    if (!data || !ids) {
+        printf("FAIL: cannot allocate %u frames\n", (unsigned)frames);
+        failures++;
+        free(data);
+        free(ids);
+        return;
+    }
+    for (uint32_t n = 0; n < frames; n++) {
+        ids[n] = s_ids[next_random() % ID_COUNT];
+        for (int i = 0; i < 8; i++) {
+            data[n][i] = (uint8_t)next_random();
+        }
+    }
+
+    ecu_data_t ecu;
+    memset(&ecu, 0, sizeof(ecu));
+    uint64_t start = now_ns();
+    for (uint32_t n = 0; n < frames; n++) {
+        legacy_parse(ids[n], data[n], &ecu);
+    }
+    uint64_t legacy_ns = now_ns() - start;
+    volatile float sink = ecu.engine_rpm + ecu.map_kpa + ecu.limit_tq_nm;
+
+    memset(&ecu, 0, sizeof(ecu));
+    start = now_ns();
+    for (uint32_t n = 0; n < frames; n++) {
+        can_decoder_decode(ids[n], data[n], 8, &ecu);
+    }
+    uint64_t table_ns = now_ns() - start;
+    sink += ecu.engine_rpm + ecu.map_kpa + ecu.limit_tq_nm;
+    (void)sink;
+
+    printf("{\"bench\":\"decode\",\"frames\":%u,\"legacy_ns_per_frame\":%.1f,\"table_ns_per_frame\":%.1f,"
+           "\"table_vs_legacy\":%.2f}\n", (unsigned)frames, (double)legacy_ns / frames,
+           (double)table_ns / frames, legacy_ns ? (double)table_ns / legacy_ns : 0.0);
+    free(data);
+    free(ids);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = argc > 1 ? (uint32_t)atoi(argv[1]) : 1000000;
+    if (frames < 1000) frames = 1000;
+
+    if (can_parser_init() != ESP_OK) {
+        printf("FAIL: cannot build the built-in signal table\n");
+        return 1;
+    }
+    can_parser_set_max_torque(MAX_TORQUE_NM);
+
+    test_layouts();
+    test_short_dlc();
+    test_equivalence(frames / 5);
+    bench(frames);
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
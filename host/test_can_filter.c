@@ -0,0 +1,267 @@
+// Host test for the TWAI acceptance filter planner: every wanted identifier passes, the
+// reported fractions match the filter, and on recorded traffic (the VW powertrain profile
+// or a stream file) the plan for the built-in decoder rejects part of the bus.
+//   test_can_filter [-n frames] [-p stream file]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "include/can_filter.h"
+#include "include/can_parser.h"
+#include "can_traffic.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while (0)
+
+static uint32_t s_rng = 12345;
+
+static uint32_t next_random(void)
+{
+    s_rng = s_rng * 1103515245U + 12345U;
+    return s_rng >> 8;
+}
+
+static char *read_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *text = malloc((size_t)size + 1);
+    if (text && fread(text, 1, (size_t)size, f) != (size_t)size) {
+        free(text);
+        text = NULL;
+    }
+    if (text) text[size] = '\0';
+    fclose(f);
+    return text;
+}
+
+// Standard identifiers a plan lets through
+static uint32_t std_ids_accepted(const can_filter_plan_t *plan)
+{
+    uint32_t n = 0;
+    for (uint32_t id = 0; id <= 0x7FF; id++) {
+        n += can_filter_accepts(plan->acceptance_code, plan->acceptance_mask, plan->single_filter, id);
+    }
+    return n;
+}
+
+// Recount what the plan reports, frame by frame
+static void check_fractions(const can_filter_plan_t *plan, const uint32_t *wanted, size_t wanted_count,
+                            const can_filter_id_count_t *traffic, size_t traffic_count)
+{
+    uint64_t frames = 0, accepted = 0, unwanted = 0;
+    for (size_t t = 0; t < traffic_count; t++) {
+        frames += traffic[t].count;
+        if (!can_filter_accepts(plan->acceptance_code, plan->acceptance_mask, plan->single_filter, traffic[t].id)) {
+            continue;
+        }
+        accepted += traffic[t].count;
+        bool want = false;
+        for (size_t w = 0; w < wanted_count; w++) {
+            want |= wanted[w] == traffic[t].id;
+        }
+        if (!want) unwanted += traffic[t].count;
+    }
+    CHECK(plan->traffic_frames == frames);
+    if (frames) {
+        CHECK(plan->accepted_fraction == (float)accepted / (float)frames);
+        CHECK(plan->unwanted_fraction == (float)unwanted / (float)frames);
+    }
+}
+
+static void test_known_sets(void)
+{
+    can_filter_plan_t plan;
+
+    // Two identifiers one bit apart: one filter, nothing else passes
+    const uint32_t pair[] = { 0x288, 0x280 };
+    CHECK(can_filter_plan(pair, 2, NULL, 0, &plan) == ESP_OK);
+    CHECK(!plan.accept_all);
+    // No traffic: not rated
+    CHECK(plan.traffic_frames == 0 && plan.accepted_fraction == 0.0f && plan.unwanted_fraction == 0.0f);
+    CHECK(std_ids_accepted(&plan) == 2);
+    CHECK(can_filter_accepts(plan.acceptance_code, plan.acceptance_mask, plan.single_filter, 0x280));
+    CHECK(can_filter_accepts(plan.acceptance_code, plan.acceptance_mask, plan.single_filter, 0x288));
+
+    // Two unrelated identifiers: a single filter would pass 2^11, dual passes exactly both
+    const uint32_t apart[] = { 0x000, 0x7FF };
+    CHECK(can_filter_plan(apart, 2, NULL, 0, &plan) == ESP_OK);
+    CHECK(!plan.single_filter);
+    CHECK(std_ids_accepted(&plan) == 2);
+
+    // Mixed formats
+    const uint32_t mixed[] = { 0x280, 0x18FEF1E5 | CAN_DECODER_ID_EXT_FLAG };
+    CHECK(can_filter_plan(mixed, 2, NULL, 0, &plan) == ESP_OK);
+    CHECK(can_filter_accepts(plan.acceptance_code, plan.acceptance_mask, plan.single_filter, mixed[0]));
+    CHECK(can_filter_accepts(plan.acceptance_code, plan.acceptance_mask, plan.single_filter, mixed[1]));
+
+    CHECK(can_filter_plan(NULL, 0, NULL, 0, &plan) == ESP_OK);
+    CHECK(plan.accept_all && plan.acceptance_mask == 0xFFFFFFFF);
+
+    static uint32_t too_many[CAN_FILTER_MAX_IDS + 1];
+    for (size_t i = 0; i < CAN_FILTER_MAX_IDS + 1; i++) too_many[i] = (uint32_t)i;
+    CHECK(can_filter_plan(too_many, CAN_FILTER_MAX_IDS + 1, NULL, 0, &plan) == ESP_ERR_INVALID_SIZE);
+}
+
+// Random identifier sets on random traffic: nothing wanted is ever filtered out
+static void test_random_sets(void)
+{
+    static can_filter_id_count_t traffic[200];
+    uint32_t wanted[CAN_FILTER_MAX_IDS];
+
+    for (int round = 0; round < 300; round++) {
+        bool ext = round % 3 == 2;
+        size_t traffic_count = 20 + next_random() % 180;
+        for (size_t t = 0; t < traffic_count; t++) {
+            uint32_t id = ext && (next_random() & 1) ? (next_random() & 0x1FFFFFFF) | CAN_DECODER_ID_EXT_FLAG
+                                                     : next_random() & 0x7FF;
+            traffic[t] = (can_filter_id_count_t) { id, 1 + next_random() % 100 };
+        }
+        // Mostly identifiers seen on the bus, some that are not
+        size_t wanted_count = 1 + next_random() % (round % 2 ? CAN_FILTER_MAX_IDS : CAN_FILTER_EXHAUSTIVE_MAX);
+        for (size_t w = 0; w < wanted_count; w++) {
+            wanted[w] = next_random() % 4 ? traffic[next_random() % traffic_count].id : next_random() & 0x7FF;
+        }
+
+        can_filter_plan_t plan;
+        CHECK(can_filter_plan(wanted, wanted_count, traffic, traffic_count, &plan) == ESP_OK);
+        for (size_t w = 0; w < wanted_count; w++) {
+            CHECK(can_filter_accepts(plan.acceptance_code, plan.acceptance_mask, plan.single_filter, wanted[w]));
+        }
+        check_fractions(&plan, wanted, wanted_count, traffic, traffic_count);
+        if (failures) {
+            printf("  round %d: %u wanted, code 0x%08X mask 0x%08X %s\n", round, (unsigned)wanted_count,
+                   plan.acceptance_code, plan.acceptance_mask, plan.single_filter ? "single" : "dual");
+            return;
+        }
+    }
+}
+
+static void test_traffic_counter(void)
+{
+    static can_filter_traffic_t counter;
+    static can_filter_id_count_t out[CAN_FILTER_TRAFFIC_SLOTS];
+    can_frame_t frame = { 0 };
+
+    can_filter_traffic_reset(&counter);
+    for (uint32_t i = 0; i < 3 * (CAN_FILTER_TRAFFIC_SLOTS + 10); i++) {
+        frame.id = i % (CAN_FILTER_TRAFFIC_SLOTS + 10);
+        can_filter_traffic_add(&counter, &frame, 1);
+    }
+    size_t count = can_filter_traffic_get(&counter, out, CAN_FILTER_TRAFFIC_SLOTS);
+    uint64_t counted = 0;
+    for (size_t i = 0; i < count; i++) counted += out[i].count;
+
+    CHECK(count == CAN_FILTER_TRAFFIC_SLOTS);
+    CHECK(counter.frames == 3 * (CAN_FILTER_TRAFFIC_SLOTS + 10));
+    CHECK(counter.overflow == 3 * 10);
+    CHECK(counted + counter.overflow == counter.frames);
+}
+
+// The built-in decoder on recorded traffic, as the CAN task plans it
+static void test_recorded_traffic(can_traffic_config_t *config, uint32_t frames)
+{
+    CHECK(can_parser_init() == ESP_OK);
+    uint32_t wanted[CAN_FILTER_MAX_IDS];
+    size_t wanted_count = can_filter_wanted_ids(can_decoder_get_active(), wanted, CAN_FILTER_MAX_IDS);
+    CHECK(wanted_count > 0 && wanted_count <= CAN_FILTER_MAX_IDS);
+    if (wanted_count == 0 || wanted_count > CAN_FILTER_MAX_IDS) return;
+    for (size_t i = 1; i < wanted_count; i++) {
+        CHECK(wanted[i - 1] < wanted[i]);
+    }
+
+    can_traffic_t bus;
+    static can_filter_traffic_t counter;
+    static can_frame_t batch[64];
+    static can_filter_id_count_t traffic[CAN_FILTER_TRAFFIC_SLOTS];
+    CHECK(can_traffic_init(&bus, config) == ESP_OK);
+    can_filter_traffic_reset(&counter);
+    while (counter.frames < frames) {
+        can_filter_traffic_add(&counter, batch, can_traffic_next(&bus, batch, 64));
+    }
+    size_t traffic_count = can_filter_traffic_get(&counter, traffic, CAN_FILTER_TRAFFIC_SLOTS);
+
+    can_filter_plan_t plan;
+    CHECK(can_filter_plan(wanted, wanted_count, traffic, traffic_count, &plan) == ESP_OK);
+    for (size_t w = 0; w < wanted_count; w++) {
+        CHECK(can_filter_accepts(plan.acceptance_code, plan.acceptance_mask, plan.single_filter, wanted[w]));
+    }
+    check_fractions(&plan, wanted, wanted_count, traffic, traffic_count);
+
+    // Never worse than the one filter over all identifiers (11-bit sets)
+    uint64_t single_unwanted = 0;
+    uint32_t single_code, single_mask = 0;
+    for (size_t w = 0; w < wanted_count; w++) {
+        single_mask |= w ? (wanted[w] ^ wanted[0]) << 21 : 0x1FFFFF;
+    }
+    single_code = (wanted[0] << 21) & ~single_mask;
+    for (size_t t = 0; t < traffic_count; t++) {
+        bool want = false;
+        for (size_t w = 0; w < wanted_count; w++) want |= wanted[w] == traffic[t].id;
+        if (!want && can_filter_accepts(single_code, single_mask, true, traffic[t].id)) {
+            single_unwanted += traffic[t].count;
+        }
+    }
+    bool all_std = true;
+    for (size_t w = 0; w < wanted_count; w++) all_std &= (wanted[w] & CAN_DECODER_ID_EXT_FLAG) == 0;
+    if (all_std) {
+        CHECK(plan.unwanted_fraction * plan.traffic_frames <= (float)single_unwanted + 0.5f);
+    }
+    CHECK(plan.accepted_fraction < 1.0f);
+
+    printf("{\"traffic\":\"%s\",\"frames\":%lu,\"ids\":%u,\"wanted_ids\":%u,\"mode\":\"%s\",\"code\":\"0x%08X\","
+           "\"mask\":\"0x%08X\",\"accepted_pct\":%.1f,\"unwanted_pct\":%.1f,\"std_ids_accepted\":%u}\n",
+           config->name, (unsigned long)plan.traffic_frames, (unsigned)traffic_count, (unsigned)wanted_count,
+           plan.single_filter ? "single" : "dual", plan.acceptance_code, plan.acceptance_mask,
+           100.0f * plan.accepted_fraction, 100.0f * plan.unwanted_fraction, std_ids_accepted(&plan));
+}
+
+int main(int argc, char **argv)
+{
+    can_traffic_config_t config;
+    can_traffic_config_vw_powertrain(&config);
+    static can_traffic_stream_t file_streams[CAN_TRAFFIC_MAX_STREAMS];
+    uint32_t frames = 100000;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:p:")) != -1) {
+        switch (opt) {
+        case 'n': frames = (uint32_t)atoi(optarg); break;
+        case 'p': {
+            char *text = read_file(optarg);
+            esp_err_t ret = text ? can_traffic_parse_streams(text, file_streams, CAN_TRAFFIC_MAX_STREAMS,
+                                                             &config.stream_count) : ESP_ERR_NOT_FOUND;
+            free(text);
+            if (ret != ESP_OK) {
+                printf("FAIL: cannot read streams from %s: %s\n", optarg, esp_err_to_name(ret));
+                return 1;
+            }
+            config.streams = file_streams;
+            config.name = optarg;
+            break;
+        }
+        default:
+            printf("usage: %s [-n frames] [-p stream file]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (frames < 1000) frames = 1000;
+
+    test_known_sets();
+    test_random_sets();
+    test_traffic_counter();
+    test_recorded_traffic(&config, frames);
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All CAN filter tests passed\n");
+    return 0;
+}
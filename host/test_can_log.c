@@ -0,0 +1,400 @@
+// Host test for the binary CAN trace logger: 100% bus load at 500 kbit/s into files in a
+// temporary directory with size and time rotation, then every frame read back in order.
+// A burst larger than the logger queue checks that lost frames are counted and marked.
+// The pre-allocated log files underneath are checked on their own first, the raw and
+// CSV export of the logged session afterwards. With the default configuration the running
+// logger and sniffer must leave the CAN task free to program an acceptance filter.
+//   test_can_log [seconds]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#include "include/can_fanout.h"
+#include "include/can_log.h"
+#include "include/can_log_export.h"
+#include "include/can_filter.h"
+#include "include/can_parser.h"
+#include "include/can_sniffer.h"
+#include "sd_log_file.h"
+
+#define BUS_BITRATE         500000
+#define FRAME_BITS          111     // 8 byte data frame, 11-bit ID, no stuff bits
+#define MAX_FILES           64
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while (0)
+
+// Frame n carries n in its data and timestamp, so order and gaps are visible
+static void make_frame(can_frame_t *frame, uint32_t n)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->timestamp_us = n;
+    frame->id = 0x280 + (n % 7);
+    frame->dlc = 8;
+    memcpy(frame->data, &n, sizeof(n));
+    uint32_t inverted = ~n;
+    memcpy(&frame->data[4], &inverted, sizeof(inverted));
+}
+
+typedef struct {
+    double seconds;
+    uint32_t published;
+    atomic_bool done;
+} bus_ctx_t;
+
+// The CAN task: publishes every frame that finished on the bus, ~4500 frames/s
+static void *bus_thread(void *arg)
+{
+    bus_ctx_t *ctx = arg;
+    const double frame_us = FRAME_BITS * 1e6 / BUS_BITRATE;
+    const uint32_t total = (uint32_t)(ctx->seconds * 1e6 / frame_us);
+    const int64_t start = esp_timer_get_time();
+    can_frame_t batch[32];
+
+    while (ctx->published < total) {
+        double now = (double)(esp_timer_get_time() - start);
+        size_t count = 0;
+        while (count < 32 && ctx->published + count < total && (ctx->published + count) * frame_us <= now) {
+            make_frame(&batch[count], ctx->published + count);
+            count++;
+        }
+        can_fanout_publish(batch, count);
+        ctx->published += count;
+        struct timespec ts = { .tv_sec = 0, .tv_nsec = 200000 };
+        nanosleep(&ts, NULL);
+    }
+    atomic_store(&ctx->done, true);
+    return NULL;
+}
+
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+typedef struct {
+    uint32_t files;
+    uint32_t frames;
+    uint32_t lost;          // Sum of the lost fields
+    uint32_t out_of_order;
+} readback_t;
+
+// Read every file of the session in order; frames must be consecutive except where marked lost
+static void read_session(const char *dir, uint32_t session, readback_t *rb)
+{
+    char *names[MAX_FILES];
+    uint32_t count = 0;
+    char prefix[8];
+    snprintf(prefix, sizeof(prefix), "%04u", session);
+    DIR *d = opendir(dir);
+    struct dirent *entry;
+    while (d && (entry = readdir(d)) != NULL && count < MAX_FILES) {
+        if (strncmp(entry->d_name, prefix, 4) == 0) names[count++] = strdup(entry->d_name);
+    }
+    if (d) closedir(d);
+    qsort(names, count, sizeof(names[0]), compare_names);
+
+    memset(rb, 0, sizeof(*rb));
+    uint32_t expected = 0;
+    for (uint32_t f = 0; f < count; f++) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s", dir, names[f]);
+        FILE *file = fopen(path, "rb");
+        CHECK(file != NULL);
+        if (!file) continue;
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        CHECK(size % CAN_LOG_ALIGN == 0);
+
+        uint8_t record[CAN_LOG_RECORD_SIZE];
+        can_log_header_t header;
+        CHECK(fread(record, 1, sizeof(record), file) == sizeof(record));
+        CHECK(can_log_decode_header(record, &header) == ESP_OK);
+        CHECK(header.session == session && header.file_index == f);
+        CHECK(header.data_bytes == size);   // Closed cleanly: truncated to the synced length
+
+        for (long pos = sizeof(record); pos < (long)header.data_bytes &&
+             fread(record, 1, sizeof(record), file) == sizeof(record); pos += sizeof(record)) {
+            can_frame_t frame;
+            uint16_t lost;
+            if (!can_log_decode_record(record, &frame, &lost)) continue;
+            uint32_t n, inverted;
+            memcpy(&n, frame.data, sizeof(n));
+            memcpy(&inverted, &frame.data[4], sizeof(inverted));
+            rb->lost += lost;
+            if (inverted != ~n || frame.timestamp_us != n || n != expected + lost) rb->out_of_order++;
+            expected = n + 1;
+            rb->frames++;
+        }
+        fclose(file);
+        free(names[f]);
+        rb->files++;
+    }
+}
+
+static long file_size(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+static void test_log_file(const char *dir)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "%s/prealloc.bin", dir);
+    uint8_t data[4 * SD_LOG_FILE_SECTOR];
+    memset(data, 0x5A, sizeof(data));
+
+    sd_log_file_t file;
+    CHECK(sd_log_file_create(&file, path, 8 * SD_LOG_FILE_SECTOR) == ESP_OK);
+    CHECK(file.preallocated && file_size(path) == 8 * SD_LOG_FILE_SECTOR);
+    CHECK(sd_log_file_write(&file, data, 3 * SD_LOG_FILE_SECTOR) == ESP_OK);
+    CHECK(sd_log_file_write(&file, data, 100) == ESP_ERR_INVALID_ARG);
+    CHECK(sd_log_file_write(&file, data, 4 * SD_LOG_FILE_SECTOR) == ESP_OK);
+    CHECK(sd_log_file_write(&file, data, 2 * SD_LOG_FILE_SECTOR) == ESP_ERR_INVALID_SIZE);
+    CHECK(sd_log_file_rewrite(&file, 0, data, SD_LOG_FILE_SECTOR) == ESP_OK);
+    CHECK(sd_log_file_rewrite(&file, 6 * SD_LOG_FILE_SECTOR, data, 2 * SD_LOG_FILE_SECTOR) == ESP_ERR_INVALID_ARG);
+    CHECK(sd_log_file_sync(&file) == ESP_OK);
+    CHECK(file_size(path) == 8 * SD_LOG_FILE_SECTOR);   // Writes do not grow the file
+    CHECK(sd_log_file_close(&file) == ESP_OK);
+    CHECK(file_size(path) == 7 * SD_LOG_FILE_SECTOR);
+    remove(path);
+}
+
+static void test_range_parser(void)
+{
+    uint32_t start, end;
+    CHECK(can_log_export_parse_range("bytes=100-2047", 4608, &start, &end) == ESP_OK && start == 100 && end == 2047);
+    CHECK(can_log_export_parse_range("bytes=10-", 4608, &start, &end) == ESP_OK && start == 10 && end == 4607);
+    CHECK(can_log_export_parse_range("bytes=10-99999999", 4608, &start, &end) == ESP_OK && end == 4607);
+    CHECK(can_log_export_parse_range("bytes=-100", 4608, &start, &end) == ESP_OK && start == 4508 && end == 4607);
+    CHECK(can_log_export_parse_range("bytes=-9999", 4608, &start, &end) == ESP_OK && start == 0);
+    CHECK(can_log_export_parse_range("bytes=4608-", 4608, &start, &end) == ESP_ERR_INVALID_SIZE);
+    CHECK(can_log_export_parse_range("bytes=-0", 4608, &start, &end) == ESP_ERR_INVALID_SIZE);
+    CHECK(can_log_export_parse_range("bytes=0-1,5-6", 4608, &start, &end) == ESP_ERR_NOT_SUPPORTED);
+    CHECK(can_log_export_parse_range("bytes=5-1", 4608, &start, &end) == ESP_ERR_NOT_SUPPORTED);
+    CHECK(can_log_export_parse_range("items=0-1", 4608, &start, &end) == ESP_ERR_NOT_SUPPORTED);
+}
+
+// Every file of the session downloaded raw (whole and as a resumed range) and as CSV
+static void test_export(const char *dir, uint32_t session, uint32_t frames)
+{
+    can_log_file_info_t files[MAX_FILES];
+    size_t count = can_log_list_files(dir, files, MAX_FILES);
+    CHECK(count > 1);
+
+    static uint8_t contents[8 * CAN_LOG_BLOCK_SIZE];
+    static char chunk[4096];
+    char row[CAN_LOG_EXPORT_CSV_ROW_MAX + 1];
+    size_t row_len = 0;
+    uint32_t rows = 0, bad_rows = 0;
+    uint32_t expected = 0;
+
+    for (size_t f = 0; f < count; f++) {
+        char path[256];
+        int path_len = snprintf(path, sizeof(path), "%s/%s", dir, files[f].name);
+        CHECK(path_len > 0 && (size_t)path_len < sizeof(path));
+        CHECK(files[f].session == session && files[f].index == f && (f == 0 || strcmp(files[f - 1].name, files[f].name) < 0));
+        FILE *file = fopen(path, "rb");
+        size_t size = file ? fread(contents, 1, sizeof(contents), file) : 0;
+        if (file) fclose(file);
+        CHECK(size == files[f].bytes);
+
+        // Raw: the file as is
+        can_log_export_t exp;
+        size_t len, total = 0;
+        bool same = true;
+        CHECK(can_log_export_open(&exp, path, CAN_LOG_EXPORT_RAW) == ESP_OK && exp.length == size);
+        while (can_log_export_read(&exp, chunk, sizeof(chunk), &len) == ESP_OK && len > 0) {
+            same = same && total + len <= size && memcmp(chunk, &contents[total], len) == 0;
+            total += len;
+        }
+        can_log_export_close(&exp);
+        CHECK(same && total == size);
+
+        // Raw range from an unaligned offset, as a resumed download asks for it
+        uint32_t start, end;
+        CHECK(can_log_export_open(&exp, path, CAN_LOG_EXPORT_RAW) == ESP_OK);
+        CHECK(can_log_export_parse_range("bytes=1000-", exp.length, &start, &end) == ESP_OK);
+        CHECK(can_log_export_set_range(&exp, start, end) == ESP_OK);
+        total = 0;
+        same = true;
+        while (can_log_export_read(&exp, chunk, sizeof(chunk), &len) == ESP_OK && len > 0) {
+            same = same && 1000 + total + len <= size && memcmp(chunk, &contents[1000 + total], len) == 0;
+            total += len;
+        }
+        can_log_export_close(&exp);
+        CHECK(same && total == size - 1000);
+
+        // CSV through a small buffer: a column line, then one row per frame in order
+        CHECK(can_log_export_open(&exp, path, CAN_LOG_EXPORT_CSV) == ESP_OK);
+        bool columns = true;
+        while (can_log_export_read(&exp, chunk, 200, &len) == ESP_OK && len > 0) {
+            for (size_t i = 0; i < len; i++) {
+                if (row_len < sizeof(row) - 1) row[row_len++] = chunk[i];
+                if (chunk[i] != '\n') continue;
+                row[row_len] = '\0';
+                row_len = 0;
+                if (columns) {
+                    CHECK(strncmp(row, "timestamp_us,id,dlc", 19) == 0);
+                    columns = false;
+                    continue;
+                }
+                // Frame n: timestamp n, ID 0x280 + n % 7, 8 bytes starting with n little endian
+                char want[32];
+                snprintf(want, sizeof(want), "%u,%03X,8,0,0,%02X,", expected, 0x280 + expected % 7, expected & 0xFF);
+                if (strncmp(row, want, strlen(want)) != 0) bad_rows++;
+                expected++;
+                rows++;
+            }
+        }
+        can_log_export_close(&exp);
+        CHECK(!columns);
+    }
+    CHECK(rows == frames && bad_rows == 0);
+}
+
+static void test_full_bus_load(const char *dir, double seconds)
+{
+    can_log_config_t config;
+    can_log_default_config(&config, dir);
+    config.max_file_bytes = 4 * CAN_LOG_BLOCK_SIZE;   // About 3.5 s of a full bus
+    config.max_file_s = 1;
+    config.sync_ms = 200;
+    CHECK(can_log_start(&config) == ESP_OK);
+    CHECK(can_log_start(&config) == ESP_ERR_INVALID_STATE);
+
+    bus_ctx_t bus = { .seconds = seconds };
+    pthread_t thread;
+    pthread_create(&thread, NULL, bus_thread, &bus);
+    pthread_join(thread, NULL);
+    CHECK(can_log_stop() == ESP_OK);
+
+    can_log_stats_t stats;
+    can_log_get_stats(&stats);
+    readback_t rb;
+    read_session(dir, stats.session, &rb);
+    printf("{\"test\":\"full_bus_load\",\"frames\":%u,\"logged\":%u,\"dropped\":%u,\"files\":%u,"
+           "\"blocks\":%u,\"buffer_waits\":%u,\"write_avg_us\":%u,\"write_max_us\":%u,\"sync_max_us\":%u,"
+           "\"create_max_us\":%u}\n",
+           bus.published, stats.frames_logged, stats.frames_dropped, stats.files, stats.blocks_written,
+           stats.buffer_waits, stats.write_avg_us, stats.write_max_us, stats.sync_max_us,
+           stats.create_max_us);
+
+    CHECK(!stats.running);
+    CHECK(stats.frames_dropped == 0 && stats.write_errors == 0 && stats.files_fragmented == 0);
+    CHECK(stats.frames_logged == bus.published);
+    CHECK(rb.frames == bus.published && rb.lost == 0 && rb.out_of_order == 0);
+    CHECK(rb.files == stats.files && rb.files >= (uint32_t)seconds);   // Rotated at least every second
+
+    test_export(dir, stats.session, rb.frames);
+}
+
+static void test_lost_frames(const char *dir)
+{
+    can_log_config_t config;
+    can_log_default_config(&config, dir);
+    config.sync_ms = 100;
+    CHECK(can_log_start(&config) == ESP_OK);
+
+    // More frames at once than the logger queue holds: the rest is lost and marked
+    const uint32_t burst = 3 * CONFIG_CAN_LOG_QUEUE_SIZE;
+    can_frame_t frame;
+    for (uint32_t n = 0; n < burst; n++) {
+        make_frame(&frame, n);
+        can_fanout_publish(&frame, 1);
+    }
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = 100 * 1000000 };
+    nanosleep(&ts, NULL);
+    make_frame(&frame, burst);
+    can_fanout_publish(&frame, 1);
+    CHECK(can_log_stop() == ESP_OK);
+
+    can_log_stats_t stats;
+    can_log_get_stats(&stats);
+    readback_t rb;
+    read_session(dir, stats.session, &rb);
+    CHECK(stats.frames_dropped == burst - CONFIG_CAN_LOG_QUEUE_SIZE);
+    CHECK(rb.frames == CONFIG_CAN_LOG_QUEUE_SIZE + 1 && rb.files == 1);
+    CHECK(rb.lost == stats.frames_dropped && rb.out_of_order == 0);
+}
+
+// The filter canbus_update_filter() installs with these consumers subscribed
+static bool filter_planned(void)
+{
+    can_filter_plan_t plan;
+    can_filter_plan_for_table(can_decoder_get_active(), can_fanout_all_ids_mask(), NULL, 0, &plan);
+    return !plan.accept_all && can_filter_accepts(plan.acceptance_code, plan.acceptance_mask, plan.single_filter, 0x280);
+}
+
+static void test_default_filter(const char *dir)
+{
+    can_log_config_t config;
+    can_log_default_config(&config, dir);
+    CHECK(!config.all_ids);
+    CHECK(can_parser_init() == ESP_OK && can_sniffer_init() == ESP_OK);
+    CHECK(can_log_start(&config) == ESP_OK);
+
+    // Both consumers active, neither needs identifiers nothing decodes
+    CHECK(can_fanout_active_mask() != 0 && can_fanout_all_ids_mask() == 0);
+    CHECK(filter_planned());
+
+    // Sniffer view on screen: the whole bus
+    can_sniffer_set_all_ids(true);
+    CHECK(!filter_planned());
+    can_sniffer_set_all_ids(false);
+    CHECK(filter_planned());
+    CHECK(can_log_stop() == ESP_OK);
+
+    // Logger of the whole bus (CONFIG_CAN_LOG_ALL_IDS)
+    config.all_ids = true;
+    CHECK(can_log_start(&config) == ESP_OK);
+    CHECK(!filter_planned());
+    CHECK(can_log_stop() == ESP_OK);
+    CHECK(filter_planned());
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 3.0;
+    if (seconds < 1.0) seconds = 1.0;
+
+    char dir[] = "/tmp/can_log_XXXXXX";
+    if (!mkdtemp(dir)) {
+        printf("FAIL: cannot create a temporary directory\n");
+        return 1;
+    }
+
+    test_log_file(dir);
+    test_range_parser();
+    test_full_bus_load(dir, seconds);
+    test_lost_frames(dir);
+
+    // The next session continues the numbering
+    can_log_stats_t stats;
+    can_log_get_stats(&stats);
+    CHECK(stats.session == 2);
+
+    test_default_filter(dir);
+
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "rm -r %s", dir);
+    if (system(cmd) != 0) printf("Could not remove %s\n", dir);
+
+    if (failures) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("CAN log: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,330 @@
+// Host test for the CAN trace replay: the same frames written as a binary trace, a candump
+// log and ASC files (hex and decimal, absolute and relative time stamps) must read back
+// alike, paced as recorded, N times faster or all at once, with looping and the end of the
+// trace reported.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "include/can_replay.h"
+#include "include/can_log.h"
+#include "include/can_decoder.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while (0)
+
+#define FRAME_COUNT 5
+
+// Trace times after the first frame, as written to the files below
+static const int64_t s_times_us[FRAME_COUNT] = { 0, 10000, 25000, 25000, 1000000 };
+
+static const can_frame_t s_frames[FRAME_COUNT] = {
+    { .id = 0x280, .dlc = 8, .data = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 } },
+    { .id = 0x18FEF1E5 | CAN_DECODER_ID_EXT_FLAG, .dlc = 3, .data = { 0xAA, 0xBB, 0xCC } },
+    { .id = 0x7DF, .dlc = 0 },
+    { .id = 0x123, .dlc = 2, .flags = CAN_FRAME_FLAG_RTR },
+    { .id = 0x5A0, .dlc = 1, .data = { 0xFF } },
+};
+
+static const char *CANDUMP_TRACE =
+    "(1436509052.249713) can0 280#0102030405060708\n"
+    "(1436509052.259713) can0 18FEF1E5#AABBCC\n"
+    "(1436509052.262000) can0 20000080#0000000000000000\n"     // Error frame
+    "(1436509052.274713) can0 7DF#\n"
+    "(1436509052.274713) can0 123#R2\n"
+    "(1436509052.280000) can0 321##10011223344\n"              // CAN FD
+    "(1436509053.249713) can0 5A0#FF\n";
+
+static const char *ASC_HEX_TRACE =
+    "date Thu Jul 9 10:57:32.249 am 2015\n"
+    "base hex  timestamps absolute\n"
+    "internal events logged\n"
+    "Begin Triggerblock Thu Jul 9 10:57:32.249 am 2015\n"
+    "   0.000000 Start of measurement\n"
+    "   1.249713 1  280             Rx   d 8 01 02 03 04 05 06 07 08  Length = 231910 BitCount = 119 ID = 640\n"
+    "   1.259713 1  18FEF1E5x       Rx   d 3 AA BB CC\n"
+    "   1.262000 1  ErrorFrame\n"
+    "   1.274713 1  7DF             Tx   d 0\n"
+    "   1.274713 1  123             Rx   r 2\n"
+    "   2.249713 1  5A0             Rx   d 1 FF\n"
+    "End TriggerBlock\n";
+
+static const char *ASC_DEC_RELATIVE_TRACE =
+    "date Thu Jul 9 10:57:32.249 am 2015\n"
+    "base dec  timestamps relative\n"
+    "   1.249713 1  640             Rx   d 8 1 2 3 4 5 6 7 8\n"
+    "   0.010000 1  419361253x      Rx   d 3 170 187 204\n"
+    "   0.015000 1  2015            Rx   d 0\n"
+    "   0.000000 1  291             Rx   r 2\n"
+    "   0.975000 1  1440            Rx   d 1 255\n";
+
+static void write_text(const char *path, const char *text)
+{
+    FILE *file = fopen(path, "w");
+    CHECK(file != NULL);
+    if (file) {
+        fputs(text, file);
+        fclose(file);
+    }
+}
+
+// Header unit, the frames with a padding record in between, and a stale record after
+// data_bytes that readers must not see
+static void write_binary(const char *path)
+{
+    static uint8_t buffer[CAN_LOG_ALIGN + 8 * CAN_LOG_RECORD_SIZE];
+    memset(buffer, 0, sizeof(buffer));
+    can_log_header_t header = {
+        .magic = { 'C', 'L', 'O', 'G' },
+        .version = CAN_LOG_VERSION,
+        .record_size = CAN_LOG_RECORD_SIZE,
+        .session = 1,
+        .start_us = 5000000,
+    };
+    for (size_t pos = CAN_LOG_RECORD_SIZE; pos < CAN_LOG_ALIGN; pos += CAN_LOG_RECORD_SIZE) {
+        uint32_t pad = CAN_LOG_ID_PAD;
+        memcpy(&buffer[pos + 8], &pad, sizeof(pad));
+    }
+    size_t pos = CAN_LOG_ALIGN;
+    for (int i = 0; i < FRAME_COUNT; i++) {
+        can_frame_t frame = s_frames[i];
+        frame.timestamp_us = 7000000 + s_times_us[i];
+        memcpy(&buffer[pos], &frame, sizeof(frame));
+        if (i == 1) {
+            uint16_t lost = 3;
+            memcpy(&buffer[pos + 22], &lost, sizeof(lost));
+        }
+        pos += CAN_LOG_RECORD_SIZE;
+        if (i == 2) {
+            uint32_t pad = CAN_LOG_ID_PAD;
+            memset(&buffer[pos], 0, CAN_LOG_RECORD_SIZE);
+            memcpy(&buffer[pos + 8], &pad, sizeof(pad));
+            pos += CAN_LOG_RECORD_SIZE;
+        }
+    }
+    header.data_bytes = (uint32_t)pos;
+    memcpy(buffer, &header, sizeof(header));
+    can_frame_t stale = s_frames[0];
+    memcpy(&buffer[pos], &stale, sizeof(stale));
+    pos += CAN_LOG_RECORD_SIZE;
+
+    FILE *file = fopen(path, "wb");
+    CHECK(file != NULL);
+    if (file) {
+        fwrite(buffer, 1, pos, file);
+        fclose(file);
+    }
+}
+
+static bool same_frame(const can_frame_t *a, const can_frame_t *b)
+{
+    return a->id == b->id && a->dlc == b->dlc && a->flags == b->flags &&
+           memcmp(a->data, b->data, a->dlc) == 0;
+}
+
+// All frames at once: content and format must match, time stamps are the call time
+static void test_read_all(const char *path, can_replay_format_t format, uint32_t skipped, uint32_t lost)
+{
+    can_replay_t replay;
+    can_replay_config_t config = { .format = CAN_REPLAY_FORMAT_AUTO, .speed = 0.0f };
+    CHECK(can_replay_open(&replay, path, &config) == ESP_OK);
+
+    can_frame_t frames[FRAME_COUNT + 2];
+    size_t count = 0;
+    CHECK(can_replay_receive_batch(&replay, frames, FRAME_COUNT + 2, &count, 42, NULL) == ESP_OK);
+    CHECK(count == FRAME_COUNT);
+    for (size_t i = 0; i < count && i < FRAME_COUNT; i++) {
+        CHECK(same_frame(&frames[i], &s_frames[i]));
+        CHECK(frames[i].timestamp_us == 42);
+    }
+    CHECK(can_replay_receive_batch(&replay, frames, FRAME_COUNT, &count, 43, NULL) == ESP_ERR_NOT_FOUND);
+    CHECK(count == 0);
+
+    can_replay_stats_t stats;
+    can_replay_get_stats(&replay, &stats);
+    CHECK(stats.format == format && stats.finished);
+    CHECK(stats.frames == FRAME_COUNT && stats.skipped == skipped && stats.recorder_lost == lost);
+    CHECK(stats.trace_us == s_times_us[FRAME_COUNT - 1]);
+    printf("{\"test\":\"read_all\",\"format\":\"%s\",\"frames\":%u,\"skipped\":%u,\"recorder_lost\":%u}\n",
+           can_replay_format_name(stats.format), (unsigned)stats.frames, (unsigned)stats.skipped,
+           (unsigned)stats.recorder_lost);
+    can_replay_close(&replay);
+}
+
+// Frames are due at start + trace time / speed; before that the replay says when
+static void test_pacing(const char *path, float speed)
+{
+    can_replay_t replay;
+    can_replay_config_t config = { .format = CAN_REPLAY_FORMAT_AUTO, .speed = speed };
+    CHECK(can_replay_open(&replay, path, &config) == ESP_OK);
+
+    const int64_t start_us = 1000000;
+    int64_t now_us = start_us;
+    can_frame_t frames[FRAME_COUNT];
+    size_t count, received = 0;
+    int timeouts = 0;
+    while (received < FRAME_COUNT) {
+        int64_t due_us = -1;
+        esp_err_t ret = can_replay_receive_batch(&replay, frames, FRAME_COUNT, &count, now_us, &due_us);
+        if (ret == ESP_ERR_TIMEOUT) {
+            CHECK(due_us > now_us);
+            CHECK(due_us == start_us + (int64_t)((double)s_times_us[received] / speed));
+            now_us = due_us;
+            timeouts++;
+            continue;
+        }
+        CHECK(ret == ESP_OK && count > 0);
+        if (ret != ESP_OK) {
+            break;
+        }
+        for (size_t i = 0; i < count; i++, received++) {
+            CHECK(frames[i].timestamp_us == start_us + (int64_t)((double)s_times_us[received] / speed));
+            CHECK(same_frame(&frames[i], &s_frames[received]));
+        }
+    }
+    CHECK(timeouts == 3);   // Frames 2 and 3 share their time stamp
+    CHECK(can_replay_receive_batch(&replay, frames, FRAME_COUNT, &count, now_us, NULL) == ESP_ERR_NOT_FOUND);
+
+    can_replay_close(&replay);
+
+    // Late calls hand out everything due since, and record how late
+    CHECK(can_replay_open(&replay, path, &config) == ESP_OK);
+    CHECK(can_replay_receive_batch(&replay, frames, FRAME_COUNT, &count, 0, NULL) == ESP_OK && count == 1);
+    CHECK(can_replay_receive_batch(&replay, frames, FRAME_COUNT, &count, 30000, NULL) == ESP_OK);
+    can_replay_stats_t stats;
+    can_replay_get_stats(&replay, &stats);
+    CHECK(count == 3);
+    CHECK(stats.late_max_us == (uint32_t)(30000 - (int64_t)((double)s_times_us[1] / speed)));
+    printf("{\"test\":\"pacing\",\"speed\":%.1f,\"timeouts\":%d,\"late_max_us\":%u}\n",
+           speed, timeouts, (unsigned)stats.late_max_us);
+    can_replay_close(&replay);
+}
+
+// Looping starts the next pass where the last one ended and never reports the end.
+// One frame per call, so the third pass ends with its last frame.
+static void test_loop(const char *path)
+{
+    can_replay_t replay;
+    can_replay_config_t config = { .format = CAN_REPLAY_FORMAT_AUTO, .speed = 1.0f, .loop = true };
+    CHECK(can_replay_open(&replay, path, &config) == ESP_OK);
+
+    can_frame_t frames[FRAME_COUNT];
+    size_t count;
+    int64_t now_us = 0, last_us = 0;
+    uint32_t received = 0;
+    bool ordered = true;
+    while (received < 3 * FRAME_COUNT) {
+        int64_t due_us;
+        esp_err_t ret = can_replay_receive_batch(&replay, frames, 1, &count, now_us, &due_us);
+        if (ret == ESP_ERR_TIMEOUT) {
+            now_us = due_us;
+            continue;
+        }
+        CHECK(ret == ESP_OK);
+        if (ret != ESP_OK) {
+            break;
+        }
+        for (size_t i = 0; i < count; i++, received++) {
+            ordered &= frames[i].timestamp_us >= last_us;
+            last_us = frames[i].timestamp_us;
+            CHECK(same_frame(&frames[i], &s_frames[received % FRAME_COUNT]));
+        }
+    }
+    can_replay_stats_t stats;
+    can_replay_get_stats(&replay, &stats);
+    CHECK(ordered);
+    CHECK(stats.loops == 2 && !stats.finished);
+    // Every pass starts right where the one before ended
+    CHECK(last_us == 3 * s_times_us[FRAME_COUNT - 1]);
+    printf("{\"test\":\"loop\",\"frames\":%u,\"loops\":%u,\"last_us\":%lld}\n",
+           (unsigned)stats.frames, (unsigned)stats.loops, (long long)last_us);
+    can_replay_close(&replay);
+}
+
+static void test_rejects(const char *dir)
+{
+    char path[256];
+    can_replay_t replay;
+    can_replay_config_t config = { .format = CAN_REPLAY_FORMAT_AUTO, .speed = 1.0f };
+    snprintf(path, sizeof(path), "%s/missing.log", dir);
+    CHECK(can_replay_open(&replay, path, &config) == ESP_ERR_NOT_FOUND);
+
+    snprintf(path, sizeof(path), "%s/notes.txt", dir);
+    write_text(path, "not a trace\nat all\n");
+    CHECK(can_replay_open(&replay, path, &config) == ESP_ERR_NOT_SUPPORTED);
+
+    // A trace without frames ends at once, also when looping
+    snprintf(path, sizeof(path), "%s/empty.asc", dir);
+    write_text(path, "date Thu Jul 9 10:57:32.249 am 2015\nbase hex  timestamps absolute\n");
+    config.loop = true;
+    CHECK(can_replay_open(&replay, path, &config) == ESP_OK);
+    can_frame_t frame;
+    size_t count;
+    CHECK(can_replay_receive_batch(&replay, &frame, 1, &count, 0, NULL) == ESP_ERR_NOT_FOUND);
+    can_replay_close(&replay);
+
+    // A binary trace asked for as such must be one
+    snprintf(path, sizeof(path), "%s/notes.txt", dir);
+    config.format = CAN_REPLAY_FORMAT_BINARY;
+    CHECK(can_replay_open(&replay, path, &config) == ESP_ERR_NOT_SUPPORTED);
+}
+
+static void test_parse_lines(void)
+{
+    can_frame_t frame;
+    int64_t trace_us;
+    CHECK(can_replay_parse_candump("(12.5) vcan0 1F334455#1122.3344", &frame, &trace_us));
+    CHECK(trace_us == 12500000 && frame.id == (0x1F334455 | CAN_DECODER_ID_EXT_FLAG));
+    CHECK(frame.dlc == 4 && frame.data[0] == 0x11 && frame.data[3] == 0x44);
+    CHECK(!can_replay_parse_candump("(12.5) can0 12#11", &frame, &trace_us));      // 2 digit ID
+    CHECK(!can_replay_parse_candump("(12.5) can0 123#112", &frame, &trace_us));    // Odd digits
+    CHECK(!can_replay_parse_candump("(12.5) can0 123#112233445566778899", &frame, &trace_us));
+    CHECK(!can_replay_parse_asc("   1.0 1  800  Rx   d 0", true, &frame, &trace_us));   // Not 11-bit
+    CHECK(!can_replay_parse_asc("   1.0 1  100  Rx   d 9 1 2 3 4 5 6 7 8 9", true, &frame, &trace_us));
+    CHECK(!can_replay_parse_asc("   1.0 CANFD 1 Rx 100 1 0 8 8 11 22 33 44 55 66 77 88", true, &frame, &trace_us));
+    CHECK(can_replay_parse_asc("12.000100\t2\t100\tTx\td\t1\t0A", true, &frame, &trace_us));
+    CHECK(trace_us == 12000100 && frame.id == 0x100 && frame.dlc == 1 && frame.data[0] == 0x0A);
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/can_replay_XXXXXX";
+    if (!mkdtemp(dir)) {
+        printf("FAIL: cannot create a temporary directory\n");
+        return 1;
+    }
+    char binary[256], candump[256], asc_hex[256], asc_dec[256];
+    snprintf(binary, sizeof(binary), "%s/00010000.CAN", dir);
+    snprintf(candump, sizeof(candump), "%s/trace.log", dir);
+    snprintf(asc_hex, sizeof(asc_hex), "%s/trace.asc", dir);
+    snprintf(asc_dec, sizeof(asc_dec), "%s/relative.asc", dir);
+    write_binary(binary);
+    write_text(candump, CANDUMP_TRACE);
+    write_text(asc_hex, ASC_HEX_TRACE);
+    write_text(asc_dec, ASC_DEC_RELATIVE_TRACE);
+
+    test_parse_lines();
+    test_read_all(binary, CAN_REPLAY_FORMAT_BINARY, 0, 3);
+    test_read_all(candump, CAN_REPLAY_FORMAT_CANDUMP, 2, 0);
+    test_read_all(asc_hex, CAN_REPLAY_FORMAT_ASC, 2, 0);
+    test_read_all(asc_dec, CAN_REPLAY_FORMAT_ASC, 0, 0);
+    test_pacing(candump, 1.0f);
+    test_pacing(asc_dec, 4.0f);
+    test_pacing(binary, 2.5f);
+    test_loop(asc_hex);
+    test_rejects(dir);
+
+    char command[300];
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    if (system(command) != 0) {
+        printf("warning: could not remove %s\n", dir);
+    }
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
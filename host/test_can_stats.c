@@ -0,0 +1,413 @@
+// Host test for the per-ID CAN statistics: frame lengths against a bit-serial encoder,
+// period and jitter figures (also over hours of frames), the table limit, paging, the
+// filtered mark, consistent snapshots while the CAN task writes, and the bus load of the
+// VW powertrain profile with and without stuff bits.
+//   test_can_stats [seconds of the concurrent run]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "esp_timer.h"
+#include "include/can_stats.h"
+#include "include/can_decoder.h"
+#include "can_traffic.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while (0)
+
+#define NEAR(a, b, tolerance) (fabs((double)(a) - (double)(b)) <= (tolerance))
+
+static uint32_t s_rng = 12345;
+
+static uint32_t next_random(void)
+{
+    s_rng = s_rng * 1103515245U + 12345U;
+    return s_rng >> 8;
+}
+
+static can_stats_id_t s_ids[CAN_STATS_SLOTS];
+
+// The snapshot refreshes at most every CAN_STATS_SNAPSHOT_MS
+static size_t fresh_snapshot(can_stats_bus_t *bus)
+{
+    usleep(CAN_STATS_SNAPSHOT_MS * 1000 + 1000);
+    return can_stats_snapshot(bus, s_ids, 0, CAN_STATS_SLOTS);
+}
+
+static void reset_stats(void)
+{
+    can_stats_reset();
+    can_stats_add(NULL, 0);
+}
+
+// ---- Reference: the frame bit by bit, stuffed the way the controller sends it ----
+
+static int push_bits(uint8_t *bits, int n, uint32_t value, int count)
+{
+    for (int i = count - 1; i >= 0; i--) {
+        bits[n++] = (value >> i) & 1;
+    }
+    return n;
+}
+
+static uint32_t reference_frame_bits(const can_frame_t *frame)
+{
+    uint8_t bits[160];
+    int n = 0;
+    bool ext = (frame->id & CAN_DECODER_ID_EXT_FLAG) != 0;
+    bool rtr = (frame->flags & CAN_FRAME_FLAG_RTR) != 0;
+    uint32_t raw = frame->id & ~CAN_DECODER_ID_EXT_FLAG;
+
+    n = push_bits(bits, n, 0, 1);                           // SOF
+    if (ext) {
+        n = push_bits(bits, n, raw >> 18, 11);
+        n = push_bits(bits, n, 3, 2);                       // SRR, IDE
+        n = push_bits(bits, n, raw & 0x3FFFF, 18);
+        n = push_bits(bits, n, rtr, 1);
+        n = push_bits(bits, n, 0, 2);                       // r1, r0
+    } else {
+        n = push_bits(bits, n, raw, 11);
+        n = push_bits(bits, n, rtr, 1);
+        n = push_bits(bits, n, 0, 2);                       // IDE, r0
+    }
+    n = push_bits(bits, n, frame->dlc, 4);
+    int data_bytes = rtr ? 0 : (frame->dlc > 8 ? 8 : frame->dlc);
+    for (int i = 0; i < data_bytes; i++) {
+        n = push_bits(bits, n, frame->data[i], 8);
+    }
+
+    uint32_t crc = 0;
+    for (int i = 0; i < n; i++) {
+        uint32_t next = bits[i] ^ ((crc >> 14) & 1);
+        crc = (crc << 1) & 0x7FFF;
+        if (next) crc ^= 0x4599;
+    }
+    n = push_bits(bits, n, crc, 15);
+
+    uint32_t stuffed = 0;
+    int run = 0;
+    uint8_t last = 1;
+    for (int i = 0; i < n; i++) {
+        run = bits[i] == last ? run + 1 : 1;
+        last = bits[i];
+        if (run == 5) {
+            stuffed++;
+            last ^= 1;
+            run = 1;
+        }
+    }
+    return (uint32_t)n + stuffed + 13;
+}
+
+static void test_frame_bits(void)
+{
+    can_frame_t frame = { 0 };
+    CHECK(can_stats_frame_bits(&frame) == 53);     // 47 bits, a stuff bit after every 5 zeros
+
+    uint32_t mismatches = 0;
+    for (int i = 0; i < 100000; i++) {
+        memset(&frame, 0, sizeof(frame));
+        bool ext = next_random() & 1;
+        frame.id = ext ? (next_random() & 0x1FFFFFFF) | CAN_DECODER_ID_EXT_FLAG : next_random() & 0x7FF;
+        frame.dlc = next_random() % 9;
+        frame.flags = (next_random() % 16) == 0 ? CAN_FRAME_FLAG_RTR : 0;
+        // Runs of equal bits are where stuffing happens: mix random, 0x00 and 0xFF bytes
+        uint32_t kind = next_random() % 3;
+        for (int b = 0; b < 8; b++) {
+            frame.data[b] = kind == 0 ? next_random() : (kind == 1 ? 0x00 : 0xFF);
+        }
+        uint32_t bits = can_stats_frame_bits(&frame);
+        if (bits != reference_frame_bits(&frame)) {
+            if (mismatches++ < 5) {
+                printf("FAIL: id 0x%X dlc %u: %u bits, reference %u\n", (unsigned)frame.id, frame.dlc,
+                       (unsigned)bits, (unsigned)reference_frame_bits(&frame));
+            }
+        }
+        uint8_t data_bytes = frame.flags ? 0 : frame.dlc;
+        uint32_t unstuffed = can_traffic_frame_bits(frame.id, data_bytes);
+        CHECK(bits >= unstuffed && bits <= unstuffed + (unstuffed - 13 - 1) / 4);
+    }
+    CHECK(mismatches == 0);
+}
+
+// ---- Periods, jitter, DLC changes and payload of one identifier ----
+
+static void test_periods(void)
+{
+    reset_stats();
+    const uint32_t id = 0x280;
+    can_frame_t frame = { .id = id, .dlc = 8 };
+    double sum = 0, sum_sq = 0;
+    uint32_t min = UINT32_MAX, max = 0, periods = 0, dlc_changes = 0;
+    int64_t t = 1000000;
+    for (int i = 0; i < 2000; i++) {
+        if (i > 0) {
+            uint32_t period = 10000 + (next_random() % 1001) - 500;    // 10 ms +-5 %
+            t += period;
+            sum += period;
+            sum_sq += (double)period * period;
+            if (period < min) min = period;
+            if (period > max) max = period;
+            periods++;
+        }
+        uint8_t dlc = (i % 500) == 499 ? 4 : 8;
+        if (i > 0 && dlc != frame.dlc) dlc_changes++;
+        frame.dlc = dlc;
+        frame.timestamp_us = t;
+        for (int b = 0; b < 8; b++) frame.data[b] = (uint8_t)(i + b);
+        can_stats_add(&frame, 1);
+    }
+
+    can_stats_bus_t bus;
+    size_t count = fresh_snapshot(&bus);
+    CHECK(count == 1 && bus.ids == 1 && bus.frames == 2000 && bus.overflow == 0);
+    if (count != 1) return;
+    const can_stats_id_t *stats = &s_ids[0];
+    double mean = sum / periods;
+    double std = sqrt(sum_sq / periods - mean * mean);
+    CHECK(stats->id == id && stats->count == 2000);
+    CHECK(NEAR(stats->period_mean_us, mean, 0.5));
+    CHECK(NEAR(stats->period_std_us, std, std * 0.01));
+    CHECK(stats->period_min_us == min && stats->period_max_us == max);
+    CHECK(stats->dlc_changes == dlc_changes && stats->dlc == frame.dlc);
+    CHECK(memcmp(stats->data, frame.data, 8) == 0);
+    printf("{\"test\":\"periods\",\"mean_us\":%.1f,\"expected_mean_us\":%.1f,\"std_us\":%.1f,"
+           "\"expected_std_us\":%.1f,\"min_us\":%u,\"max_us\":%u,\"dlc_changes\":%u}\n",
+           stats->period_mean_us, mean, stats->period_std_us, std, (unsigned)stats->period_min_us,
+           (unsigned)stats->period_max_us, (unsigned)stats->dlc_changes);
+
+    // A reset empties the table with the next batch
+    reset_stats();
+    CHECK(fresh_snapshot(&bus) == 0 && bus.frames == 0 && bus.bits == 0);
+}
+
+// Six hours of a 100 Hz ID with +-5 us of jitter: the spread stays exact, where float
+// accumulators drift once the sum of squares dwarfs each new term
+static void test_long_run(void)
+{
+    reset_stats();
+    can_frame_t frame = { .id = 0x5A0, .dlc = 8 };
+    const uint32_t frames = 6 * 3600 * 100;
+    int64_t t = 0;
+    for (uint32_t i = 0; i < frames; i++) {
+        t += 10000 + (int64_t)(i % 11) - 5;         // Uniform over 11 values: variance 10
+        frame.timestamp_us = t;
+        can_stats_add(&frame, 1);
+    }
+    can_stats_bus_t bus;
+    CHECK(fresh_snapshot(&bus) == 1);
+    CHECK(NEAR(s_ids[0].period_mean_us, 10000.0, 0.01));
+    CHECK(NEAR(s_ids[0].period_std_us, sqrt(10.0), 0.01));
+    printf("{\"test\":\"long_run\",\"frames\":%u,\"mean_us\":%.3f,\"std_us\":%.4f,\"expected_std_us\":%.4f}\n",
+           (unsigned)frames, s_ids[0].period_mean_us, s_ids[0].period_std_us, sqrt(10.0));
+}
+
+// ---- Every 11-bit identifier, more 29-bit identifiers than slots ----
+
+static void test_overflow(void)
+{
+    reset_stats();
+    can_frame_t frame = { .dlc = 1 };
+    for (uint32_t id = 0; id <= 0x7FF; id++) {
+        frame.id = id;
+        frame.timestamp_us = id;
+        can_stats_add(&frame, 1);
+    }
+    can_stats_bus_t bus;
+    size_t count = fresh_snapshot(&bus);
+    CHECK(count == 0x800 && bus.ids == 0x800 && bus.overflow == 0);
+
+    const uint32_t ext_sent = CAN_STATS_EXT_SLOTS * 2;
+    for (uint32_t i = 0; i < ext_sent; i++) {
+        frame.id = (0x18DA0000 + i * 0x101) | CAN_DECODER_ID_EXT_FLAG;
+        can_stats_add(&frame, 1);
+    }
+    count = fresh_snapshot(&bus);
+    CHECK(count == bus.ids && count <= CAN_STATS_SLOTS && count >= 0x800 + CAN_STATS_EXT_SLOTS * 9 / 10);
+    CHECK(bus.ids + bus.overflow == 0x800 + ext_sent && bus.frames == 0x800 + ext_sent);
+    for (size_t i = 1; i < count; i++) {
+        CHECK(s_ids[i - 1].id < s_ids[i].id);
+    }
+    // Paging returns the same snapshot, under the generation of the first page
+    can_stats_id_t page[7];
+    can_stats_bus_t page_bus;
+    size_t paged = 0;
+    for (size_t got; (got = can_stats_snapshot(&page_bus, page, paged, 7)) > 0; paged += got) {
+        CHECK(memcmp(page, &s_ids[paged], got * sizeof(page[0])) == 0);
+        CHECK(page_bus.generation == bus.generation);
+    }
+    CHECK(paged == count);
+
+    // A refresh between two pages shows in the generation
+    usleep(CAN_STATS_SNAPSHOT_MS * 1000 + 1000);
+    can_stats_snapshot(NULL, NULL, 0, 0);
+    can_stats_snapshot(&page_bus, page, 7, 7);
+    CHECK(page_bus.generation != bus.generation);
+    printf("{\"test\":\"overflow\",\"ids_sent\":%u,\"tracked\":%zu,\"overflow\":%u}\n",
+           (unsigned)(0x800 + ext_sent), count, (unsigned)bus.overflow);
+}
+
+// ---- Behind an acceptance filter ----
+
+static void test_filtered(void)
+{
+    reset_stats();
+    can_stats_bus_t bus;
+    fresh_snapshot(&bus);
+    CHECK(!bus.filtered);
+
+    can_stats_set_filtered(true);
+    fresh_snapshot(&bus);
+    CHECK(bus.filtered);
+
+    // Still filtered for the interval the filter was lifted in, then not
+    can_stats_set_filtered(false);
+    fresh_snapshot(&bus);
+    CHECK(bus.filtered);
+    fresh_snapshot(&bus);
+    CHECK(!bus.filtered);
+}
+
+// ---- Snapshots while the CAN task writes: every payload encodes the count of its ID ----
+
+#define CONCURRENT_IDS 400
+
+static atomic_bool s_stop;
+
+static void *writer_thread(void *arg)
+{
+    static uint32_t counts[CONCURRENT_IDS];
+    can_frame_t batch[16];
+    uint32_t next = 0;
+    while (!atomic_load(&s_stop)) {
+        for (int i = 0; i < 16; i++) {
+            uint32_t slot = next++ % CONCURRENT_IDS;
+            uint32_t count = ++counts[slot];
+            batch[i] = (can_frame_t) { .id = slot, .dlc = 8, .timestamp_us = (int64_t)count * 1000 };
+            memcpy(batch[i].data, &count, 4);
+            memcpy(batch[i].data + 4, &count, 4);
+        }
+        can_stats_add(batch, 16);
+    }
+    return NULL;
+}
+
+static void test_concurrent(int seconds)
+{
+    reset_stats();
+    atomic_store(&s_stop, false);
+    pthread_t writer;
+    pthread_create(&writer, NULL, writer_thread, NULL);
+
+    uint32_t snapshots = 0, checked = 0, torn = 0;
+    int64_t end = esp_timer_get_time() + (int64_t)seconds * 1000000;
+    while (esp_timer_get_time() < end) {
+        can_stats_bus_t bus;
+        size_t count = fresh_snapshot(&bus);
+        snapshots++;
+        for (size_t i = 0; i < count; i++) {
+            const can_stats_id_t *stats = &s_ids[i];
+            uint32_t first, second;
+            memcpy(&first, stats->data, 4);
+            memcpy(&second, stats->data + 4, 4);
+            bool ok = first == stats->count && second == stats->count && stats->dlc == 8 &&
+                      (stats->count < 2 || (stats->period_min_us == 1000 && stats->period_max_us == 1000));
+            torn += !ok;
+            checked++;
+        }
+    }
+    atomic_store(&s_stop, true);
+    pthread_join(writer, NULL);
+
+    CHECK(torn == 0);
+    CHECK(checked > 0);
+    printf("{\"test\":\"concurrent\",\"snapshots\":%u,\"entries_checked\":%u,\"torn\":%u}\n",
+           (unsigned)snapshots, (unsigned)checked, (unsigned)torn);
+}
+
+// ---- Bus load of recorded traffic, and the rates of the snapshot interval ----
+
+static void test_bus_load(void)
+{
+    can_traffic_config_t config;
+    can_traffic_config_vw_powertrain(&config);
+    can_traffic_t traffic;
+    CHECK(can_traffic_init(&traffic, &config) == ESP_OK);
+
+    reset_stats();
+    can_stats_bus_t bus;
+    usleep(CAN_STATS_SNAPSHOT_MS * 1000 + 1000);
+    int64_t ta = esp_timer_get_time();
+    can_stats_snapshot(&bus, NULL, 0, 0);
+    int64_t tb = esp_timer_get_time();
+
+    static can_frame_t batch[32];
+    uint64_t stuffed_bits = 0, plain_bits = 0;
+    uint32_t frames = 0;
+    while (traffic.bus_us < 10000000) {
+        size_t count = can_traffic_next(&traffic, batch, 32);
+        for (size_t i = 0; i < count; i++) {
+            stuffed_bits += can_stats_frame_bits(&batch[i]);
+            plain_bits += can_traffic_frame_bits(batch[i].id, batch[i].dlc);
+        }
+        can_stats_add(batch, count);
+        frames += count;
+    }
+    double bus_s = traffic.bus_us / 1e6;
+    double stuffed_load = 100.0 * stuffed_bits / (config.bitrate * bus_s);
+    double plain_load = 100.0 * plain_bits / (config.bitrate * bus_s);
+
+    usleep(CAN_STATS_SNAPSHOT_MS * 1000 + 1000);
+    int64_t t0 = esp_timer_get_time();
+    size_t count = can_stats_snapshot(&bus, s_ids, 0, CAN_STATS_SLOTS);
+    int64_t t1 = esp_timer_get_time();
+
+    CHECK(count == config.stream_count && bus.frames == frames && bus.bits == stuffed_bits);
+    CHECK(stuffed_load >= plain_load && stuffed_load <= plain_load * 1.25);
+    CHECK(stuffed_bits > plain_bits);
+
+    // Rates are per second of the interval between the two refreshes
+    double longest = (t1 - ta) / 1e6, shortest = (t0 - tb) / 1e6;
+    double load_max = 100.0 * stuffed_bits / (config.bitrate * shortest);
+    double load_min = 100.0 * stuffed_bits / (config.bitrate * longest);
+    CHECK(bus.bus_load_pct >= load_min * 0.999 && bus.bus_load_pct <= load_max * 1.001);
+    CHECK(bus.frames_per_s >= frames / longest * 0.999 && bus.frames_per_s <= frames / shortest * 1.001);
+    uint32_t id_frames = 0;
+    for (size_t i = 0; i < count; i++) {
+        id_frames += s_ids[i].count;
+        CHECK(s_ids[i].rate_hz >= s_ids[i].count / longest * 0.999 && s_ids[i].rate_hz <= s_ids[i].count / shortest * 1.001);
+    }
+    CHECK(id_frames == frames);
+
+    printf("{\"test\":\"bus_load\",\"traffic\":\"%s\",\"frames\":%u,\"bus_s\":%.1f,\"load_pct\":%.2f,"
+           "\"load_unstuffed_pct\":%.2f,\"stuff_overhead_pct\":%.2f}\n",
+           config.name, (unsigned)frames, bus_s, stuffed_load, plain_load,
+           100.0 * (stuffed_bits - plain_bits) / plain_bits);
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 2;
+    if (seconds < 1) seconds = 1;
+
+    if (can_stats_init(500000) != ESP_OK) {
+        printf("FAIL: cannot set up the statistics\n");
+        return 1;
+    }
+    test_frame_bits();
+    test_periods();
+    test_long_run();
+    test_overflow();
+    test_filtered();
+    test_concurrent(seconds);
+    test_bus_load();
+
+    printf("{\"test\":\"can_stats\",\"failures\":%d}\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,215 @@
+// Host test for the CAN transports behind the one batch receive call: the TWAI backend on the
+// simulated driver, the file backend waiting for paced trace frames, and the SocketCAN backend
+// on a virtual interface when the machine has one. Without it the other checks still run
+// and the exit code is SKIP_EXIT_CODE, which ctest reports as skipped.
+//   test_can_transport [interface, default vcan0]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#include "include/canbus.h"
+#include "include/can_decoder.h"
+#include "can_transport_socketcan.h"
+
+#define SKIP_EXIT_CODE  77
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while (0)
+
+static can_frame_t s_frames[CONFIG_CANBUS_RX_BATCH_SIZE];
+
+static void test_common(void)
+{
+    can_transport_t closed = { 0 };
+    size_t count = 1;
+    can_transport_stats_t stats;
+    CHECK(can_transport_receive_batch(&closed, s_frames, 1, &count, 0) == ESP_ERR_INVALID_STATE && count == 0);
+    CHECK(can_transport_receive_batch(&closed, s_frames, 0, &count, 0) == ESP_ERR_INVALID_ARG);
+    CHECK(can_transport_get_stats(&closed, &stats) == ESP_ERR_INVALID_STATE);
+    CHECK(can_transport_start(&closed) == ESP_ERR_INVALID_STATE);
+    can_transport_close(&closed);
+}
+
+// The bus transport of the CAN task on the simulated driver: frames, batch and loss counters
+static void test_twai(void)
+{
+    twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT(0, 0, TWAI_MODE_LISTEN_ONLY);
+    twai_timing_config_t t_config = TWAI_TIMING_CONFIG_500KBITS();
+    twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+    g_config.rx_queue_len = 8;
+    CHECK(twai_driver_install(&g_config, &t_config, &f_config) == ESP_OK);
+    can_transport_t *bus = canbus_bus_transport();
+    CHECK(can_transport_start(bus) == ESP_OK);
+
+    for (uint32_t i = 0; i < 10; i++) {
+        twai_message_t message = { .identifier = 0x100 + i, .data_length_code = 2, .data = { (uint8_t)i, 0xA5 } };
+        if (i == 1) {
+            message.extd = 1;
+            message.identifier = 0x18DAF110;
+        }
+        if (i == 2) {
+            message.rtr = 1;
+        }
+        twai_sim_deliver(&message);
+    }
+    canbus_stats_t stats;
+    CHECK(canbus_get_stats(&stats) == ESP_OK);
+    CHECK(strcmp(stats.name, "twai") == 0 && stats.rx_queued == 8 && stats.rx_missed == 2);
+
+    size_t count = 0;
+    int64_t before = esp_timer_get_time();
+    CHECK(can_transport_receive_batch(bus, s_frames, CONFIG_CANBUS_RX_BATCH_SIZE, &count, pdMS_TO_TICKS(100)) == ESP_OK);
+    CHECK(count == 8);
+    CHECK(s_frames[0].id == 0x100 && s_frames[0].dlc == 2 && s_frames[0].data[1] == 0xA5);
+    CHECK(s_frames[1].id == (0x18DAF110 | CAN_DECODER_ID_EXT_FLAG));
+    CHECK(s_frames[2].flags == CAN_FRAME_FLAG_RTR && s_frames[3].flags == 0);
+    CHECK(s_frames[7].timestamp_us >= before && s_frames[7].timestamp_us <= esp_timer_get_time());
+    CHECK(canbus_receive_batch(s_frames, CONFIG_CANBUS_RX_BATCH_SIZE, &count, 1) == ESP_ERR_TIMEOUT && count == 0);
+
+    CHECK(canbus_get_stats(&stats) == ESP_OK);
+    CHECK(stats.frames_received == 8 && stats.batches == 1 && stats.max_batch == 8 && stats.rx_queued == 0);
+    CHECK(stats.state == CAN_TRANSPORT_STATE_RUNNING);
+    printf("{\"test\":\"twai\",\"frames\":%u,\"batches\":%u,\"max_batch\":%u,\"rx_missed\":%u}\n",
+           (unsigned)stats.frames_received, (unsigned)stats.batches, (unsigned)stats.max_batch,
+           (unsigned)stats.rx_missed);
+    CHECK(can_transport_stop(bus) == ESP_OK);
+    twai_driver_uninstall();
+}
+
+// A paced trace: frames due now come at once, the receive call waits for later ones
+static void test_file(void)
+{
+    char path[] = "/tmp/can_transport_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    if (fd < 0) {
+        return;
+    }
+    const char *trace =
+        "(100.000000) can0 280#0011223344556677\n"
+        "(100.000000) can0 18FEF1E5#AA\n"
+        "(100.010000) can0 321##100112233\n"       // CAN FD
+        "(100.060000) can0 5A0#\n";
+    CHECK(write(fd, trace, strlen(trace)) == (ssize_t)strlen(trace));
+    close(fd);
+
+    can_transport_t file;
+    can_replay_config_t config = { .format = CAN_REPLAY_FORMAT_AUTO, .speed = 1.0f };
+    CHECK(can_transport_file_open(&file, path, &config) == ESP_OK);
+    size_t count = 0;
+    CHECK(can_transport_receive_batch(&file, s_frames, 8, &count, 0) == ESP_ERR_INVALID_STATE);
+    CHECK(can_transport_start(&file) == ESP_OK);
+
+    CHECK(can_transport_receive_batch(&file, s_frames, 8, &count, 0) == ESP_OK && count == 2);
+    CHECK(s_frames[1].id == (0x18FEF1E5 | CAN_DECODER_ID_EXT_FLAG) && s_frames[1].data[0] == 0xAA);
+    int64_t first_us = s_frames[0].timestamp_us;
+    CHECK(can_transport_receive_batch(&file, s_frames, 8, &count, 0) == ESP_ERR_TIMEOUT);
+
+    int64_t start = esp_timer_get_time();
+    CHECK(can_transport_receive_batch(&file, s_frames, 8, &count, pdMS_TO_TICKS(500)) == ESP_OK && count == 1);
+    int64_t waited_us = esp_timer_get_time() - start;
+    CHECK(s_frames[0].id == 0x5A0 && s_frames[0].timestamp_us == first_us + 60000);
+    CHECK(esp_timer_get_time() >= s_frames[0].timestamp_us);
+    CHECK(waited_us < 400000);
+    CHECK(can_transport_receive_batch(&file, s_frames, 8, &count, pdMS_TO_TICKS(100)) == ESP_ERR_NOT_FOUND);
+
+    can_transport_stats_t stats;
+    can_replay_stats_t replay;
+    CHECK(can_transport_get_stats(&file, &stats) == ESP_OK);
+    can_transport_file_get_replay_stats(&file, &replay);
+    CHECK(strcmp(stats.name, "file") == 0 && stats.frames_received == 3 && stats.batches == 2);
+    CHECK(stats.max_batch == 2 && stats.skipped == 1 && stats.state == CAN_TRANSPORT_STATE_STOPPED);
+    CHECK(replay.finished && replay.frames == 3);
+    printf("{\"test\":\"file\",\"frames\":%u,\"batches\":%u,\"skipped\":%u,\"waited_ms\":%.1f}\n",
+           (unsigned)stats.frames_received, (unsigned)stats.batches, (unsigned)stats.skipped, waited_us / 1000.0);
+    can_transport_close(&file);
+    CHECK(file.ops == NULL);
+    unlink(path);
+}
+
+// Frames written to the interface by another socket come back through the transport.
+// Returns false if the interface or CAN sockets are not available.
+static bool test_socketcan(const char *interface)
+{
+    can_transport_t transport;
+    esp_err_t ret = can_transport_socketcan_open(&transport, interface);
+    if (ret == ESP_ERR_NOT_FOUND || ret == ESP_ERR_NOT_SUPPORTED) {
+        printf("{\"test\":\"socketcan\",\"interface\":\"%s\",\"skipped\":\"%s\"}\n", interface,
+               ret == ESP_ERR_NOT_FOUND ? "no such interface" : "no CAN sockets");
+        return false;
+    }
+    CHECK(ret == ESP_OK);
+    if (ret != ESP_OK) {
+        return true;
+    }
+    CHECK(can_transport_start(&transport) == ESP_OK);
+
+    int sender = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    struct ifreq ifr = { 0 };
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", interface);
+    CHECK(sender >= 0 && ioctl(sender, SIOCGIFINDEX, &ifr) == 0);
+    struct sockaddr_can addr = { .can_family = AF_CAN, .can_ifindex = ifr.ifr_ifindex };
+    CHECK(bind(sender, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+
+    const uint32_t sent = 1000;
+    for (uint32_t i = 0; i < sent; i++) {
+        struct can_frame raw = { .can_id = 0x100 + (i % 0x600), .can_dlc = 8 };
+        if (i % 7 == 0) {
+            raw.can_id = (0x18DA0000 + i) | CAN_EFF_FLAG;
+        }
+        memcpy(raw.data, &i, sizeof(i));
+        CHECK(write(sender, &raw, sizeof(raw)) == (ssize_t)sizeof(raw));
+    }
+
+    uint32_t received = 0, in_order = 0;
+    size_t count;
+    while (received < sent &&
+           can_transport_receive_batch(&transport, s_frames, CONFIG_CANBUS_RX_BATCH_SIZE, &count, pdMS_TO_TICKS(500)) == ESP_OK) {
+        for (size_t i = 0; i < count; i++, received++) {
+            uint32_t value;
+            memcpy(&value, s_frames[i].data, sizeof(value));
+            uint32_t id = received % 7 == 0 ? (0x18DA0000 + received) | CAN_DECODER_ID_EXT_FLAG : 0x100 + (received % 0x600);
+            in_order += value == received && s_frames[i].id == id && s_frames[i].dlc == 8;
+        }
+    }
+    close(sender);
+
+    can_transport_stats_t stats;
+    CHECK(can_transport_get_stats(&transport, &stats) == ESP_OK);
+    CHECK(received == sent && in_order == sent && stats.rx_missed == 0);
+    CHECK(strcmp(stats.name, "socketcan") == 0 && stats.frames_received == sent);
+    printf("{\"test\":\"socketcan\",\"interface\":\"%s\",\"frames\":%u,\"batches\":%u,\"max_batch\":%u,\"rx_missed\":%u}\n",
+           interface, (unsigned)received, (unsigned)stats.batches, (unsigned)stats.max_batch,
+           (unsigned)stats.rx_missed);
+    can_transport_close(&transport);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    test_common();
+    test_twai();
+    test_file();
+    bool socketcan = test_socketcan(argc > 1 ? argv[1] : "vcan0");
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    if (!socketcan) {
+        printf("all checks passed, SocketCAN skipped\n");
+        return SKIP_EXIT_CODE;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
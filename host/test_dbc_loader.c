@@ -0,0 +1,200 @@
+// Host test for the DBC loader: parses sample DBC files and checks the
+// compiled decoder table, frame formatting and a large generated DBC.
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "esp_timer.h"
+#include "include/dbc_loader.h"
+#include "include/can_decoder.h"
+#include "include/ecu_data.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while (0)
+
+#define CHECK_NEAR(a, b) CHECK(fabsf((float)(a) - (float)(b)) < 0.01f)
+
+// Stand-in for the built-in table of can_parser.c: MAP on 0x580, BOV on 0x394
+static const can_signal_def_t s_builtin_signals[] = {
+    { 0x394,  0,  8, CAN_BYTE_ORDER_INTEL,    0, ECU_SIG_BOV_PERCENT, 50.0f / 255.0f, 0.0f },
+    { 0x580, 23, 16, CAN_BYTE_ORDER_MOTOROLA, 0, ECU_SIG_MAP_KPA,     0.01f,          0.0f },
+};
+static can_decoder_table_t s_builtin_table;
+
+static void activate_builtin(void)
+{
+    CHECK(can_decoder_table_build(&s_builtin_table, s_builtin_signals, 2) == ESP_OK);
+    can_decoder_set_active(&s_builtin_table);
+    can_decoder_set_max_torque(500.0f);
+}
+
+static void test_sample_file(void)
+{
+    activate_builtin();
+    CHECK(dbc_loader_load_file(HOST_DBC_DIR "/sample_vw.dbc") == ESP_OK);
+    CHECK(dbc_loader_activate() == ESP_OK);
+    CHECK(dbc_loader_is_loaded());
+
+    dbc_loader_stats_t stats;
+    dbc_loader_get_stats(&stats);
+    CHECK(stats.messages == 3);              // VECTOR__INDEPENDENT_SIG_MSG is dropped
+    CHECK(stats.signals == 7);
+    CHECK(stats.skipped_signals == 1);       // Gear_Info is multiplexed
+    CHECK(stats.bound_signals == 4);         // tcu_tq_req_nm by name, the rest by DashField attribute
+
+    const dbc_message_t *msg = dbc_find_message(0x280);
+    CHECK(msg != NULL);
+    if (msg) {
+        CHECK(strcmp(msg->name, "Motor_1") == 0);
+        CHECK(strcmp(msg->comment, "Engine speed, pedal and torque target") == 0);
+        CHECK(msg->signal_count == 4);
+        CHECK(msg->dlc == 8);
+    }
+
+    const dbc_message_t *ext = dbc_find_message(0x18FEF1E5 | CAN_DECODER_ID_EXT_FLAG);
+    CHECK(ext != NULL);
+    if (ext) CHECK(strcmp(ext->comment, "Extended status frame") == 0);
+    CHECK(dbc_find_message(0x18FEF1E5) == NULL);
+    CHECK(dbc_find_message(0x123) == NULL);
+
+    // Motor_1: rpm 3000 (raw 12000 = 0x2EE0 big endian in bytes 2..3), pedal 50%, torque 40%
+    const uint8_t motor[8] = { 0x00, 0x00, 0x2E, 0xE0, 125, 0x66, 0xD8, 0x00 };
+    ecu_data_t data = {0};
+    uint32_t updated = can_decoder_decode(0x280, motor, 8, &data);
+    CHECK(updated == ((1UL << ECU_SIG_ENGINE_RPM) | (1UL << ECU_SIG_ENG_TRG_NM)));
+    CHECK_NEAR(data.engine_rpm, 3000.0f);
+    CHECK_NEAR(data.eng_trg_nm, 102 * 0.3937f * 5.0f);
+
+    // Extended frame replaces the built-in MAP row, BOV stays built-in
+    const uint8_t boost[4] = { 0x10, 0x27, 0x00, 0x00 };
+    updated = can_decoder_decode(0x18FEF1E5 | CAN_DECODER_ID_EXT_FLAG, boost, 4, &data);
+    CHECK(updated == (1UL << ECU_SIG_MAP_KPA));
+    CHECK_NEAR(data.map_kpa, 100.0f);
+    const uint8_t map_builtin[8] = { 0, 0, 0x27, 0x10, 0, 0, 0, 0 };
+    CHECK(can_decoder_decode(0x580, map_builtin, 8, &data) == 0);
+    const uint8_t bov[1] = { 255 };
+    CHECK(can_decoder_decode(0x394, bov, 1, &data) == (1UL << ECU_SIG_BOV_PERCENT));
+    CHECK_NEAR(data.bov_percent, 50.0f);
+
+    // Sniffer text with signed signal and units
+    char text[160];
+    size_t len = dbc_format_frame(0x280, motor, 8, text, sizeof(text));
+    CHECK(len == strlen(text));
+    CHECK(strcmp(text, "Motor_1: Engine_Speed=3000rpm Pedal_Position=50% "
+                       "Engine_Torque_Target=40.16% throttle_temp=-80degC") == 0);
+
+    // Truncation keeps the string terminated
+    char small[12];
+    len = dbc_format_frame(0x280, motor, 8, small, sizeof(small));
+    CHECK(len == sizeof(small) - 1 && strlen(small) == len);
+
+    // Short frame: signals that do not fit are left out
+    len = dbc_format_frame(0x280, motor, 4, text, sizeof(text));
+    CHECK(strcmp(text, "Motor_1: Engine_Speed=3000rpm") == 0);
+
+    CHECK(dbc_format_frame(0x7FF, motor, 8, text, sizeof(text)) == 0 && text[0] == '\0');
+
+    // Loading twice would free a table the CAN task may still use
+    CHECK(dbc_loader_load_file(HOST_DBC_DIR "/sample_vw.dbc") == ESP_ERR_INVALID_STATE);
+
+    can_decoder_set_active(&s_builtin_table);
+    dbc_loader_reset();
+}
+
+// A vendor-sized file: long comment lines, many messages, an overlong line
+static void test_large_generated_file(void)
+{
+    const char *path = "large_generated.dbc";
+    FILE *f = fopen(path, "w");
+    CHECK(f != NULL);
+    if (!f) return;
+
+    fprintf(f, "VERSION \"\"\n\nBU_: ECU\n\n");
+    for (int m = 0; m < 400; m++) {
+        fprintf(f, "BO_ %d Msg_%d: 8 ECU\n", 0x100 + m, m);
+        for (int s = 0; s < 8; s++) {
+            fprintf(f, " SG_ Sig_%d_%d : %d|8@1+ (0.5,%d) [0|255] \"unit\" Vector__XXX\n", m, s, s * 8, s);
+        }
+        fprintf(f, "\n");
+    }
+    // Overlong comment with the closing quote past the line buffer
+    fprintf(f, "CM_ BO_ %d \"", 0x100);
+    for (int i = 0; i < DBC_LINE_MAX * 3; i++) fputc('x', f);
+    fprintf(f, "\";\n");
+    for (int m = 0; m < 400; m++) {
+        fprintf(f, "CM_ SG_ %d Sig_%d_0 \"Generated signal comment used to pad the file towards the size "
+                   "of a real vendor database, spanning\nseveral lines of text\nin the usual DBC way\";\n",
+                0x100 + m, m);
+        fprintf(f, "CM_ BO_ %d \"Message %d\";\n", 0x100 + m, m);
+    }
+    // Padding comments until the file reaches 500 KB
+    long size = ftell(f);
+    for (int i = 0; size < 500 * 1024; i++) {
+        fprintf(f, "CM_ \"Padding comment %d with some text to read through\";\n", i);
+        size = ftell(f);
+    }
+    fprintf(f, "BA_ \"DashField\" SG_ %d Sig_1_0 \"wg_set_percent\";\n", 0x101);
+    fclose(f);
+
+    activate_builtin();
+    int64_t start = esp_timer_get_time();
+    CHECK(dbc_loader_load_file(path) == ESP_OK);
+    CHECK(dbc_loader_activate() == ESP_OK);
+    int64_t elapsed_us = esp_timer_get_time() - start;
+    printf("Parsed %ld byte DBC in %lld us\n", size, (long long)elapsed_us);
+
+    dbc_loader_stats_t stats;
+    dbc_loader_get_stats(&stats);
+    CHECK(stats.messages == 400);
+    CHECK(stats.signals == 3200);
+    CHECK(stats.truncated_lines == 1);
+    CHECK(stats.bound_signals == 1);
+
+    // The comment after the overlong line is still attached to its message
+    const dbc_message_t *msg = dbc_find_message(0x100);
+    CHECK(msg != NULL);
+    if (msg) CHECK(strcmp(msg->comment, "Message 0") == 0);
+    msg = dbc_find_message(0x100 + 399);
+    CHECK(msg != NULL);
+    if (msg) CHECK(msg->signal_count == 8 && strcmp(msg->comment, "Message 399") == 0);
+
+    const uint8_t frame[8] = { 10, 20, 30, 40, 50, 60, 70, 80 };
+    ecu_data_t data = {0};
+    CHECK(can_decoder_decode(0x101, frame, 8, &data) == (1UL << ECU_SIG_WG_SET_PERCENT));
+    CHECK_NEAR(data.wg_set_percent, 5.0f);
+
+    can_decoder_set_active(&s_builtin_table);
+    dbc_loader_reset();
+    remove(path);
+}
+
+static void test_missing_inputs(void)
+{
+    CHECK(dbc_loader_load_file("does_not_exist.dbc") == ESP_ERR_NOT_FOUND);
+    CHECK(dbc_loader_load_dir("does_not_exist") == ESP_ERR_NOT_FOUND);
+    CHECK(!dbc_loader_is_loaded());
+    dbc_loader_reset();
+
+    // Directory scan picks up the sample file
+    activate_builtin();
+    CHECK(dbc_loader_load_dir(HOST_DBC_DIR) == ESP_OK);
+    CHECK(dbc_find_message(0x280) != NULL);
+    can_decoder_set_active(&s_builtin_table);
+    dbc_loader_reset();
+}
+
+int main(void)
+{
+    test_sample_file();
+    test_large_generated_file();
+    test_missing_inputs();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All DBC loader checks passed\n");
+    return 0;
+}
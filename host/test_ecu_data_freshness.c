@@ -0,0 +1,135 @@
+// Host test for the ecu_data freshness tracking: the update rate averaged over the
+// intervals (a batch delivering two frames back to back must not inflate it), the
+// stale mask of fast, slow and never written signals, and the updated mask between
+// two snapshots.
+//   test_ecu_data_freshness
+#include <stdio.h>
+#include <math.h>
+#include "include/ecu_data.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while (0)
+
+#define SIG(s)  (1UL << (s))
+#define ALL_SIGNALS ((1UL << ECU_SIG_COUNT) - 1)
+
+static void mark(uint32_t mask, int64_t timestamp_us)
+{
+    ecu_data_write_begin();
+    ecu_data_mark_updated(mask, timestamp_us);
+    ecu_data_write_end();
+}
+
+static void snapshot(ecu_data_freshness_t *freshness)
+{
+    ecu_data_get_snapshot(NULL, freshness);
+}
+
+static void test_never_written(void)
+{
+    ecu_data_freshness_t freshness;
+    ecu_data_init();
+    snapshot(&freshness);
+    CHECK(ecu_data_stale_mask(&freshness, 1000000) == ALL_SIGNALS);
+    CHECK(ecu_data_stale_mask(NULL, 0) == ALL_SIGNALS);
+    CHECK(ecu_data_updated_mask(NULL, &freshness) == ALL_SIGNALS);
+    CHECK(ecu_data_updated_mask(&freshness, NULL) == 0);
+    CHECK(ecu_data_updated_mask(&freshness, &freshness) == 0);
+
+    // One write: fresh, but no interval to rate yet
+    mark(SIG(ECU_SIG_ENGINE_RPM), 1000);
+    snapshot(&freshness);
+    CHECK(freshness.period_us[ECU_SIG_ENGINE_RPM] == 0.0f && freshness.rate_hz[ECU_SIG_ENGINE_RPM] == 0.0f);
+    CHECK(ecu_data_stale_mask(&freshness, 1000) == (ALL_SIGNALS & ~SIG(ECU_SIG_ENGINE_RPM)));
+}
+
+// 100 Hz on average, delivered in pairs 1 ms apart: the average of the intervals is 10 ms,
+// where an average of the per-interval rates would say about 500 Hz
+static void test_rate(void)
+{
+    ecu_data_freshness_t freshness;
+    ecu_data_init();
+    int64_t t = 1000000;
+    for (int i = 0; i < 200; i++) {
+        mark(SIG(ECU_SIG_ENGINE_RPM), t);
+        t += i % 2 ? 19000 : 1000;
+        mark(SIG(ECU_SIG_MAP_KPA), 1000000 + i * 10000LL);
+    }
+    snapshot(&freshness);
+    float rpm_hz = freshness.rate_hz[ECU_SIG_ENGINE_RPM];
+    float map_hz = freshness.rate_hz[ECU_SIG_MAP_KPA];
+    CHECK(rpm_hz > 90.0f && rpm_hz < 110.0f);
+    CHECK(fabsf(map_hz - 100.0f) < 0.01f);
+    CHECK(fabsf(freshness.period_us[ECU_SIG_ENGINE_RPM] * rpm_hz - 1e6f) < 1.0f);
+    CHECK(freshness.update_count[ECU_SIG_ENGINE_RPM] == 200 && freshness.update_count[ECU_SIG_MAP_KPA] == 200);
+    printf("{\"test\":\"rate\",\"paired_hz\":%.1f,\"even_hz\":%.1f}\n", rpm_hz, map_hz);
+}
+
+static void test_stale(void)
+{
+    ecu_data_freshness_t freshness;
+    ecu_data_init();
+
+    // Fast signal: the ECU_DATA_STALE_MIN_MS floor applies. Slow one (1 Hz): its own periods.
+    for (int64_t t = 0; t <= 10000000; t += 10000) {
+        mark(SIG(ECU_SIG_ENGINE_RPM), 1000000 + t);
+    }
+    for (int64_t t = 0; t <= 10000000; t += 1000000) {
+        mark(SIG(ECU_SIG_WG_SET_PERCENT), 1000000 + t);
+    }
+    snapshot(&freshness);
+    int64_t last = 11000000;
+    uint32_t never = ALL_SIGNALS & ~(SIG(ECU_SIG_ENGINE_RPM) | SIG(ECU_SIG_WG_SET_PERCENT));
+    int64_t floor_us = ECU_DATA_STALE_MIN_MS * 1000LL;
+    int64_t slow_us = ECU_DATA_STALE_PERIODS * 1000000LL;
+
+    CHECK(ecu_data_stale_mask(&freshness, last) == never);
+    CHECK(ecu_data_stale_mask(&freshness, last + floor_us - 1000) == never);
+    CHECK(ecu_data_stale_mask(&freshness, last + floor_us + 1000) == (never | SIG(ECU_SIG_ENGINE_RPM)));
+    CHECK(ecu_data_stale_mask(&freshness, last + slow_us - 1000) == (never | SIG(ECU_SIG_ENGINE_RPM)));
+    CHECK(ecu_data_stale_mask(&freshness, last + slow_us + 1000) == ALL_SIGNALS);
+
+    // A new write makes it fresh again
+    mark(SIG(ECU_SIG_ENGINE_RPM), last + slow_us);
+    snapshot(&freshness);
+    CHECK(ecu_data_stale_mask(&freshness, last + slow_us + 1000) == (ALL_SIGNALS & ~SIG(ECU_SIG_ENGINE_RPM)));
+}
+
+static void test_updated(void)
+{
+    ecu_data_freshness_t before, after;
+    ecu_data_init();
+    mark(SIG(ECU_SIG_ENGINE_RPM) | SIG(ECU_SIG_MAP_KPA), 1000);
+    snapshot(&before);
+
+    mark(SIG(ECU_SIG_MAP_KPA), 2000);
+    mark(SIG(ECU_SIG_BOV_PERCENT) | SIG(ECU_SIG_MAP_KPA), 3000);
+    snapshot(&after);
+    CHECK(ecu_data_updated_mask(&before, &after) == (SIG(ECU_SIG_MAP_KPA) | SIG(ECU_SIG_BOV_PERCENT)));
+    CHECK(ecu_data_updated_mask(&after, &after) == 0);
+
+    // The whole data set replaced
+    ecu_data_t data = { 0 };
+    before = after;
+    ecu_data_update(&data);
+    snapshot(&after);
+    CHECK(ecu_data_updated_mask(&before, &after) == ALL_SIGNALS);
+}
+
+int main(void)
+{
+    test_never_written();
+    test_rate();
+    test_stale();
+    test_updated();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
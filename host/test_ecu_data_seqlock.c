@@ -0,0 +1,167 @@
+// Stress test for the ecu_data seqlock: one writer publishes frames in which every
+// signal holds the same value while several readers take copies. A copy with mixed
+// values is a torn read. Also reports read/write latency, and how many torn copies
+// an unprotected memcpy of the same struct sees (shows the test can detect tears).
+//   test_ecu_data_seqlock [seconds]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include "include/ecu_data.h"
+
+#define READER_THREADS  3
+#define LATENCY_BUCKETS 4096  // 10 ns buckets up to ~41 us, last bucket collects the rest
+
+typedef struct {
+    uint64_t ops;
+    uint64_t torn;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint32_t histogram[LATENCY_BUCKETS];
+} latency_stats_t;
+
+typedef struct {
+    bool unprotected;
+    latency_stats_t stats;
+} reader_ctx_t;
+
+static atomic_bool s_stop;
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void record(latency_stats_t *stats, uint64_t ns)
+{
+    stats->ops++;
+    stats->total_ns += ns;
+    if (ns > stats->max_ns) stats->max_ns = ns;
+    uint64_t bucket = ns / 10;
+    stats->histogram[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+}
+
+static uint64_t percentile_ns(const latency_stats_t *stats, double pct)
+{
+    uint64_t target = (uint64_t)(stats->ops * pct / 100.0);
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += stats->histogram[i];
+        if (seen > target) return (uint64_t)i * 10;
+    }
+    return stats->max_ns;
+}
+
+static bool is_torn(const ecu_data_t *data)
+{
+    for (int i = 1; i < ECU_SIG_COUNT; i++) {
+        if (*ecu_data_field((ecu_data_t *)data, (ecu_signal_t)i) != data->engine_rpm) return true;
+    }
+    return false;
+}
+
+static void *writer_thread(void *arg)
+{
+    latency_stats_t *stats = arg;
+    float value = 0.0f;
+
+    while (!atomic_load(&s_stop)) {
+        value += 1.0f;
+        uint64_t start = now_ns();
+        ecu_data_t *data = ecu_data_write_begin();
+        for (int i = 0; i < ECU_SIG_COUNT; i++) {
+            *ecu_data_field(data, (ecu_signal_t)i) = value;
+        }
+        ecu_data_write_end();
+        record(stats, now_ns() - start);
+    }
+    return NULL;
+}
+
+static void *reader_thread(void *arg)
+{
+    reader_ctx_t *ctx = arg;
+    ecu_data_t copy;
+
+    while (!atomic_load(&s_stop)) {
+        uint64_t start = now_ns();
+        if (ctx->unprotected) {
+            // What readers got before: a plain copy of the shared struct
+            memcpy(&copy, ecu_data_get(), sizeof(copy));
+        } else {
+            ecu_data_get_copy(&copy);
+        }
+        record(&ctx->stats, now_ns() - start);
+        if (is_torn(&copy)) ctx->stats.torn++;
+    }
+    return NULL;
+}
+
+static void print_stats(const char *name, const latency_stats_t *stats)
+{
+    printf("{\"role\":\"%s\",\"ops\":%llu,\"torn\":%llu,\"avg_ns\":%.1f,\"p99_ns\":%llu,\"max_ns\":%llu}\n",
+           name, (unsigned long long)stats->ops, (unsigned long long)stats->torn,
+           stats->ops ? (double)stats->total_ns / stats->ops : 0.0,
+           (unsigned long long)percentile_ns(stats, 99.0), (unsigned long long)stats->max_ns);
+}
+
+// Returns the number of torn reads over all readers
+static uint64_t run(bool unprotected, double seconds)
+{
+    static latency_stats_t writer_stats;
+    static reader_ctx_t readers[READER_THREADS];
+    pthread_t writer;
+    pthread_t reader_threads[READER_THREADS];
+
+    memset(&writer_stats, 0, sizeof(writer_stats));
+    memset(readers, 0, sizeof(readers));
+    atomic_store(&s_stop, false);
+
+    pthread_create(&writer, NULL, writer_thread, &writer_stats);
+    for (int i = 0; i < READER_THREADS; i++) {
+        readers[i].unprotected = unprotected;
+        pthread_create(&reader_threads[i], NULL, reader_thread, &readers[i]);
+    }
+
+    struct timespec ts = { .tv_sec = (time_t)seconds, .tv_nsec = (long)((seconds - (time_t)seconds) * 1e9) };
+    nanosleep(&ts, NULL);
+    atomic_store(&s_stop, true);
+
+    pthread_join(writer, NULL);
+    latency_stats_t all_readers = {0};
+    for (int i = 0; i < READER_THREADS; i++) {
+        pthread_join(reader_threads[i], NULL);
+        all_readers.ops += readers[i].stats.ops;
+        all_readers.torn += readers[i].stats.torn;
+        all_readers.total_ns += readers[i].stats.total_ns;
+        if (readers[i].stats.max_ns > all_readers.max_ns) all_readers.max_ns = readers[i].stats.max_ns;
+        for (int b = 0; b < LATENCY_BUCKETS; b++) all_readers.histogram[b] += readers[i].stats.histogram[b];
+    }
+
+    print_stats(unprotected ? "writer_vs_memcpy" : "writer", &writer_stats);
+    print_stats(unprotected ? "reader_memcpy" : "reader_seqlock", &all_readers);
+    return all_readers.torn;
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    if (seconds <= 0) seconds = 2.0;
+
+    ecu_data_init();
+
+    uint64_t unprotected_torn = run(true, seconds / 4);
+    uint64_t torn = run(false, seconds);
+
+    if (torn != 0) {
+        printf("FAIL: %llu torn reads through ecu_data_get_copy()\n", (unsigned long long)torn);
+        return 1;
+    }
+    printf("No torn reads with %d readers (unprotected memcpy: %llu torn)\n",
+           READER_THREADS, (unsigned long long)unprotected_torn);
+    return 0;
+}
@@ -0,0 +1,221 @@
+// Host test for the binary live data stream: encode/decode round trip on random walks,
+// sequence gap and malformed frame handling, and the cost of 4 clients at 50 Hz compared
+// with one client polling /data as JSON at 50 Hz.
+//   test_ecu_stream [seconds]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "include/ecu_stream.h"
+
+#define STREAM_CLIENTS      4
+#define STREAM_RATE_HZ      50
+#define HTTP_OVERHEAD_BYTES 250   // GET request + response headers of one /data poll
+#define WS_HEADER_BYTES     2     // Server to client frame header, payload < 126 bytes
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while (0)
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// One 20 ms step of plausible engine data: most signals move a little, some not at all
+static void random_walk(ecu_data_t *data, uint64_t *timestamp_ms)
+{
+    static const float max_step[ECU_SIG_COUNT] = { 60.0f, 2.0f, 2.0f, 3.0f, 2.0f, 2.0f, 5.0f,
+                                                   8.0f, 8.0f, 8.0f, 8.0f, 4.0f };
+    static const float max_value[ECU_SIG_COUNT] = { 7000.0f, 100.0f, 100.0f, 300.0f, 100.0f, 100.0f,
+                                                    100.0f, 600.0f, 600.0f, 600.0f, 600.0f, 600.0f };
+    for (int i = 0; i < ECU_SIG_COUNT; i++) {
+        if (rand() % 4 == 0) continue;
+        float *field = ecu_data_field(data, (ecu_signal_t)i);
+        *field += max_step[i] * ((float)rand() / RAND_MAX * 2.0f - 1.0f);
+        if (*field < 0.0f) *field = 0.0f;
+        if (*field > max_value[i]) *field = max_value[i];
+    }
+    *timestamp_ms += 1000 / STREAM_RATE_HZ;
+    data->timestamp = *timestamp_ms;
+}
+
+static void check_decoded(const ecu_stream_decoder_t *decoder, const ecu_data_t *data)
+{
+    for (int i = 0; i < ECU_SIG_COUNT; i++) {
+        float expected = *ecu_data_field((ecu_data_t *)data, (ecu_signal_t)i);
+        float step = ecu_stream_signal_step((ecu_signal_t)i);
+        float got = ecu_stream_decoder_value(decoder, (ecu_signal_t)i);
+        if (fabsf(got - expected) > step / 2 + 1e-3f) {
+            printf("signal %d: got %f expected %f\n", i, got, expected);
+            failures++;
+            return;
+        }
+    }
+}
+
+static void test_round_trip(void)
+{
+    ecu_stream_encoder_t encoder;
+    ecu_stream_decoder_t decoder;
+    ecu_data_t data = { .engine_rpm = 900.0f, .map_kpa = 100.0f };
+    uint64_t timestamp_ms = 0;
+    uint8_t frame[ECU_STREAM_MAX_FRAME_SIZE];
+
+    ecu_stream_encoder_reset(&encoder);
+    ecu_stream_decoder_reset(&decoder);
+    srand(1);
+
+    for (int n = 0; n < 20000; n++) {
+        random_walk(&data, &timestamp_ms);
+        uint16_t stale_mask = (uint16_t)(n / 1000 & 0x0FFF);
+        size_t len = ecu_stream_encode(&encoder, &data, stale_mask, n % 500 == 0, frame, sizeof(frame));
+        CHECK(len <= ECU_STREAM_MAX_FRAME_SIZE);
+        if (len == 0) continue;
+        CHECK(n == 0 ? (frame[1] & ECU_STREAM_FLAG_KEYFRAME) != 0 : 1);
+        CHECK(ecu_stream_decode(&decoder, frame, len) == ESP_OK);
+        CHECK(decoder.stale_mask == stale_mask);
+        CHECK(decoder.timestamp_ms == (uint32_t)timestamp_ms);
+        check_decoded(&decoder, &data);
+    }
+
+    // Nothing changed: no frame
+    CHECK(ecu_stream_encode(&encoder, &data, decoder.stale_mask, false, frame, sizeof(frame)) == 0);
+    // Buffer too small for a worst case frame
+    CHECK(ecu_stream_encode(&encoder, &data, 0, true, frame, ECU_STREAM_MAX_FRAME_SIZE - 1) == 0);
+}
+
+static void test_sequence_and_malformed(void)
+{
+    ecu_stream_encoder_t encoder;
+    ecu_stream_decoder_t decoder;
+    ecu_data_t data = { .engine_rpm = 1000.0f };
+    uint8_t key[ECU_STREAM_MAX_FRAME_SIZE];
+    uint8_t delta1[ECU_STREAM_MAX_FRAME_SIZE];
+    uint8_t delta2[ECU_STREAM_MAX_FRAME_SIZE];
+
+    ecu_stream_encoder_reset(&encoder);
+    ecu_stream_decoder_reset(&decoder);
+    size_t key_len = ecu_stream_encode(&encoder, &data, 0, false, key, sizeof(key));
+    data.engine_rpm = 1100.0f;
+    size_t delta1_len = ecu_stream_encode(&encoder, &data, 0, false, delta1, sizeof(delta1));
+    data.engine_rpm = 1050.0f;
+    size_t delta2_len = ecu_stream_encode(&encoder, &data, 0, false, delta2, sizeof(delta2));
+    CHECK(key_len == ECU_STREAM_HEADER_SIZE + ECU_SIG_COUNT * 2 + 1);   // rpm 1000 takes 2 bytes
+    CHECK(delta1_len == ECU_STREAM_HEADER_SIZE + 3);
+
+    // Deltas before the keyframe, and after a lost frame, are rejected
+    CHECK(ecu_stream_decode(&decoder, delta1, delta1_len) == ESP_ERR_INVALID_STATE);
+    CHECK(ecu_stream_decode(&decoder, key, key_len) == ESP_OK);
+    CHECK(ecu_stream_decode(&decoder, delta2, delta2_len) == ESP_ERR_INVALID_STATE);
+    CHECK(ecu_stream_decoder_value(&decoder, ECU_SIG_ENGINE_RPM) == 1000.0f);
+
+    // Malformed frames leave the state untouched
+    uint8_t bad[ECU_STREAM_MAX_FRAME_SIZE];
+    CHECK(ecu_stream_decode(&decoder, delta1, ECU_STREAM_HEADER_SIZE - 1) == ESP_ERR_INVALID_SIZE);
+    CHECK(ecu_stream_decode(&decoder, delta1, delta1_len - 1) == ESP_ERR_INVALID_SIZE);   // Truncated varint
+    memcpy(bad, delta1, delta1_len);
+    bad[0] = ECU_STREAM_VERSION + 1;
+    CHECK(ecu_stream_decode(&decoder, bad, delta1_len) == ESP_ERR_INVALID_ARG);
+    memcpy(bad, delta1, delta1_len);
+    bad[ECU_STREAM_HEADER_SIZE] = ECU_SIG_COUNT;                                          // Unknown signal
+    CHECK(ecu_stream_decode(&decoder, bad, delta1_len) == ESP_ERR_INVALID_SIZE);
+    memcpy(bad, delta1, delta1_len);
+    bad[10] = 2;                                                                          // Count past the end
+    CHECK(ecu_stream_decode(&decoder, bad, delta1_len) == ESP_ERR_INVALID_SIZE);
+    memset(bad, 0xFF, sizeof(bad));
+    memcpy(bad, delta1, ECU_STREAM_HEADER_SIZE + 1);                                      // Endless varint
+    CHECK(ecu_stream_decode(&decoder, bad, sizeof(bad)) == ESP_ERR_INVALID_SIZE);
+    CHECK(decoder.sequence == 1 && ecu_stream_decoder_value(&decoder, ECU_SIG_ENGINE_RPM) == 1000.0f);
+
+    CHECK(ecu_stream_decode(&decoder, delta1, delta1_len) == ESP_OK);
+    CHECK(ecu_stream_decode(&decoder, delta2, delta2_len) == ESP_OK);
+    CHECK(ecu_stream_decoder_value(&decoder, ECU_SIG_ENGINE_RPM) == 1050.0f);
+
+    // A keyframe resynchronizes after a gap
+    data.engine_rpm = 3000.0f;
+    ecu_stream_encode(&encoder, &data, 0, false, delta1, sizeof(delta1));                 // Lost
+    data.engine_rpm = 3100.0f;
+    key_len = ecu_stream_encode(&encoder, &data, 0, true, key, sizeof(key));
+    CHECK(ecu_stream_decode(&decoder, key, key_len) == ESP_OK);
+    CHECK(ecu_stream_decoder_value(&decoder, ECU_SIG_ENGINE_RPM) == 3100.0f);
+}
+
+// The /data response, as the polling client gets it
+static size_t format_json(const ecu_data_t *data, char *buf, size_t size)
+{
+    int len = snprintf(buf, size,
+        "{\"map_pressure\":%.1f,\"wastegate_pos\":%.1f,\"tps_position\":%.1f,"
+        "\"engine_rpm\":%.0f,\"target_boost\":%.1f,\"tcu_status\":%d}",
+        data->map_kpa, data->wg_pos_percent, data->tps_position,
+        data->engine_rpm, data->wg_set_percent, 0);
+    return len > 0 ? (size_t)len : 0;
+}
+
+static void bench_stream_vs_poll(double seconds)
+{
+    static ecu_stream_encoder_t encoders[STREAM_CLIENTS];
+    ecu_data_t data = { .engine_rpm = 2500.0f, .map_kpa = 150.0f };
+    uint64_t timestamp_ms = 0;
+    uint8_t frame[ECU_STREAM_MAX_FRAME_SIZE];
+    char json[256];
+
+    for (int c = 0; c < STREAM_CLIENTS; c++) ecu_stream_encoder_reset(&encoders[c]);
+    srand(2);
+
+    // Each tick is one 20 ms period: every stream client gets a frame, the poller one response
+    uint64_t ticks = 0, stream_bytes = 0, poll_bytes = 0, stream_ns = 0, poll_ns = 0;
+    volatile size_t sink = 0;
+    const uint64_t end = now_ns() + (uint64_t)(seconds * 1e9);
+    while (now_ns() < end) {
+        for (int batch = 0; batch < 100; batch++, ticks++) {
+            random_walk(&data, &timestamp_ms);
+
+            uint64_t start = now_ns();
+            for (int c = 0; c < STREAM_CLIENTS; c++) {
+                size_t len = ecu_stream_encode(&encoders[c], &data, 0, ticks % (5 * STREAM_RATE_HZ) == 0,
+                                               frame, sizeof(frame));
+                stream_bytes += len ? len + WS_HEADER_BYTES : 0;
+                sink += len;
+            }
+            uint64_t mid = now_ns();
+            size_t len = format_json(&data, json, sizeof(json));
+            sink += len;
+            stream_ns += mid - start;
+            poll_ns += now_ns() - mid;
+            poll_bytes += len + HTTP_OVERHEAD_BYTES;
+        }
+    }
+
+    double stream_s = (double)ticks / STREAM_RATE_HZ;
+    printf("{\"path\":\"ws_binary\",\"clients\":%d,\"rate_hz\":%d,\"bytes_per_s\":%.0f,\"encode_ns_per_period\":%.1f}\n",
+           STREAM_CLIENTS, STREAM_RATE_HZ, stream_bytes / stream_s, (double)stream_ns / ticks);
+    printf("{\"path\":\"http_json_poll\",\"clients\":1,\"rate_hz\":%d,\"bytes_per_s\":%.0f,\"encode_ns_per_period\":%.1f}\n",
+           STREAM_RATE_HZ, poll_bytes / stream_s, (double)poll_ns / ticks);
+
+    // Four binary streams carry all 12 signals and still cost less than one JSON poller of 6
+    CHECK(stream_bytes < poll_bytes);
+    CHECK(stream_ns < poll_ns);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+    if (seconds <= 0) seconds = 1.0;
+
+    test_round_trip();
+    test_sequence_and_malformed();
+    bench_stream_vs_poll(seconds);
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All ECU stream tests passed\n");
+    return 0;
+}
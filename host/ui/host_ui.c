@@ -0,0 +1,163 @@
+// Host runtime of the dashboard UI, see host_ui.h
+#include "host_ui.h"
+#include "lvgl.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// Each block carries its size in front, so frees can be counted
+typedef struct {
+    size_t size;
+    size_t pad;                 // Keep the payload 16 byte aligned
+} alloc_header_t;
+
+static size_t s_lvgl_bytes = 0;
+static size_t s_lvgl_peak_bytes = 0;
+static uint32_t s_tick_ms = 0;
+static host_ui_frame_stats_t s_frame_stats;
+static bool s_refr_drew = false;      // Set by the monitor callback
+static uint32_t s_refr_px = 0;
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void *host_ui_malloc(size_t size)
+{
+    alloc_header_t *header = malloc(sizeof(*header) + size);
+    if (!header) {
+        return NULL;
+    }
+    header->size = size;
+    s_lvgl_bytes += size;
+    if (s_lvgl_bytes > s_lvgl_peak_bytes) {
+        s_lvgl_peak_bytes = s_lvgl_bytes;
+    }
+    return header + 1;
+}
+
+void host_ui_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    alloc_header_t *header = (alloc_header_t *)ptr - 1;
+    s_lvgl_bytes -= header->size;
+    free(header);
+}
+
+void *host_ui_realloc(void *ptr, size_t size)
+{
+    if (!ptr) {
+        return host_ui_malloc(size);
+    }
+    alloc_header_t *header = (alloc_header_t *)ptr - 1;
+    size_t old_size = header->size;
+    alloc_header_t *resized = realloc(header, sizeof(*header) + size);
+    if (!resized) {
+        return NULL;
+    }
+    resized->size = size;
+    s_lvgl_bytes = s_lvgl_bytes - old_size + size;
+    if (s_lvgl_bytes > s_lvgl_peak_bytes) {
+        s_lvgl_peak_bytes = s_lvgl_bytes;
+    }
+    return resized + 1;
+}
+
+void host_ui_heap_get(host_ui_heap_t *heap)
+{
+    heap->lvgl_bytes = s_lvgl_bytes;
+    heap->lvgl_peak_bytes = s_lvgl_peak_bytes;
+#ifdef __GLIBC__
+    heap->process_bytes = mallinfo2().uordblks;
+#else
+    heap->process_bytes = 0;
+#endif
+}
+
+void host_ui_heap_reset_peak(void)
+{
+    s_lvgl_peak_bytes = s_lvgl_bytes;
+}
+
+uint32_t host_ui_tick_ms(void)
+{
+    return s_tick_ms;
+}
+
+void host_ui_advance_ms(uint32_t ms)
+{
+    s_tick_ms += ms;
+}
+
+static void host_ui_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+{
+    // Direct mode: LVGL drew straight into the frame buffer the panel would scan out
+    lv_disp_flush_ready(drv);
+}
+
+// End of a refresh that drew something; px is the area redrawn
+static void host_ui_monitor_cb(lv_disp_drv_t *drv, uint32_t time_ms, uint32_t px)
+{
+    s_refr_drew = true;
+    s_refr_px = px;
+}
+
+// The whole refresh is timed: layout, copying the previous frame's areas and drawing
+static void host_ui_refr_timer_cb(lv_timer_t *timer)
+{
+    s_refr_drew = false;
+    uint64_t start = now_ns();
+    _lv_disp_refr_timer(timer);
+    uint64_t elapsed = now_ns() - start;
+    if (!s_refr_drew) {
+        return;
+    }
+    s_frame_stats.frames++;
+    s_frame_stats.render_ns += elapsed;
+    if (elapsed > s_frame_stats.max_render_ns) {
+        s_frame_stats.max_render_ns = elapsed;
+    }
+    s_frame_stats.px += s_refr_px;
+}
+
+lv_disp_t *host_ui_display_create(void)
+{
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_disp_drv_t disp_drv;
+    const size_t px = (size_t)HOST_UI_HOR_RES * HOST_UI_VER_RES;
+    lv_color_t *fb0 = calloc(px, sizeof(lv_color_t));
+    lv_color_t *fb1 = calloc(px, sizeof(lv_color_t));
+    if (!fb0 || !fb1) {
+        free(fb0);
+        free(fb1);
+        return NULL;
+    }
+    lv_disp_draw_buf_init(&draw_buf, fb0, fb1, px);
+
+    lv_disp_drv_init(&disp_drv);
+    disp_drv.hor_res = HOST_UI_HOR_RES;
+    disp_drv.ver_res = HOST_UI_VER_RES;
+    disp_drv.flush_cb = host_ui_flush_cb;
+    disp_drv.monitor_cb = host_ui_monitor_cb;
+    disp_drv.draw_buf = &draw_buf;
+    disp_drv.direct_mode = true;
+    lv_disp_t *disp = lv_disp_drv_register(&disp_drv);
+    if (disp) {
+        lv_timer_set_cb(disp->refr_timer, host_ui_refr_timer_cb);
+    }
+    return disp;
+}
+
+void host_ui_frame_stats_take(host_ui_frame_stats_t *stats)
+{
+    *stats = s_frame_stats;
+    s_frame_stats = (host_ui_frame_stats_t){0};
+}
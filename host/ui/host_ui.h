@@ -0,0 +1,44 @@
+// Host runtime of the dashboard UI: LVGL heap accounting, a virtual tick and a headless
+// 800x480 RGB565 display. Also included by lv_conf.h, so it must not include lvgl.h.
+#ifndef HOST_UI_H
+#define HOST_UI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HOST_UI_HOR_RES     800
+#define HOST_UI_VER_RES     480
+
+// LVGL allocator (LV_MEM_CUSTOM): the C heap, with the bytes in use counted
+void *host_ui_malloc(size_t size);
+void host_ui_free(void *ptr);
+void *host_ui_realloc(void *ptr, size_t size);
+
+typedef struct {
+    size_t lvgl_bytes;          // Allocated by LVGL now
+    size_t lvgl_peak_bytes;     // Since the last host_ui_heap_reset_peak()
+    size_t process_bytes;       // Whole C heap in use (frame buffers, image caches), 0 if unknown
+} host_ui_heap_t;
+
+void host_ui_heap_get(host_ui_heap_t *heap);
+void host_ui_heap_reset_peak(void);
+
+// LVGL tick (LV_TICK_CUSTOM): only moves when advanced
+uint32_t host_ui_tick_ms(void);
+void host_ui_advance_ms(uint32_t ms);
+
+typedef struct {
+    uint32_t frames;            // Refreshes that drew something
+    uint64_t render_ns;         // Time spent in those refreshes
+    uint64_t max_render_ns;
+    uint64_t px;                // Pixels redrawn (invalidated area after joining)
+} host_ui_frame_stats_t;
+
+// Create the display: two full frame buffers in direct mode, as the panel with
+// CONFIG_EXAMPLE_DOUBLE_FB. The flush just hands the buffer back.
+struct _lv_disp_t *host_ui_display_create(void);
+
+// Frame statistics since the previous call
+void host_ui_frame_stats_take(host_ui_frame_stats_t *stats);
+
+#endif // HOST_UI_H
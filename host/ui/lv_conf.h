@@ -0,0 +1,126 @@
+// LVGL configuration of the host UI build. Follows the CONFIG_LV_* values in sdkconfig;
+// widgets the dashboard does not use are left out. Memory and tick come from host_ui.
+#ifndef LV_CONF_H
+#define LV_CONF_H
+
+#include <stdint.h>
+
+// Color
+#define LV_COLOR_DEPTH              16
+#define LV_COLOR_16_SWAP            0
+#define LV_COLOR_SCREEN_TRANSP      0
+#define LV_COLOR_CHROMA_KEY         lv_color_hex(0x00ff00)
+
+// Memory: the C heap as on the target (CONFIG_LV_MEM_CUSTOM), counted per screen
+#define LV_MEM_CUSTOM               1
+#define LV_MEM_CUSTOM_INCLUDE       "host_ui.h"
+#define LV_MEM_CUSTOM_ALLOC         host_ui_malloc
+#define LV_MEM_CUSTOM_FREE          host_ui_free
+#define LV_MEM_CUSTOM_REALLOC       host_ui_realloc
+#define LV_MEM_BUF_MAX_NUM          16
+#define LV_MEMCPY_MEMSET_STD        1
+
+// HAL: virtual time, advanced by the benchmark
+#define LV_DISP_DEF_REFR_PERIOD     30
+#define LV_INDEV_DEF_READ_PERIOD    30
+#define LV_TICK_CUSTOM              1
+#define LV_TICK_CUSTOM_INCLUDE      "host_ui.h"
+#define LV_TICK_CUSTOM_SYS_TIME_EXPR (host_ui_tick_ms())
+#define LV_DPI_DEF                  130
+
+// Drawing
+#define LV_DRAW_COMPLEX             1
+#define LV_SHADOW_CACHE_SIZE        0
+#define LV_CIRCLE_CACHE_SIZE        4
+#define LV_LAYER_SIMPLE_BUF_SIZE    (24 * 1024)
+#define LV_IMG_CACHE_DEF_SIZE       0
+#define LV_GRADIENT_MAX_STOPS       2
+#define LV_GRAD_CACHE_DEF_SIZE      0
+#define LV_USE_GPU_SDL              0
+
+// Logging and asserts
+#define LV_USE_LOG                  0
+#define LV_USE_ASSERT_NULL          1
+#define LV_USE_ASSERT_MALLOC        1
+#define LV_USE_ASSERT_STYLE         0
+#define LV_USE_ASSERT_MEM_INTEGRITY 0
+#define LV_USE_ASSERT_OBJ           0
+#define LV_USE_PERF_MONITOR         0
+#define LV_USE_MEM_MONITOR          0
+#define LV_USE_USER_DATA            1
+#define LV_USE_LARGE_COORD          0
+
+// Fonts
+#define LV_FONT_MONTSERRAT_8        1
+#define LV_FONT_MONTSERRAT_10       1
+#define LV_FONT_MONTSERRAT_12       1
+#define LV_FONT_MONTSERRAT_14       1
+#define LV_FONT_MONTSERRAT_16       1
+#define LV_FONT_MONTSERRAT_18       1
+#define LV_FONT_MONTSERRAT_20       1
+#define LV_FONT_MONTSERRAT_22       1
+#define LV_FONT_MONTSERRAT_24       1
+#define LV_FONT_MONTSERRAT_26       1
+#define LV_FONT_MONTSERRAT_28       1
+#define LV_FONT_MONTSERRAT_30       1
+#define LV_FONT_MONTSERRAT_32       1
+#define LV_FONT_DEFAULT             &lv_font_montserrat_14
+#define LV_USE_FONT_PLACEHOLDER     1
+#define LV_TXT_ENC                  LV_TXT_ENC_UTF8
+
+// Widgets
+#define LV_USE_ARC                  1
+#define LV_USE_BAR                  1
+#define LV_USE_BTN                  1
+#define LV_USE_BTNMATRIX            1
+#define LV_USE_CANVAS               1
+#define LV_USE_CHECKBOX             1
+#define LV_USE_DROPDOWN             1
+#define LV_USE_IMG                  1
+#define LV_USE_LABEL                1
+#define LV_USE_LINE                 1
+#define LV_USE_ROLLER               1
+#define LV_USE_SLIDER               1
+#define LV_USE_SWITCH               1
+#define LV_USE_TEXTAREA             1
+#define LV_USE_TABLE                1
+#define LV_USE_LED                  1
+
+#define LV_USE_ANIMIMG              0
+#define LV_USE_CALENDAR             0
+#define LV_USE_CHART                0
+#define LV_USE_COLORWHEEL           0
+#define LV_USE_IMGBTN               0
+#define LV_USE_KEYBOARD             0
+#define LV_USE_LIST                 0
+#define LV_USE_MENU                 0
+#define LV_USE_METER                0
+#define LV_USE_MSGBOX               0
+#define LV_USE_SPAN                 0
+#define LV_USE_SPINBOX              0
+#define LV_USE_SPINNER              0
+#define LV_USE_TABVIEW              0
+#define LV_USE_TILEVIEW             0
+#define LV_USE_WIN                  0
+
+// Themes and layouts
+#define LV_USE_THEME_DEFAULT        1
+#define LV_THEME_DEFAULT_DARK       0
+#define LV_THEME_DEFAULT_GROW       1
+#define LV_THEME_DEFAULT_TRANSITION_TIME 80
+#define LV_USE_THEME_BASIC          1
+#define LV_USE_THEME_MONO           0
+#define LV_USE_FLEX                 1
+#define LV_USE_GRID                 1
+
+// Others
+#define LV_USE_SNAPSHOT             1
+#define LV_USE_FS_STDIO             0
+#define LV_USE_PNG                  0
+#define LV_USE_GIF                  0
+#define LV_USE_QRCODE               0
+#define LV_USE_FREETYPE             0
+#define LV_USE_FFMPEG               0
+#define LV_USE_RLOTTIE              0
+
+#endif // LV_CONF_H
@@ -9,6 +9,7 @@
 #include "nvs_flash.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "include/task_config.h"
 #include <string.h>
 #include "ui/settings_config.h" // For settings_save()
 
@@ -30,8 +31,7 @@ static nvs_operation_t static_nvs_operation;
 // Размер стека для фоновой задачи
 #define BACKGROUND_TASK_STACK_SIZE 4096
 
-// Приоритет фоновой задачи
-#define BACKGROUND_TASK_PRIORITY 5
+// Приоритет и ядро фоновой задачи: include/task_config.h
 
 /**
  * @brief Основная функция фоновой задачи
@@ -166,13 +166,14 @@ esp_err_t background_task_init(void)
     }
 
     // Создание фоновой задачи
-    BaseType_t ret = xTaskCreate(
+    BaseType_t ret = xTaskCreatePinnedToCore(
         background_task_worker,
         "bg_worker",
         BACKGROUND_TASK_STACK_SIZE,
         NULL,
-        BACKGROUND_TASK_PRIORITY,
-        &background_task_handle
+        TASK_BACKGROUND_PRIORITY,
+        &background_task_handle,
+        TASK_CORE_BACKGROUND
     );
 
     if (ret != pdPASS) {
@@ -0,0 +1,229 @@
+/*
+ * Table-driven CAN signal decoder
+ * Decodes frames using a compiled signal table instead of per-ID switch statements
+ */
+
+#include "include/can_decoder.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "CAN_DECODER";
+
+// Table used by can_decoder_decode(). Swapped atomically (aligned pointer store).
+static const can_decoder_table_t *volatile s_active_table = NULL;
+
+// Multiplier applied to CAN_SIG_FLAG_TORQUE_PCT signals: max torque / 100%
+static float s_torque_pct_to_nm = 500.0f / 100.0f;
+
+// Position of the signal inside the 64-bit frame word (see can_decoder_extract)
+static inline bool signal_layout(const can_signal_def_t *signal, uint8_t *shift, uint8_t *min_dlc)
+{
+    if (signal->length == 0 || signal->length > 32 || signal->start_bit > 63) {
+        return false;
+    }
+
+    if (signal->byte_order == CAN_BYTE_ORDER_INTEL) {
+        // Intel: start bit is the LSB, counted from bit 0 of byte 0
+        uint8_t msb = signal->start_bit + signal->length - 1;
+        if (msb > 63) return false;
+        *shift = signal->start_bit;
+        *min_dlc = msb / 8 + 1;
+    } else {
+        // Motorola: start bit is the MSB in DBC numbering. Convert to a
+        // linear position where bit 0 is the MSB of byte 0.
+        uint8_t msb_linear = (signal->start_bit / 8) * 8 + (7 - signal->start_bit % 8);
+        uint8_t lsb_linear = msb_linear + signal->length - 1;
+        if (lsb_linear > 63) return false;
+        *shift = 63 - lsb_linear;
+        *min_dlc = lsb_linear / 8 + 1;
+    }
+    return true;
+}
+
+// Frame bytes as a little endian word (byte 0 in the low bits)
+static inline uint64_t load_le64(const uint8_t *frame)
+{
+    uint64_t word;
+    memcpy(&word, frame, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+static inline float raw_to_physical(const can_signal_def_t *signal, uint64_t word, uint8_t shift)
+{
+    uint64_t mask = (1ULL << signal->length) - 1;
+    uint64_t raw = (word >> shift) & mask;
+
+    if ((signal->flags & CAN_SIG_FLAG_SIGNED) && (raw & (1ULL << (signal->length - 1)))) {
+        return (float)(int64_t)(raw | ~mask) * signal->scale + signal->offset;
+    }
+    return (float)raw * signal->scale + signal->offset;
+}
+
+// Index of the first signal for an identifier, or -1 if the ID is not decoded
+static inline int find_first_signal(const can_decoder_table_t *table, uint32_t id)
+{
+    if (!(id & CAN_DECODER_ID_EXT_FLAG)) {
+        if (id >= CAN_DECODER_STD_ID_COUNT) return -1;
+        return (int)table->std_index[id] - 1;
+    }
+
+    // Extended identifiers: lower bound binary search
+    size_t lo = 0;
+    size_t hi = table->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (table->signals[mid].can_id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo < table->count && table->signals[lo].can_id == id) ? (int)lo : -1;
+}
+
+esp_err_t can_decoder_table_build(can_decoder_table_t *table, const can_signal_def_t *signals, size_t count)
+{
+    if (!table || (!signals && count > 0) || count > UINT16_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Decoded for every frame of the ID: internal RAM, two bytes per signal
+    can_signal_layout_t *layouts = NULL;
+    if (count > 0) {
+        layouts = malloc(count * sizeof(*layouts));
+        if (!layouts) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    memset(table->std_index, 0, sizeof(table->std_index));
+    table->signals = signals;
+    table->layouts = layouts;
+    table->count = count;
+
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0 && signals[i].can_id < signals[i - 1].can_id) {
+            ESP_LOGE(TAG, "Signal table not sorted by CAN ID at index %u", (unsigned)i);
+            can_decoder_table_free(table);
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (!signal_layout(&signals[i], &layouts[i].shift, &layouts[i].min_dlc)) {
+            ESP_LOGE(TAG, "Invalid signal layout for ID 0x%lX (start %u, length %u)",
+                     (unsigned long)signals[i].can_id, signals[i].start_bit, signals[i].length);
+            can_decoder_table_free(table);
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        uint32_t id = signals[i].can_id;
+        if (!(id & CAN_DECODER_ID_EXT_FLAG)) {
+            if (id >= CAN_DECODER_STD_ID_COUNT) {
+                ESP_LOGE(TAG, "Standard CAN ID 0x%lX out of range", (unsigned long)id);
+                can_decoder_table_free(table);
+                return ESP_ERR_INVALID_ARG;
+            }
+            if (table->std_index[id] == 0) {
+                table->std_index[id] = (uint16_t)(i + 1);
+            }
+        }
+    }
+
+    ESP_LOGI(TAG, "Signal table built: %u signals", (unsigned)count);
+    return ESP_OK;
+}
+
+void can_decoder_table_free(can_decoder_table_t *table)
+{
+    if (!table) {
+        return;
+    }
+    free(table->layouts);
+    table->layouts = NULL;
+    table->signals = NULL;
+    table->count = 0;
+    memset(table->std_index, 0, sizeof(table->std_index));
+}
+
+void can_decoder_set_active(const can_decoder_table_t *table)
+{
+    s_active_table = table;
+}
+
+const can_decoder_table_t* can_decoder_get_active(void)
+{
+    return s_active_table;
+}
+
+bool can_decoder_extract(const can_signal_def_t *signal, const uint8_t *data, uint8_t dlc, float *value)
+{
+    uint8_t shift, min_dlc;
+    if (!signal || !data || !value || !signal_layout(signal, &shift, &min_dlc) || dlc < min_dlc) {
+        return false;
+    }
+
+    uint8_t frame[8] = {0};
+    memcpy(frame, data, dlc > 8 ? 8 : dlc);
+    uint64_t word = load_le64(frame);
+    if (signal->byte_order == CAN_BYTE_ORDER_MOTOROLA) {
+        word = __builtin_bswap64(word);
+    }
+    *value = raw_to_physical(signal, word, shift);
+    return true;
+}
+
+bool can_decoder_has_id(uint32_t id)
+{
+    const can_decoder_table_t *table = s_active_table;
+    return table && find_first_signal(table, id) >= 0;
+}
+
+uint32_t can_decoder_decode(uint32_t id, const uint8_t *data, uint8_t dlc, ecu_data_t *ecu_data)
+{
+    const can_decoder_table_t *table = s_active_table;
+    if (!table || !data || !ecu_data) {
+        return 0;
+    }
+
+    int first = find_first_signal(table, id);
+    if (first < 0) {
+        return 0; // ID not decoded
+    }
+
+    if (dlc > 8) dlc = 8;
+    uint8_t frame[8] = {0};
+    memcpy(frame, data, dlc);
+    const uint64_t le_word = load_le64(frame);
+    const uint64_t be_word = __builtin_bswap64(le_word);
+
+    uint32_t updated = 0;
+    for (size_t i = (size_t)first; i < table->count && table->signals[i].can_id == id; i++) {
+        const can_signal_def_t *signal = &table->signals[i];
+        const can_signal_layout_t *layout = &table->layouts[i];
+        float *target = ecu_data_field(ecu_data, (ecu_signal_t)signal->field);
+
+        // Too short for the signal: leave the field as it was instead of decoding padding
+        if (!target || dlc < layout->min_dlc) {
+            continue;
+        }
+
+        float value = raw_to_physical(signal,
+                                      signal->byte_order == CAN_BYTE_ORDER_INTEL ? le_word : be_word,
+                                      layout->shift);
+        if (signal->flags & CAN_SIG_FLAG_TORQUE_PCT) {
+            value *= s_torque_pct_to_nm;
+        }
+
+        *target = value;
+        updated |= 1UL << signal->field;
+    }
+
+    return updated;
+}
+
+void can_decoder_set_max_torque(float max_torque_nm)
+{
+    s_torque_pct_to_nm = max_torque_nm / 100.0f;
+}
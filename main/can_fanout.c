@@ -0,0 +1,197 @@
+/*
+ * CAN frame fan-out
+ * The CAN task publishes every received batch once; each consumer has its own
+ * bounded ring and drop counter, so a slow consumer never stalls ingest.
+ * Kept free of UI dependencies so it also builds on the host.
+ */
+
+#include "include/can_fanout.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+#include <stdatomic.h>
+
+static const char *TAG = "CAN_FANOUT";
+
+struct can_subscriber {
+    const char *name;
+    can_frame_t *slots;
+    uint32_t mask;
+    atomic_uint_least32_t head;       // Written by the producer
+    atomic_uint_least32_t tail;       // Written by the consumer
+    atomic_uint_least32_t dropped;
+    atomic_bool active;
+    atomic_bool all_ids;
+};
+
+static struct can_subscriber s_subscribers[CAN_FANOUT_MAX_SUBSCRIBERS];
+static atomic_uint_least32_t s_subscriber_count = 0;
+static atomic_flag s_subscribe_lock = ATOMIC_FLAG_INIT;
+
+esp_err_t can_fanout_subscribe(const char *name, size_t capacity, can_subscriber_t **subscriber)
+{
+    if (!name || !subscriber || capacity == 0 || capacity > 0x8000) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    // Ring in internal RAM: written for every frame by the CAN task
+    can_frame_t *slots = heap_caps_malloc(size * sizeof(can_frame_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!slots) {
+        ESP_LOGE(TAG, "No memory for %u frames of subscriber '%s'", (unsigned)size, name);
+        return ESP_ERR_NO_MEM;
+    }
+
+    while (atomic_flag_test_and_set_explicit(&s_subscribe_lock, memory_order_acquire)) {
+        vTaskDelay(1); // Let a preempted subscriber finish
+    }
+    uint32_t index = atomic_load_explicit(&s_subscriber_count, memory_order_relaxed);
+    if (index >= CAN_FANOUT_MAX_SUBSCRIBERS) {
+        atomic_flag_clear_explicit(&s_subscribe_lock, memory_order_release);
+        heap_caps_free(slots);
+        ESP_LOGE(TAG, "Too many subscribers, '%s' rejected", name);
+        return ESP_ERR_NO_MEM;
+    }
+    struct can_subscriber *sub = &s_subscribers[index];
+    sub->name = name;
+    sub->slots = slots;
+    sub->mask = (uint32_t)size - 1;
+    atomic_init(&sub->head, 0);
+    atomic_init(&sub->tail, 0);
+    atomic_init(&sub->dropped, 0);
+    atomic_init(&sub->active, true);
+    atomic_init(&sub->all_ids, true);
+    // The publisher only looks at entries below the count
+    atomic_store_explicit(&s_subscriber_count, index + 1, memory_order_release);
+    atomic_flag_clear_explicit(&s_subscribe_lock, memory_order_release);
+
+    ESP_LOGI(TAG, "Subscriber '%s': %u frames", name, (unsigned)size);
+    *subscriber = sub;
+    return ESP_OK;
+}
+
+void can_fanout_set_active(can_subscriber_t *subscriber, bool active)
+{
+    if (subscriber) {
+        atomic_store_explicit(&subscriber->active, active, memory_order_relaxed);
+    }
+}
+
+void can_fanout_set_all_ids(can_subscriber_t *subscriber, bool all_ids)
+{
+    if (subscriber) {
+        atomic_store_explicit(&subscriber->all_ids, all_ids, memory_order_relaxed);
+    }
+}
+
+uint32_t can_fanout_active_mask(void)
+{
+    uint32_t mask = 0;
+    uint32_t count = atomic_load_explicit(&s_subscriber_count, memory_order_acquire);
+    for (uint32_t i = 0; i < count; i++) {
+        if (atomic_load_explicit(&s_subscribers[i].active, memory_order_relaxed)) {
+            mask |= 1U << i;
+        }
+    }
+    return mask;
+}
+
+uint32_t can_fanout_all_ids_mask(void)
+{
+    uint32_t mask = 0;
+    uint32_t count = atomic_load_explicit(&s_subscriber_count, memory_order_acquire);
+    for (uint32_t i = 0; i < count; i++) {
+        if (atomic_load_explicit(&s_subscribers[i].active, memory_order_relaxed) &&
+            atomic_load_explicit(&s_subscribers[i].all_ids, memory_order_relaxed)) {
+            mask |= 1U << i;
+        }
+    }
+    return mask;
+}
+
+void can_fanout_publish(const can_frame_t *frames, size_t count)
+{
+    if (!frames || count == 0) {
+        return;
+    }
+    uint32_t subscribers = atomic_load_explicit(&s_subscriber_count, memory_order_acquire);
+
+    for (uint32_t s = 0; s < subscribers; s++) {
+        struct can_subscriber *sub = &s_subscribers[s];
+        if (!atomic_load_explicit(&sub->active, memory_order_relaxed)) {
+            continue;
+        }
+        uint32_t head = atomic_load_explicit(&sub->head, memory_order_relaxed);
+        uint32_t tail = atomic_load_explicit(&sub->tail, memory_order_acquire);
+        uint32_t space = sub->mask + 1 - (head - tail);
+        size_t n = count < space ? count : space;
+
+        for (size_t i = 0; i < n; i++) {
+            sub->slots[(head + i) & sub->mask] = frames[i];
+        }
+        atomic_store_explicit(&sub->head, head + (uint32_t)n, memory_order_release);
+        if (n < count) {
+            atomic_fetch_add_explicit(&sub->dropped, (uint32_t)(count - n), memory_order_relaxed);
+        }
+    }
+}
+
+size_t can_fanout_receive(can_subscriber_t *subscriber, can_frame_t *frames, size_t max_frames)
+{
+    if (!subscriber || !frames || max_frames == 0) {
+        return 0;
+    }
+    uint32_t tail = atomic_load_explicit(&subscriber->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&subscriber->head, memory_order_acquire);
+    uint32_t queued = head - tail;
+    size_t n = queued < max_frames ? queued : max_frames;
+
+    for (size_t i = 0; i < n; i++) {
+        frames[i] = subscriber->slots[(tail + i) & subscriber->mask];
+    }
+    // Hand the slots back to the producer once they are copied
+    atomic_store_explicit(&subscriber->tail, tail + (uint32_t)n, memory_order_release);
+    return n;
+}
+
+void can_fanout_flush(can_subscriber_t *subscriber)
+{
+    if (subscriber) {
+        uint32_t head = atomic_load_explicit(&subscriber->head, memory_order_acquire);
+        atomic_store_explicit(&subscriber->tail, head, memory_order_release);
+    }
+}
+
+void can_fanout_get_subscriber_stats(can_subscriber_t *subscriber, can_fanout_stats_t *stats)
+{
+    if (!subscriber || !stats) {
+        return;
+    }
+    uint32_t head = atomic_load_explicit(&subscriber->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&subscriber->tail, memory_order_relaxed);
+    stats->name = subscriber->name;
+    stats->delivered = head;
+    stats->dropped = atomic_load_explicit(&subscriber->dropped, memory_order_relaxed);
+    stats->queued = head - tail;
+    stats->capacity = subscriber->mask + 1;
+    stats->active = atomic_load_explicit(&subscriber->active, memory_order_relaxed);
+}
+
+size_t can_fanout_get_stats(can_fanout_stats_t *stats, size_t max_stats)
+{
+    if (!stats) {
+        return 0;
+    }
+    uint32_t subscribers = atomic_load_explicit(&s_subscriber_count, memory_order_acquire);
+    size_t n = subscribers < max_stats ? subscribers : max_stats;
+
+    for (size_t i = 0; i < n; i++) {
+        can_fanout_get_subscriber_stats(&s_subscribers[i], &stats[i]);
+    }
+    return n;
+}
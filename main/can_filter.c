@@ -0,0 +1,396 @@
+/*
+ * TWAI acceptance filter planner, see include/can_filter.h
+ * Kept free of driver dependencies so it also builds on the host.
+ */
+
+#include "include/can_filter.h"
+#include "include/ecu_data.h"
+#include <string.h>
+
+#define STD_ID_BITS     11
+#define EXT_ID_BITS     29
+
+// Where a filter looks at the identifier
+typedef enum {
+    SLOT_SINGLE,    // 32 bit code
+    SLOT_DUAL_1,    // 16 bit code, upper half of the register
+    SLOT_DUAL_2,    // 16 bit code, lower half of the register
+} slot_t;
+
+// One filter: mask bits set are don't care
+typedef struct {
+    uint32_t code;
+    uint32_t mask;
+} cube_t;
+
+typedef struct {
+    uint32_t unwanted;      // Accepted frames no identifier wants
+    uint32_t accepted;
+    double space;           // Accepted share of the 11-bit plus 29-bit identifier space
+} cost_t;
+
+// Identifier bits of a frame in the filter layout, and which of them the filter compares
+static void frame_field(uint32_t id, slot_t slot, uint32_t *value, uint32_t *care)
+{
+    bool ext = (id & CAN_DECODER_ID_EXT_FLAG) != 0;
+    uint32_t raw = id & ~CAN_DECODER_ID_EXT_FLAG;
+    if (slot == SLOT_SINGLE) {
+        *value = ext ? raw << 3 : raw << 21;
+        *care = ext ? 0xFFFFFFF8U : 0xFFE00000U;
+    } else {
+        *value = ext ? (raw >> 13) & 0xFFFF : (raw << 5) & 0xFFFF;
+        *care = ext ? 0xFFFFU : 0xFFE0U;
+    }
+}
+
+static bool cube_matches(cube_t cube, slot_t slot, uint32_t id)
+{
+    uint32_t value, care;
+    frame_field(id, slot, &value, &care);
+    return ((value ^ cube.code) & care & ~cube.mask) == 0;
+}
+
+bool can_filter_accepts(uint32_t code, uint32_t mask, bool single_filter, uint32_t id)
+{
+    if (single_filter) {
+        return cube_matches((cube_t) { code, mask }, SLOT_SINGLE, id);
+    }
+    return cube_matches((cube_t) { code >> 16, mask >> 16 }, SLOT_DUAL_1, id) ||
+           cube_matches((cube_t) { code & 0xFFFF, mask & 0xFFFF }, SLOT_DUAL_2, id);
+}
+
+// Smallest filter of a slot passing all the identifiers
+static cube_t cube_of(const uint32_t *ids, size_t count, slot_t slot)
+{
+    uint32_t width = slot == SLOT_SINGLE ? 0xFFFFFFFFU : 0xFFFFU;
+    cube_t cube = { 0, 0 };
+    for (size_t i = 0; i < count; i++) {
+        uint32_t value, care;
+        frame_field(ids[i], slot, &value, &care);
+        cube.mask |= ~care;
+        if (i == 0) {
+            cube.code = value;
+        } else {
+            cube.mask |= value ^ cube.code;
+        }
+    }
+    if (slot == SLOT_DUAL_2) {
+        // Data bits of filter 1 for 11-bit frames
+        cube.mask |= 0xF;
+    }
+    cube.mask &= width;
+    cube.code &= ~cube.mask & width;
+    return cube;
+}
+
+// Identifier code and don't care bits of a filter, for one frame format
+static void id_cube(cube_t cube, slot_t slot, bool ext, uint32_t *code, uint32_t *dont_care)
+{
+    if (slot == SLOT_SINGLE) {
+        int shift = ext ? 3 : 21;
+        uint32_t bits = ext ? 0x1FFFFFFF : 0x7FF;
+        *code = (cube.code >> shift) & bits;
+        *dont_care = (cube.mask >> shift) & bits;
+    } else if (ext) {
+        // ID28..13 compared, the low 13 bits never
+        *code = (cube.code & 0xFFFF) << 13;
+        *dont_care = ((cube.mask & 0xFFFF) << 13) | 0x1FFF;
+    } else {
+        *code = (cube.code >> 5) & 0x7FF;
+        *dont_care = (cube.mask >> 5) & 0x7FF;
+    }
+}
+
+static double pow2(int bits)
+{
+    return (double)(1ULL << bits);
+}
+
+// Identifiers of one format passed by one or two filters
+static double id_space(const cube_t *cubes, const slot_t *slots, size_t count, bool ext)
+{
+    uint32_t code[2], dc[2];
+    for (size_t i = 0; i < count; i++) {
+        id_cube(cubes[i], slots[i], ext, &code[i], &dc[i]);
+    }
+    double space = pow2(__builtin_popcount(dc[0]));
+    if (count == 2) {
+        space += pow2(__builtin_popcount(dc[1]));
+        if (((code[0] ^ code[1]) & ~dc[0] & ~dc[1]) == 0) {
+            space -= pow2(__builtin_popcount(dc[0] & dc[1]));
+        }
+    }
+    return space;
+}
+
+static bool is_wanted(const uint32_t *wanted, size_t count, uint32_t id)
+{
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (wanted[mid] == id) {
+            return true;
+        }
+        if (wanted[mid] < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return false;
+}
+
+static cost_t rate(const cube_t *cubes, const slot_t *slots, size_t count, const uint32_t *wanted, size_t wanted_count,
+                   const can_filter_id_count_t *traffic, size_t traffic_count)
+{
+    cost_t cost = { 0, 0, 0.0 };
+    for (size_t t = 0; t < traffic_count; t++) {
+        bool pass = false;
+        for (size_t i = 0; i < count && !pass; i++) {
+            pass = cube_matches(cubes[i], slots[i], traffic[t].id);
+        }
+        if (pass) {
+            cost.accepted += traffic[t].count;
+            if (!is_wanted(wanted, wanted_count, traffic[t].id)) {
+                cost.unwanted += traffic[t].count;
+            }
+        }
+    }
+    cost.space = id_space(cubes, slots, count, false) / pow2(STD_ID_BITS) +
+                 id_space(cubes, slots, count, true) / pow2(EXT_ID_BITS);
+    return cost;
+}
+
+static bool cheaper(cost_t a, cost_t b)
+{
+    return a.unwanted != b.unwanted ? a.unwanted < b.unwanted : a.space < b.space;
+}
+
+typedef struct {
+    const uint32_t *wanted;
+    size_t wanted_count;
+    const can_filter_id_count_t *traffic;
+    size_t traffic_count;
+    cube_t best[2];
+    cost_t best_cost;
+    bool found;
+} dual_search_t;
+
+// Rate the split given by a membership bit mask, both ways round
+static void try_split(dual_search_t *search, const bool *in_first)
+{
+    uint32_t groups[2][CAN_FILTER_MAX_IDS];
+    size_t sizes[2] = { 0, 0 };
+    for (size_t i = 0; i < search->wanted_count; i++) {
+        int g = in_first[i] ? 0 : 1;
+        groups[g][sizes[g]++] = search->wanted[i];
+    }
+    if (sizes[0] == 0 || sizes[1] == 0) {
+        return;
+    }
+    static const slot_t slots[2] = { SLOT_DUAL_1, SLOT_DUAL_2 };
+    for (int order = 0; order < 2; order++) {
+        cube_t cubes[2] = {
+            cube_of(groups[order], sizes[order], SLOT_DUAL_1),
+            cube_of(groups[order ^ 1], sizes[order ^ 1], SLOT_DUAL_2),
+        };
+        cost_t cost = rate(cubes, slots, 2, search->wanted, search->wanted_count,
+                           search->traffic, search->traffic_count);
+        if (!search->found || cheaper(cost, search->best_cost)) {
+            search->best[0] = cubes[0];
+            search->best[1] = cubes[1];
+            search->best_cost = cost;
+            search->found = true;
+        }
+    }
+}
+
+static void search_dual(dual_search_t *search)
+{
+    size_t n = search->wanted_count;
+    bool in_first[CAN_FILTER_MAX_IDS];
+
+    if (n <= CAN_FILTER_EXHAUSTIVE_MAX) {
+        // Every split into two groups; the last identifier always goes to the second
+        for (uint32_t split = 1; split < (1U << (n - 1)); split++) {
+            for (size_t i = 0; i < n; i++) {
+                in_first[i] = (split >> i) & 1;
+            }
+            try_split(search, in_first);
+        }
+        return;
+    }
+
+    // Too many to try all: split on each identifier bit, and at each point of the sorted list
+    for (int bit = 0; bit < 32; bit++) {
+        for (size_t i = 0; i < n; i++) {
+            in_first[i] = (search->wanted[i] >> bit) & 1;
+        }
+        try_split(search, in_first);
+    }
+    for (size_t at = 1; at < n; at++) {
+        for (size_t i = 0; i < n; i++) {
+            in_first[i] = i < at;
+        }
+        try_split(search, in_first);
+    }
+}
+
+static void fill_rates(can_filter_plan_t *plan, cost_t cost, const can_filter_id_count_t *traffic, size_t traffic_count)
+{
+    uint64_t frames = 0;
+    for (size_t t = 0; t < traffic_count; t++) {
+        frames += traffic[t].count;
+    }
+    plan->traffic_frames = (uint32_t)frames;
+    // No traffic, no rating: traffic_frames 0 tells readers the fractions mean nothing
+    plan->accepted_fraction = frames ? (float)cost.accepted / (float)frames : 0.0f;
+    plan->unwanted_fraction = frames ? (float)cost.unwanted / (float)frames : 0.0f;
+}
+
+void can_filter_plan_accept_all(const can_filter_id_count_t *traffic, size_t traffic_count, can_filter_plan_t *plan)
+{
+    memset(plan, 0, sizeof(*plan));
+    plan->accept_all = true;
+    plan->single_filter = true;
+    plan->acceptance_mask = 0xFFFFFFFFU;
+    uint32_t frames = 0;
+    for (size_t t = 0; t < traffic_count; t++) {
+        frames += traffic[t].count;
+    }
+    // Used when a consumer wants every frame, so nothing counts as unwanted
+    fill_rates(plan, (cost_t) { 0, frames, 1.0 }, traffic, traffic_count);
+}
+
+esp_err_t can_filter_plan(const uint32_t *wanted, size_t wanted_count,
+                          const can_filter_id_count_t *traffic, size_t traffic_count,
+                          can_filter_plan_t *plan)
+{
+    if (!plan || (wanted_count && !wanted) || (traffic_count && !traffic)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (wanted_count > CAN_FILTER_MAX_IDS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (wanted_count == 0) {
+        can_filter_plan_accept_all(traffic, traffic_count, plan);
+        return ESP_OK;
+    }
+
+    // Sorted and unique, for the membership test
+    uint32_t ids[CAN_FILTER_MAX_IDS];
+    size_t n = 0;
+    for (size_t i = 0; i < wanted_count; i++) {
+        size_t pos = n;
+        while (pos > 0 && ids[pos - 1] > wanted[i]) {
+            pos--;
+        }
+        if (pos > 0 && ids[pos - 1] == wanted[i]) {
+            continue;
+        }
+        memmove(&ids[pos + 1], &ids[pos], (n - pos) * sizeof(ids[0]));
+        ids[pos] = wanted[i];
+        n++;
+    }
+
+    static const slot_t single_slot = SLOT_SINGLE;
+    cube_t single = cube_of(ids, n, SLOT_SINGLE);
+    cost_t single_cost = rate(&single, &single_slot, 1, ids, n, traffic, traffic_count);
+
+    dual_search_t search = {
+        .wanted = ids,
+        .wanted_count = n,
+        .traffic = traffic,
+        .traffic_count = traffic_count,
+    };
+    search_dual(&search);
+
+    memset(plan, 0, sizeof(*plan));
+    if (search.found && cheaper(search.best_cost, single_cost)) {
+        plan->single_filter = false;
+        plan->acceptance_code = (search.best[0].code << 16) | search.best[1].code;
+        plan->acceptance_mask = (search.best[0].mask << 16) | search.best[1].mask;
+        fill_rates(plan, search.best_cost, traffic, traffic_count);
+    } else {
+        plan->single_filter = true;
+        plan->acceptance_code = single.code;
+        plan->acceptance_mask = single.mask;
+        fill_rates(plan, single_cost, traffic, traffic_count);
+    }
+    return ESP_OK;
+}
+
+size_t can_filter_wanted_ids(const can_decoder_table_t *table, uint32_t *ids, size_t max)
+{
+    size_t count = 0;
+    if (!table || !ids) {
+        return 0;
+    }
+    // The signals are sorted by identifier
+    for (size_t i = 0; i < table->count; i++) {
+        const can_signal_def_t *signal = &table->signals[i];
+        if (signal->field == ECU_SIG_NONE || (count > 0 && ids[count - 1] == signal->can_id)) {
+            continue;
+        }
+        if (count == max) {
+            return max + 1;
+        }
+        ids[count++] = signal->can_id;
+    }
+    return count;
+}
+
+size_t can_filter_plan_for_table(const can_decoder_table_t *table, uint32_t all_ids_consumers,
+                                 const can_filter_id_count_t *traffic, size_t traffic_count,
+                                 can_filter_plan_t *plan)
+{
+    uint32_t wanted[CAN_FILTER_MAX_IDS];
+    size_t wanted_count = can_filter_wanted_ids(table, wanted, CAN_FILTER_MAX_IDS);
+
+    // Too many decoded IDs are not worth filtering
+    if (all_ids_consumers != 0 || wanted_count == 0 || wanted_count > CAN_FILTER_MAX_IDS ||
+        can_filter_plan(wanted, wanted_count, traffic, traffic_count, plan) != ESP_OK) {
+        can_filter_plan_accept_all(traffic, traffic_count, plan);
+    }
+    return wanted_count;
+}
+
+void can_filter_traffic_reset(can_filter_traffic_t *traffic)
+{
+    memset(traffic, 0, sizeof(*traffic));
+}
+
+void can_filter_traffic_add(can_filter_traffic_t *traffic, const can_frame_t *frames, size_t count)
+{
+    for (size_t f = 0; f < count; f++) {
+        uint32_t id = frames[f].id;
+        // Open addressing on a multiplicative hash of the identifier
+        uint32_t slot = (id * 2654435761U) >> 24;
+        size_t probe;
+        for (probe = 0; probe < CAN_FILTER_TRAFFIC_SLOTS; probe++) {
+            can_filter_id_count_t *entry = &traffic->slots[(slot + probe) % CAN_FILTER_TRAFFIC_SLOTS];
+            if (entry->count == 0) {
+                entry->id = id;
+            }
+            if (entry->id == id) {
+                entry->count++;
+                break;
+            }
+        }
+        if (probe == CAN_FILTER_TRAFFIC_SLOTS) {
+            traffic->overflow++;
+        }
+        traffic->frames++;
+    }
+}
+
+size_t can_filter_traffic_get(const can_filter_traffic_t *traffic, can_filter_id_count_t *out, size_t max)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < CAN_FILTER_TRAFFIC_SLOTS && count < max; i++) {
+        if (traffic->slots[i].count) {
+            out[count++] = traffic->slots[i];
+        }
+    }
+    return count;
+}
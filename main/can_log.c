@@ -0,0 +1,496 @@
+/*
+ * Binary CAN trace logger
+ * A drain task moves frames from the CAN frame fan-out into one of two PSRAM blocks;
+ * a low priority writer task writes full blocks to the SD card, so a slow card only
+ * delays the writer while the other block keeps filling. Files are pre-allocated, so
+ * block writes do not allocate clusters. File format: include/can_log.h.
+ * Kept free of SD card driver dependencies so it also builds on the host.
+ */
+
+#include "include/can_log.h"
+#include "include/can_fanout.h"
+#include "include/task_config.h"
+#include "sd_log_file.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define CAN_LOG_DRAIN_MS            20
+#define CAN_LOG_LOST_OFFSET         22
+
+_Static_assert(sizeof(can_frame_t) == CAN_LOG_RECORD_SIZE, "records are received straight from the fan-out");
+_Static_assert(offsetof(can_frame_t, data) + 8 == CAN_LOG_LOST_OFFSET, "lost is kept in the frame padding");
+_Static_assert(sizeof(can_log_header_t) == CAN_LOG_RECORD_SIZE, "the header is record 0");
+_Static_assert(CAN_LOG_ALIGN % 512 == 0 && CAN_LOG_ALIGN % CAN_LOG_RECORD_SIZE == 0, "alignment unit");
+
+static const char *TAG = "CAN_LOG";
+
+static can_log_config_t s_config;
+static char s_dir[24];
+static can_subscriber_t *s_subscription = NULL;
+static TaskHandle_t s_writer_task = NULL;
+static TaskHandle_t s_stop_waiter = NULL;
+static atomic_bool s_stop_requested;
+static atomic_bool s_drain_done;
+static atomic_bool s_running;
+static can_log_stats_t s_stats;     // Each field written by one task; frames_dropped is summed on read
+
+// Ping-pong blocks. A non-zero length hands the block to the writer until it is written.
+static uint8_t *s_blocks[2] = { NULL, NULL };
+static atomic_uint_least32_t s_block_len[2];
+static uint32_t s_block_frames[2];
+
+// Drain task state
+static uint32_t s_fill_block = 0;
+static uint32_t s_fill_len = 0;
+static uint32_t s_fill_frames = 0;
+static uint32_t s_fanout_dropped = 0;
+static uint32_t s_pending_lost = 0;
+static uint32_t s_drain_dropped = 0;    // Fan-out queue full
+static int64_t s_last_handover_us = 0;
+
+// Writer task state
+static sd_log_file_t s_file = { .fd = -1 };
+static can_log_header_t s_header;
+static uint8_t s_header_unit[CAN_LOG_ALIGN];
+static int64_t s_file_start_us = 0;
+static int64_t s_last_sync_us = 0;
+static bool s_unsynced = false;
+static uint64_t s_write_total_us = 0;
+static uint32_t s_write_dropped = 0;    // Blocks that could not be written
+
+static inline void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void put_padding(uint8_t *p, size_t len)
+{
+    memset(p, 0, len);
+    for (size_t pos = 0; pos + CAN_LOG_RECORD_SIZE <= len; pos += CAN_LOG_RECORD_SIZE) {
+        uint32_t id = CAN_LOG_ID_PAD;
+        memcpy(&p[pos + offsetof(can_frame_t, id)], &id, sizeof(id));
+    }
+}
+
+void can_log_default_config(can_log_config_t *config, const char *dir)
+{
+    config->dir = dir;
+    config->max_file_bytes = (uint32_t)CONFIG_CAN_LOG_FILE_MAX_MB * 1024 * 1024;
+    config->max_file_s = CONFIG_CAN_LOG_FILE_MAX_S;
+    config->sync_ms = CONFIG_CAN_LOG_SYNC_MS;
+#if CONFIG_CAN_LOG_ALL_IDS
+    config->all_ids = true;
+#else
+    config->all_ids = false;
+#endif
+}
+
+bool can_log_decode_record(const uint8_t *record, can_frame_t *frame, uint16_t *lost)
+{
+    memcpy(frame, record, offsetof(can_frame_t, data) + sizeof(frame->data));
+    if (lost) {
+        *lost = get_u16(&record[CAN_LOG_LOST_OFFSET]);
+    }
+    return frame->id != CAN_LOG_ID_PAD;
+}
+
+esp_err_t can_log_decode_header(const uint8_t *record, can_log_header_t *header)
+{
+    memcpy(header, record, sizeof(*header));
+    if (memcmp(header->magic, "CLOG", 4) != 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (header->version != CAN_LOG_VERSION || header->record_size != CAN_LOG_RECORD_SIZE) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return ESP_OK;
+}
+
+bool can_log_parse_name(const char *name, uint32_t *session, uint32_t *index)
+{
+    if (!name || strlen(name) != 12 || strcmp(&name[8], ".CAN") != 0) {
+        return false;
+    }
+    uint32_t value[2] = { 0, 0 };
+    for (int i = 0; i < 8; i++) {
+        if (name[i] < '0' || name[i] > '9') {
+            return false;
+        }
+        value[i / 4] = value[i / 4] * 10 + (uint32_t)(name[i] - '0');
+    }
+    if (session) {
+        *session = value[0];
+    }
+    if (index) {
+        *index = value[1];
+    }
+    return true;
+}
+
+// ---- Drain task: fan-out queue -> block ----
+
+static void hand_over(int64_t now_us)
+{
+    s_block_frames[s_fill_block] = s_fill_frames;
+    atomic_store_explicit(&s_block_len[s_fill_block], s_fill_len, memory_order_release);
+    s_fill_block ^= 1;
+    s_fill_len = 0;
+    s_fill_frames = 0;
+    s_last_handover_us = now_us;
+    xTaskNotifyGive(s_writer_task);
+}
+
+// Frames the fan-out could not queue because we fell behind. Called with the queue just
+// emptied: they were dropped after the frames taken so far, so the next record carries them.
+static void account_drops(void)
+{
+    can_fanout_stats_t fanout;
+    can_fanout_get_subscriber_stats(s_subscription, &fanout);
+    uint32_t dropped = fanout.dropped - s_fanout_dropped;
+    s_fanout_dropped = fanout.dropped;
+    s_drain_dropped += dropped;
+    s_pending_lost += dropped;
+}
+
+static void drain(bool final)
+{
+    int64_t now = esp_timer_get_time();
+
+    while (1) {
+        if (atomic_load_explicit(&s_block_len[s_fill_block], memory_order_acquire) != 0) {
+            // Both blocks wait for the writer: the frames stay in the fan-out queue
+            s_stats.buffer_waits++;
+            return;
+        }
+        uint8_t *block = s_blocks[s_fill_block];
+        size_t space = (CAN_LOG_BLOCK_SIZE - s_fill_len) / CAN_LOG_RECORD_SIZE;
+        size_t n = can_fanout_receive(s_subscription, (can_frame_t *)&block[s_fill_len], space);
+        for (size_t i = 0; i < n; i++) {
+            uint8_t *record = &block[s_fill_len + i * CAN_LOG_RECORD_SIZE];
+            put_u16(&record[CAN_LOG_LOST_OFFSET], s_pending_lost > 0xFFFF ? 0xFFFF : (uint16_t)s_pending_lost);
+            s_pending_lost = 0;
+        }
+        s_fill_len += n * CAN_LOG_RECORD_SIZE;
+        s_fill_frames += n;
+        s_stats.frames_logged += n;
+        if (n < space) {
+            account_drops();
+            break;
+        }
+        hand_over(now);
+    }
+
+    // Partial block on the sync period: padded to the next aligned size
+    if (s_fill_len > 0 && (final || now - s_last_handover_us >= (int64_t)s_config.sync_ms * 1000)) {
+        uint32_t aligned = (s_fill_len + CAN_LOG_ALIGN - 1) / CAN_LOG_ALIGN * CAN_LOG_ALIGN;
+        put_padding(&s_blocks[s_fill_block][s_fill_len], aligned - s_fill_len);
+        s_fill_len = aligned;
+        hand_over(now);
+    }
+}
+
+static void can_log_drain_task(void *arg)
+{
+    s_last_handover_us = esp_timer_get_time();
+    while (!atomic_load(&s_stop_requested)) {
+        vTaskDelay(pdMS_TO_TICKS(CAN_LOG_DRAIN_MS));
+        drain(false);
+    }
+    can_fanout_set_active(s_subscription, false);
+
+    // The writer may still hold the block we need: wait for it instead of dropping the tail
+    can_fanout_stats_t fanout;
+    drain(true);
+    can_fanout_get_subscriber_stats(s_subscription, &fanout);
+    while (s_fill_len > 0 || fanout.queued > 0) {
+        vTaskDelay(pdMS_TO_TICKS(CAN_LOG_DRAIN_MS));
+        drain(true);
+        can_fanout_get_subscriber_stats(s_subscription, &fanout);
+    }
+
+    atomic_store(&s_drain_done, true);
+    xTaskNotifyGive(s_writer_task);
+    vTaskDelete(NULL);
+}
+
+// ---- Writer task: block -> SD card ----
+
+// Highest session number among the files in the log directory
+static uint32_t last_session(void)
+{
+    uint32_t last = 0;
+    DIR *dir = opendir(s_dir);
+    if (!dir) {
+        return 0;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        uint32_t session;
+        if (can_log_parse_name(entry->d_name, &session, NULL) && session > last) {
+            last = session;
+        }
+    }
+    closedir(dir);
+    return last;
+}
+
+// Header unit with the current length: at offset 0 for an update, appended for a new file
+static esp_err_t write_header(bool append)
+{
+    s_header.data_bytes = append ? sizeof(s_header_unit) : s_file.written;
+    put_padding(s_header_unit, sizeof(s_header_unit));
+    memcpy(s_header_unit, &s_header, sizeof(s_header));
+    return append ? sd_log_file_write(&s_file, s_header_unit, sizeof(s_header_unit))
+                  : sd_log_file_rewrite(&s_file, 0, s_header_unit, sizeof(s_header_unit));
+}
+
+static void sync_file(void)
+{
+    int64_t start = esp_timer_get_time();
+    write_header(false);
+    sd_log_file_sync(&s_file);
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+    if (us > s_stats.sync_max_us) {
+        s_stats.sync_max_us = us;
+    }
+    s_unsynced = false;
+    s_last_sync_us = esp_timer_get_time();
+}
+
+static void close_file(void)
+{
+    if (s_file.fd < 0) {
+        return;
+    }
+    if (s_unsynced) {
+        sync_file();
+    }
+    sd_log_file_close(&s_file);
+    s_stats.file[0] = '\0';
+}
+
+static bool open_file(int64_t now_us)
+{
+    snprintf(s_stats.file, sizeof(s_stats.file), "%s/%04u%04u.CAN", s_dir,
+             (unsigned)(s_stats.session % 10000), (unsigned)(s_stats.files % 10000));
+    int64_t start = esp_timer_get_time();
+    if (sd_log_file_create(&s_file, s_stats.file, s_config.max_file_bytes / CAN_LOG_ALIGN * CAN_LOG_ALIGN) != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot create %s", s_stats.file);
+        s_stats.file[0] = '\0';
+        return false;
+    }
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+    if (us > s_stats.create_max_us) {
+        s_stats.create_max_us = us;
+    }
+    if (!s_file.preallocated) {
+        s_stats.files_fragmented++;
+    }
+
+    s_header = (can_log_header_t) {
+        .magic = { 'C', 'L', 'O', 'G' },
+        .version = CAN_LOG_VERSION,
+        .record_size = CAN_LOG_RECORD_SIZE,
+        .session = (uint16_t)s_stats.session,
+        .file_index = (uint16_t)s_stats.files,
+        .start_us = now_us,
+    };
+    if (write_header(true) != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot write the header of %s", s_stats.file);
+        close_file();
+        return false;
+    }
+
+    s_stats.files++;
+    s_file_start_us = now_us;
+    s_unsynced = true;
+    ESP_LOGI(TAG, "Logging to %s", s_stats.file);
+    return true;
+}
+
+static void write_block(const uint8_t *block, uint32_t len, uint32_t frames)
+{
+    int64_t now = esp_timer_get_time();
+    if (s_file.fd >= 0 && (len > s_file.size - s_file.written ||
+                           (s_config.max_file_s && now - s_file_start_us >= (int64_t)s_config.max_file_s * 1000000))) {
+        close_file();
+    }
+    if (s_file.fd < 0 && !open_file(now)) {
+        s_stats.write_errors++;
+        s_write_dropped += frames;
+        return;
+    }
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = sd_log_file_write(&s_file, block, len);
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+    if (ret != ESP_OK) {
+        // Retry with a new file on the next block
+        ESP_LOGE(TAG, "Write to %s failed, %lu frames lost", s_stats.file, (unsigned long)frames);
+        s_stats.write_errors++;
+        s_write_dropped += frames;
+        close_file();
+        return;
+    }
+
+    s_unsynced = true;
+    s_stats.blocks_written++;
+    s_stats.bytes_written += len;
+    s_write_total_us += us;
+    s_stats.write_avg_us = (uint32_t)(s_write_total_us / s_stats.blocks_written);
+    if (us > s_stats.write_max_us) {
+        s_stats.write_max_us = us;
+    }
+}
+
+static void can_log_writer_task(void *arg)
+{
+    uint32_t next = 0;
+    s_last_sync_us = esp_timer_get_time();
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(s_config.sync_ms));
+        bool drain_done = atomic_load(&s_drain_done);
+
+        uint32_t len;
+        while ((len = atomic_load_explicit(&s_block_len[next], memory_order_acquire)) != 0) {
+            write_block(s_blocks[next], len, s_block_frames[next]);
+            atomic_store_explicit(&s_block_len[next], 0, memory_order_release);
+            next ^= 1;
+        }
+        if (s_file.fd >= 0 && s_unsynced && esp_timer_get_time() - s_last_sync_us >= (int64_t)s_config.sync_ms * 1000) {
+            sync_file();
+        }
+        if (drain_done) {
+            break;
+        }
+    }
+
+    close_file();
+    ESP_LOGI(TAG, "Stopped: %lu frames logged, %lu dropped, %lu files",
+             (unsigned long)s_stats.frames_logged, (unsigned long)(s_drain_dropped + s_write_dropped),
+             (unsigned long)s_stats.files);
+    s_writer_task = NULL;
+    atomic_store(&s_running, false);
+    if (s_stop_waiter) {
+        xTaskNotifyGive(s_stop_waiter);
+    }
+    vTaskDelete(NULL);
+}
+
+// ---- Control ----
+
+esp_err_t can_log_start(const can_log_config_t *config)
+{
+    if (!config || !config->dir || strlen(config->dir) >= sizeof(s_dir) || config->sync_ms == 0 ||
+        config->max_file_bytes < 2 * CAN_LOG_BLOCK_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (atomic_load(&s_running)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_config = *config;
+    strcpy(s_dir, config->dir);
+    s_config.dir = s_dir;
+    struct stat st;
+    if (stat(s_dir, &st) != 0 && mkdir(s_dir, 0777) != 0) {
+        ESP_LOGE(TAG, "Cannot create %s", s_dir);
+        return ESP_FAIL;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (!s_blocks[i]) {
+            s_blocks[i] = heap_caps_malloc(CAN_LOG_BLOCK_SIZE, MALLOC_CAP_SPIRAM);
+        }
+        if (!s_blocks[i]) {
+            ESP_LOGE(TAG, "No PSRAM for the %d KB log blocks", 2 * CAN_LOG_BLOCK_SIZE / 1024);
+            return ESP_ERR_NO_MEM;
+        }
+        atomic_store(&s_block_len[i], 0);
+    }
+    if (!s_subscription) {
+        esp_err_t ret = can_fanout_subscribe("logger", CONFIG_CAN_LOG_QUEUE_SIZE, &s_subscription);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.session = last_session() % 9999 + 1;
+    s_write_total_us = 0;
+    s_drain_dropped = s_write_dropped = 0;
+    s_fill_block = s_fill_len = s_fill_frames = 0;
+    s_pending_lost = 0;
+    atomic_store(&s_stop_requested, false);
+    atomic_store(&s_drain_done, false);
+    s_stop_waiter = NULL;
+
+    // Only frames from now on
+    can_fanout_set_all_ids(s_subscription, config->all_ids);
+    can_fanout_flush(s_subscription);
+    can_fanout_stats_t fanout;
+    can_fanout_get_subscriber_stats(s_subscription, &fanout);
+    s_fanout_dropped = fanout.dropped;
+    can_fanout_set_active(s_subscription, true);
+
+    atomic_store(&s_running, true);
+    if (xTaskCreatePinnedToCore(can_log_writer_task, "can_log_wr", 4096, NULL, TASK_CAN_LOG_WRITER_PRIORITY,
+                                &s_writer_task, TASK_CORE_BACKGROUND) != pdPASS) {
+        atomic_store(&s_running, false);
+        can_fanout_set_active(s_subscription, false);
+        ESP_LOGE(TAG, "Cannot create the writer task");
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreatePinnedToCore(can_log_drain_task, "can_log", 3072, NULL, TASK_CAN_LOG_DRAIN_PRIORITY,
+                                NULL, TASK_CORE_INGEST) != pdPASS) {
+        // The writer exits once the drain is done
+        can_fanout_set_active(s_subscription, false);
+        atomic_store(&s_drain_done, true);
+        xTaskNotifyGive(s_writer_task);
+        ESP_LOGE(TAG, "Cannot create the drain task");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Session %lu: %lu MB / %lu s per file, sync every %lu ms",
+             (unsigned long)s_stats.session, (unsigned long)(s_config.max_file_bytes >> 20),
+             (unsigned long)s_config.max_file_s, (unsigned long)s_config.sync_ms);
+    return ESP_OK;
+}
+
+esp_err_t can_log_stop(void)
+{
+    if (!atomic_load(&s_running)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_stop_waiter = xTaskGetCurrentTaskHandle();
+    atomic_store(&s_stop_requested, true);
+    while (atomic_load(&s_running)) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    }
+    return ESP_OK;
+}
+
+void can_log_get_stats(can_log_stats_t *stats)
+{
+    if (stats) {
+        *stats = s_stats;
+        stats->frames_dropped = s_drain_dropped + s_write_dropped;
+        stats->running = atomic_load(&s_running);
+    }
+}
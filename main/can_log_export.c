@@ -0,0 +1,305 @@
+/*
+ * Trace file export: raw byte ranges or CSV converted record by record, see
+ * include/can_log_export.h. Kept free of HTTP server dependencies so it also builds
+ * on the host.
+ */
+
+#include "include/can_log_export.h"
+#include "include/can_decoder.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define SECTOR_SIZE     512
+
+static const char *TAG = "CAN_LOG_EXPORT";
+
+static const char s_csv_columns[] = "timestamp_us,id,dlc,flags,lost,d0,d1,d2,d3,d4,d5,d6,d7\n";
+
+// Valid length of an open trace file, header in *header if it has one
+static uint32_t valid_length(int fd, can_log_header_t *header, bool *has_header)
+{
+    struct stat st;
+    uint32_t size = fstat(fd, &st) == 0 ? (uint32_t)st.st_size : 0;
+    uint8_t record[CAN_LOG_RECORD_SIZE];
+
+    *has_header = pread(fd, record, sizeof(record), 0) == (ssize_t)sizeof(record) &&
+                  can_log_decode_header(record, header) == ESP_OK;
+    // The file being written, or one cut short by a power loss: only what was synced
+    if (*has_header && header->data_bytes < size) {
+        return header->data_bytes;
+    }
+    return size;
+}
+
+esp_err_t can_log_export_open(can_log_export_t *exp, const char *path, can_log_export_format_t format)
+{
+    if (!exp || !path) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(exp, 0, sizeof(*exp));
+    exp->fd = open(path, O_RDONLY);
+    if (exp->fd < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    can_log_header_t header;
+    bool has_header;
+    exp->format = format;
+    exp->length = valid_length(exp->fd, &header, &has_header);
+    exp->end = exp->length;
+    if (format == CAN_LOG_EXPORT_CSV) {
+        if (!has_header) {
+            can_log_export_close(exp);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        exp->pos = CAN_LOG_ALIGN;   // Past the header unit
+    }
+    return ESP_OK;
+}
+
+esp_err_t can_log_export_set_range(can_log_export_t *exp, uint32_t start, uint32_t end)
+{
+    if (!exp || exp->fd < 0 || exp->format != CAN_LOG_EXPORT_RAW || start > end || end >= exp->length) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    exp->pos = start;
+    exp->end = end + 1;
+    return ESP_OK;
+}
+
+static esp_err_t read_raw(can_log_export_t *exp, char *buf, size_t size, size_t *len)
+{
+    size_t n = exp->end - exp->pos < size ? exp->end - exp->pos : size;
+    // End reads on a sector boundary, so after an unaligned range start the card reads whole sectors
+    uint32_t over = (exp->pos + n) % SECTOR_SIZE;
+    if (n == size && n > over) {
+        n -= over;
+    }
+    if (n > 0 && pread(exp->fd, buf, n, exp->pos) != (ssize_t)n) {
+        return ESP_FAIL;
+    }
+    exp->pos += n;
+    *len = n;
+    return ESP_OK;
+}
+
+static char *put_dec(char *p, uint64_t value)
+{
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (n) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+static char *put_hex(char *p, uint32_t value, int digits)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4) {
+        *p++ = hex[(value >> shift) & 0x0F];
+    }
+    return p;
+}
+
+// One CSV row, at most CAN_LOG_EXPORT_CSV_ROW_MAX bytes
+static size_t format_row(const can_frame_t *frame, uint16_t lost, char *buf)
+{
+    char *p = buf;
+    uint8_t dlc = frame->dlc > 8 ? 8 : frame->dlc;
+    bool ext = (frame->id & CAN_DECODER_ID_EXT_FLAG) != 0;
+
+    p = put_dec(p, frame->timestamp_us > 0 ? (uint64_t)frame->timestamp_us : 0);
+    *p++ = ',';
+    p = put_hex(p, frame->id & ~CAN_DECODER_ID_EXT_FLAG, ext ? 8 : 3);
+    *p++ = ',';
+    p = put_dec(p, dlc);
+    *p++ = ',';
+    p = put_dec(p, frame->flags);
+    *p++ = ',';
+    p = put_dec(p, lost);
+    for (int i = 0; i < 8; i++) {
+        *p++ = ',';
+        if (i < dlc) {
+            p = put_hex(p, frame->data[i], 2);
+        }
+    }
+    *p++ = '\n';
+    return (size_t)(p - buf);
+}
+
+static esp_err_t read_csv(can_log_export_t *exp, char *buf, size_t size, size_t *len)
+{
+    size_t used = 0;
+    if (!exp->csv_columns_sent) {
+        if (size < sizeof(s_csv_columns)) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        memcpy(buf, s_csv_columns, sizeof(s_csv_columns) - 1);
+        used = sizeof(s_csv_columns) - 1;
+        exp->csv_columns_sent = true;
+    }
+
+    while (size - used >= CAN_LOG_EXPORT_CSV_ROW_MAX) {
+        if (exp->record_next == exp->record_count) {
+            if (exp->pos >= exp->end) {
+                break;
+            }
+            // One alignment unit at a time: the valid length is a multiple of it
+            size_t n = exp->end - exp->pos < sizeof(exp->records) ? exp->end - exp->pos : sizeof(exp->records);
+            if (pread(exp->fd, exp->records, n, exp->pos) != (ssize_t)n) {
+                return ESP_FAIL;
+            }
+            exp->pos += n;
+            exp->record_count = (uint16_t)(n / CAN_LOG_RECORD_SIZE);
+            exp->record_next = 0;
+            continue;
+        }
+        can_frame_t frame;
+        uint16_t lost;
+        if (can_log_decode_record(&exp->records[exp->record_next++ * CAN_LOG_RECORD_SIZE], &frame, &lost)) {
+            used += format_row(&frame, lost, &buf[used]);
+        }
+    }
+    if (used == 0 && size < CAN_LOG_EXPORT_CSV_ROW_MAX && exp->pos < exp->end) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *len = used;
+    return ESP_OK;
+}
+
+esp_err_t can_log_export_read(can_log_export_t *exp, char *buf, size_t size, size_t *len)
+{
+    if (!exp || exp->fd < 0 || !buf || !len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *len = 0;
+    return exp->format == CAN_LOG_EXPORT_CSV ? read_csv(exp, buf, size, len) : read_raw(exp, buf, size, len);
+}
+
+void can_log_export_close(can_log_export_t *exp)
+{
+    if (exp && exp->fd >= 0) {
+        close(exp->fd);
+        exp->fd = -1;
+    }
+}
+
+static bool parse_u32(const char **p, uint32_t *value)
+{
+    const char *s = *p;
+    uint64_t v = 0;
+    while (*s >= '0' && *s <= '9') {
+        v = v * 10 + (uint64_t)(*s++ - '0');
+        if (v > UINT32_MAX) {
+            return false;
+        }
+    }
+    if (s == *p) {
+        return false;
+    }
+    *p = s;
+    *value = (uint32_t)v;
+    return true;
+}
+
+esp_err_t can_log_export_parse_range(const char *value, uint32_t length, uint32_t *start, uint32_t *end)
+{
+    if (!value || !start || !end) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strncmp(value, "bytes=", 6) != 0 || strchr(value, ',')) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    const char *p = value + 6;
+    uint32_t first = 0, last = length ? length - 1 : 0;
+
+    if (*p == '-') {
+        // Suffix: the last n bytes
+        p++;
+        uint32_t n;
+        if (!parse_u32(&p, &n) || *p) {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        if (n == 0 || length == 0) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        first = n < length ? length - n : 0;
+    } else {
+        if (!parse_u32(&p, &first) || *p++ != '-') {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        if (*p) {
+            uint32_t requested;
+            if (!parse_u32(&p, &requested) || *p || requested < first) {
+                return ESP_ERR_NOT_SUPPORTED;
+            }
+            if (requested < last) {
+                last = requested;
+            }
+        }
+        if (first >= length) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+    *start = first;
+    *end = last;
+    return ESP_OK;
+}
+
+static int compare_files(const void *a, const void *b)
+{
+    return strcmp(((const can_log_file_info_t *)a)->name, ((const can_log_file_info_t *)b)->name);
+}
+
+size_t can_log_list_files(const char *dir, can_log_file_info_t *files, size_t max)
+{
+    DIR *d = dir ? opendir(dir) : NULL;
+    if (!d || !files) {
+        if (d) {
+            closedir(d);
+        }
+        return 0;
+    }
+
+    size_t count = 0;
+    struct dirent *entry;
+    char path[64];
+    while (count < max && (entry = readdir(d)) != NULL) {
+        uint32_t session, index;
+        if (!can_log_parse_name(entry->d_name, &session, &index) ||
+            snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name) >= (int)sizeof(path)) {
+            continue;
+        }
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            continue;
+        }
+        can_log_file_info_t *file = &files[count++];
+        can_log_header_t header;
+        bool has_header;
+        memcpy(file->name, entry->d_name, sizeof(file->name));
+        file->session = (uint16_t)session;
+        file->index = (uint16_t)index;
+        file->bytes = valid_length(fd, &header, &has_header);
+        file->start_us = has_header ? header.start_us : 0;
+        close(fd);
+    }
+    closedir(d);
+    if (count == max) {
+        ESP_LOGW(TAG, "Listing only the first %u trace files in %s", (unsigned)max, dir);
+    }
+
+    qsort(files, count, sizeof(files[0]), compare_files);
+    return count;
+}
@@ -1,6 +1,8 @@
 #include "include/can_parser.h"
+#include "include/can_decoder.h"
 #include "include/ecu_data.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include <string.h>
 
 static const char *TAG = "CAN_PARSER";
@@ -8,14 +10,58 @@ static const char *TAG = "CAN_PARSER";
 // Default max torque in Nm. Can be updated by can_parser_set_max_torque().
 static float g_max_torque_nm = 500.0f;
 
-// Helper function to extract a 16-bit unsigned integer from a byte array.
-static inline uint16_t get_u16(const uint8_t* data, int offset) {
-    return (uint16_t)(data[offset] << 8) | data[offset + 1];
+// VW powertrain signals, sorted by CAN ID.
+// Adding a signal only needs a new row here; see can_signal_def_t for the fields.
+static const can_signal_def_t s_vw_signals[] = {
+    //  ID     start len  byte order                flags                    target field            scale        offset
+    // RPM, TPS, Pedal Pos, Target Torque
+    // TODO: Resolve data conflict for Engine Actual Torque (eng_act_nm).
+    // The user specification maps eng_act_nm to byte 3, but this byte is already
+    // used as the low byte for the 16-bit engine_rpm value, so it is not decoded.
+    { 0x280, 23, 16, CAN_BYTE_ORDER_MOTOROLA, 0,                       ECU_SIG_ENGINE_RPM,     0.25f,       0.0f },
+    { 0x280, 32,  8, CAN_BYTE_ORDER_INTEL,    0,                       ECU_SIG_ABS_PEDAL_POS,  0.4f,        0.0f },
+    { 0x280, 40,  8, CAN_BYTE_ORDER_INTEL,    CAN_SIG_FLAG_TORQUE_PCT, ECU_SIG_ENG_TRG_NM,     0.3937f,     0.0f },
+    { 0x280, 56,  8, CAN_BYTE_ORDER_INTEL,    0,                       ECU_SIG_TPS_POSITION,   0.3937f,     0.0f },
+
+    // Torque Limit
+    { 0x288, 40,  8, CAN_BYTE_ORDER_INTEL,    CAN_SIG_FLAG_TORQUE_PCT, ECU_SIG_LIMIT_TQ_NM,    0.4f,        0.0f },
+
+    // Wastegate
+    { 0x390,  8,  8, CAN_BYTE_ORDER_INTEL,    0,                       ECU_SIG_WG_SET_PERCENT, 0.5f,        0.0f },
+    { 0x390, 16,  8, CAN_BYTE_ORDER_INTEL,    0,                       ECU_SIG_WG_POS_PERCENT, 0.5f,        0.0f },
+
+    // Blow-Off Valve: raw / 255 * 50 %
+    { 0x394,  0,  8, CAN_BYTE_ORDER_INTEL,    0,                       ECU_SIG_BOV_PERCENT,    50.0f / 255.0f, 0.0f },
+
+    // TCU Torque
+    { 0x488,  8,  8, CAN_BYTE_ORDER_INTEL,    CAN_SIG_FLAG_TORQUE_PCT, ECU_SIG_TCU_TQ_REQ_NM,  0.39f,       0.0f },
+    { 0x488, 16,  8, CAN_BYTE_ORDER_INTEL,    CAN_SIG_FLAG_TORQUE_PCT, ECU_SIG_TCU_TQ_ACT_NM,  0.39f,       0.0f },
+
+    // MAP: raw * 0.01 = kPa
+    { 0x580, 23, 16, CAN_BYTE_ORDER_MOTOROLA, 0,                       ECU_SIG_MAP_KPA,        0.01f,       0.0f },
+};
+
+// Compiled lookup table for the built-in signals
+static can_decoder_table_t s_vw_table;
+
+esp_err_t can_parser_init(void)
+{
+    esp_err_t ret = can_decoder_table_build(&s_vw_table, s_vw_signals,
+                                            sizeof(s_vw_signals) / sizeof(s_vw_signals[0]));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to build built-in signal table: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    can_decoder_set_max_torque(g_max_torque_nm);
+    can_decoder_set_active(&s_vw_table);
+    return ESP_OK;
 }
 
 void can_parser_set_max_torque(float max_torque) {
     if (max_torque > 0) {
         g_max_torque_nm = max_torque;
+        can_decoder_set_max_torque(g_max_torque_nm);
         ESP_LOGI(TAG, "Maximum torque for calculations set to %.1f Nm", g_max_torque_nm);
     }
 }
@@ -25,65 +71,32 @@ void parse_can_message(const twai_message_t* message) {
         return;
     }
 
-    // Get a pointer to the global ECU data struct.
-    // The canbus_task is responsible for locking the mutex before calling this.
-    ecu_data_t* ecu_data = ecu_data_get();
-    if (!ecu_data) {
+    uint32_t id = message->identifier;
+    if (message->extd) {
+        id |= CAN_DECODER_ID_EXT_FLAG;
+    }
+
+    // Decode straight into the published ECU data. Readers get consistent copies
+    // through the seqlock. O(1) lookup of the frame's signals in the active table;
+    // frames nothing is decoded from leave the sequence alone.
+    if (!can_decoder_has_id(id)) {
         return;
     }
+    ecu_data_t* ecu_data = ecu_data_write_begin();
+    uint32_t updated = can_decoder_decode(id, message->data, message->data_length_code, ecu_data);
+    ecu_data_mark_updated(updated, esp_timer_get_time());
+    ecu_data_write_end();
+}
 
-    float raw_value_percent = 0.0f;
-
-    switch (message->identifier) {
-        case 0x280: // RPM, TPS, Pedal Pos, Target Torque, Actual Torque
-            ecu_data->engine_rpm = ((message->data[2] << 8) | message->data[3]) * 0.25f;
-            ecu_data->tps_position = message->data[7] * 0.3937f;
-            ecu_data->abs_pedal_pos = message->data[4] * 0.4f;
-
-            // Torque values are first calculated as %, then converted to Nm
-            raw_value_percent = message->data[5] * 0.3937f;
-            ecu_data->eng_trg_nm = (raw_value_percent / 100.0f) * g_max_torque_nm;
-
-            // TODO: Resolve data conflict for Engine Actual Torque (eng_act_nm).
-            // The user specification maps eng_act_nm to byte 3, but this byte is already
-            // used as the low byte for the 16-bit engine_rpm value.
-            // Disabling eng_act_nm parsing for now to prioritize engine_rpm.
-            // raw_value_percent = message->data[3] * 0.3937f;
-            // ecu_data->eng_act_nm = (raw_value_percent / 100.0f) * g_max_torque_nm;
-            break;
-
-        case 0x580: // MAP
-            // Formula: raw * 0.01 = kPa
-            ecu_data->map_kpa = ((message->data[2] << 8) | message->data[3]) * 0.01f;
-            break;
-
-        case 0x390: // Wastegate
-            ecu_data->wg_set_percent = message->data[1] / 2.0f;
-            ecu_data->wg_pos_percent = message->data[2] / 2.0f;
-            break;
-
-        case 0x394: // Blow-Off Valve
-            ecu_data->bov_percent = (message->data[0] / 255.0f) * 50.0f;
-            break;
-
-        case 0x488: // TCU Torque
-            raw_value_percent = message->data[1] * 0.39f;
-            ecu_data->tcu_tq_req_nm = (raw_value_percent / 100.0f) * g_max_torque_nm;
-
-            raw_value_percent = message->data[2] * 0.39f;
-            ecu_data->tcu_tq_act_nm = (raw_value_percent / 100.0f) * g_max_torque_nm;
-            break;
-
-        case 0x288: // Torque Limit
-            raw_value_percent = message->data[5] * 0.4f;
-            ecu_data->limit_tq_nm = (raw_value_percent / 100.0f) * g_max_torque_nm;
-            break;
-
-        default:
-            // Unhandled CAN ID
-            break;
+uint32_t parse_can_frame(const can_frame_t* frame) {
+    if (!frame || (frame->flags & CAN_FRAME_FLAG_RTR) || !can_decoder_has_id(frame->id)) {
+        return 0;
     }
 
-    // After parsing and updating the local copy, update the global structure.
-    // The calling function (canbus_task) is responsible for calling ecu_data_update.
+    // Freshness uses the time the frame left the driver, not the decode time
+    ecu_data_t* ecu_data = ecu_data_write_begin();
+    uint32_t updated = can_decoder_decode(frame->id, frame->data, frame->dlc, ecu_data);
+    ecu_data_mark_updated(updated, frame->timestamp_us);
+    ecu_data_write_end();
+    return updated;
 }
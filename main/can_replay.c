@@ -0,0 +1,430 @@
+/*
+ * CAN trace replay: binary, candump and ASC traces paced as recorded, see include/can_replay.h
+ * Kept free of driver dependencies so it also builds on the host.
+ */
+
+#include "include/can_replay.h"
+#include "include/can_log.h"
+#include "include/can_decoder.h"
+#include "esp_log.h"
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "CAN_REPLAY";
+
+#define DETECT_LINES    50      // Text lines looked at to tell candump from ASC
+
+// ============================================================================
+// Text parsing
+// ============================================================================
+
+static const char *skip_spaces(const char *p)
+{
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    return p;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Unsigned number in base 16 or 10, at most max_digits digits; returns the end or NULL
+static const char *parse_number(const char *p, int base, int max_digits, uint32_t *value)
+{
+    uint32_t v = 0;
+    int digits = 0;
+    for (int d; (d = hex_value(*p)) >= 0 && d < base; p++) {
+        if (++digits > max_digits) {
+            return NULL;
+        }
+        v = v * (uint32_t)base + (uint32_t)d;
+    }
+    *value = v;
+    return digits ? p : NULL;
+}
+
+// Seconds with an optional fraction ("12.345678") in microseconds; returns the end or NULL
+static const char *parse_seconds(const char *p, int64_t *us)
+{
+    uint32_t seconds;
+    const char *end = parse_number(p, 10, 10, &seconds);
+    if (!end) {
+        return NULL;
+    }
+    int64_t value = (int64_t)seconds * 1000000;
+    if (*end == '.') {
+        int64_t scale = 100000;
+        for (end++; *end >= '0' && *end <= '9'; end++) {
+            value += (*end - '0') * scale;
+            scale /= 10;
+        }
+    }
+    *us = value;
+    return end;
+}
+
+// "(1436509052.249713) can0 280#0011223344556677", "123#R", 8 hex digit IDs are 29-bit
+bool can_replay_parse_candump(const char *line, can_frame_t *frame, int64_t *trace_us)
+{
+    const char *p = skip_spaces(line);
+    if (*p++ != '(' || !(p = parse_seconds(p, trace_us)) || *p++ != ')') {
+        return false;
+    }
+    p = skip_spaces(p);
+    while (*p && *p != ' ' && *p != '\t') {     // Interface name
+        p++;
+    }
+    p = skip_spaces(p);
+
+    memset(frame, 0, sizeof(*frame));
+    const char *id_start = p;
+    uint32_t id;
+    if (!(p = parse_number(p, 16, 8, &id)) || *p++ != '#') {
+        return false;
+    }
+    if (p - id_start - 1 == 8) {
+        if (id > 0x1FFFFFFF) {
+            return false;   // Error frame (CAN_ERR_FLAG)
+        }
+        id |= CAN_DECODER_ID_EXT_FLAG;
+    } else if (p - id_start - 1 != 3) {
+        return false;
+    }
+    frame->id = id;
+
+    if (*p == '#') {
+        return false;       // CAN FD
+    }
+    if (*p == 'R' || *p == 'r') {
+        frame->flags = CAN_FRAME_FLAG_RTR;
+        int dlc = hex_value(p[1]);
+        frame->dlc = dlc >= 0 && dlc <= 8 ? (uint8_t)dlc : 0;
+        return true;
+    }
+    while (frame->dlc < 8) {
+        int high = hex_value(p[0]);
+        int low = high >= 0 ? hex_value(p[1]) : -1;
+        if (low < 0) {
+            break;
+        }
+        frame->data[frame->dlc++] = (uint8_t)(high << 4 | low);
+        p += 2;
+        if (*p == '.') {
+            p++;            // Optional byte separator
+        }
+    }
+    return hex_value(*p) < 0;
+}
+
+// "   0.015234 1  280             Rx   d 8 01 02 03 04 05 06 07 08  Length = ..." with
+// 29-bit IDs written as "18FEF1E5x", remote frames as "r"
+bool can_replay_parse_asc(const char *line, bool hex, can_frame_t *frame, int64_t *trace_us)
+{
+    int base = hex ? 16 : 10;
+    uint32_t channel, id;
+    const char *p = parse_seconds(skip_spaces(line), trace_us);
+    if (!p || (*p != ' ' && *p != '\t')) {
+        return false;
+    }
+    p = parse_number(skip_spaces(p), 10, 3, &channel);     // CANFD lines and events have no channel here
+    if (!p || (*p != ' ' && *p != '\t')) {
+        return false;
+    }
+    p = parse_number(skip_spaces(p), base, hex ? 8 : 9, &id);
+    if (!p) {
+        return false;
+    }
+    memset(frame, 0, sizeof(*frame));
+    if (*p == 'x' || *p == 'X') {
+        if (id > 0x1FFFFFFF) {
+            return false;
+        }
+        frame->id = id | CAN_DECODER_ID_EXT_FLAG;
+        p++;
+    } else if (id <= 0x7FF) {
+        frame->id = id;
+    } else {
+        return false;
+    }
+    p = skip_spaces(p);
+    if (strncasecmp(p, "Rx", 2) != 0 && strncasecmp(p, "Tx", 2) != 0) {
+        return false;
+    }
+    p = skip_spaces(p + 2);
+    char type = *p++;
+    uint32_t dlc;
+    if ((type != 'd' && type != 'r') || !(p = parse_number(skip_spaces(p), 16, 1, &dlc)) || dlc > 8) {
+        return false;
+    }
+    frame->dlc = (uint8_t)dlc;
+    if (type == 'r') {
+        frame->flags = CAN_FRAME_FLAG_RTR;
+        return true;
+    }
+    for (uint32_t i = 0; i < dlc; i++) {
+        uint32_t byte;
+        if (!(p = parse_number(skip_spaces(p), base, hex ? 2 : 3, &byte)) || byte > 0xFF) {
+            return false;
+        }
+        frame->data[i] = (uint8_t)byte;
+    }
+    return true;
+}
+
+// ASC header lines: "base hex  timestamps absolute"
+static void parse_asc_header(can_replay_t *replay, const char *line)
+{
+    const char *p = skip_spaces(line);
+    if (strncasecmp(p, "base ", 5) == 0) {
+        replay->asc_hex = strncasecmp(skip_spaces(p + 5), "dec", 3) != 0;
+        replay->asc_relative = strstr(p, "relative") != NULL;
+    }
+}
+
+// ============================================================================
+// File reading
+// ============================================================================
+
+// Next line, false at the end of the file. Longer lines are cut to an empty line.
+static bool read_line(can_replay_t *replay)
+{
+    if (!fgets(replay->line, sizeof(replay->line), replay->file)) {
+        return false;
+    }
+    size_t len = strlen(replay->line);
+    if (len == sizeof(replay->line) - 1 && replay->line[len - 1] != '\n') {
+        int c;
+        while ((c = fgetc(replay->file)) != EOF && c != '\n') {
+        }
+        replay->line[0] = '\0';
+        replay->stats.skipped++;
+    }
+    return true;
+}
+
+static can_replay_format_t detect_text_format(can_replay_t *replay)
+{
+    can_frame_t frame;
+    int64_t trace_us;
+    for (int i = 0; i < DETECT_LINES && read_line(replay); i++) {
+        const char *p = skip_spaces(replay->line);
+        if (*p == '(' && can_replay_parse_candump(p, &frame, &trace_us)) {
+            return CAN_REPLAY_FORMAT_CANDUMP;
+        }
+        if (strncasecmp(p, "date ", 5) == 0 || strncasecmp(p, "base ", 5) == 0 ||
+            strncasecmp(p, "begin triggerblock", 18) == 0 || can_replay_parse_asc(p, true, &frame, &trace_us)) {
+            return CAN_REPLAY_FORMAT_ASC;
+        }
+    }
+    return CAN_REPLAY_FORMAT_AUTO;
+}
+
+// Back to the first frame of the file
+static esp_err_t rewind_trace(can_replay_t *replay)
+{
+    replay->asc_hex = true;
+    replay->asc_relative = false;
+    replay->trace_last_us = 0;
+    if (replay->config.format == CAN_REPLAY_FORMAT_BINARY) {
+        replay->binary_pos = CAN_LOG_ALIGN;     // Past the header unit
+        return fseek(replay->file, CAN_LOG_ALIGN, SEEK_SET) == 0 ? ESP_OK : ESP_FAIL;
+    }
+    return fseek(replay->file, 0, SEEK_SET) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+// Next frame of the file: ESP_OK, ESP_ERR_NOT_FOUND at its end, ESP_FAIL on a read error
+static esp_err_t read_frame(can_replay_t *replay, can_frame_t *frame, int64_t *trace_us)
+{
+    if (replay->config.format == CAN_REPLAY_FORMAT_BINARY) {
+        uint8_t record[CAN_LOG_RECORD_SIZE];
+        while (replay->binary_pos + CAN_LOG_RECORD_SIZE <= replay->binary_end) {
+            if (fread(record, 1, sizeof(record), replay->file) != sizeof(record)) {
+                return ferror(replay->file) ? ESP_FAIL : ESP_ERR_NOT_FOUND;
+            }
+            replay->binary_pos += CAN_LOG_RECORD_SIZE;
+            uint16_t lost;
+            if (can_log_decode_record(record, frame, &lost)) {
+                replay->stats.recorder_lost += lost;
+                *trace_us = frame->timestamp_us;
+                return ESP_OK;
+            }
+        }
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    while (read_line(replay)) {
+        const char *p = skip_spaces(replay->line);
+        if (*p == '\0' || *p == '\n' || *p == '\r') {
+            continue;
+        }
+        if (replay->config.format == CAN_REPLAY_FORMAT_CANDUMP) {
+            if (can_replay_parse_candump(p, frame, trace_us)) {
+                return ESP_OK;
+            }
+        } else {
+            if (can_replay_parse_asc(p, replay->asc_hex, frame, trace_us)) {
+                if (replay->asc_relative) {
+                    *trace_us += replay->trace_last_us;
+                }
+                replay->trace_last_us = *trace_us;
+                return ESP_OK;
+            }
+            if (!isdigit((unsigned char)*p)) {
+                parse_asc_header(replay, p);    // Header and trigger block lines
+                continue;
+            }
+        }
+        replay->stats.skipped++;
+    }
+    return ferror(replay->file) ? ESP_FAIL : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t can_replay_open(can_replay_t *replay, const char *path, const can_replay_config_t *config)
+{
+    if (!replay || !path || !config || config->speed < 0.0f) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(replay, 0, sizeof(*replay));
+    replay->config = *config;
+    replay->file = fopen(path, "rb");
+    if (!replay->file) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Binary traces start with the logger header, anything else is read as text
+    uint8_t record[CAN_LOG_RECORD_SIZE];
+    can_log_header_t header;
+    bool binary = fread(record, 1, sizeof(record), replay->file) == sizeof(record) &&
+                  can_log_decode_header(record, &header) == ESP_OK;
+    if (replay->config.format == CAN_REPLAY_FORMAT_AUTO) {
+        if (binary) {
+            replay->config.format = CAN_REPLAY_FORMAT_BINARY;
+        } else {
+            fseek(replay->file, 0, SEEK_SET);
+            replay->config.format = detect_text_format(replay);
+        }
+    }
+    if (replay->config.format == CAN_REPLAY_FORMAT_AUTO ||
+        (replay->config.format == CAN_REPLAY_FORMAT_BINARY && !binary)) {
+        can_replay_close(replay);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    if (replay->config.format == CAN_REPLAY_FORMAT_BINARY) {
+        // Only what the logger synced: after a power loss the rest is stale card content
+        fseek(replay->file, 0, SEEK_END);
+        long size = ftell(replay->file);
+        replay->binary_end = header.data_bytes && header.data_bytes < (uint32_t)size ? header.data_bytes : (uint32_t)size;
+    }
+    if (rewind_trace(replay) != ESP_OK) {
+        can_replay_close(replay);
+        return ESP_FAIL;
+    }
+    replay->stats.skipped = 0;
+    replay->stats.format = replay->config.format;
+    replay->stats.speed = replay->config.speed;
+    replay->stats.loop = replay->config.loop;
+    if (replay->config.speed > 0.0f) {
+        ESP_LOGI(TAG, "Replaying %s (%s) at %.2gx", path, can_replay_format_name(replay->config.format),
+                 (double)replay->config.speed);
+    } else {
+        ESP_LOGI(TAG, "Replaying %s (%s) at full speed", path, can_replay_format_name(replay->config.format));
+    }
+    return ESP_OK;
+}
+
+esp_err_t can_replay_receive_batch(can_replay_t *replay, can_frame_t *frames, size_t max_frames,
+                                   size_t *count, int64_t now_us, int64_t *due_us)
+{
+    if (!replay || !replay->file || !frames || !count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *count = 0;
+    float speed = replay->config.speed;
+
+    while (*count < max_frames) {
+        if (!replay->have_next) {
+            esp_err_t ret = read_frame(replay, &replay->next, &replay->next_trace_us);
+            if (ret == ESP_ERR_NOT_FOUND && replay->config.loop && replay->anchored) {
+                // The next pass starts where this one ended
+                replay->anchored = false;
+                replay->stats.loops++;
+                ret = rewind_trace(replay);
+                if (ret == ESP_OK) {
+                    continue;
+                }
+            }
+            if (ret != ESP_OK) {
+                replay->stats.finished = ret == ESP_ERR_NOT_FOUND;
+                return *count ? ESP_OK : ret;
+            }
+            replay->have_next = true;
+        }
+
+        if (!replay->anchored) {
+            replay->anchored = true;
+            replay->trace_first_us = replay->next_trace_us;
+            replay->wall_start_us = now_us > replay->last_due_us ? now_us : replay->last_due_us;
+        }
+        int64_t trace_us = replay->next_trace_us - replay->trace_first_us;
+        int64_t due = now_us;
+        if (speed > 0.0f) {
+            due = replay->wall_start_us + (int64_t)((double)trace_us / speed);
+            // Out of order time stamps (merged recordings) are sent right after the previous frame
+            if (due < replay->last_due_us) {
+                due = replay->last_due_us;
+            }
+            if (due > now_us) {
+                if (*count == 0) {
+                    if (due_us) {
+                        *due_us = due;
+                    }
+                    return ESP_ERR_TIMEOUT;
+                }
+                break;
+            }
+            if (now_us - due > (int64_t)replay->stats.late_max_us) {
+                replay->stats.late_max_us = (uint32_t)(now_us - due);
+            }
+        }
+
+        can_frame_t *frame = &frames[(*count)++];
+        *frame = replay->next;
+        frame->timestamp_us = due;
+        replay->last_due_us = due;
+        replay->have_next = false;
+        replay->stats.frames++;
+        replay->stats.trace_us = trace_us;
+    }
+    return ESP_OK;
+}
+
+void can_replay_get_stats(const can_replay_t *replay, can_replay_stats_t *stats)
+{
+    *stats = replay->stats;
+}
+
+void can_replay_close(can_replay_t *replay)
+{
+    if (replay && replay->file) {
+        fclose(replay->file);
+        replay->file = NULL;
+    }
+}
+
+const char *can_replay_format_name(can_replay_format_t format)
+{
+    switch (format) {
+    case CAN_REPLAY_FORMAT_BINARY:  return "binary";
+    case CAN_REPLAY_FORMAT_CANDUMP: return "candump";
+    case CAN_REPLAY_FORMAT_ASC:     return "asc";
+    default:                        return "auto";
+    }
+}
@@ -0,0 +1,161 @@
+/*
+ * CAN sniffer frame history
+ * Raw frames from the CAN frame fan-out, formatted by the UI only when they are shown.
+ * Kept free of UI dependencies so it also builds on the host.
+ */
+
+#include "include/can_sniffer.h"
+#include "include/can_decoder.h"
+#include "include/can_fanout.h"
+#include "include/dbc_loader.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CAN_SNIFFER_RING_MASK   (CAN_SNIFFER_RING_SIZE - 1)
+
+_Static_assert((CAN_SNIFFER_RING_SIZE & CAN_SNIFFER_RING_MASK) == 0, "CAN_SNIFFER_RING_SIZE must be a power of two");
+
+static const char *TAG = "CAN_SNIFFER";
+
+// Frames arrive through the fan-out; the history below is only touched by the consumer.
+// Frame n lives in slot n & MASK.
+static can_subscriber_t *s_subscription = NULL;
+static bool s_enabled = true;
+static bool s_all_ids = false;
+static can_frame_t s_ring[CAN_SNIFFER_RING_SIZE];
+static uint32_t s_head = 0;
+static uint32_t s_clear_index = 0;   // Frames before this index were cleared
+
+esp_err_t can_sniffer_init(void)
+{
+    if (s_subscription) {
+        return ESP_OK;
+    }
+    esp_err_t ret = can_fanout_subscribe("sniffer", CAN_SNIFFER_QUEUE_SIZE, &s_subscription);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to subscribe to CAN frames: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    can_fanout_set_active(s_subscription, s_enabled);
+    can_fanout_set_all_ids(s_subscription, s_all_ids);
+    return ESP_OK;
+}
+
+size_t can_sniffer_poll(void)
+{
+    if (!s_subscription) {
+        return 0;
+    }
+    size_t total = 0;
+    while (1) {
+        // Straight into the history; a wrap splits the copy in two
+        size_t contiguous = CAN_SNIFFER_RING_SIZE - (s_head & CAN_SNIFFER_RING_MASK);
+        size_t n = can_fanout_receive(s_subscription, &s_ring[s_head & CAN_SNIFFER_RING_MASK], contiguous);
+        s_head += (uint32_t)n;
+        total += n;
+        if (n < contiguous) {
+            return total;
+        }
+    }
+}
+
+void can_sniffer_set_enabled(bool enabled)
+{
+    s_enabled = enabled;
+    if (s_subscription) {
+        can_fanout_set_active(s_subscription, enabled);
+    }
+}
+
+void can_sniffer_set_all_ids(bool all_ids)
+{
+    s_all_ids = all_ids;
+    if (s_subscription) {
+        can_fanout_set_all_ids(s_subscription, all_ids);
+    }
+}
+
+bool can_sniffer_is_enabled(void)
+{
+    return s_enabled;
+}
+
+void can_sniffer_clear(void)
+{
+    can_fanout_flush(s_subscription);
+    s_clear_index = s_head;
+}
+
+uint32_t can_sniffer_count(void)
+{
+    return s_head - s_clear_index;
+}
+
+uint32_t can_sniffer_dropped(void)
+{
+    can_fanout_stats_t stats = {0};
+    can_fanout_get_subscriber_stats(s_subscription, &stats);
+    return stats.dropped;
+}
+
+size_t can_sniffer_snapshot(can_frame_t *frames, size_t max_frames)
+{
+    if (!frames || max_frames == 0) {
+        return 0;
+    }
+    uint32_t available = s_head - s_clear_index;
+    if (available > CAN_SNIFFER_RING_SIZE) {
+        available = CAN_SNIFFER_RING_SIZE;
+    }
+    size_t n = available < max_frames ? available : max_frames;
+    for (size_t i = 0; i < n; i++) {
+        frames[i] = s_ring[(s_head - 1 - i) & CAN_SNIFFER_RING_MASK];
+    }
+    return n;
+}
+
+size_t can_sniffer_format_frame(const can_frame_t *frame, char *buf, size_t size)
+{
+    if (!frame || !buf || size == 0) {
+        return 0;
+    }
+    uint8_t dlc = frame->dlc > 8 ? 8 : frame->dlc;
+
+    // Receive time in seconds.milliseconds
+    uint32_t ms = (uint32_t)(frame->timestamp_us / 1000);
+    char timestamp_str[16];
+    snprintf(timestamp_str, sizeof(timestamp_str), "%lu.%03lu",
+             (unsigned long)(ms / 1000), (unsigned long)(ms % 1000));
+
+    // HEX and ASCII data
+    static const char hex[] = "0123456789ABCDEF";
+    char data_hex_str[3 * 8 + 1];
+    char data_ascii_str[8 + 1];
+    for (int i = 0; i < dlc; i++) {
+        uint8_t byte = frame->data[i];
+        data_hex_str[3 * i] = hex[byte >> 4];
+        data_hex_str[3 * i + 1] = hex[byte & 0x0F];
+        data_hex_str[3 * i + 2] = ' ';
+        data_ascii_str[i] = (byte >= 32 && byte <= 126) ? (char)byte : '.';
+    }
+    data_hex_str[3 * dlc] = '\0';
+    data_ascii_str[dlc] = '\0';
+
+    // DBC Comments: message name and decoded signals, empty if no DBC is loaded
+    char dbc_comment[160];
+    dbc_format_frame(frame->id, frame->data, dlc, dbc_comment, sizeof(dbc_comment));
+
+    int len = snprintf(buf, size, "%-12s | %-3lX | %-1d | %-24s | %-8s | %s",
+                       timestamp_str,
+                       (unsigned long)(frame->id & ~CAN_DECODER_ID_EXT_FLAG),
+                       dlc,
+                       data_hex_str,
+                       data_ascii_str,
+                       dbc_comment);
+    if (len < 0) {
+        buf[0] = '\0';
+        return 0;
+    }
+    return (size_t)len < size ? (size_t)len : size - 1;
+}
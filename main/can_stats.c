@@ -0,0 +1,488 @@
+/*
+ * Per-identifier CAN statistics and bus load, see include/can_stats.h
+ * Kept free of driver dependencies so it also builds on the host.
+ */
+
+#include "include/can_stats.h"
+#include "include/can_decoder.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+static const char *TAG = "CAN_STATS";
+
+#define EXT_SLOT_BITS   8
+#define SLOT_EMPTY      0xFFFFFFFFU     // Not a valid identifier, even with the 29-bit flag
+_Static_assert((1U << EXT_SLOT_BITS) == CAN_STATS_EXT_SLOTS, "CAN_STATS_EXT_SLOTS must be 2^EXT_SLOT_BITS");
+_Static_assert(CAN_STATS_STD_SLOTS == CAN_DECODER_STD_ID_COUNT, "one slot per 11-bit identifier");
+
+// Reader spins this many times on an entry being written before sleeping a tick
+#define CAN_STATS_READ_SPINS    64
+
+// Bits after the CRC sequence, never stuffed: CRC delimiter, ACK slot and delimiter,
+// end of frame, interframe space
+#define TRAILER_BITS    (1 + 2 + 7 + 3)
+
+#define CRC15_POLY      0x4599
+
+// Widest members first: with the sequence counter a slot is 64 bytes
+typedef struct {
+    double period_mean_us;      // Welford running mean and sum of squared deviations
+    double period_m2;
+    int64_t last_us;
+    uint32_t id;                // SLOT_EMPTY if free
+    uint32_t count;
+    uint32_t dlc_changes;
+    uint32_t period_min_us;
+    uint32_t period_max_us;
+    uint8_t dlc;
+    uint8_t data[8];
+} slot_values_t;
+
+// Sequence odd while the CAN task writes the values
+typedef struct {
+    atomic_uint_least32_t seq;
+    slot_values_t v;
+} slot_t;
+
+typedef struct {
+    uint64_t frames;
+    uint64_t bits;
+    uint32_t overflow;
+    uint32_t resets;
+} bus_values_t;
+
+// Shared by the readers, refreshed under s_snapshot_lock
+typedef struct {
+    can_stats_bus_t bus;
+    can_stats_id_t ids[CAN_STATS_SLOTS];        // Sorted by identifier
+    size_t count;
+    uint32_t prev_count[CAN_STATS_SLOTS];       // Per slot, at the previous refresh
+    uint64_t prev_frames;
+    uint64_t prev_bits;
+    uint32_t prev_resets;
+    int64_t time_us;                            // Of the previous refresh
+} snapshot_t;
+
+// 11-bit identifiers at their own index, then the open-addressed 29-bit ones
+static slot_t *s_slots = NULL;
+static atomic_uint_least32_t s_bus_seq = 0;
+static bus_values_t s_bus;
+static atomic_bool s_reset_pending = false;
+static atomic_bool s_filtered = false;          // Filter active now
+static atomic_bool s_filtered_seen = false;     // Filter active at some point since the refresh
+static uint32_t s_bitrate = 500000;
+
+static snapshot_t *s_snapshot = NULL;
+static SemaphoreHandle_t s_snapshot_lock = NULL;
+
+// Bit stuffing state: value of the last bit on the wire (stuff bits included) and how many
+// equal bits end with it, 1..4. State = value * 4 + run - 1. Five equal bits insert a stuff bit.
+#define STUFF_STATES    8
+#define STUFF_IDLE      (1 * 4 + 0)     // Recessive bus before the start of frame
+
+// Per state and data byte: next state in the low nibble, stuff bits inserted in the high one
+static uint8_t s_stuff_table[STUFF_STATES][256];
+static uint16_t s_crc_table[256];
+
+static inline void write_begin(atomic_uint_least32_t *seq)
+{
+    uint32_t value = atomic_load_explicit(seq, memory_order_relaxed);
+    atomic_store_explicit(seq, value + 1, memory_order_relaxed);
+    // Order the odd sequence before any of the value stores
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void write_end(atomic_uint_least32_t *seq)
+{
+    uint32_t value = atomic_load_explicit(seq, memory_order_relaxed);
+    atomic_store_explicit(seq, value + 1, memory_order_release);
+}
+
+// Consistent copy of values published under seq
+static void read_values(atomic_uint_least32_t *seq, const void *values, void *copy, size_t size)
+{
+    uint32_t spins = 0;
+    uint32_t seq_before, seq_after;
+    do {
+        seq_before = atomic_load_explicit(seq, memory_order_acquire);
+        if (seq_before & 1) {
+            if (++spins >= CAN_STATS_READ_SPINS) {
+                vTaskDelay(1);
+                spins = 0;
+            }
+            seq_after = seq_before + 1;
+            continue;
+        }
+        memcpy(copy, values, size);
+        // Order the value loads before the second sequence load
+        atomic_thread_fence(memory_order_acquire);
+        seq_after = atomic_load_explicit(seq, memory_order_relaxed);
+    } while (seq_before != seq_after);
+}
+
+// ============================================================================
+// Frame length on the wire
+// ============================================================================
+
+// One bit through the stuffing state, returns the stuff bits inserted after it
+static uint32_t stuff_bit(uint8_t *state, uint32_t bit)
+{
+    uint32_t last = *state / 4;
+    uint32_t run = *state % 4 + 1;
+    run = bit == last ? run + 1 : 1;
+    if (run == 5) {
+        // The stuff bit is the complement and starts the next run
+        *state = (uint8_t)((bit ^ 1) * 4);
+        return 1;
+    }
+    *state = (uint8_t)(bit * 4 + run - 1);
+    return 0;
+}
+
+static uint32_t crc_bit(uint32_t crc, uint32_t bit)
+{
+    uint32_t feedback = bit ^ ((crc >> 14) & 1);
+    crc = (crc << 1) & 0x7FFF;
+    return feedback ? crc ^ CRC15_POLY : crc;
+}
+
+static void build_tables(void)
+{
+    for (uint32_t state = 0; state < STUFF_STATES; state++) {
+        for (uint32_t byte = 0; byte < 256; byte++) {
+            uint8_t next = (uint8_t)state;
+            uint32_t stuffed = 0;
+            for (int bit = 7; bit >= 0; bit--) {
+                stuffed += stuff_bit(&next, (byte >> bit) & 1);
+            }
+            s_stuff_table[state][byte] = (uint8_t)(next | (stuffed << 4));
+        }
+    }
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        uint32_t crc = 0;
+        for (int bit = 7; bit >= 0; bit--) {
+            crc = crc_bit(crc, (byte >> bit) & 1);
+        }
+        s_crc_table[byte] = (uint16_t)crc;
+    }
+}
+
+uint32_t can_stats_frame_bits(const can_frame_t *frame)
+{
+    bool ext = (frame->id & CAN_DECODER_ID_EXT_FLAG) != 0;
+    bool rtr = (frame->flags & CAN_FRAME_FLAG_RTR) != 0;
+    uint32_t raw = frame->id & ~CAN_DECODER_ID_EXT_FLAG;
+    uint32_t dlc = frame->dlc & 0xF;
+
+    // Start of frame (dominant, 0) to the DLC, first bit on the wire highest
+    uint64_t header;
+    int header_bits;
+    if (ext) {
+        // SOF, ID 28..18, SRR, IDE, ID 17..0, RTR, r1, r0, DLC
+        header = ((uint64_t)((raw >> 18) & 0x7FF) << 27) | (1ULL << 26) | (1ULL << 25) |
+                 ((uint64_t)(raw & 0x3FFFF) << 7) | ((uint64_t)rtr << 6) | dlc;
+        header_bits = 39;
+    } else {
+        // SOF, ID 10..0, RTR, IDE, r0, DLC
+        header = ((uint64_t)(raw & 0x7FF) << 7) | ((uint64_t)rtr << 6) | dlc;
+        header_bits = 19;
+    }
+
+    // Leading bits one at a time, then whole bytes through the tables
+    uint8_t state = STUFF_IDLE;
+    uint32_t crc = 0;
+    uint32_t stuffed = 0;
+    int bit = header_bits - 1;
+    for (; bit >= 0 && (bit + 1) % 8 != 0; bit--) {
+        uint32_t value = (uint32_t)(header >> bit) & 1;
+        crc = crc_bit(crc, value);
+        stuffed += stuff_bit(&state, value);
+    }
+    uint8_t bytes[4 + 8];
+    uint32_t byte_count = 0;
+    for (; bit >= 0; bit -= 8) {
+        bytes[byte_count++] = (uint8_t)(header >> (bit - 7));
+    }
+    uint32_t data_bytes = rtr ? 0 : (dlc > 8 ? 8 : dlc);
+    memcpy(&bytes[byte_count], frame->data, data_bytes);
+    byte_count += data_bytes;
+
+    for (uint32_t i = 0; i < byte_count; i++) {
+        uint8_t byte = bytes[i];
+        crc = ((crc << 8) & 0x7FFF) ^ s_crc_table[((crc >> 7) ^ byte) & 0xFF];
+        uint8_t entry = s_stuff_table[state][byte];
+        state = entry & 0x0F;
+        stuffed += entry >> 4;
+    }
+
+    // CRC sequence: its upper byte through the table, the last 7 bits one at a time
+    uint8_t entry = s_stuff_table[state][crc >> 7];
+    state = entry & 0x0F;
+    stuffed += entry >> 4;
+    for (bit = 6; bit >= 0; bit--) {
+        stuffed += stuff_bit(&state, (crc >> bit) & 1);
+    }
+    return (uint32_t)header_bits + data_bytes * 8 + 15 + stuffed + TRAILER_BITS;
+}
+
+// ============================================================================
+// CAN task
+// ============================================================================
+
+static void apply_reset(void)
+{
+    for (size_t i = 0; i < CAN_STATS_SLOTS; i++) {
+        if (s_slots[i].v.id == SLOT_EMPTY) {
+            continue;
+        }
+        write_begin(&s_slots[i].seq);
+        memset(&s_slots[i].v, 0, sizeof(s_slots[i].v));
+        s_slots[i].v.id = SLOT_EMPTY;
+        write_end(&s_slots[i].seq);
+    }
+    write_begin(&s_bus_seq);
+    uint32_t resets = s_bus.resets + 1;
+    memset(&s_bus, 0, sizeof(s_bus));
+    s_bus.resets = resets;
+    write_end(&s_bus_seq);
+}
+
+static slot_t *claim_slot(slot_t *slot, uint32_t id)
+{
+    write_begin(&slot->seq);
+    memset(&slot->v, 0, sizeof(slot->v));
+    slot->v.id = id;
+    write_end(&slot->seq);
+    return slot;
+}
+
+// Slot of an identifier, claimed if it is new. Every 11-bit identifier has one; a 29-bit
+// identifier gets NULL if none is free within CAN_STATS_MAX_PROBE.
+static slot_t *find_slot(uint32_t id)
+{
+    if (id < CAN_STATS_STD_SLOTS) {
+        slot_t *slot = &s_slots[id];
+        return slot->v.id == id ? slot : claim_slot(slot, id);
+    }
+    slot_t *ext = &s_slots[CAN_STATS_STD_SLOTS];
+    uint32_t hash = (id * 2654435761U) >> (32 - EXT_SLOT_BITS);
+    for (uint32_t probe = 0; probe < CAN_STATS_MAX_PROBE; probe++) {
+        slot_t *slot = &ext[(hash + probe) & (CAN_STATS_EXT_SLOTS - 1)];
+        if (slot->v.id == id) {
+            return slot;
+        }
+        if (slot->v.id == SLOT_EMPTY) {
+            return claim_slot(slot, id);
+        }
+    }
+    return NULL;
+}
+
+static void slot_add(slot_t *slot, const can_frame_t *frame)
+{
+    slot_values_t *v = &slot->v;
+    write_begin(&slot->seq);
+    if (v->count > 0) {
+        int64_t elapsed = frame->timestamp_us - v->last_us;
+        uint32_t period = elapsed < 0 ? 0 : (elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed);
+        uint32_t periods = v->count;    // Including this one
+        if (periods == 1 || period < v->period_min_us) v->period_min_us = period;
+        if (period > v->period_max_us) v->period_max_us = period;
+        // Double: a float m2 loses the spread of a steady ID after a few minutes
+        double delta = (double)period - v->period_mean_us;
+        v->period_mean_us += delta / (double)periods;
+        v->period_m2 += delta * ((double)period - v->period_mean_us);
+        if (frame->dlc != v->dlc) {
+            v->dlc_changes++;
+        }
+    }
+    v->count++;
+    v->last_us = frame->timestamp_us;
+    v->dlc = frame->dlc;
+    memcpy(v->data, frame->data, sizeof(v->data));
+    write_end(&slot->seq);
+}
+
+void can_stats_add(const can_frame_t *frames, size_t count)
+{
+    if (!s_slots) {
+        return;
+    }
+    if (atomic_exchange_explicit(&s_reset_pending, false, memory_order_acquire)) {
+        apply_reset();
+    }
+    if (count == 0) {
+        return;
+    }
+
+    uint64_t bits = 0;
+    uint32_t overflow = 0;
+    for (size_t i = 0; i < count; i++) {
+        bits += can_stats_frame_bits(&frames[i]);
+        slot_t *slot = find_slot(frames[i].id);
+        if (slot) {
+            slot_add(slot, &frames[i]);
+        } else {
+            overflow++;
+        }
+    }
+
+    write_begin(&s_bus_seq);
+    s_bus.frames += count;
+    s_bus.bits += bits;
+    s_bus.overflow += overflow;
+    write_end(&s_bus_seq);
+}
+
+void can_stats_reset(void)
+{
+    atomic_store_explicit(&s_reset_pending, true, memory_order_release);
+}
+
+void can_stats_set_filtered(bool filtered)
+{
+    atomic_store(&s_filtered, filtered);
+    if (filtered) {
+        atomic_store(&s_filtered_seen, true);
+    }
+}
+
+// ============================================================================
+// Readers
+// ============================================================================
+
+static int compare_id(const void *a, const void *b)
+{
+    uint32_t id_a = ((const can_stats_id_t *)a)->id;
+    uint32_t id_b = ((const can_stats_id_t *)b)->id;
+    return id_a < id_b ? -1 : id_a > id_b;
+}
+
+static void refresh_snapshot(snapshot_t *snap, int64_t now_us)
+{
+    bus_values_t bus;
+    read_values(&s_bus_seq, &s_bus, &bus, sizeof(bus));
+    bool reset = bus.resets != snap->prev_resets;
+    float seconds = (float)(now_us - snap->time_us) / 1e6f;
+    if (seconds <= 0.0f) seconds = 1e-6f;
+
+    size_t count = 0;
+    for (size_t i = 0; i < CAN_STATS_SLOTS; i++) {
+        slot_values_t v = { 0 };    // read_values() always fills it; the compiler cannot tell
+        read_values(&s_slots[i].seq, &s_slots[i].v, &v, sizeof(v));
+        uint32_t prev = reset ? 0 : snap->prev_count[i];
+        snap->prev_count[i] = v.id == SLOT_EMPTY ? 0 : v.count;
+        if (v.id == SLOT_EMPTY) {
+            continue;
+        }
+
+        can_stats_id_t *out = &snap->ids[count++];
+        out->id = v.id;
+        out->count = v.count;
+        out->rate_hz = (float)(v.count >= prev ? v.count - prev : v.count) / seconds;
+        uint32_t periods = v.count > 0 ? v.count - 1 : 0;
+        out->period_mean_us = (float)v.period_mean_us;
+        out->period_std_us = periods > 0 ? (float)sqrt(v.period_m2 / (double)periods) : 0.0f;
+        out->period_min_us = v.period_min_us;
+        out->period_max_us = v.period_max_us;
+        out->dlc_changes = v.dlc_changes;
+        out->dlc = v.dlc;
+        memcpy(out->data, v.data, sizeof(out->data));
+    }
+    qsort(snap->ids, count, sizeof(snap->ids[0]), compare_id);
+    snap->count = count;
+
+    uint64_t prev_frames = reset ? 0 : snap->prev_frames;
+    uint64_t prev_bits = reset ? 0 : snap->prev_bits;
+    uint64_t frames = bus.frames >= prev_frames ? bus.frames - prev_frames : bus.frames;
+    uint64_t bits = bus.bits >= prev_bits ? bus.bits - prev_bits : bus.bits;
+
+    snap->bus.frames = bus.frames;
+    snap->bus.bits = bus.bits;
+    snap->bus.frames_per_s = (float)frames / seconds;
+    snap->bus.bus_load_pct = 100.0f * (float)bits / ((float)s_bitrate * seconds);
+    snap->bus.bitrate = s_bitrate;
+    snap->bus.ids = (uint32_t)count;
+    snap->bus.overflow = bus.overflow;
+    snap->bus.filtered = atomic_exchange(&s_filtered_seen, atomic_load(&s_filtered));
+    snap->bus.generation++;
+
+    snap->prev_frames = bus.frames;
+    snap->prev_bits = bus.bits;
+    snap->prev_resets = bus.resets;
+    snap->time_us = now_us;
+}
+
+size_t can_stats_snapshot(can_stats_bus_t *bus, can_stats_id_t *ids, size_t first, size_t max)
+{
+    if (!s_snapshot) {
+        if (bus) memset(bus, 0, sizeof(*bus));
+        return 0;
+    }
+
+    xSemaphoreTake(s_snapshot_lock, portMAX_DELAY);
+    int64_t now_us = esp_timer_get_time();
+    if (first == 0 && (s_snapshot->bus.generation == 0 ||
+                       now_us - s_snapshot->time_us >= CAN_STATS_SNAPSHOT_MS * 1000LL)) {
+        refresh_snapshot(s_snapshot, now_us);
+    }
+    if (bus) {
+        *bus = s_snapshot->bus;
+    }
+    size_t copied = 0;
+    if (ids && first < s_snapshot->count) {
+        copied = s_snapshot->count - first < max ? s_snapshot->count - first : max;
+        memcpy(ids, &s_snapshot->ids[first], copied * sizeof(ids[0]));
+    }
+    xSemaphoreGive(s_snapshot_lock);
+    return copied;
+}
+
+esp_err_t can_stats_init(uint32_t bitrate)
+{
+    if (bitrate == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_bitrate = bitrate;
+    if (s_snapshot) {
+        return ESP_OK;
+    }
+
+    build_tables();
+
+    // One cache line per frame on the CAN task, the snapshot read twice a second: PSRAM is fine
+    slot_t *slots = heap_caps_calloc(CAN_STATS_SLOTS, sizeof(slot_t), MALLOC_CAP_SPIRAM);
+    if (!slots) {
+        slots = heap_caps_calloc(CAN_STATS_SLOTS, sizeof(slot_t), MALLOC_CAP_DEFAULT);
+    }
+    snapshot_t *snap = heap_caps_calloc(1, sizeof(snapshot_t), MALLOC_CAP_SPIRAM);
+    if (!snap) {
+        snap = heap_caps_calloc(1, sizeof(snapshot_t), MALLOC_CAP_DEFAULT);
+    }
+    s_snapshot_lock = xSemaphoreCreateMutex();
+    if (!slots || !snap || !s_snapshot_lock) {
+        ESP_LOGE(TAG, "Failed to allocate the statistics tables");
+        heap_caps_free(slots);
+        heap_caps_free(snap);
+        return ESP_ERR_NO_MEM;
+    }
+    for (size_t i = 0; i < CAN_STATS_SLOTS; i++) {
+        atomic_init(&slots[i].seq, 0);
+        slots[i].v.id = SLOT_EMPTY;
+    }
+    snap->time_us = esp_timer_get_time();
+    s_slots = slots;
+    s_snapshot = snap;
+
+    ESP_LOGI(TAG, "CAN statistics: %d identifiers, %lu bit/s", CAN_STATS_SLOTS, (unsigned long)bitrate);
+    return ESP_OK;
+}
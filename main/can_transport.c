@@ -0,0 +1,72 @@
+/*
+ * CAN transport: batch receive over the TWAI, file and SocketCAN backends, see include/can_transport.h
+ * Kept free of driver dependencies so it also builds on the host.
+ */
+
+#include "include/can_transport.h"
+#include <string.h>
+
+esp_err_t can_transport_start(can_transport_t *transport)
+{
+    if (!transport || !transport->ops) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return transport->ops->start(transport);
+}
+
+esp_err_t can_transport_stop(can_transport_t *transport)
+{
+    if (!transport || !transport->ops) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return transport->ops->stop(transport);
+}
+
+esp_err_t can_transport_receive_batch(can_transport_t *transport, can_frame_t *frames, size_t max_frames,
+                                      size_t *count, TickType_t wait_ticks)
+{
+    if (!frames || !count || max_frames == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *count = 0;
+    if (!transport || !transport->ops) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = transport->ops->receive_batch(transport, frames, max_frames, count, wait_ticks);
+    if (ret != ESP_OK || *count == 0) {
+        *count = 0;
+        return ret == ESP_OK ? ESP_ERR_TIMEOUT : ret;
+    }
+    transport->frames_received += *count;
+    transport->batches++;
+    if (*count > transport->max_batch) {
+        transport->max_batch = *count;
+    }
+    return ESP_OK;
+}
+
+esp_err_t can_transport_get_stats(can_transport_t *transport, can_transport_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (!transport || !transport->ops) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = transport->ops->get_stats(transport, stats);
+    stats->name = transport->ops->name;
+    stats->frames_received = transport->frames_received;
+    stats->batches = transport->batches;
+    stats->max_batch = transport->max_batch;
+    return ret;
+}
+
+void can_transport_close(can_transport_t *transport)
+{
+    if (transport && transport->ops) {
+        transport->ops->close(transport);
+        memset(transport, 0, sizeof(*transport));
+    }
+}
@@ -0,0 +1,103 @@
+/*
+ * File transport: a recorded trace (include/can_replay.h) as frame source
+ * Waits for the frames of a paced replay the way the driver waits for the bus.
+ * Kept free of driver dependencies so it also builds on the host.
+ */
+
+#include "include/can_transport.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    can_replay_t replay;
+    bool running;
+} file_transport_t;
+
+static esp_err_t file_transport_start(can_transport_t *transport)
+{
+    ((file_transport_t *)transport->ctx)->running = true;
+    return ESP_OK;
+}
+
+static esp_err_t file_transport_stop(can_transport_t *transport)
+{
+    ((file_transport_t *)transport->ctx)->running = false;
+    return ESP_OK;
+}
+
+static esp_err_t file_transport_receive_batch(can_transport_t *transport, can_frame_t *frames, size_t max_frames,
+                                              size_t *count, TickType_t wait_ticks)
+{
+    file_transport_t *file = transport->ctx;
+    if (!file->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const int64_t tick_us = portTICK_PERIOD_MS * 1000;
+    int64_t deadline = esp_timer_get_time() + (int64_t)wait_ticks * tick_us;
+    while (1) {
+        int64_t now = esp_timer_get_time();
+        int64_t due = now;
+        esp_err_t ret = can_replay_receive_batch(&file->replay, frames, max_frames, count, now, &due);
+        if (ret != ESP_ERR_TIMEOUT || now >= deadline) {
+            return ret;
+        }
+        // Sleep whole ticks, rounded up: frames are never handed out before they are due
+        int64_t wake = due < deadline ? due : deadline;
+        TickType_t ticks = (TickType_t)((wake - now + tick_us - 1) / tick_us);
+        vTaskDelay(ticks ? ticks : 1);
+    }
+}
+
+static esp_err_t file_transport_get_stats(can_transport_t *transport, can_transport_stats_t *stats)
+{
+    file_transport_t *file = transport->ctx;
+    can_replay_stats_t replay;
+    can_replay_get_stats(&file->replay, &replay);
+    stats->rx_missed = replay.recorder_lost;
+    stats->skipped = replay.skipped;
+    stats->state = file->running && !replay.finished ? CAN_TRANSPORT_STATE_RUNNING : CAN_TRANSPORT_STATE_STOPPED;
+    return ESP_OK;
+}
+
+static void file_transport_close(can_transport_t *transport)
+{
+    file_transport_t *file = transport->ctx;
+    can_replay_close(&file->replay);
+    free(file);
+}
+
+static const can_transport_ops_t s_file_ops = {
+    .name = "file",
+    .start = file_transport_start,
+    .stop = file_transport_stop,
+    .receive_batch = file_transport_receive_batch,
+    .get_stats = file_transport_get_stats,
+    .close = file_transport_close,
+};
+
+esp_err_t can_transport_file_open(can_transport_t *transport, const char *path, const can_replay_config_t *config)
+{
+    if (!transport) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(transport, 0, sizeof(*transport));
+    file_transport_t *file = calloc(1, sizeof(*file));
+    if (!file) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t ret = can_replay_open(&file->replay, path, config);
+    if (ret != ESP_OK) {
+        free(file);
+        return ret;
+    }
+    transport->ops = &s_file_ops;
+    transport->ctx = file;
+    return ESP_OK;
+}
+
+void can_transport_file_get_replay_stats(const can_transport_t *transport, can_replay_stats_t *stats)
+{
+    can_replay_get_stats(&((const file_transport_t *)transport->ctx)->replay, stats);
+}
@@ -0,0 +1,91 @@
+/*
+ * TWAI transport
+ * Drains the driver RX queue in batches; counters come from twai_get_status_info().
+ * Kept free of UI dependencies so it also builds on the host.
+ */
+
+#include "include/can_transport.h"
+#include "include/can_decoder.h"
+#include "driver/twai.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static inline void frame_from_twai(can_frame_t *frame, const twai_message_t *message, int64_t timestamp_us)
+{
+    frame->timestamp_us = timestamp_us;
+    frame->id = message->identifier | (message->extd ? CAN_DECODER_ID_EXT_FLAG : 0);
+    frame->dlc = message->data_length_code > 8 ? 8 : message->data_length_code;
+    frame->flags = message->rtr ? CAN_FRAME_FLAG_RTR : 0;
+    memcpy(frame->data, message->data, sizeof(frame->data));
+}
+
+static esp_err_t twai_transport_start(can_transport_t *transport)
+{
+    return twai_start();
+}
+
+static esp_err_t twai_transport_stop(can_transport_t *transport)
+{
+    return twai_stop();
+}
+
+static esp_err_t twai_transport_receive_batch(can_transport_t *transport, can_frame_t *frames, size_t max_frames,
+                                              size_t *count, TickType_t wait_ticks)
+{
+    twai_message_t message;
+    esp_err_t ret = twai_receive(&message, wait_ticks);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    frame_from_twai(&frames[0], &message, esp_timer_get_time());
+    size_t n = 1;
+
+    // Take whatever else is already queued without blocking
+    while (n < max_frames && twai_receive(&message, 0) == ESP_OK) {
+        frame_from_twai(&frames[n], &message, esp_timer_get_time());
+        n++;
+    }
+    *count = n;
+    return ESP_OK;
+}
+
+static esp_err_t twai_transport_get_stats(can_transport_t *transport, can_transport_stats_t *stats)
+{
+    twai_status_info_t status;
+    esp_err_t ret = twai_get_status_info(&status);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    stats->rx_queued = status.msgs_to_rx;
+    stats->rx_missed = status.rx_missed_count;
+    stats->rx_overrun = status.rx_overrun_count;
+    stats->bus_errors = status.bus_error_count;
+    stats->arb_lost = status.arb_lost_count;
+    stats->rx_error_counter = status.rx_error_counter;
+    stats->tx_error_counter = status.tx_error_counter;
+    stats->state = status.state;
+    return ESP_OK;
+}
+
+static void twai_transport_close(can_transport_t *transport)
+{
+}
+
+const can_transport_ops_t can_transport_twai_ops = {
+    .name = "twai",
+    .start = twai_transport_start,
+    .stop = twai_transport_stop,
+    .receive_batch = twai_transport_receive_batch,
+    .get_stats = twai_transport_get_stats,
+    .close = twai_transport_close,
+};
+
+esp_err_t can_transport_twai_open(can_transport_t *transport)
+{
+    if (!transport) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(transport, 0, sizeof(*transport));
+    transport->ops = &can_transport_twai_ops;
+    return ESP_OK;
+}
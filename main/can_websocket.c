@@ -6,13 +6,21 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_wifi.h"
 #include "esp_http_server.h"
 #include "driver/twai.h"
 #include <string.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "include/can_websocket.h"
+#include "include/ecu_data.h"
+#include "include/ecu_stream.h"
+#include "include/task_config.h"
 #include "ui/settings_config.h"
 
 static const char *TAG = "CAN_WEBSOCKET";
@@ -25,16 +33,142 @@ static esp_err_t data_handler(httpd_req_t *req);
 static can_data_t g_can_data = {0};
 static httpd_handle_t ws_server = NULL;
 
-// WebSocket handler for basic HTTP upgrade
+// Live stream clients. Added/removed by the server task, served by the broadcaster task.
+typedef struct {
+    int fd;                          // -1 = free
+    uint32_t period_us;              // 1 / negotiated rate
+    int64_t next_send_us;
+    int64_t next_keyframe_us;
+    bool keyframe_requested;
+    ecu_stream_encoder_t encoder;
+} ws_client_t;
+
+static ws_client_t ws_clients[WS_STREAM_MAX_CLIENTS];
+static SemaphoreHandle_t ws_clients_mutex = NULL;
+
+// Broadcaster statistics, logged every WS_STREAM_STATS_PERIOD_US
+#define WS_STREAM_STATS_PERIOD_US  (10 * 1000000LL)
+static uint32_t ws_frames_sent = 0;
+static uint32_t ws_bytes_sent = 0;
+static uint32_t ws_send_errors = 0;
+
+static void ws_clients_reset(void)
+{
+    for (int i = 0; i < WS_STREAM_MAX_CLIENTS; i++) {
+        ws_clients[i].fd = -1;
+    }
+}
+
+static uint32_t ws_rate_to_period_us(int rate_hz)
+{
+    if (rate_hz < WS_STREAM_MIN_RATE_HZ) rate_hz = WS_STREAM_MIN_RATE_HZ;
+    if (rate_hz > WS_STREAM_MAX_RATE_HZ) rate_hz = WS_STREAM_MAX_RATE_HZ;
+    return 1000000 / rate_hz;
+}
+
+static void ws_client_add(int fd)
+{
+    xSemaphoreTake(ws_clients_mutex, portMAX_DELAY);
+    ws_client_t *client = NULL;
+    for (int i = 0; i < WS_STREAM_MAX_CLIENTS; i++) {
+        if (ws_clients[i].fd == fd) {
+            client = &ws_clients[i];
+            break;
+        }
+        if (ws_clients[i].fd < 0 && !client) {
+            client = &ws_clients[i];
+        }
+    }
+    if (client) {
+        client->fd = fd;
+        client->period_us = ws_rate_to_period_us(WS_STREAM_DEFAULT_RATE_HZ);
+        client->next_send_us = 0;
+        client->next_keyframe_us = 0;
+        client->keyframe_requested = true;
+        ecu_stream_encoder_reset(&client->encoder);
+    }
+    xSemaphoreGive(ws_clients_mutex);
+
+    if (client) {
+        ESP_LOGI(TAG, "Stream client %d connected (%d Hz)", fd, WS_STREAM_DEFAULT_RATE_HZ);
+    } else {
+        ESP_LOGW(TAG, "Stream client %d rejected: %d clients already connected", fd, WS_STREAM_MAX_CLIENTS);
+    }
+}
+
+static void ws_client_remove(int fd)
+{
+    xSemaphoreTake(ws_clients_mutex, portMAX_DELAY);
+    for (int i = 0; i < WS_STREAM_MAX_CLIENTS; i++) {
+        if (ws_clients[i].fd == fd) {
+            ws_clients[i].fd = -1;
+            ESP_LOGI(TAG, "Stream client %d disconnected", fd);
+        }
+    }
+    xSemaphoreGive(ws_clients_mutex);
+}
+
+// Client control messages (text): "rate:<hz>" sets the stream rate, "key" asks for a keyframe
+static void ws_client_command(int fd, const char *command)
+{
+    int rate_hz = 0;
+    bool is_rate = sscanf(command, "rate:%d", &rate_hz) == 1;
+    bool is_key = strncmp(command, "key", 3) == 0;
+
+    xSemaphoreTake(ws_clients_mutex, portMAX_DELAY);
+    for (int i = 0; i < WS_STREAM_MAX_CLIENTS; i++) {
+        if (ws_clients[i].fd != fd) {
+            continue;
+        }
+        if (is_rate) {
+            ws_clients[i].period_us = ws_rate_to_period_us(rate_hz);
+            ws_clients[i].next_send_us = 0;
+        }
+        if (is_key) {
+            ws_clients[i].keyframe_requested = true;
+        }
+    }
+    xSemaphoreGive(ws_clients_mutex);
+
+    if (is_rate) {
+        ESP_LOGI(TAG, "Stream client %d: rate %d Hz requested", fd, rate_hz);
+    }
+}
+
+// Closing a session (client left, or send failed): forget the stream client
+static void ws_close_fn(httpd_handle_t hd, int sockfd)
+{
+    ws_client_remove(sockfd);
+    close(sockfd);
+}
+
+// WebSocket handler: the handshake registers a stream client, text frames are control messages
 static esp_err_t ws_handler(httpd_req_t *req)
 {
     if (req->method == HTTP_GET) {
         ESP_LOGI(TAG, "Handshake done, new WebSocket connection opened");
+        ws_client_add(httpd_req_to_sockfd(req));
         return ESP_OK;
     }
-    
-    // For now, just return OK since we're not handling complex WebSocket frames
-    return ESP_OK;
+
+    httpd_ws_frame_t frame = {0};
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);   // Length only
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    char command[32] = {0};
+    if (frame.len == 0) {
+        return ESP_OK;
+    }
+    if (frame.len >= sizeof(command)) {
+        return ESP_ERR_INVALID_SIZE; // Not a control message; the error closes the session
+    }
+    frame.payload = (uint8_t *)command;
+    ret = httpd_ws_recv_frame(req, &frame, sizeof(command) - 1);
+    if (ret == ESP_OK && frame.type == HTTPD_WS_TYPE_TEXT) {
+        ws_client_command(httpd_req_to_sockfd(req), command);
+    }
+    return ret;
 }
 
 // Data handler for /data endpoint
@@ -102,51 +236,74 @@ static esp_err_t data_handler(httpd_req_t *req)
 
 
 
-// Broadcast CAN data to all connected clients via HTTP
+// Send the live data to every stream client whose next frame is due.
+// Called by the broadcaster task only: it is the single sender on the stream sockets.
 void broadcast_can_data(void)
 {
-    bool demo_enabled = demo_mode_get_enabled();
-    ESP_LOGD(TAG, "📡 Broadcast check - demo mode: %s", demo_enabled ? "ENABLED" : "DISABLED");
+    static uint8_t frames[WS_STREAM_MAX_CLIENTS][ECU_STREAM_MAX_FRAME_SIZE];
+    int fds[WS_STREAM_MAX_CLIENTS];
+    size_t lengths[WS_STREAM_MAX_CLIENTS];
+    int due = 0;
 
-    if (!demo_enabled) {
-        // Demo mode disabled - don't broadcast
-        ESP_LOGI(TAG, "🚫 Broadcast cancelled - demo mode disabled");
+    if (!ws_server || !ws_clients_mutex) {
         return;
     }
+    int64_t now = esp_timer_get_time();
+    ecu_data_t data;
+    ecu_data_freshness_t freshness;
+    uint16_t stale_mask = 0;
+    bool have_data = false;
+
+    // Encode under the lock, send without it: a slow socket must not block the server task
+    xSemaphoreTake(ws_clients_mutex, portMAX_DELAY);
+    for (int i = 0; i < WS_STREAM_MAX_CLIENTS; i++) {
+        ws_client_t *client = &ws_clients[i];
+        if (client->fd < 0 || now < client->next_send_us) {
+            continue;
+        }
+        if (!have_data) {
+            ecu_data_get_snapshot(&data, &freshness);
+            stale_mask = (uint16_t)ecu_data_stale_mask(&freshness, now);
+            have_data = true;
+        }
 
-    if (!g_can_data.data_valid) {
-        // No real data, generate demo data for broadcast
-        static int demo_counter = 0;
-        demo_counter++;
-
-        // Generate demo data using simple periodic functions
-        int cycle = demo_counter % 100;
-        float phase = cycle / 100.0f;
-        float map_pressure = 120.0f + 30.0f * (cycle > 50 ? (100 - cycle) : cycle) / 50.0f;
-        float wastegate_pos = 45.0f + 25.0f * phase;
-        float tps_position = 35.0f + 30.0f * phase;
-        float engine_rpm = 2500.0f + 500.0f * phase;
-        float target_boost = 180.0f + 20.0f * phase;
-        int tcu_status = (demo_counter % 100 > 95) ? 1 : 0;
-
-        char json_data[256];
-        snprintf(json_data, sizeof(json_data),
-            "{\"map_pressure\":%.1f,\"wastegate_pos\":%.1f,\"tps_position\":%.1f,"
-            "\"engine_rpm\":%.0f,\"target_boost\":%.1f,\"tcu_status\":%d}",
-            map_pressure, wastegate_pos, tps_position, engine_rpm, target_boost, tcu_status);
-
-        ESP_LOGD(TAG, "Broadcasting demo CAN data: %s", json_data);
-        return;
+        bool keyframe = client->keyframe_requested || now >= client->next_keyframe_us;
+        size_t len = ecu_stream_encode(&client->encoder, &data, stale_mask, keyframe,
+                                       frames[due], sizeof(frames[due]));
+        if (keyframe) {
+            client->keyframe_requested = false;
+            client->next_keyframe_us = now + WS_STREAM_KEYFRAME_INTERVAL_US;
+        }
+        // Keep the cadence, but never try to catch up on missed periods
+        client->next_send_us += client->period_us;
+        if (client->next_send_us <= now) {
+            client->next_send_us = now + client->period_us;
+        }
+        if (len > 0) {
+            fds[due] = client->fd;
+            lengths[due] = len;
+            due++;
+        }
+    }
+    xSemaphoreGive(ws_clients_mutex);
+
+    for (int i = 0; i < due; i++) {
+        httpd_ws_frame_t frame = {
+            .final = true,
+            .type = HTTPD_WS_TYPE_BINARY,
+            .payload = frames[i],
+            .len = lengths[i],
+        };
+        esp_err_t ret = httpd_ws_send_frame_async(ws_server, fds[i], &frame);
+        if (ret == ESP_OK) {
+            ws_frames_sent++;
+            ws_bytes_sent += lengths[i] + 2; // 2 byte WebSocket header for payloads < 126 bytes
+        } else {
+            ws_send_errors++;
+            ESP_LOGW(TAG, "Stream client %d: send failed (%s), closing", fds[i], esp_err_to_name(ret));
+            httpd_sess_trigger_close(ws_server, fds[i]);   // ws_close_fn removes the client
+        }
     }
-
-    char json_data[256];
-    snprintf(json_data, sizeof(json_data),
-        "{\"map_pressure\":%d,\"wastegate_pos\":%d,\"tps_position\":%d,"
-        "\"engine_rpm\":%d,\"target_boost\":%d,\"tcu_status\":%d}",
-        g_can_data.map_pressure, g_can_data.wastegate_pos, g_can_data.tps_position,
-        g_can_data.engine_rpm, g_can_data.target_boost, g_can_data.tcu_status);
-
-    ESP_LOGD(TAG, "Broadcasting CAN data: %s", json_data);
 }
 
 // Update CAN data from main CAN task
@@ -168,9 +325,6 @@ void update_websocket_can_data(uint16_t rpm, uint16_t map, uint8_t tps,
 
         ESP_LOGD(TAG, "✅ CAN data updated - RPM: %d, MAP: %d, TPS: %d, Wastegate: %d, Boost: %d, TCU: %d",
                   rpm, map, tps, wastegate, target_boost, tcu_status);
-
-        // Broadcast updated data
-        broadcast_can_data();
     } else {
         // Demo mode disabled - clear data
         g_can_data.engine_rpm = 0;
@@ -185,12 +339,24 @@ void update_websocket_can_data(uint16_t rpm, uint16_t map, uint8_t tps,
     }
 }
 
-// Start WebSocket server (simplified HTTP server for now)
+// Start WebSocket server: binary live data stream on /ws, JSON polling fallback on /data
 esp_err_t start_websocket_server(void)
 {
+    if (!ws_clients_mutex) {
+        ws_clients_mutex = xSemaphoreCreateMutex();
+        if (!ws_clients_mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    ws_clients_reset();
+
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = 8081;  // Use different port to avoid conflict with main HTTP server
+    config.ctrl_port = 32769;   // The main HTTP server uses the default control port
     config.max_open_sockets = 7;
+    config.close_fn = ws_close_fn;
+    config.task_priority = TASK_HTTPD_PRIORITY;
+    config.core_id = TASK_CORE_BACKGROUND;
 
     ESP_LOGI(TAG, "Starting WebSocket server on port: '%d'", config.server_port);
     
@@ -199,7 +365,8 @@ esp_err_t start_websocket_server(void)
             .uri = "/ws",
             .method = HTTP_GET,
             .handler = ws_handler,
-            .user_ctx = NULL
+            .user_ctx = NULL,
+            .is_websocket = true
         };
         httpd_register_uri_handler(ws_server, &ws_uri);
         
@@ -229,12 +396,29 @@ void stop_websocket_server(void)
     }
 }
 
-// WebSocket broadcast task
+// WebSocket broadcast task: the only task sending stream frames
 void websocket_broadcast_task(void *pvParameters)
 {
+    TickType_t last_wake = xTaskGetTickCount();
+    int64_t stats_start = esp_timer_get_time();
+
     while (1) {
         broadcast_can_data();
-        vTaskDelay(pdMS_TO_TICKS(100)); // Broadcast at 10Hz
+
+        int64_t now = esp_timer_get_time();
+        if (now - stats_start >= WS_STREAM_STATS_PERIOD_US) {
+            if (ws_frames_sent || ws_send_errors) {
+                ESP_LOGI(TAG, "Stream: %lu frames/s, %lu bytes/s, %lu send errors",
+                         (unsigned long)(ws_frames_sent * 1000000LL / (now - stats_start)),
+                         (unsigned long)(ws_bytes_sent * 1000000LL / (now - stats_start)),
+                         (unsigned long)ws_send_errors);
+            }
+            ws_frames_sent = 0;
+            ws_bytes_sent = 0;
+            ws_send_errors = 0;
+            stats_start = now;
+        }
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(WS_STREAM_TICK_MS));
     }
 }
 
@@ -4,12 +4,21 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
 #include "esp_timer.h"
+#include "esp_intr_alloc.h"
 #include "include/web_server.h"
 #include "include/can_websocket.h"
 #include "lvgl.h"
-#include "ui/screens/ui_Screen3.h"
+#include "ui/ui_updates.h"
 #include "include/can_parser.h"
+#include "include/can_decoder.h"
+#include "include/can_fanout.h"
+#include "include/can_filter.h"
+#include "include/can_stats.h"
+#include "include/can_replay.h"
+#include "sdkconfig.h"
 #include "sd_card.h" // Replaced sd_card_manager.h
 
 static const char *CAN_TAG = "CANBUS";
@@ -23,6 +32,43 @@ static twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
 static bool canbus_initialized = false;
 static bool canbus_running = false;
 
+// Frames drained from the driver queue per pass (static: keeps them off the task stack)
+static can_frame_t rx_batch[CONFIG_CANBUS_RX_BATCH_SIZE];
+
+// Acceptance filter. Frames are counted per ID while everything is accepted; that traffic
+// rates the filter planned for the decoded IDs whenever no fan-out consumer needs all frames.
+// The first plan waits until the bus has been watched for a while: slow IDs (1 Hz and less)
+// have to show up in the traffic before a filter can be rated on it.
+#define CANBUS_FILTER_OBSERVE_MS        3000
+#define CANBUS_FILTER_OBSERVE_FRAMES    1000
+static can_filter_traffic_t s_filter_traffic;
+static can_filter_plan_t s_filter_plan = {
+    .accept_all = true, .single_filter = true, .acceptance_mask = 0xFFFFFFFF,
+};
+static int64_t s_filter_observe_start_us = 0;
+static bool s_filter_observed = false;
+static portMUX_TYPE s_filter_lock = portMUX_INITIALIZER_UNLOCKED;
+static const can_decoder_table_t *s_filter_table = NULL;
+static uint32_t s_filter_subscribers = UINT32_MAX;
+
+// Trace replay. While one runs the CAN task takes its frames from a file transport instead
+// of the driver (stopped meanwhile), so everything downstream keeps its single producer.
+#define CANBUS_REPLAY_YIELD_MS  100
+static _Atomic(can_transport_t *) s_replay_pending = NULL;  // Opened, waiting for the CAN task
+static atomic_bool s_replay_stop = false;
+static can_transport_t *s_replay = NULL;                    // CAN task only
+static bool s_replay_full_speed = false;
+static bool s_replay_resume_driver = false;
+static portMUX_TYPE s_replay_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool s_replay_starting = false;
+static bool s_replay_running = false;
+static bool s_replay_stats_valid = false;
+static can_replay_stats_t s_replay_stats;
+
+// Driver loss counters already reported (they restart when the driver is reinstalled)
+static uint32_t s_reported_missed = 0;
+static uint32_t s_reported_overrun = 0;
+
 esp_err_t canbus_init(void)
 {
     if (canbus_initialized) {
@@ -30,7 +76,25 @@ esp_err_t canbus_init(void)
         return ESP_OK;
     }
     
-    esp_err_t ret = twai_driver_install(&g_config, &t_config, &f_config);
+    esp_err_t ret = can_parser_init();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // Bus load is rated against the bit rate of t_config
+    ret = can_stats_init(500000);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    g_config.rx_queue_len = CONFIG_CANBUS_RX_QUEUE_LEN;
+#ifdef CONFIG_TWAI_ISR_IN_IRAM
+    // The handler is in IRAM (Kconfig); the flag keeps the interrupt enabled while the flash
+    // cache is off (NVS and settings writes), so the controller FIFO is still drained then.
+    // Also applies to the reinstalls of canbus_install_filter().
+    g_config.intr_flags |= ESP_INTR_FLAG_IRAM;
+#endif
+    ret = twai_driver_install(&g_config, &t_config, &f_config);
     if (ret != ESP_OK) {
         ESP_LOGE(CAN_TAG, "Failed to install TWAI driver: %s", esp_err_to_name(ret));
         return ret;
@@ -53,7 +117,7 @@ esp_err_t canbus_start(void)
         return ESP_OK;
     }
     
-    esp_err_t ret = twai_start();
+    esp_err_t ret = can_transport_start(canbus_bus_transport());
     if (ret != ESP_OK) {
         ESP_LOGE(CAN_TAG, "Failed to start TWAI: %s", esp_err_to_name(ret));
         return ret;
@@ -71,7 +135,7 @@ esp_err_t canbus_stop(void)
         return ESP_OK;
     }
     
-    esp_err_t ret = twai_stop();
+    esp_err_t ret = can_transport_stop(canbus_bus_transport());
     if (ret != ESP_OK) {
         ESP_LOGE(CAN_TAG, "Failed to stop TWAI: %s", esp_err_to_name(ret));
         return ret;
@@ -82,49 +146,322 @@ esp_err_t canbus_stop(void)
     return ESP_OK;
 }
 
-// The canbus_task is now much simpler. It receives a message and passes it to the new parser.
+// Warn when the driver reports new lost frames
+static void canbus_check_rx_losses(void)
+{
+    canbus_stats_t stats;
+
+    if (canbus_get_stats(&stats) != ESP_OK) {
+        return;
+    }
+    if (stats.rx_missed != s_reported_missed || stats.rx_overrun != s_reported_overrun) {
+        ESP_LOGW(CAN_TAG, "CAN frames lost: %lu queue full, %lu FIFO overrun (max batch %lu)",
+                 (unsigned long)(stats.rx_missed - s_reported_missed),
+                 (unsigned long)(stats.rx_overrun - s_reported_overrun),
+                 (unsigned long)stats.max_batch);
+        s_reported_missed = stats.rx_missed;
+        s_reported_overrun = stats.rx_overrun;
+    }
+}
+
+// The driver takes the acceptance filter only when it is installed: reinstall it.
+// Runs in the CAN task, the only caller of twai_receive(); being pinned to the ingest core,
+// it installs the interrupt there again.
+static esp_err_t canbus_install_filter(const can_filter_plan_t *plan)
+{
+    f_config.acceptance_code = plan->acceptance_code;
+    f_config.acceptance_mask = plan->acceptance_mask;
+    f_config.single_filter = plan->single_filter;
+
+    if (canbus_running) {
+        twai_stop();
+    }
+    twai_driver_uninstall();
+    esp_err_t ret = twai_driver_install(&g_config, &t_config, &f_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(CAN_TAG, "Failed to install TWAI driver with the new filter: %s", esp_err_to_name(ret));
+        f_config = (twai_filter_config_t)TWAI_FILTER_CONFIG_ACCEPT_ALL();
+        if (twai_driver_install(&g_config, &t_config, &f_config) != ESP_OK) {
+            canbus_initialized = false;
+            canbus_running = false;
+            return ret;
+        }
+    }
+    s_reported_missed = 0;
+    s_reported_overrun = 0;
+    if (canbus_running && twai_start() != ESP_OK) {
+        canbus_running = false;
+    }
+    return ret;
+}
+
+// Replan the acceptance filter when the decoded IDs change or a fan-out consumer starts or
+// stops needing every identifier
+static void canbus_update_filter(void)
+{
+    if (!canbus_initialized) {
+        return;
+    }
+    if (!s_filter_observed) {
+        // Keep accepting everything until the traffic is worth planning on. A quiet bus
+        // (or a replay, which is not counted) keeps the filter open, which costs nothing.
+        int64_t now = esp_timer_get_time();
+        if (s_filter_observe_start_us == 0) {
+            s_filter_observe_start_us = now;
+        }
+        if (now - s_filter_observe_start_us < CANBUS_FILTER_OBSERVE_MS * 1000LL ||
+            s_filter_traffic.frames < CANBUS_FILTER_OBSERVE_FRAMES) {
+            return;
+        }
+        s_filter_observed = true;
+    }
+    const can_decoder_table_t *table = can_decoder_get_active();
+    uint32_t subscribers = can_fanout_all_ids_mask();
+    if (table == s_filter_table && subscribers == s_filter_subscribers) {
+        return;
+    }
+    s_filter_table = table;
+    s_filter_subscribers = subscribers;
+
+    // Sniffer view, logger of the whole bus, ... take every frame
+    static can_filter_id_count_t traffic[CAN_FILTER_TRAFFIC_SLOTS];
+    size_t traffic_count = can_filter_traffic_get(&s_filter_traffic, traffic, CAN_FILTER_TRAFFIC_SLOTS);
+    can_filter_plan_t plan;
+    size_t wanted_count = can_filter_plan_for_table(table, subscribers, traffic, traffic_count, &plan);
+
+    bool same_filter = plan.accept_all ? s_filter_plan.accept_all :
+        (!s_filter_plan.accept_all && plan.single_filter == s_filter_plan.single_filter &&
+         plan.acceptance_code == s_filter_plan.acceptance_code && plan.acceptance_mask == s_filter_plan.acceptance_mask);
+    if (!same_filter && canbus_install_filter(&plan) != ESP_OK) {
+        can_filter_plan_accept_all(traffic, traffic_count, &plan);
+    }
+
+    taskENTER_CRITICAL(&s_filter_lock);
+    s_filter_plan = plan;
+    taskEXIT_CRITICAL(&s_filter_lock);
+    can_stats_set_filtered(!plan.accept_all);
+
+    if (!same_filter) {
+        if (plan.accept_all) {
+            ESP_LOGI(CAN_TAG, "Acceptance filter: all frames (%s)", subscribers ? "a raw frame consumer needs every ID" : "no plan");
+        } else if (plan.traffic_frames == 0) {
+            ESP_LOGI(CAN_TAG, "Acceptance filter: %s code 0x%08lX mask 0x%08lX for %u IDs, no observed traffic to rate it on",
+                     plan.single_filter ? "single" : "dual", (unsigned long)plan.acceptance_code,
+                     (unsigned long)plan.acceptance_mask, (unsigned)wanted_count);
+        } else {
+            ESP_LOGI(CAN_TAG, "Acceptance filter: %s code 0x%08lX mask 0x%08lX for %u IDs, %.1f%% of %lu observed frames accepted (%.1f%% unwanted)",
+                     plan.single_filter ? "single" : "dual", (unsigned long)plan.acceptance_code,
+                     (unsigned long)plan.acceptance_mask, (unsigned)wanted_count, 100.0f * plan.accepted_fraction,
+                     (unsigned long)plan.traffic_frames, 100.0f * plan.unwanted_fraction);
+        }
+    }
+}
+
+void canbus_get_filter(can_filter_plan_t *plan)
+{
+    taskENTER_CRITICAL(&s_filter_lock);
+    *plan = s_filter_plan;
+    taskEXIT_CRITICAL(&s_filter_lock);
+}
+
+// Everything a batch of frames goes through, from the bus or from a replayed trace
+static void canbus_process_batch(size_t count, bool from_bus)
+{
+    uint32_t changed = 0;
+    int64_t first_change_us = 0;
+    for (size_t i = 0; i < count; i++) {
+        const can_frame_t *frame = &rx_batch[i];
+
+        // 1. Parse the received CAN frame. The parser updates the global g_ecu_data struct.
+        uint32_t updated = parse_can_frame(frame);
+        if (updated && !changed) {
+            first_change_us = frame->timestamp_us;
+        }
+        changed |= updated;
+    }
+
+    // 2. Hand the raw frames to the other consumers (sniffer, SD card logger, ...). Each has its own
+    // queue and drains it on its own task; a slow one only loses its own frames.
+    can_fanout_publish(rx_batch, count);
+
+    // Per-ID counters and bus load, read at 2 Hz by Screen3 and /can/ids
+    can_stats_add(rx_batch, count);
+
+    // Traffic per ID for the filter planner; behind a filter the rest of the bus is unseen.
+    // A replayed trace may come from another car.
+    if (from_bus && s_filter_plan.accept_all) {
+        can_filter_traffic_add(&s_filter_traffic, rx_batch, count);
+    }
+
+    // Wake the UI task once per batch; it coalesces to the display refresh rate
+    ui_updates_notify(changed, first_change_us);
+}
+
+// Full speed replay: wait while a fan-out consumer has no room for another batch, and
+// give the lower priority tasks of the core a tick now and then
+static void canbus_replay_yield(void)
+{
+    static int64_t last_yield_us = 0;
+    int64_t now = esp_timer_get_time();
+    bool full = false;
+    can_fanout_stats_t subscribers[CAN_FANOUT_MAX_SUBSCRIBERS];
+    size_t subscriber_count = can_fanout_get_stats(subscribers, CAN_FANOUT_MAX_SUBSCRIBERS);
+    for (size_t i = 0; i < subscriber_count; i++) {
+        full |= subscribers[i].active &&
+                subscribers[i].capacity - subscribers[i].queued < CONFIG_CANBUS_RX_BATCH_SIZE;
+    }
+    if (full || now - last_yield_us > CANBUS_REPLAY_YIELD_MS * 1000) {
+        vTaskDelay(1);
+        last_yield_us = esp_timer_get_time();
+    }
+}
+
+// Run the replay, if there is one, in place of the driver. Returns false when the frames
+// come from the bus.
+static bool canbus_replay_poll(void)
+{
+    if (!s_replay) {
+        can_transport_t *pending = atomic_exchange(&s_replay_pending, NULL);
+        if (!pending) {
+            return false;
+        }
+        s_replay = pending;
+        can_replay_stats_t replay_stats;
+        can_transport_file_get_replay_stats(s_replay, &replay_stats);
+        s_replay_full_speed = replay_stats.speed <= 0.0f;
+        s_replay_resume_driver = canbus_running;
+        canbus_stop();
+        ESP_LOGI(CAN_TAG, "Replay started, CAN driver stopped");
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    if (!atomic_load(&s_replay_stop)) {
+        // Waits for the next frame that is due; at most 100 ms, to see a stop request
+        size_t count = 0;
+        ret = can_transport_receive_batch(s_replay, rx_batch, CONFIG_CANBUS_RX_BATCH_SIZE, &count, pdMS_TO_TICKS(100));
+        if (ret == ESP_OK) {
+            canbus_process_batch(count, false);
+            if (s_replay_full_speed) {
+                canbus_replay_yield();
+            }
+        } else if (ret == ESP_ERR_TIMEOUT) {
+            can_stats_add(NULL, 0);
+        }
+    }
+
+    taskENTER_CRITICAL(&s_replay_lock);
+    can_transport_file_get_replay_stats(s_replay, &s_replay_stats);
+    s_replay_stats_valid = true;
+    s_replay_running = ret == ESP_OK || ret == ESP_ERR_TIMEOUT;
+    taskEXIT_CRITICAL(&s_replay_lock);
+    if (ret == ESP_OK || ret == ESP_ERR_TIMEOUT) {
+        return true;
+    }
+
+    // End of the trace, a read error or a stop request: back to the bus
+    ESP_LOGI(CAN_TAG, "Replay ended (%s): %lu frames, %lu skipped",
+             atomic_load(&s_replay_stop) ? "stopped" : (ret == ESP_ERR_NOT_FOUND ? "end of trace" : esp_err_to_name(ret)),
+             (unsigned long)s_replay_stats.frames, (unsigned long)s_replay_stats.skipped);
+    can_transport_close(s_replay);
+    free(s_replay);
+    s_replay = NULL;
+    atomic_store(&s_replay_stop, false);
+    if (s_replay_resume_driver) {
+        canbus_start();
+    }
+    return true;
+}
+
+esp_err_t canbus_replay_start(const char *path, const can_replay_config_t *config)
+{
+    if (!canbus_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    taskENTER_CRITICAL(&s_replay_lock);
+    bool busy = s_replay_running || s_replay_starting;
+    s_replay_starting = !busy;
+    taskEXIT_CRITICAL(&s_replay_lock);
+    if (busy) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    can_transport_t *replay = malloc(sizeof(*replay));
+    if (replay) {
+        ret = can_transport_file_open(replay, path, config);
+    }
+    if (ret == ESP_OK) {
+        ret = can_transport_start(replay);
+        if (ret != ESP_OK) {
+            can_transport_close(replay);
+        }
+    }
+    if (ret == ESP_OK) {
+        taskENTER_CRITICAL(&s_replay_lock);
+        s_replay_running = true;
+        taskEXIT_CRITICAL(&s_replay_lock);
+        atomic_store(&s_replay_stop, false);
+        atomic_store(&s_replay_pending, replay);
+    } else {
+        ESP_LOGW(CAN_TAG, "Replay of %s not started: %s", path, esp_err_to_name(ret));
+        free(replay);
+    }
+    taskENTER_CRITICAL(&s_replay_lock);
+    s_replay_starting = false;
+    taskEXIT_CRITICAL(&s_replay_lock);
+    return ret;
+}
+
+void canbus_replay_stop(void)
+{
+    atomic_store(&s_replay_stop, true);
+}
+
+bool canbus_replay_get_status(can_replay_stats_t *stats)
+{
+    taskENTER_CRITICAL(&s_replay_lock);
+    bool running = s_replay_running;
+    if (stats) {
+        if (s_replay_stats_valid) {
+            *stats = s_replay_stats;
+        } else {
+            memset(stats, 0, sizeof(*stats));
+        }
+    }
+    taskEXIT_CRITICAL(&s_replay_lock);
+    return running;
+}
+
+// Drains the driver queue in batches and passes every frame to the parser.
+// The task only blocks while the queue is empty, so ingest keeps up with a fully loaded bus.
 void canbus_task(void *pvParameters)
 {
-    ESP_LOGI(CAN_TAG, "CAN bus task started");
+    ESP_LOGI(CAN_TAG, "CAN bus task started (batch %d, RX queue %d)",
+             CONFIG_CANBUS_RX_BATCH_SIZE, CONFIG_CANBUS_RX_QUEUE_LEN);
 
-    twai_message_t message;
     uint32_t consecutive_errors = 0;
     uint32_t last_message_time = xTaskGetTickCount();
+    uint32_t last_loss_check = last_message_time;
 
     while (1) {
-        esp_err_t ret = twai_receive(&message, pdMS_TO_TICKS(100)); // 100ms timeout
+        // A trace replay takes the place of the driver until it ends
+        if (canbus_replay_poll()) {
+            last_message_time = xTaskGetTickCount();
+            continue;
+        }
+
+        size_t count = 0;
+        esp_err_t ret = canbus_receive_batch(rx_batch, CONFIG_CANBUS_RX_BATCH_SIZE, &count,
+                                             pdMS_TO_TICKS(100)); // 100ms timeout
 
         if (ret == ESP_OK) {
             consecutive_errors = 0;
             last_message_time = xTaskGetTickCount();
 
-            // 1. Parse the received CAN message using the new parser.
-            // The parser will update the global g_ecu_data struct.
-            parse_can_message(&message);
-
-            // 2. The global data structure is now updated.
-            // The UI task will periodically read this data to update the gauges.
-
-            // 3. Send raw CAN message to Screen3 sniffer for debugging.
-            ui_process_real_can_message(message.identifier, message.data, message.data_length_code);
-
-            // 4. Log CAN trace to SD card if enabled
-            /*
-            // TODO: Re-implement CAN tracing with the new SD card driver
-            if (sd_card_is_can_trace_enabled()) {
-                char trace_buffer[100];
-                // Format: timestamp,ID,d0,d1,d2,d3,d4,d5,d6,d7
-                snprintf(trace_buffer, sizeof(trace_buffer), "%llu,%X,%02X,%02X,%02X,%02X,%02X,%02X,%02X,%02X\n",
-                         esp_timer_get_time() / 1000,
-                         message.identifier,
-                         message.data[0], message.data[1], message.data[2], message.data[3],
-                         message.data[4], message.data[5], message.data[6], message.data[7]);
-                sd_card_append_file("/sdcard/can_trace.csv", trace_buffer);
-            }
-            */
-
+            canbus_process_batch(count, true);
         } else if (ret == ESP_ERR_TIMEOUT) {
             // Timeout is normal if there's no traffic on the bus.
+            can_stats_add(NULL, 0); // Apply a reset asked for while the bus is quiet
             // Check if we haven't received data for too long.
             uint32_t current_time = xTaskGetTickCount();
             if ((current_time - last_message_time) > pdMS_TO_TICKS(5000)) { // 5 seconds
@@ -151,8 +488,18 @@ void canbus_task(void *pvParameters)
                     data_stream_add_entry("CAN bus recovery failed", LOG_ERROR);
                     vTaskDelay(pdMS_TO_TICKS(5000));
                 }
+            } else {
+                // Driver not running (e.g. bus-off): don't spin on the error
+                vTaskDelay(pdMS_TO_TICKS(10));
             }
         }
-        vTaskDelay(pdMS_TO_TICKS(10));
+
+        canbus_update_filter();
+
+        uint32_t now = xTaskGetTickCount();
+        if ((now - last_loss_check) > pdMS_TO_TICKS(5000)) {
+            canbus_check_rx_losses();
+            last_loss_check = now;
+        }
     }
 }
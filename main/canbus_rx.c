@@ -0,0 +1,25 @@
+/*
+ * CAN bus receive path
+ * The TWAI transport the CAN task drains, and its receive counters.
+ * Kept free of UI dependencies so it also builds on the host.
+ */
+
+#include "include/canbus.h"
+
+// Set up statically: the web server and the task monitor may read counters before canbus_init()
+static can_transport_t s_bus = { .ops = &can_transport_twai_ops };
+
+can_transport_t *canbus_bus_transport(void)
+{
+    return &s_bus;
+}
+
+esp_err_t canbus_receive_batch(can_frame_t *frames, size_t max_frames, size_t *count, TickType_t wait_ticks)
+{
+    return can_transport_receive_batch(&s_bus, frames, max_frames, count, wait_ticks);
+}
+
+esp_err_t canbus_get_stats(canbus_stats_t *stats)
+{
+    return can_transport_get_stats(&s_bus, stats);
+}
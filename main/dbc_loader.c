@@ -0,0 +1,596 @@
+/*
+ * DBC file loader
+ * Streams Vector DBC files line by line into a compact ID-indexed signal
+ * database in PSRAM and compiles the bound signals into the CAN decoder.
+ */
+
+#include "include/dbc_loader.h"
+#include "include/ecu_data.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <dirent.h>
+
+static const char *TAG = "DBC_LOADER";
+
+// Attribute binding a DBC signal to a dashboard field:
+//   BA_ "DashField" SG_ 640 Engine_Speed "engine_rpm";
+#define DBC_FIELD_ATTRIBUTE    "DashField"
+
+// Message comments are shortened to fit a sniffer row
+#define DBC_COMMENT_MAX        64
+
+#define DBC_EXT_ID_MASK        0x1FFFFFFFU
+
+typedef struct {
+    dbc_message_t messages[DBC_MAX_MESSAGES];
+    dbc_signal_t signals[DBC_MAX_SIGNALS];
+    size_t message_count;
+    size_t signal_count;
+    uint16_t std_index[CAN_DECODER_STD_ID_COUNT]; // 1-based message index, 0 = unknown
+    char pool[DBC_STRING_POOL_SIZE];
+    size_t pool_used;
+    can_decoder_table_t table;
+} dbc_database_t;
+
+// State of a quoted CM_ string, which may span several lines
+typedef struct {
+    bool active;
+    bool escape;
+    dbc_message_t *target;       // NULL if the comment is not kept
+    size_t len;
+    char text[DBC_COMMENT_MAX + 1];
+} dbc_comment_state_t;
+
+static dbc_database_t *s_db = NULL;
+static can_signal_def_t *s_compiled = NULL;
+static volatile bool s_loaded = false;
+static dbc_loader_stats_t s_stats;
+
+static const char *pool_strdup(const char *str, size_t len)
+{
+    if (s_db->pool_used + len + 1 > sizeof(s_db->pool)) {
+        return "";
+    }
+    char *dst = &s_db->pool[s_db->pool_used];
+    memcpy(dst, str, len);
+    dst[len] = '\0';
+    s_db->pool_used += len + 1;
+    return dst;
+}
+
+static inline char *skip_ws(char *p)
+{
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+// Keyword at the start of p followed by whitespace; returns the text after it
+static char *match_keyword(char *p, const char *keyword)
+{
+    size_t len = strlen(keyword);
+    if (strncmp(p, keyword, len) != 0 || (p[len] != ' ' && p[len] != '\t')) {
+        return NULL;
+    }
+    return skip_ws(p + len);
+}
+
+static size_t token_length(const char *p)
+{
+    size_t len = 0;
+    while (p[len] && !isspace((unsigned char)p[len]) && p[len] != ':' && p[len] != ';') len++;
+    return len;
+}
+
+// Linear search, used while parsing (messages are sorted only on activation)
+static dbc_message_t *find_message_unsorted(uint32_t id)
+{
+    static dbc_message_t *last = NULL;
+    if (last && last >= s_db->messages && last < s_db->messages + s_db->message_count && last->id == id) {
+        return last;
+    }
+    for (size_t i = 0; i < s_db->message_count; i++) {
+        if (s_db->messages[i].id == id) {
+            last = &s_db->messages[i];
+            return last;
+        }
+    }
+    return NULL;
+}
+
+static dbc_signal_t *find_signal(dbc_message_t *msg, const char *name, size_t len)
+{
+    for (size_t i = 0; i < msg->signal_count; i++) {
+        dbc_signal_t *sig = &s_db->signals[msg->first_signal + i];
+        if (strncmp(sig->name, name, len) == 0 && sig->name[len] == '\0') {
+            return sig;
+        }
+    }
+    return NULL;
+}
+
+static bool is_torque_field(uint8_t field)
+{
+    return field >= ECU_SIG_TCU_TQ_REQ_NM && field <= ECU_SIG_LIMIT_TQ_NM;
+}
+
+static void bind_signal(dbc_signal_t *sig, ecu_signal_t field)
+{
+    if (sig->def.field == ECU_SIG_NONE) {
+        s_stats.bound_signals++;
+    }
+    sig->def.field = field;
+    if (is_torque_field(field) && strcmp(sig->unit, "%") == 0) {
+        sig->def.flags |= CAN_SIG_FLAG_TORQUE_PCT;
+    } else {
+        sig->def.flags &= ~CAN_SIG_FLAG_TORQUE_PCT;
+    }
+}
+
+// BO_ 640 Motor_1: 8 Motor
+static dbc_message_t *parse_message(char *p)
+{
+    char *end;
+    uint32_t id = strtoul(p, &end, 10);
+    if (end == p) return NULL;
+
+    // Pseudo message holding unassigned signals, and malformed extended IDs
+    if ((id & CAN_DECODER_ID_EXT_FLAG) ? (id & ~CAN_DECODER_ID_EXT_FLAG) > DBC_EXT_ID_MASK
+                                       : id >= CAN_DECODER_STD_ID_COUNT) {
+        return NULL;
+    }
+
+    if (s_db->message_count >= DBC_MAX_MESSAGES) {
+        ESP_LOGW(TAG, "Message capacity (%d) reached, ignoring ID %lu", DBC_MAX_MESSAGES, (unsigned long)id);
+        return NULL;
+    }
+
+    p = skip_ws(end);
+    size_t name_len = token_length(p);
+    dbc_message_t *msg = &s_db->messages[s_db->message_count++];
+    msg->id = id;
+    msg->name = pool_strdup(p, name_len);
+    msg->comment = "";
+    msg->first_signal = (uint16_t)s_db->signal_count;
+    msg->signal_count = 0;
+
+    p = strchr(p + name_len, ':');
+    msg->dlc = p ? (uint8_t)strtoul(p + 1, NULL, 10) : 8;
+
+    s_stats.messages++;
+    return msg;
+}
+
+// SG_ Engine_Speed [M|mX] : 24|16@1+ (0.25,0) [0|16383.75] "rpm" Receiver
+static void parse_signal(char *p, dbc_message_t *msg)
+{
+    if (!msg) return; // Signal of an ignored message
+
+    size_t name_len = token_length(p);
+    char *name = p;
+    p = skip_ws(p + name_len);
+
+    if (*p != ':') {
+        // Multiplexer indicator: "M" is a plain signal, "mX" depends on the multiplexor
+        if (*p == 'm') {
+            s_stats.skipped_signals++;
+            return;
+        }
+        p = strchr(p, ':');
+        if (!p) return;
+    }
+    p++;
+
+    char *end;
+    unsigned long start = strtoul(p, &end, 10);
+    if (*end != '|') return;
+    unsigned long length = strtoul(end + 1, &end, 10);
+    if (*end != '@' || (end[1] != '0' && end[1] != '1') || (end[2] != '+' && end[2] != '-')) return;
+
+    can_signal_def_t def = {
+        .can_id = msg->id,
+        .start_bit = start > 63 ? 0xFF : (uint8_t)start,
+        .length = length > 32 ? 0 : (uint8_t)length,
+        .byte_order = end[1] == '1' ? CAN_BYTE_ORDER_INTEL : CAN_BYTE_ORDER_MOTOROLA,
+        .flags = end[2] == '-' ? CAN_SIG_FLAG_SIGNED : 0,
+        .field = ECU_SIG_NONE,
+        .scale = 1.0f,
+        .offset = 0.0f,
+    };
+
+    p = strchr(end, '(');
+    if (p) {
+        def.scale = strtof(p + 1, &end);
+        if (*end == ',') def.offset = strtof(end + 1, &end);
+    }
+
+    // Reject layouts the decoder cannot extract (over 32 bits, beyond 8 bytes)
+    static const uint8_t full_frame[8] = {0};
+    float probe;
+    if (!can_decoder_extract(&def, full_frame, sizeof(full_frame), &probe)) {
+        s_stats.skipped_signals++;
+        return;
+    }
+
+    if (s_db->signal_count >= DBC_MAX_SIGNALS) {
+        s_stats.skipped_signals++;
+        return;
+    }
+
+    const char *unit = "";
+    char *quote = strchr(end, '"');
+    if (quote) {
+        char *close = strchr(quote + 1, '"');
+        if (close) unit = pool_strdup(quote + 1, (size_t)(close - quote - 1));
+    }
+
+    dbc_signal_t *sig = &s_db->signals[s_db->signal_count++];
+    sig->def = def;
+    sig->name = pool_strdup(name, name_len);
+    sig->unit = unit;
+    msg->signal_count++;
+    s_stats.signals++;
+
+    // Signals named after a dashboard field are bound without an attribute
+    ecu_signal_t field = ecu_signal_from_name(sig->name);
+    if (field != ECU_SIG_NONE) {
+        bind_signal(sig, field);
+    }
+}
+
+// Feed quoted comment text; returns true once the closing quote was seen
+static bool scan_comment(dbc_comment_state_t *state, const char *p)
+{
+    for (; *p; p++) {
+        char c = *p;
+        if (state->escape) {
+            state->escape = false;
+        } else if (c == '\\') {
+            state->escape = true;
+            continue;
+        } else if (c == '"') {
+            state->active = false;
+            if (state->target) {
+                while (state->len > 0 && state->text[state->len - 1] == ' ') state->len--;
+                state->target->comment = pool_strdup(state->text, state->len);
+            }
+            return true;
+        }
+
+        if (c == '\r' || c == '\n' || c == '\t') c = ' ';
+        // Line breaks and indentation collapse to single spaces
+        if (state->target && state->len < DBC_COMMENT_MAX &&
+            !(c == ' ' && (state->len == 0 || state->text[state->len - 1] == ' '))) {
+            state->text[state->len++] = c;
+        }
+    }
+    return false;
+}
+
+// CM_ BO_ 640 "Engine data";  CM_ SG_ 640 Engine_Speed "...";  CM_ "..."
+static void parse_comment(char *p, dbc_comment_state_t *state)
+{
+    memset(state, 0, sizeof(*state));
+
+    char *rest;
+    if ((rest = match_keyword(p, "BO_")) != NULL) {
+        char *end;
+        uint32_t id = strtoul(rest, &end, 10);
+        if (end != rest) state->target = find_message_unsorted(id);
+    }
+
+    char *quote = strchr(p, '"');
+    if (!quote) return;
+    state->active = true;
+    scan_comment(state, quote + 1);
+}
+
+// BA_ "DashField" SG_ 640 Engine_Speed "engine_rpm";
+static void parse_attribute(char *p)
+{
+    static const char prefix[] = "\"" DBC_FIELD_ATTRIBUTE "\"";
+    if (strncmp(p, prefix, sizeof(prefix) - 1) != 0) return;
+
+    p = match_keyword(skip_ws(p + sizeof(prefix) - 1), "SG_");
+    if (!p) return;
+
+    char *end;
+    uint32_t id = strtoul(p, &end, 10);
+    if (end == p) return;
+    dbc_message_t *msg = find_message_unsorted(id);
+    if (!msg) return;
+
+    p = skip_ws(end);
+    size_t name_len = token_length(p);
+    dbc_signal_t *sig = find_signal(msg, p, name_len);
+
+    char *quote = strchr(p + name_len, '"');
+    char *close = quote ? strchr(quote + 1, '"') : NULL;
+    if (!sig || !close) return;
+    *close = '\0';
+
+    ecu_signal_t field = ecu_signal_from_name(quote + 1);
+    if (field == ECU_SIG_NONE) {
+        ESP_LOGW(TAG, "Unknown dashboard field \"%s\" for signal %s", quote + 1, sig->name);
+        return;
+    }
+    bind_signal(sig, field);
+}
+
+static esp_err_t ensure_database(void)
+{
+    if (s_db) return ESP_OK;
+
+    s_db = heap_caps_calloc(1, sizeof(dbc_database_t), MALLOC_CAP_SPIRAM);
+    if (!s_db) {
+        ESP_LOGE(TAG, "Failed to allocate DBC database (%u bytes)", (unsigned)sizeof(dbc_database_t));
+        return ESP_ERR_NO_MEM;
+    }
+    memset(&s_stats, 0, sizeof(s_stats));
+    return ESP_OK;
+}
+
+esp_err_t dbc_loader_load_file(const char *path)
+{
+    if (!path) return ESP_ERR_INVALID_ARG;
+    if (s_loaded) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t ret = ensure_database();
+    if (ret != ESP_OK) return ret;
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        ESP_LOGE(TAG, "Failed to open %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    // Larger stdio buffer: fewer, bigger SD card reads
+    setvbuf(f, NULL, _IOFBF, 4096);
+
+    char line[DBC_LINE_MAX];
+    dbc_message_t *current = NULL;
+    dbc_comment_state_t comment = {0};
+    bool continuation = false;
+    size_t messages_before = s_stats.messages;
+    size_t signals_before = s_stats.signals;
+
+    while (fgets(line, sizeof(line), f)) {
+        size_t len = strlen(line);
+        bool complete = len > 0 && line[len - 1] == '\n';
+
+        if (continuation) {
+            // Tail of an overlong line: only a pending comment needs it
+            if (comment.active) scan_comment(&comment, line);
+        } else {
+            s_stats.lines++;
+            if (!complete && !feof(f)) s_stats.truncated_lines++;
+
+            if (comment.active) {
+                scan_comment(&comment, line);
+            } else {
+                char *p = skip_ws(line);
+                char *rest;
+                if ((rest = match_keyword(p, "BO_")) != NULL) {
+                    current = parse_message(rest);
+                } else if ((rest = match_keyword(p, "SG_")) != NULL) {
+                    parse_signal(rest, current);
+                } else if ((rest = match_keyword(p, "CM_")) != NULL) {
+                    parse_comment(rest, &comment);
+                } else if ((rest = match_keyword(p, "BA_")) != NULL) {
+                    parse_attribute(rest);
+                } else if (*p != '\r' && *p != '\n' && *p != '\0') {
+                    current = NULL; // Any other section ends the signal list
+                }
+            }
+        }
+        continuation = !complete;
+    }
+    fclose(f);
+
+    ESP_LOGI(TAG, "%s: %u messages, %u signals", path,
+             (unsigned)(s_stats.messages - messages_before),
+             (unsigned)(s_stats.signals - signals_before));
+    return ESP_OK;
+}
+
+static bool has_dbc_extension(const char *name)
+{
+    size_t len = strlen(name);
+    return len > 4 && strcasecmp(name + len - 4, ".dbc") == 0;
+}
+
+esp_err_t dbc_loader_load_dir(const char *dir_path)
+{
+    if (!dir_path) return ESP_ERR_INVALID_ARG;
+
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        ESP_LOGW(TAG, "Cannot open %s, no DBC loaded", dir_path);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    int files = 0;
+    struct dirent *entry;
+    char path[300];
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.' || !has_dbc_extension(entry->d_name)) continue;
+
+        snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+        if (dbc_loader_load_file(path) == ESP_OK) {
+            files++;
+        }
+    }
+    closedir(dir);
+
+    if (files == 0) {
+        ESP_LOGI(TAG, "No DBC files in %s, using built-in signals", dir_path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    return dbc_loader_activate();
+}
+
+static int compare_message(const void *a, const void *b)
+{
+    uint32_t ia = ((const dbc_message_t *)a)->id;
+    uint32_t ib = ((const dbc_message_t *)b)->id;
+    return (ia > ib) - (ia < ib);
+}
+
+static int compare_signal_def(const void *a, const void *b)
+{
+    const can_signal_def_t *sa = a;
+    const can_signal_def_t *sb = b;
+    if (sa->can_id != sb->can_id) return (sa->can_id > sb->can_id) - (sa->can_id < sb->can_id);
+    return (int)sa->start_bit - (int)sb->start_bit;
+}
+
+esp_err_t dbc_loader_activate(void)
+{
+    if (s_loaded) return ESP_ERR_INVALID_STATE;
+    if (!s_db || s_db->message_count == 0) return ESP_ERR_NOT_FOUND;
+
+    // Sort messages for lookup. Signal ranges move with their message.
+    qsort(s_db->messages, s_db->message_count, sizeof(dbc_message_t), compare_message);
+    memset(s_db->std_index, 0, sizeof(s_db->std_index));
+    for (size_t i = 0; i < s_db->message_count; i++) {
+        uint32_t id = s_db->messages[i].id;
+        if (!(id & CAN_DECODER_ID_EXT_FLAG)) {
+            s_db->std_index[id] = (uint16_t)(i + 1);
+        }
+    }
+
+    // Fields the DBC binds replace the built-in rows for those fields
+    uint32_t bound_fields = 0;
+    size_t row_count = 0;
+    for (size_t i = 0; i < s_db->signal_count; i++) {
+        uint8_t field = s_db->signals[i].def.field;
+        if (field < ECU_SIG_COUNT) {
+            bound_fields |= 1UL << field;
+            row_count++;
+        }
+    }
+
+    const can_decoder_table_t *builtin = can_decoder_get_active();
+    size_t builtin_count = builtin ? builtin->count : 0;
+    for (size_t i = 0; i < builtin_count; i++) {
+        uint8_t field = builtin->signals[i].field;
+        if (field >= ECU_SIG_COUNT || !(bound_fields & (1UL << field))) row_count++;
+    }
+
+    if (row_count > 0) {
+        s_compiled = heap_caps_malloc(row_count * sizeof(can_signal_def_t), MALLOC_CAP_SPIRAM);
+        if (!s_compiled) return ESP_ERR_NO_MEM;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < s_db->signal_count; i++) {
+        if (s_db->signals[i].def.field < ECU_SIG_COUNT) s_compiled[n++] = s_db->signals[i].def;
+    }
+    for (size_t i = 0; i < builtin_count; i++) {
+        uint8_t field = builtin->signals[i].field;
+        if (field >= ECU_SIG_COUNT || !(bound_fields & (1UL << field))) s_compiled[n++] = builtin->signals[i];
+    }
+    qsort(s_compiled, n, sizeof(can_signal_def_t), compare_signal_def);
+
+    esp_err_t ret = can_decoder_table_build(&s_db->table, s_compiled, n);
+    if (ret != ESP_OK) {
+        heap_caps_free(s_compiled);
+        s_compiled = NULL;
+        return ret;
+    }
+
+    can_decoder_set_active(&s_db->table);
+    s_loaded = true;
+
+    ESP_LOGI(TAG, "DBC active: %u messages, %u signals, %u bound to dashboard fields (%u built-in kept), pool %u/%u bytes",
+             (unsigned)s_db->message_count, (unsigned)s_db->signal_count, (unsigned)s_stats.bound_signals,
+             (unsigned)(n - (size_t)s_stats.bound_signals), (unsigned)s_db->pool_used, (unsigned)sizeof(s_db->pool));
+    if (s_stats.skipped_signals || s_stats.truncated_lines) {
+        ESP_LOGW(TAG, "%u signals skipped (multiplexed, >32 bit or over capacity), %u lines truncated",
+                 (unsigned)s_stats.skipped_signals, (unsigned)s_stats.truncated_lines);
+    }
+    return ESP_OK;
+}
+
+bool dbc_loader_is_loaded(void)
+{
+    return s_loaded;
+}
+
+const dbc_message_t* dbc_find_message(uint32_t id)
+{
+    if (!s_loaded) return NULL;
+
+    if (!(id & CAN_DECODER_ID_EXT_FLAG)) {
+        if (id >= CAN_DECODER_STD_ID_COUNT || s_db->std_index[id] == 0) return NULL;
+        return &s_db->messages[s_db->std_index[id] - 1];
+    }
+
+    size_t lo = 0;
+    size_t hi = s_db->message_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (s_db->messages[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo < s_db->message_count && s_db->messages[lo].id == id) ? &s_db->messages[lo] : NULL;
+}
+
+const dbc_signal_t* dbc_get_signal(size_t index)
+{
+    if (!s_loaded || index >= s_db->signal_count) return NULL;
+    return &s_db->signals[index];
+}
+
+size_t dbc_format_frame(uint32_t id, const uint8_t *data, uint8_t dlc, char *buf, size_t size)
+{
+    if (!buf || size == 0) return 0;
+    buf[0] = '\0';
+
+    const dbc_message_t *msg = dbc_find_message(id);
+    if (!msg || !data) return 0;
+
+    size_t pos = 0;
+    int n = snprintf(buf, size, "%s:", msg->name);
+    if (n > 0) pos = (size_t)n < size ? (size_t)n : size - 1;
+
+    for (size_t i = 0; i < msg->signal_count && pos < size - 1; i++) {
+        const dbc_signal_t *sig = &s_db->signals[msg->first_signal + i];
+        float value;
+        if (!can_decoder_extract(&sig->def, data, dlc, &value)) continue;
+
+        n = snprintf(buf + pos, size - pos, " %s=%.4g%s", sig->name, value, sig->unit);
+        if (n < 0) break;
+        pos += (size_t)n < size - pos ? (size_t)n : size - pos - 1;
+    }
+
+    if (msg->signal_count == 0 && msg->comment[0] && pos < size - 1) {
+        n = snprintf(buf + pos, size - pos, " %s", msg->comment);
+        if (n > 0) pos += (size_t)n < size - pos ? (size_t)n : size - pos - 1;
+    }
+    return pos;
+}
+
+void dbc_loader_get_stats(dbc_loader_stats_t *stats)
+{
+    if (stats) *stats = s_stats;
+}
+
+void dbc_loader_reset(void)
+{
+    s_loaded = false;
+    if (s_db) {
+        can_decoder_table_free(&s_db->table);
+    }
+    heap_caps_free(s_compiled);
+    s_compiled = NULL;
+    heap_caps_free(s_db);
+    s_db = NULL;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
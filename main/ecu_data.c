@@ -7,16 +7,59 @@
 #include "esp_log.h"
 #include "esp_timer.h"
 #include <stdio.h>
+#include <inttypes.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 #include <time.h>
 #include <math.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "freertos/task.h"
 
 static const char *TAG = "ECU_DATA";
 
-// Global ECU data
+// Global ECU data, published with a seqlock: the sequence is odd while the
+// single writer is modifying the struct. Readers copy and retry if it changed.
 static ecu_data_t g_ecu_data = {0};
-static SemaphoreHandle_t ecu_data_mutex = NULL;
+static ecu_data_freshness_t g_ecu_freshness = {0};
+static atomic_uint_least32_t g_ecu_data_seq = 0;
+
+// Reader spins this many times on an in-progress write before sleeping a tick,
+// so a reader that preempted the writer on the same core lets it finish.
+#define ECU_DATA_READ_SPINS 64
+
+// Offsets of the signal fields inside ecu_data_t, indexed by ecu_signal_t
+static const uint16_t ecu_signal_offsets[ECU_SIG_COUNT] = {
+    [ECU_SIG_ENGINE_RPM]     = offsetof(ecu_data_t, engine_rpm),
+    [ECU_SIG_TPS_POSITION]   = offsetof(ecu_data_t, tps_position),
+    [ECU_SIG_ABS_PEDAL_POS]  = offsetof(ecu_data_t, abs_pedal_pos),
+    [ECU_SIG_MAP_KPA]        = offsetof(ecu_data_t, map_kpa),
+    [ECU_SIG_WG_SET_PERCENT] = offsetof(ecu_data_t, wg_set_percent),
+    [ECU_SIG_WG_POS_PERCENT] = offsetof(ecu_data_t, wg_pos_percent),
+    [ECU_SIG_BOV_PERCENT]    = offsetof(ecu_data_t, bov_percent),
+    [ECU_SIG_TCU_TQ_REQ_NM]  = offsetof(ecu_data_t, tcu_tq_req_nm),
+    [ECU_SIG_TCU_TQ_ACT_NM]  = offsetof(ecu_data_t, tcu_tq_act_nm),
+    [ECU_SIG_ENG_TRG_NM]     = offsetof(ecu_data_t, eng_trg_nm),
+    [ECU_SIG_ENG_ACT_NM]     = offsetof(ecu_data_t, eng_act_nm),
+    [ECU_SIG_LIMIT_TQ_NM]    = offsetof(ecu_data_t, limit_tq_nm),
+};
+
+// Signal names, matching the ecu_data_t field names
+static const char *const ecu_signal_names[ECU_SIG_COUNT] = {
+    [ECU_SIG_ENGINE_RPM]     = "engine_rpm",
+    [ECU_SIG_TPS_POSITION]   = "tps_position",
+    [ECU_SIG_ABS_PEDAL_POS]  = "abs_pedal_pos",
+    [ECU_SIG_MAP_KPA]        = "map_kpa",
+    [ECU_SIG_WG_SET_PERCENT] = "wg_set_percent",
+    [ECU_SIG_WG_POS_PERCENT] = "wg_pos_percent",
+    [ECU_SIG_BOV_PERCENT]    = "bov_percent",
+    [ECU_SIG_TCU_TQ_REQ_NM]  = "tcu_tq_req_nm",
+    [ECU_SIG_TCU_TQ_ACT_NM]  = "tcu_tq_act_nm",
+    [ECU_SIG_ENG_TRG_NM]     = "eng_trg_nm",
+    [ECU_SIG_ENG_ACT_NM]     = "eng_act_nm",
+    [ECU_SIG_LIMIT_TQ_NM]    = "limit_tq_nm",
+};
 
 // System settings
 static system_settings_t g_system_settings = {
@@ -35,13 +78,11 @@ static bool data_stream_initialized = false;
 // Initialize ECU data system
 void ecu_data_init(void)
 {
-    if (ecu_data_mutex == NULL) {
-        ecu_data_mutex = xSemaphoreCreateMutex();
-    }
-
     // Initialize ECU data with default values
-    memset(&g_ecu_data, 0, sizeof(ecu_data_t));
-    g_ecu_data.timestamp = esp_timer_get_time() / 1000; // milliseconds
+    ecu_data_t *data = ecu_data_write_begin();
+    memset(data, 0, sizeof(ecu_data_t));
+    memset(&g_ecu_freshness, 0, sizeof(g_ecu_freshness));
+    ecu_data_write_end();
 
     // Initialize data stream
     memset(data_stream, 0, sizeof(data_stream));
@@ -50,34 +91,158 @@ void ecu_data_init(void)
     ESP_LOGI(TAG, "ECU data system initialized");
 }
 
-// Update ECU data (thread-safe)
+// Start modifying the published data. Single writer only (the CAN task).
+ecu_data_t* ecu_data_write_begin(void)
+{
+    uint32_t seq = atomic_load_explicit(&g_ecu_data_seq, memory_order_relaxed);
+    atomic_store_explicit(&g_ecu_data_seq, seq + 1, memory_order_relaxed);
+    // Order the odd sequence before any of the data stores
+    atomic_thread_fence(memory_order_release);
+    return &g_ecu_data;
+}
+
+// Publish the changes made since ecu_data_write_begin()
+void ecu_data_write_end(void)
+{
+    g_ecu_data.timestamp = esp_timer_get_time() / 1000; // milliseconds
+    uint32_t seq = atomic_load_explicit(&g_ecu_data_seq, memory_order_relaxed);
+    atomic_store_explicit(&g_ecu_data_seq, seq + 1, memory_order_release);
+}
+
+// Replace the whole data set (writer side)
 void ecu_data_update(ecu_data_t *data)
 {
-    if (!data || !ecu_data_mutex) return;
+    if (!data) return;
+
+    ecu_data_t *target = ecu_data_write_begin();
+    memcpy(target, data, sizeof(ecu_data_t));
+    ecu_data_mark_updated((1UL << ECU_SIG_COUNT) - 1, esp_timer_get_time());
+    ecu_data_write_end();
+}
 
-    if (xSemaphoreTake(ecu_data_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        memcpy(&g_ecu_data, data, sizeof(ecu_data_t));
-        g_ecu_data.timestamp = esp_timer_get_time() / 1000; // milliseconds
+// Writer-side pointer, only valid between ecu_data_write_begin() and ecu_data_write_end()
+ecu_data_t* ecu_data_get(void)
+{
+    return &g_ecu_data;
+}
 
-        xSemaphoreGive(ecu_data_mutex);
+// Record signal writes (writer side, between ecu_data_write_begin/end)
+void ecu_data_mark_updated(uint32_t mask, int64_t timestamp_us)
+{
+    for (int i = 0; mask && i < ECU_SIG_COUNT; i++, mask >>= 1) {
+        if (!(mask & 1)) continue;
+
+        int64_t last = g_ecu_freshness.last_update_us[i];
+        if (last > 0 && timestamp_us > last) {
+            // Average the intervals, not their reciprocals: one short gap (two frames of a
+            // batch) would otherwise pull the rate far up
+            float period = (float)(timestamp_us - last);
+            float avg = g_ecu_freshness.period_us[i];
+            avg = avg > 0.0f ? avg + ECU_DATA_RATE_EWMA_ALPHA * (period - avg) : period;
+            g_ecu_freshness.period_us[i] = avg;
+            g_ecu_freshness.rate_hz[i] = 1e6f / avg;
+        }
+        g_ecu_freshness.last_update_us[i] = timestamp_us;
+        g_ecu_freshness.update_count[i]++;
     }
 }
 
-// Get current ECU data (thread-safe)
-ecu_data_t* ecu_data_get(void)
+// Get a consistent copy of the current ECU data and/or freshness without locking
+void ecu_data_get_snapshot(ecu_data_t *data, ecu_data_freshness_t *freshness)
 {
-    return &g_ecu_data; // For now, return direct pointer (should be protected by mutex in caller)
+    if (!data && !freshness) return;
+
+    uint32_t spins = 0;
+    uint32_t seq_before, seq_after;
+    do {
+        seq_before = atomic_load_explicit(&g_ecu_data_seq, memory_order_acquire);
+        if (seq_before & 1) {
+            // Write in progress
+            if (++spins >= ECU_DATA_READ_SPINS) {
+                vTaskDelay(1);
+                spins = 0;
+            }
+            seq_after = seq_before + 1;
+            continue;
+        }
+        if (data) memcpy(data, &g_ecu_data, sizeof(ecu_data_t));
+        if (freshness) memcpy(freshness, &g_ecu_freshness, sizeof(ecu_data_freshness_t));
+        // Order the data loads before the second sequence load
+        atomic_thread_fence(memory_order_acquire);
+        seq_after = atomic_load_explicit(&g_ecu_data_seq, memory_order_relaxed);
+    } while (seq_before != seq_after);
 }
 
-// Get a thread-safe copy of the current ECU data
 void ecu_data_get_copy(ecu_data_t *data_copy)
 {
-    if (!data_copy || !ecu_data_mutex) return;
+    ecu_data_get_snapshot(data_copy, NULL);
+}
 
-    if (xSemaphoreTake(ecu_data_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        memcpy(data_copy, &g_ecu_data, sizeof(ecu_data_t));
-        xSemaphoreGive(ecu_data_mutex);
+uint32_t ecu_data_stale_mask(const ecu_data_freshness_t *freshness, int64_t now_us)
+{
+    if (!freshness) return (1UL << ECU_SIG_COUNT) - 1;
+
+    uint32_t stale = 0;
+    for (int i = 0; i < ECU_SIG_COUNT; i++) {
+        int64_t last = freshness->last_update_us[i];
+        if (last == 0) {
+            stale |= 1UL << i;
+            continue;
+        }
+        int64_t timeout_us = (int64_t)ECU_DATA_STALE_MIN_MS * 1000;
+        if (freshness->period_us[i] > 0.0f) {
+            int64_t periods_us = (int64_t)(ECU_DATA_STALE_PERIODS * freshness->period_us[i]);
+            if (periods_us > timeout_us) timeout_us = periods_us;
+        }
+        if (now_us - last > timeout_us) {
+            stale |= 1UL << i;
+        }
+    }
+    return stale;
+}
+
+uint32_t ecu_data_updated_mask(const ecu_data_freshness_t *before, const ecu_data_freshness_t *after)
+{
+    if (!after) return 0;
+    if (!before) return (1UL << ECU_SIG_COUNT) - 1;
+
+    uint32_t updated = 0;
+    for (int i = 0; i < ECU_SIG_COUNT; i++) {
+        if (before->update_count[i] != after->update_count[i]) {
+            updated |= 1UL << i;
+        }
+    }
+    return updated;
+}
+
+// Changes every time the writer publishes new data
+uint32_t ecu_data_get_sequence(void)
+{
+    return atomic_load_explicit(&g_ecu_data_seq, memory_order_acquire) & ~1U;
+}
+
+// Get a pointer to a signal field inside an ECU data struct
+float* ecu_data_field(ecu_data_t *data, ecu_signal_t signal)
+{
+    if (!data || signal >= ECU_SIG_COUNT) return NULL;
+    return (float *)((uint8_t *)data + ecu_signal_offsets[signal]);
+}
+
+const char* ecu_signal_name(ecu_signal_t signal)
+{
+    return signal < ECU_SIG_COUNT ? ecu_signal_names[signal] : "unknown";
+}
+
+ecu_signal_t ecu_signal_from_name(const char *name)
+{
+    if (!name) return ECU_SIG_NONE;
+
+    for (int i = 0; i < ECU_SIG_COUNT; i++) {
+        if (strcasecmp(name, ecu_signal_names[i]) == 0) {
+            return (ecu_signal_t)i;
+        }
     }
+    return ECU_SIG_NONE;
 }
 
 // Convert ECU data to JSON string
@@ -185,7 +350,7 @@ char* data_stream_to_json(void)
             default: type_str = "info"; break;
         }
 
-        ptr += sprintf(ptr, "{\"timestamp\":%llu,\"message\":\"%s\",\"type\":\"%s\"}",
+        ptr += sprintf(ptr, "{\"timestamp\":%" PRIu64 ",\"message\":\"%s\",\"type\":\"%s\"}",
                        data_stream[index].timestamp,
                        data_stream[index].message,
                        type_str);
@@ -216,7 +381,7 @@ char* data_stream_to_string(void)
 
         if (data_stream[index].timestamp == 0) continue;
 
-        ptr += sprintf(ptr, "[%llu] %s\n",
+        ptr += sprintf(ptr, "[%" PRIu64 "] %s\n",
                        data_stream[index].timestamp,
                        data_stream[index].message);
     }
@@ -0,0 +1,206 @@
+/*
+ * ECU live data stream encoding
+ * Compact binary frames with per client delta encoding, see include/ecu_stream.h.
+ * Kept free of network dependencies so it also builds on the host.
+ */
+
+#include "include/ecu_stream.h"
+#include <string.h>
+#include <math.h>
+
+// Quantization step per signal: display precision of the gauges
+static const float ecu_stream_steps[ECU_SIG_COUNT] = {
+    [ECU_SIG_ENGINE_RPM]     = 1.0f,
+    [ECU_SIG_TPS_POSITION]   = 0.1f,
+    [ECU_SIG_ABS_PEDAL_POS]  = 0.1f,
+    [ECU_SIG_MAP_KPA]        = 0.1f,
+    [ECU_SIG_WG_SET_PERCENT] = 0.1f,
+    [ECU_SIG_WG_POS_PERCENT] = 0.1f,
+    [ECU_SIG_BOV_PERCENT]    = 0.1f,
+    [ECU_SIG_TCU_TQ_REQ_NM]  = 0.1f,
+    [ECU_SIG_TCU_TQ_ACT_NM]  = 0.1f,
+    [ECU_SIG_ENG_TRG_NM]     = 0.1f,
+    [ECU_SIG_ENG_ACT_NM]     = 0.1f,
+    [ECU_SIG_LIMIT_TQ_NM]    = 0.1f,
+};
+
+// 1 / step, so quantizing is a multiplication
+static const float ecu_stream_scales[ECU_SIG_COUNT] = {
+    [ECU_SIG_ENGINE_RPM]     = 1.0f,
+    [ECU_SIG_TPS_POSITION]   = 10.0f,
+    [ECU_SIG_ABS_PEDAL_POS]  = 10.0f,
+    [ECU_SIG_MAP_KPA]        = 10.0f,
+    [ECU_SIG_WG_SET_PERCENT] = 10.0f,
+    [ECU_SIG_WG_POS_PERCENT] = 10.0f,
+    [ECU_SIG_BOV_PERCENT]    = 10.0f,
+    [ECU_SIG_TCU_TQ_REQ_NM]  = 10.0f,
+    [ECU_SIG_TCU_TQ_ACT_NM]  = 10.0f,
+    [ECU_SIG_ENG_TRG_NM]     = 10.0f,
+    [ECU_SIG_ENG_ACT_NM]     = 10.0f,
+    [ECU_SIG_LIMIT_TQ_NM]    = 10.0f,
+};
+
+float ecu_stream_signal_step(ecu_signal_t signal)
+{
+    return (unsigned)signal < ECU_SIG_COUNT ? ecu_stream_steps[signal] : 1.0f;
+}
+
+static inline void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+// Zigzag varint: small changes in either direction take one byte
+static size_t put_varint(uint8_t *p, int32_t value)
+{
+    uint32_t v = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static size_t get_varint(const uint8_t *p, size_t len, int32_t *value)
+{
+    uint32_t v = 0;
+    for (size_t n = 0; n < len && n < 5; n++) {
+        v |= (uint32_t)(p[n] & 0x7F) << (7 * n);
+        if (!(p[n] & 0x80)) {
+            *value = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+// Multiply and round half away from zero by hand: no division or libm call per signal
+static int32_t quantize(float value, ecu_signal_t signal)
+{
+    float q = value * ecu_stream_scales[signal];
+    if (!(q < 1e9f)) return isnan(q) ? 0 : 1000000000;
+    if (q < -1e9f) return -1000000000;
+    return (int32_t)(q >= 0.0f ? q + 0.5f : q - 0.5f);
+}
+
+void ecu_stream_encoder_reset(ecu_stream_encoder_t *encoder)
+{
+    if (encoder) {
+        memset(encoder, 0, sizeof(*encoder));
+    }
+}
+
+size_t ecu_stream_encode(ecu_stream_encoder_t *encoder, const ecu_data_t *data, uint16_t stale_mask,
+                         bool keyframe, uint8_t *buf, size_t size)
+{
+    if (!encoder || !data || !buf || size < ECU_STREAM_MAX_FRAME_SIZE) {
+        return 0;
+    }
+    keyframe = keyframe || !encoder->keyframe_sent;
+
+    size_t len = ECU_STREAM_HEADER_SIZE;
+    uint8_t count = 0;
+    for (int i = 0; i < ECU_SIG_COUNT; i++) {
+        int32_t q = quantize(*ecu_data_field((ecu_data_t *)data, (ecu_signal_t)i), (ecu_signal_t)i);
+        int32_t delta = q - encoder->sent[i];
+        if (!keyframe && delta == 0) {
+            continue;
+        }
+        buf[len++] = (uint8_t)i;
+        len += put_varint(&buf[len], keyframe ? q : delta);
+        encoder->sent[i] = q;
+        count++;
+    }
+    if (count == 0 && stale_mask == encoder->stale_mask) {
+        return 0;
+    }
+
+    encoder->sequence++;
+    encoder->stale_mask = stale_mask;
+    encoder->keyframe_sent = true;
+
+    buf[0] = ECU_STREAM_VERSION;
+    buf[1] = keyframe ? ECU_STREAM_FLAG_KEYFRAME : 0;
+    put_u16(&buf[2], encoder->sequence);
+    put_u32(&buf[4], (uint32_t)data->timestamp);
+    put_u16(&buf[8], stale_mask);
+    buf[10] = count;
+    return len;
+}
+
+void ecu_stream_decoder_reset(ecu_stream_decoder_t *decoder)
+{
+    if (decoder) {
+        memset(decoder, 0, sizeof(*decoder));
+    }
+}
+
+esp_err_t ecu_stream_decode(ecu_stream_decoder_t *decoder, const uint8_t *frame, size_t len)
+{
+    if (!decoder || !frame) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len < ECU_STREAM_HEADER_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (frame[0] != ECU_STREAM_VERSION) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    bool keyframe = frame[1] & ECU_STREAM_FLAG_KEYFRAME;
+    uint16_t sequence = get_u16(&frame[2]);
+    if (!keyframe && (!decoder->synced || sequence != (uint16_t)(decoder->sequence + 1))) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Validate before applying so a malformed frame leaves the state untouched
+    int32_t values[ECU_SIG_COUNT];
+    memcpy(values, decoder->value, sizeof(values));
+    size_t pos = ECU_STREAM_HEADER_SIZE;
+    for (uint8_t n = 0; n < frame[10]; n++) {
+        if (pos >= len || frame[pos] >= ECU_SIG_COUNT) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        uint8_t signal = frame[pos++];
+        int32_t value;
+        size_t used = get_varint(&frame[pos], len - pos, &value);
+        if (used == 0) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        pos += used;
+        values[signal] = keyframe ? value : values[signal] + value;
+    }
+
+    memcpy(decoder->value, values, sizeof(values));
+    decoder->sequence = sequence;
+    decoder->timestamp_ms = get_u32(&frame[4]);
+    decoder->stale_mask = get_u16(&frame[8]);
+    decoder->synced = true;
+    return ESP_OK;
+}
+
+float ecu_stream_decoder_value(const ecu_stream_decoder_t *decoder, ecu_signal_t signal)
+{
+    if (!decoder || (unsigned)signal >= ECU_SIG_COUNT) {
+        return 0.0f;
+    }
+    return decoder->value[signal] * ecu_stream_steps[signal];
+}
@@ -0,0 +1,87 @@
+#ifndef CAN_DECODER_H
+#define CAN_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "include/ecu_data.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of distinct standard (11-bit) CAN identifiers, size of the direct lookup index.
+#define CAN_DECODER_STD_ID_COUNT   2048
+
+// Set in an identifier to mark a 29-bit extended frame (same convention as SocketCAN).
+#define CAN_DECODER_ID_EXT_FLAG    0x80000000U
+
+// Signal flags
+#define CAN_SIG_FLAG_SIGNED        0x01  // Raw value is two's complement
+#define CAN_SIG_FLAG_TORQUE_PCT    0x02  // Physical value is % of max torque, stored in Nm
+
+// Bit numbering follows the DBC convention.
+typedef enum {
+    CAN_BYTE_ORDER_INTEL = 0,     // Little endian, start bit is the LSB
+    CAN_BYTE_ORDER_MOTOROLA = 1,  // Big endian, start bit is the MSB
+} can_byte_order_t;
+
+// One signal inside a CAN frame: physical = raw * scale + offset
+typedef struct {
+    uint32_t can_id;      // Identifier, CAN_DECODER_ID_EXT_FLAG set for 29-bit frames
+    uint8_t start_bit;    // DBC start bit (0..63)
+    uint8_t length;       // Length in bits (1..32)
+    uint8_t byte_order;   // can_byte_order_t
+    uint8_t flags;        // CAN_SIG_FLAG_*
+    uint8_t field;        // Target ecu_signal_t, ECU_SIG_NONE if not stored
+    float scale;
+    float offset;
+} can_signal_def_t;
+
+// Where a signal sits in the 64-bit frame word, worked out once when the table is built
+typedef struct {
+    uint8_t shift;        // Right shift of the LSB (Intel: little endian word, Motorola: big endian)
+    uint8_t min_dlc;      // Frames shorter than this do not carry the signal
+} can_signal_layout_t;
+
+// Compiled signal table with O(1) lookup for 11-bit identifiers.
+// Extended identifiers are looked up by binary search over the sorted signals.
+typedef struct {
+    const can_signal_def_t *signals;  // Sorted by can_id
+    can_signal_layout_t *layouts;     // One per signal, owned by the table
+    size_t count;
+    uint16_t std_index[CAN_DECODER_STD_ID_COUNT]; // 1-based index of the first signal, 0 = not decoded
+} can_decoder_table_t;
+
+// Build the lookup index for a signal array sorted by can_id. The table must be zeroed or
+// freed before. The signal array must outlive the table.
+esp_err_t can_decoder_table_build(can_decoder_table_t *table, const can_signal_def_t *signals, size_t count);
+
+// Release what can_decoder_table_build() allocated. The table must not be active.
+void can_decoder_table_free(can_decoder_table_t *table);
+
+// Make a table the one used by can_decoder_decode(). Safe to call while decoding.
+void can_decoder_set_active(const can_decoder_table_t *table);
+const can_decoder_table_t* can_decoder_get_active(void);
+
+// Whether the active table has signals for this identifier. Lets callers skip frames of
+// other identifiers before touching the ECU data.
+bool can_decoder_has_id(uint32_t id);
+
+// Decode one frame into the ECU data struct. A signal that does not fit in dlc bytes is
+// skipped (its field keeps the previous value) rather than decoded from padding.
+// Returns a bitmask (1 << ecu_signal_t) of the fields that were written.
+uint32_t can_decoder_decode(uint32_t id, const uint8_t *data, uint8_t dlc, ecu_data_t *ecu_data);
+
+// Extract the physical value of a single signal (no torque conversion).
+// Returns false if the frame is too short to contain the signal.
+bool can_decoder_extract(const can_signal_def_t *signal, const uint8_t *data, uint8_t dlc, float *value);
+
+// Maximum torque used for CAN_SIG_FLAG_TORQUE_PCT signals.
+void can_decoder_set_max_torque(float max_torque_nm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAN_DECODER_H
@@ -0,0 +1,66 @@
+#ifndef CAN_FANOUT_H
+#define CAN_FANOUT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "include/can_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frame consumers that can subscribe (sniffer, logger, network streamer, ...)
+#define CAN_FANOUT_MAX_SUBSCRIBERS  6
+
+// Subscription: a bounded single-producer/single-consumer ring owned by one consumer
+typedef struct can_subscriber can_subscriber_t;
+
+// Per subscriber counters
+typedef struct {
+    const char *name;
+    uint32_t delivered;     // Frames put into the ring
+    uint32_t dropped;       // Frames lost because the ring was full
+    uint32_t queued;        // Frames waiting to be received
+    uint32_t capacity;
+    bool active;
+} can_fanout_stats_t;
+
+// Register a consumer. capacity is rounded up to a power of two.
+// Safe to call while frames are being published.
+esp_err_t can_fanout_subscribe(const char *name, size_t capacity, can_subscriber_t **subscriber);
+
+// Paused subscribers get no frames and count no drops
+void can_fanout_set_active(can_subscriber_t *subscriber, bool active);
+
+// Whether the subscriber needs every identifier on the bus (the default), or only the ones
+// the dashboard decodes. The acceptance filter stays open while an active subscriber needs all.
+void can_fanout_set_all_ids(can_subscriber_t *subscriber, bool all_ids);
+
+// Bit i set if subscriber i (in subscription order) is active
+uint32_t can_fanout_active_mask(void);
+
+// Bit i set if subscriber i is active and needs every identifier
+uint32_t can_fanout_all_ids_mask(void);
+
+// Copy frames to every active subscriber. Called by the CAN task only; never blocks:
+// a subscriber whose ring is full loses the frames (counted in its drop counter).
+void can_fanout_publish(const can_frame_t *frames, size_t count);
+
+// Take up to max_frames queued frames, oldest first. Only the subscriber's owner calls this.
+size_t can_fanout_receive(can_subscriber_t *subscriber, can_frame_t *frames, size_t max_frames);
+
+// Forget the queued frames (consumer side)
+void can_fanout_flush(can_subscriber_t *subscriber);
+
+void can_fanout_get_subscriber_stats(can_subscriber_t *subscriber, can_fanout_stats_t *stats);
+
+// Counters of all subscribers, returns the number written
+size_t can_fanout_get_stats(can_fanout_stats_t *stats, size_t max_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAN_FANOUT_H
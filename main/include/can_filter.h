@@ -0,0 +1,87 @@
+#ifndef CAN_FILTER_H
+#define CAN_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "include/can_frame.h"
+#include "include/can_decoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// TWAI acceptance filter planning: the code/mask that lets the decoded identifiers through
+// while rejecting as much of the remaining bus traffic as possible.
+//
+// The controller has one 32 bit acceptance code and mask (mask bit set = don't care),
+// used as one filter or as two. Identifier bits in the code:
+//   single  11-bit: bits 31..21      29-bit: bits 31..3
+//   dual    11-bit: filter 1 bits 31..21, filter 2 bits 15..5
+//           29-bit: filter 1 bits 31..16, filter 2 bits 15..0 (ID28..13 only)
+// Plans never compare RTR or data bits. In dual mode bits 3..0 also hold data bits of
+// 11-bit frames for filter 1, so plans leave them don't care.
+
+#define CAN_FILTER_MAX_IDS          64      // Wanted identifiers per plan
+#define CAN_FILTER_EXHAUSTIVE_MAX   10      // Up to this many, every dual split is tried
+#define CAN_FILTER_TRAFFIC_SLOTS    256     // Identifiers the traffic counter tells apart
+
+// Observed frames per identifier, the cost model of the planner
+typedef struct {
+    uint32_t id;            // CAN_DECODER_ID_EXT_FLAG set for 29-bit frames
+    uint32_t count;
+} can_filter_id_count_t;
+
+typedef struct {
+    bool accept_all;
+    bool single_filter;
+    uint32_t acceptance_code;
+    uint32_t acceptance_mask;
+    uint32_t traffic_frames;    // Frames in the traffic the plan was rated on, 0: not rated
+    float accepted_fraction;    // Of that traffic, passed by the filter (0 when not rated)
+    float unwanted_fraction;    // Passed although no identifier wants it (0 when not rated)
+} can_filter_plan_t;
+
+// Identifier counter fed by the CAN task while the filter accepts everything
+typedef struct {
+    can_filter_id_count_t slots[CAN_FILTER_TRAFFIC_SLOTS];  // id 0 with count 0 = free
+    uint32_t frames;
+    uint32_t overflow;      // Frames of identifiers that found no free slot
+} can_filter_traffic_t;
+
+// Whether a code/mask passes a frame with this identifier (identifier bits only)
+bool can_filter_accepts(uint32_t code, uint32_t mask, bool single_filter, uint32_t id);
+
+// Best single or dual filter for the wanted identifiers, rated on traffic (may be empty:
+// the plan then only minimises the identifier space it lets through). No wanted
+// identifiers gives an accept-all plan.
+esp_err_t can_filter_plan(const uint32_t *wanted, size_t wanted_count,
+                          const can_filter_id_count_t *traffic, size_t traffic_count,
+                          can_filter_plan_t *plan);
+
+// Accept everything (a consumer wants every frame), rated on traffic
+void can_filter_plan_accept_all(const can_filter_id_count_t *traffic, size_t traffic_count, can_filter_plan_t *plan);
+
+// The filter the CAN task installs: accept-all while all_ids_consumers is non-zero (a raw
+// frame consumer needs every identifier, can_fanout_all_ids_mask()), or when the table
+// decodes nothing or too many identifiers to filter; the plan for the decoded identifiers
+// otherwise. Returns the number of decoded identifiers (CAN_FILTER_MAX_IDS + 1: too many).
+size_t can_filter_plan_for_table(const can_decoder_table_t *table, uint32_t all_ids_consumers,
+                                 const can_filter_id_count_t *traffic, size_t traffic_count,
+                                 can_filter_plan_t *plan);
+
+// Identifiers with a signal stored in the ECU data, sorted and unique. Returns the count,
+// or max + 1 if there are more than max.
+size_t can_filter_wanted_ids(const can_decoder_table_t *table, uint32_t *ids, size_t max);
+
+void can_filter_traffic_reset(can_filter_traffic_t *traffic);
+void can_filter_traffic_add(can_filter_traffic_t *traffic, const can_frame_t *frames, size_t count);
+// Compact copy of the used slots, returns the count
+size_t can_filter_traffic_get(const can_filter_traffic_t *traffic, can_filter_id_count_t *out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAN_FILTER_H
@@ -0,0 +1,26 @@
+#ifndef CAN_FRAME_H
+#define CAN_FRAME_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frame flags
+#define CAN_FRAME_FLAG_RTR   0x01  // Remote transmission request, no data
+
+// Received CAN frame, independent of the driver that delivered it
+typedef struct {
+    int64_t timestamp_us;   // esp_timer time at which the frame was taken from the driver
+    uint32_t id;            // CAN_DECODER_ID_EXT_FLAG set for 29-bit frames
+    uint8_t dlc;
+    uint8_t flags;          // CAN_FRAME_FLAG_*
+    uint8_t data[8];
+} can_frame_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAN_FRAME_H
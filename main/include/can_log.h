@@ -0,0 +1,100 @@
+#ifndef CAN_LOG_H
+#define CAN_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "include/can_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Binary CAN trace files, an array of 24 byte records (little endian):
+//   i64 timestamp_us   esp_timer time the frame was received
+//   u32 id             CAN_DECODER_ID_EXT_FLAG set for 29-bit frames, CAN_LOG_ID_* markers
+//   u8  dlc
+//   u8  flags          CAN_FRAME_FLAG_*
+//   u8  data[8]
+//   u16 lost           Frames the logger lost right before this one (saturates)
+// Record 0 is the file header (can_log_header_t), followed by padding records up to
+// CAN_LOG_ALIGN. Every write is a multiple of CAN_LOG_ALIGN bytes, so writes stay
+// sector aligned; a partially filled block is completed with padding records.
+// Files are pre-allocated at their maximum size (sd_log_file.h) and truncated when closed.
+// The header is rewritten on every sync with the bytes written so far: after a power loss
+// readers stop at data_bytes, the rest of the file is stale card content.
+// Files are named <dir>/SSSSFFFF.CAN: session (one per boot) and file number in it.
+#define CAN_LOG_RECORD_SIZE     24
+#define CAN_LOG_ALIGN           1536                    // Multiple of the 512 byte sector and the record
+#define CAN_LOG_BLOCK_SIZE      (64 * CAN_LOG_ALIGN)    // One ping-pong buffer, 4096 records
+#define CAN_LOG_VERSION         2
+
+#define CAN_LOG_ID_PAD          0xFFFFFFFFU             // Padding record, skipped by readers
+
+#define CAN_LOG_DEFAULT_DIR     "/sdcard/logs"
+
+typedef struct {
+    char magic[4];          // "CLOG"
+    uint16_t version;       // CAN_LOG_VERSION
+    uint16_t record_size;   // CAN_LOG_RECORD_SIZE
+    uint16_t session;
+    uint16_t file_index;
+    uint32_t data_bytes;    // Valid bytes from the start of the file as of the last sync
+    int64_t start_us;       // esp_timer time the file was created
+} can_log_header_t;
+
+typedef struct {
+    const char *dir;            // Directory on the mounted card, created if missing
+    uint32_t max_file_bytes;    // Pre-allocated file size; a new file starts when it is full
+    uint32_t max_file_s;        // or the file is this old (0 = no time limit)
+    uint32_t sync_ms;           // Write out the partial block and fsync at least this often
+    bool all_ids;               // Log identifiers nothing decodes; keeps the acceptance filter open
+} can_log_config_t;
+
+typedef struct {
+    bool running;
+    uint32_t session;
+    uint32_t files;             // Files created this session
+    uint32_t files_fragmented;  // Files that could not be pre-allocated and grow per write
+    uint32_t frames_logged;     // Frames in blocks handed to the writer
+    uint32_t frames_dropped;    // Frames lost: logger queue full or a block failed to write
+    uint32_t buffer_waits;      // Drain passes that found both buffers waiting for the writer
+    uint32_t blocks_written;
+    uint64_t bytes_written;
+    uint32_t write_errors;
+    uint32_t write_avg_us;      // Time per block write
+    uint32_t write_max_us;
+    uint32_t sync_max_us;       // Time per header update and fsync
+    uint32_t create_max_us;     // Time to create and pre-allocate a file
+    char file[40];              // Current file, empty if none is open
+} can_log_stats_t;
+
+// Defaults from Kconfig, logging to dir
+void can_log_default_config(can_log_config_t *config, const char *dir);
+
+// Subscribe to the CAN frame fan-out, allocate the ping-pong buffers (PSRAM if available)
+// and start the drain and writer tasks. The CAN task is never blocked: frames the logger
+// cannot take are dropped from its fan-out queue and counted.
+esp_err_t can_log_start(const can_log_config_t *config);
+
+// Write out what was received, close the file and stop both tasks. Blocks until done.
+esp_err_t can_log_stop(void);
+
+void can_log_get_stats(can_log_stats_t *stats);
+
+// Record access for readers of trace files. Returns false for padding records.
+bool can_log_decode_record(const uint8_t *record, can_frame_t *frame, uint16_t *lost);
+
+// Check record 0 of a file
+esp_err_t can_log_decode_header(const uint8_t *record, can_log_header_t *header);
+
+// Session and file number of a trace file name (SSSSFFFF.CAN, no directory).
+// False for anything else, so it also validates names taken from requests.
+bool can_log_parse_name(const char *name, uint32_t *session, uint32_t *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAN_LOG_H
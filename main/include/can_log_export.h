@@ -0,0 +1,71 @@
+#ifndef CAN_LOG_EXPORT_H
+#define CAN_LOG_EXPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "include/can_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Reading trace files back for download: the raw file (with byte ranges) or CSV rows
+// converted on the fly. The caller supplies the output buffer and sends each piece as
+// it comes, so the file is never held in RAM.
+
+#define CAN_LOG_EXPORT_CSV_ROW_MAX  72      // Longest CSV row, the output buffer must hold one
+
+typedef enum {
+    CAN_LOG_EXPORT_RAW,
+    CAN_LOG_EXPORT_CSV,     // timestamp_us,id,dlc,flags,lost,d0,...,d7; 29-bit IDs have 8 hex digits
+} can_log_export_format_t;
+
+typedef struct {
+    int fd;
+    can_log_export_format_t format;
+    uint32_t length;            // Valid bytes: data_bytes of the header, or the file size
+    uint32_t pos;               // Next file byte to read
+    uint32_t end;               // Stop before this file byte
+    bool csv_columns_sent;
+    uint16_t record_count;      // CSV: records in the read buffer
+    uint16_t record_next;       // CSV: next record to convert
+    uint8_t records[CAN_LOG_ALIGN];
+} can_log_export_t;
+
+typedef struct {
+    char name[13];              // SSSSFFFF.CAN
+    uint16_t session;
+    uint16_t index;
+    uint32_t bytes;             // Valid bytes, see can_log_export_t.length
+    int64_t start_us;           // esp_timer time the file was created, 0 if the header is unreadable
+} can_log_file_info_t;
+
+// Open a trace file. Raw export covers the whole valid length until a range is set.
+// ESP_ERR_NOT_FOUND if the file does not exist; CSV needs a valid header
+// (ESP_ERR_NOT_SUPPORTED otherwise).
+esp_err_t can_log_export_open(can_log_export_t *exp, const char *path, can_log_export_format_t format);
+
+// Raw export of bytes start..end (inclusive) only
+esp_err_t can_log_export_set_range(can_log_export_t *exp, uint32_t start, uint32_t end);
+
+// Fill buf with the next piece of the export; *len is 0 at the end
+esp_err_t can_log_export_read(can_log_export_t *exp, char *buf, size_t size, size_t *len);
+
+void can_log_export_close(can_log_export_t *exp);
+
+// HTTP Range header value ("bytes=a-b", "bytes=a-", "bytes=-n") for a file of length bytes.
+// ESP_ERR_INVALID_SIZE if it cannot be satisfied, ESP_ERR_NOT_SUPPORTED for other forms
+// (several ranges, other units), which are answered with the whole file.
+esp_err_t can_log_export_parse_range(const char *value, uint32_t length, uint32_t *start, uint32_t *end);
+
+// Trace files in dir, sorted by session and file number. Returns the number found,
+// at most max.
+size_t can_log_list_files(const char *dir, can_log_file_info_t *files, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAN_LOG_EXPORT_H
@@ -2,13 +2,20 @@
 #define CAN_PARSER_H
 
 #include "driver/twai.h"
+#include "include/can_frame.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Build the built-in signal table and make it the active decoder table.
+// Must be called before the first parse_can_message().
+esp_err_t can_parser_init(void);
+
 // Function to parse a received CAN message and update the ECU data structure.
 void parse_can_message(const twai_message_t* message);
+// Returns the mask (1 << ecu_signal_t) of the signals the frame updated.
+uint32_t parse_can_frame(const can_frame_t* frame);
 
 // Function to set the configurable maximum torque value for calculations.
 void can_parser_set_max_torque(float max_torque);
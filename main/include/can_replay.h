@@ -0,0 +1,96 @@
+#ifndef CAN_REPLAY_H
+#define CAN_REPLAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "esp_err.h"
+#include "include/can_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Recorded CAN traces played back as a frame source for the CAN task, which runs them
+// through the same decode, fan-out, statistics and UI path as frames from the bus.
+//
+// Trace files: binary traces of the logger (include/can_log.h), candump logs
+// ("(1436509052.249713) can0 280#0011223344556677", candump -l) and Vector ASC files.
+// Frames are paced like the recording, N times faster, or handed out as fast as they are
+// taken. Replayed frames carry the esp_timer time they are due, like received frames.
+
+#define CAN_REPLAY_LINE_MAX     160     // Longest text line read, longer ones are skipped
+
+typedef enum {
+    CAN_REPLAY_FORMAT_AUTO,     // From the file content
+    CAN_REPLAY_FORMAT_BINARY,
+    CAN_REPLAY_FORMAT_CANDUMP,
+    CAN_REPLAY_FORMAT_ASC,
+} can_replay_format_t;
+
+typedef struct {
+    can_replay_format_t format;
+    float speed;                // 1 = as recorded, N = N times faster, 0 = as fast as possible
+    bool loop;                  // Start over at the end of the trace
+} can_replay_config_t;
+
+typedef struct {
+    can_replay_format_t format;
+    float speed;
+    bool loop;
+    bool finished;              // End of the trace reached (never while looping)
+    uint32_t frames;            // Frames handed out
+    uint32_t skipped;           // Lines or records that are not a classic CAN frame
+    uint32_t recorder_lost;     // Frames the recording itself lost (binary traces)
+    uint32_t loops;             // Times the trace started over
+    uint32_t late_max_us;       // Longest a frame was handed out after it was due
+    int64_t trace_us;           // Position in the trace: time of the last frame after the first
+} can_replay_stats_t;
+
+typedef struct {
+    FILE *file;
+    can_replay_config_t config;
+    bool asc_hex;               // ASC: identifiers and data in hex ("base hex")
+    bool asc_relative;          // ASC: time stamps relative to the previous frame
+    uint32_t binary_end;        // Binary: valid bytes of the file
+    uint32_t binary_pos;
+    // Pacing: a frame is due at wall_start_us + (its trace time - trace_first_us) / speed
+    bool anchored;
+    int64_t trace_first_us;
+    int64_t trace_last_us;      // Previous frame, for relative ASC times
+    int64_t wall_start_us;
+    int64_t last_due_us;
+    bool have_next;             // next was read but is not due yet
+    can_frame_t next;
+    int64_t next_trace_us;
+    can_replay_stats_t stats;
+    char line[CAN_REPLAY_LINE_MAX];
+} can_replay_t;
+
+// Open a trace. ESP_ERR_NOT_FOUND if the file cannot be opened, ESP_ERR_NOT_SUPPORTED if
+// it is not a trace this reads.
+esp_err_t can_replay_open(can_replay_t *replay, const char *path, const can_replay_config_t *config);
+
+// The frames due by now_us (esp_timer time), up to max_frames: ESP_OK with *count > 0,
+// ESP_ERR_TIMEOUT with the time the next frame is due in *due_us, ESP_ERR_NOT_FOUND at the
+// end of the trace, ESP_FAIL if the file cannot be read.
+esp_err_t can_replay_receive_batch(can_replay_t *replay, can_frame_t *frames, size_t max_frames,
+                                   size_t *count, int64_t now_us, int64_t *due_us);
+
+void can_replay_get_stats(const can_replay_t *replay, can_replay_stats_t *stats);
+
+void can_replay_close(can_replay_t *replay);
+
+// One text line of a trace. False for lines without a classic CAN frame (comments, headers,
+// error and CAN FD frames). ASC time stamps are returned as written (see asc_relative).
+bool can_replay_parse_candump(const char *line, can_frame_t *frame, int64_t *trace_us);
+bool can_replay_parse_asc(const char *line, bool hex, can_frame_t *frame, int64_t *trace_us);
+
+const char *can_replay_format_name(can_replay_format_t format);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAN_REPLAY_H
@@ -0,0 +1,60 @@
+#ifndef CAN_SNIFFER_H
+#define CAN_SNIFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "include/can_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frames kept for the sniffer view (power of two). The oldest frame is overwritten.
+#define CAN_SNIFFER_RING_SIZE   256
+
+// Fan-out queue between the CAN task and the sniffer, drained every CAN_SNIFFER_POLL_MS
+#define CAN_SNIFFER_QUEUE_SIZE  512
+#define CAN_SNIFFER_POLL_MS     30
+
+// Column header matching can_sniffer_format_frame()
+#define CAN_SNIFFER_HEADER      "TIME         | ID  | DLC | DATA                     | ASCII    | DBC COMMENTS"
+
+// Subscribe the sniffer to the CAN frame fan-out. Everything below runs on the
+// consumer (LVGL) thread only.
+esp_err_t can_sniffer_init(void);
+
+// Move the frames queued by the CAN task into the sniffer history.
+// Returns the number of frames taken.
+size_t can_sniffer_poll(void);
+
+// While disabled, the CAN task does not queue frames for the sniffer
+void can_sniffer_set_enabled(bool enabled);
+bool can_sniffer_is_enabled(void);
+
+// Record every identifier on the bus, not only the decoded ones. Opens the acceptance
+// filter, so it is only set while the sniffer view is shown.
+void can_sniffer_set_all_ids(bool all_ids);
+
+// Forget the frames recorded so far
+void can_sniffer_clear(void);
+
+// Frames recorded since the last clear (including those already overwritten)
+uint32_t can_sniffer_count(void);
+
+// Frames the CAN task could not queue because the sniffer fell behind
+uint32_t can_sniffer_dropped(void);
+
+// Copy up to max_frames of the newest frames, newest first
+size_t can_sniffer_snapshot(can_frame_t *frames, size_t max_frames);
+
+// One terminal row: time, ID, DLC, hex, ASCII and the DBC decode of the frame.
+// Returns the number of characters written.
+size_t can_sniffer_format_frame(const can_frame_t *frame, char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAN_SNIFFER_H
@@ -0,0 +1,86 @@
+#ifndef CAN_STATS_H
+#define CAN_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "include/can_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-identifier CAN statistics and bus load.
+//
+// The CAN task adds every frame in constant time: each 11-bit identifier has its own entry,
+// 29-bit ones are probed for in an open-addressed table. A few counter updates follow,
+// published per entry with a sequence counter like the ECU data (odd while the entry is
+// written), so the frame path never takes a lock. Readers get a snapshot refreshed at most
+// every CAN_STATS_SNAPSHOT_MS, shared by all of them.
+//
+// Bus load counts the exact frame length on the wire, stuff bits included. It covers the
+// frames the CAN task receives: behind an acceptance filter (canbus_get_filter()) the
+// rejected identifiers are not seen, and the snapshot is marked filtered.
+
+#define CAN_STATS_STD_SLOTS         2048    // One per 11-bit identifier
+#define CAN_STATS_EXT_SLOTS         256     // 29-bit identifiers tracked (power of two)
+#define CAN_STATS_SLOTS             (CAN_STATS_STD_SLOTS + CAN_STATS_EXT_SLOTS)
+#define CAN_STATS_MAX_PROBE         32      // 29-bit slots tried per frame before it counts as overflow
+#define CAN_STATS_SNAPSHOT_MS       500     // Readers see counters at most this old (2 Hz)
+
+// One identifier in a snapshot
+typedef struct {
+    uint32_t id;                // CAN_DECODER_ID_EXT_FLAG set for 29-bit frames
+    uint32_t count;             // Frames since start or the last reset
+    float rate_hz;              // Frames per second over the last snapshot interval
+    float period_mean_us;       // Time between frames, 0 until two were seen
+    float period_std_us;
+    uint32_t period_min_us;
+    uint32_t period_max_us;
+    uint32_t dlc_changes;       // Frames whose DLC differed from the one before
+    uint8_t dlc;                // Last frame
+    uint8_t data[8];
+} can_stats_id_t;
+
+typedef struct {
+    uint64_t frames;            // Since start or the last reset
+    uint64_t bits;              // On the wire, stuff bits and interframe space included
+    float frames_per_s;         // Over the last snapshot interval
+    float bus_load_pct;
+    uint32_t bitrate;
+    uint32_t ids;               // Identifiers in the table
+    uint32_t overflow;          // Frames of identifiers that found no slot
+    uint32_t generation;        // Changes with every refresh: pages of one snapshot share it
+    bool filtered;              // An acceptance filter hid part of the bus during the interval:
+                                // bus_load_pct and the identifiers cover the accepted frames only
+} can_stats_bus_t;
+
+// Build the bit length tables and the snapshot buffer; bitrate in bit/s
+esp_err_t can_stats_init(uint32_t bitrate);
+
+// CAN task only. Count may be 0: a pending reset is still applied.
+void can_stats_add(const can_frame_t *frames, size_t count);
+
+// Forget everything counted so far (applied by the CAN task with its next batch)
+void can_stats_reset(void);
+
+// Whether the frames added from now on pass an acceptance filter (CAN task)
+void can_stats_set_filtered(bool filtered);
+
+// Bus summary and up to max identifiers from index first, sorted by identifier. Asking for
+// the first page refreshes the snapshot once it is older than CAN_STATS_SNAPSHOT_MS, so
+// another reader can refresh it between two pages: compare the generation of every page
+// with the first and start over if it changed. One call is always consistent.
+// Returns the number of identifiers copied. Either pointer may be NULL.
+size_t can_stats_snapshot(can_stats_bus_t *bus, can_stats_id_t *ids, size_t first, size_t max);
+
+// Length of a frame on the wire in bits: SOF to the end of the interframe space, with the
+// stuff bits of the header, data and CRC. Needs can_stats_init().
+uint32_t can_stats_frame_bits(const can_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAN_STATS_H
@@ -0,0 +1,101 @@
+#ifndef CAN_TRANSPORT_H
+#define CAN_TRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "include/can_frame.h"
+#include "include/can_replay.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frame sources of the CAN task behind one batch receive call: the TWAI controller, recorded
+// traces (can_replay.h) and, in the Linux build, SocketCAN interfaces (host/can_transport_socketcan.h).
+//
+// A transport is a table of backend functions and the backend's own state. The calls below
+// add the batch counters every backend shares; the backend fills in its loss and error
+// counters. Only one task receives from a transport.
+
+// Same values as twai_state_t
+typedef enum {
+    CAN_TRANSPORT_STATE_STOPPED,
+    CAN_TRANSPORT_STATE_RUNNING,
+    CAN_TRANSPORT_STATE_BUS_OFF,
+    CAN_TRANSPORT_STATE_RECOVERING,
+} can_transport_state_t;
+
+typedef struct {
+    const char *name;           // Backend: "twai", "file", "socketcan"
+    uint32_t frames_received;   // Frames handed out
+    uint32_t batches;           // Non-empty receive batches
+    uint32_t max_batch;         // Largest batch seen; the receive size means the source was backed up
+    uint32_t rx_queued;         // Frames waiting in the backend queue now, where it can tell
+    uint32_t rx_missed;         // Lost before they were taken: driver queue or socket buffer full,
+                                // frames the recorder of a trace lost
+    uint32_t rx_overrun;        // Lost in the controller RX FIFO
+    uint32_t bus_errors;        // Bus errors or error frames seen
+    uint32_t arb_lost;
+    uint32_t rx_error_counter;  // Controller REC
+    uint32_t tx_error_counter;  // Controller TEC
+    uint32_t state;             // can_transport_state_t
+    uint32_t skipped;           // Not passed on: CAN FD frames, unreadable trace lines
+} can_transport_stats_t;
+
+typedef struct can_transport can_transport_t;
+
+typedef struct {
+    const char *name;
+    esp_err_t (*start)(can_transport_t *transport);
+    esp_err_t (*stop)(can_transport_t *transport);
+    // As can_transport_receive_batch()
+    esp_err_t (*receive_batch)(can_transport_t *transport, can_frame_t *frames, size_t max_frames,
+                               size_t *count, TickType_t wait_ticks);
+    // Backend counters only: everything but name and the batch counters
+    esp_err_t (*get_stats)(can_transport_t *transport, can_transport_stats_t *stats);
+    void (*close)(can_transport_t *transport);
+} can_transport_ops_t;
+
+struct can_transport {
+    const can_transport_ops_t *ops;
+    void *ctx;                  // Backend state
+    uint32_t frames_received;
+    uint32_t batches;
+    uint32_t max_batch;
+};
+
+esp_err_t can_transport_start(can_transport_t *transport);
+esp_err_t can_transport_stop(can_transport_t *transport);
+
+// Up to max_frames, blocking up to wait_ticks for the first one; frames carry the esp_timer
+// time they were taken (or were due, for traces). Returns ESP_OK with *count > 0,
+// ESP_ERR_TIMEOUT if nothing arrived, ESP_ERR_NOT_FOUND at the end of a trace, or the
+// backend error.
+esp_err_t can_transport_receive_batch(can_transport_t *transport, can_frame_t *frames, size_t max_frames,
+                                      size_t *count, TickType_t wait_ticks);
+
+esp_err_t can_transport_get_stats(can_transport_t *transport, can_transport_stats_t *stats);
+
+// Release the backend; the transport can be opened again
+void can_transport_close(can_transport_t *transport);
+
+// ---- Backends ----
+
+// The installed TWAI driver (twai_driver_install() stays with the caller). The backend has
+// no state of its own: a transport initialized with { .ops = &can_transport_twai_ops } is open.
+extern const can_transport_ops_t can_transport_twai_ops;
+esp_err_t can_transport_twai_open(can_transport_t *transport);
+
+// A recorded trace, paced as configured (can_replay.h); returns as can_replay_open()
+esp_err_t can_transport_file_open(can_transport_t *transport, const char *path, const can_replay_config_t *config);
+
+// Replay counters of a file transport
+void can_transport_file_get_replay_stats(const can_transport_t *transport, can_replay_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAN_TRANSPORT_H
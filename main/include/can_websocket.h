@@ -7,6 +7,16 @@
 
 #include "esp_err.h"
 
+// Binary live data stream on ws://<ip>:8081/ws (frame format: include/ecu_stream.h).
+// Clients pick their rate with the text message "rate:<hz>" and can ask for a
+// full frame with "key". A keyframe is also sent on connect and periodically.
+#define WS_STREAM_MAX_CLIENTS           6
+#define WS_STREAM_DEFAULT_RATE_HZ       20
+#define WS_STREAM_MIN_RATE_HZ           1
+#define WS_STREAM_MAX_RATE_HZ           50
+#define WS_STREAM_TICK_MS               10      // Broadcaster period
+#define WS_STREAM_KEYFRAME_INTERVAL_US  (5 * 1000000LL)
+
 // Initialize and start data server
 esp_err_t start_websocket_server(void);
 
@@ -28,6 +38,9 @@ void stop_websocket_server(void);
 void update_websocket_can_data(uint16_t rpm, uint16_t map, uint8_t tps,
                               uint8_t wastegate, uint16_t target_boost, uint8_t tcu_status);
 
+// Send due stream frames; called by the broadcast task
+void broadcast_can_data(void);
+
 // Data broadcast task
 void websocket_broadcast_task(void *pvParameters);
 
@@ -1,9 +1,14 @@
 #ifndef CANBUS_H
 #define CANBUS_H
 
+#include <stddef.h>
 #include "esp_err.h"
 #include "driver/twai.h"
 #include "include/ecu_data.h"
+#include "include/can_frame.h"
+#include "include/can_filter.h"
+#include "include/can_replay.h"
+#include "include/can_transport.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -21,12 +26,40 @@ extern "C" {
 #define CAN_ID_TARGET_BOOST   0x205
 #define CAN_ID_TCU_STATUS     0x206 // Example ID, not used by new parser
 
+// Receive path counters of the bus transport. Driver counters come from twai_get_status_info().
+typedef can_transport_stats_t canbus_stats_t;
+
 // Function prototypes
 esp_err_t canbus_init(void);
 esp_err_t canbus_start(void);
 esp_err_t canbus_stop(void);
 void canbus_task(void *pvParameters);
 
+// The TWAI transport of the bus, see can_transport.h
+can_transport_t *canbus_bus_transport(void);
+
+// Drain up to max_frames from the driver queue, blocking up to wait_ticks for the first one.
+// Every frame is timestamped when it is taken from the queue.
+// Returns ESP_OK with *count > 0, ESP_ERR_TIMEOUT if nothing arrived, or the driver error.
+esp_err_t canbus_receive_batch(can_frame_t *frames, size_t max_frames, size_t *count, TickType_t wait_ticks);
+
+esp_err_t canbus_get_stats(canbus_stats_t *stats);
+
+// Acceptance filter in use. The CAN task replans it when the decoded IDs change or a
+// consumer of raw frames starts or stops needing every identifier (sniffer view shown,
+// logger with CONFIG_CAN_LOG_ALL_IDS).
+void canbus_get_filter(can_filter_plan_t *plan);
+
+// Replay a recorded trace through the CAN task in place of the bus: decoder, fan-out
+// consumers, statistics and UI see its frames as if they were received. The driver is
+// stopped until the trace ends or canbus_replay_stop() is called.
+// ESP_ERR_INVALID_STATE while a replay runs, otherwise as can_replay_open().
+esp_err_t canbus_replay_start(const char *path, const can_replay_config_t *config);
+void canbus_replay_stop(void);
+
+// Counters of the running or last replay (zero if there was none). Returns true while one runs.
+bool canbus_replay_get_status(can_replay_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
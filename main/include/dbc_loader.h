@@ -0,0 +1,83 @@
+#ifndef DBC_LOADER_H
+#define DBC_LOADER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "include/can_decoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Capacity of the DBC database (allocated once in PSRAM on first load)
+#define DBC_MAX_MESSAGES       512
+#define DBC_MAX_SIGNALS        4096
+#define DBC_STRING_POOL_SIZE   (128 * 1024)
+
+// Longest DBC line kept. Longer lines are truncated, the rest is skipped.
+#define DBC_LINE_MAX           512
+
+// Default directory scanned for *.dbc files
+#define DBC_DEFAULT_DIR        "/sdcard"
+
+// Signal as described in the DBC. def.field is the bound ecu_signal_t or ECU_SIG_NONE.
+typedef struct {
+    can_signal_def_t def;
+    const char *name;
+    const char *unit;
+} dbc_signal_t;
+
+// Message (frame) with its signals stored contiguously
+typedef struct {
+    uint32_t id;                 // CAN_DECODER_ID_EXT_FLAG set for 29-bit frames
+    const char *name;
+    const char *comment;         // "" if the DBC has no CM_ BO_ entry
+    uint16_t first_signal;       // Index into the signal array
+    uint16_t signal_count;
+    uint8_t dlc;
+} dbc_message_t;
+
+// Parse one DBC file into the database. The file is streamed line by line.
+esp_err_t dbc_loader_load_file(const char *path);
+
+// Parse every *.dbc file in a directory, then activate the result.
+// Returns ESP_ERR_NOT_FOUND if the directory holds no DBC file.
+esp_err_t dbc_loader_load_dir(const char *dir_path);
+
+// Compile the parsed signals into a decoder table and make it active.
+// Signals bound to an ECU field replace the built-in rows for that field.
+// Can only be done once; the previous table may still be in use by the CAN task.
+esp_err_t dbc_loader_activate(void);
+
+bool dbc_loader_is_loaded(void);
+
+// Message lookup, NULL if the identifier is not in the DBC
+const dbc_message_t* dbc_find_message(uint32_t id);
+const dbc_signal_t* dbc_get_signal(size_t index);
+
+// "Name: sig=value unit, ..." for a received frame. Writes "" if the ID is unknown.
+// Returns the number of characters written.
+size_t dbc_format_frame(uint32_t id, const uint8_t *data, uint8_t dlc, char *buf, size_t size);
+
+// Parser statistics of the last load
+typedef struct {
+    uint32_t lines;
+    uint32_t messages;
+    uint32_t signals;
+    uint32_t bound_signals;      // Signals mapped to an ECU field
+    uint32_t skipped_signals;    // Multiplexed, >32 bit or over capacity
+    uint32_t truncated_lines;
+} dbc_loader_stats_t;
+
+void dbc_loader_get_stats(dbc_loader_stats_t *stats);
+
+// Release the database. Only for tests: the decoder table must not be active.
+void dbc_loader_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DBC_LOADER_H
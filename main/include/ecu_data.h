@@ -34,6 +34,40 @@ typedef struct {
     uint64_t timestamp;
 } ecu_data_t;
 
+// Identifiers of the float signals in ecu_data_t, in field declaration order.
+// Used by the table-driven CAN decoder to address target fields.
+typedef enum {
+    ECU_SIG_ENGINE_RPM = 0,
+    ECU_SIG_TPS_POSITION,
+    ECU_SIG_ABS_PEDAL_POS,
+    ECU_SIG_MAP_KPA,
+    ECU_SIG_WG_SET_PERCENT,
+    ECU_SIG_WG_POS_PERCENT,
+    ECU_SIG_BOV_PERCENT,
+    ECU_SIG_TCU_TQ_REQ_NM,
+    ECU_SIG_TCU_TQ_ACT_NM,
+    ECU_SIG_ENG_TRG_NM,
+    ECU_SIG_ENG_ACT_NM,
+    ECU_SIG_LIMIT_TQ_NM,
+    ECU_SIG_COUNT,
+    ECU_SIG_NONE = 0xFF
+} ecu_signal_t;
+
+// Freshness tracking. A signal is stale if it was never received, or has not been
+// updated for ECU_DATA_STALE_PERIODS of its own update period, and at least
+// ECU_DATA_STALE_MIN_MS (slow signals are not flagged by scheduling jitter).
+#define ECU_DATA_STALE_MIN_MS     500
+#define ECU_DATA_STALE_PERIODS    5
+#define ECU_DATA_RATE_EWMA_ALPHA  0.1f  // Weight of the newest interval in period_us
+
+// Per-signal update metadata, published together with ecu_data_t
+typedef struct {
+    int64_t last_update_us[ECU_SIG_COUNT]; // esp_timer time of the last write, 0 = never
+    float period_us[ECU_SIG_COUNT];        // EWMA of the update interval, 0 = fewer than two writes
+    float rate_hz[ECU_SIG_COUNT];          // 1e6 / period_us
+    uint32_t update_count[ECU_SIG_COUNT];  // Increments on every write; compare to find changed signals
+} ecu_data_freshness_t;
+
 // System settings
 typedef struct {
     float max_boost_limit;       // Maximum boost limit
@@ -64,9 +98,26 @@ typedef struct {
 
 // Function prototypes
 void ecu_data_init(void);
-void ecu_data_update(ecu_data_t *data);
-ecu_data_t* ecu_data_get(void); // Unsafe, for internal use
-void ecu_data_get_copy(ecu_data_t *data_copy); // Thread-safe getter
+// Writer side (single writer, the CAN task). Changes between begin and end are
+// published atomically to readers; the writer never blocks.
+ecu_data_t* ecu_data_write_begin(void);
+void ecu_data_write_end(void);
+void ecu_data_update(ecu_data_t *data); // Replace all fields (writer side)
+ecu_data_t* ecu_data_get(void); // Writer only, between ecu_data_write_begin/end
+// Reader side: lock-free, torn-free copy; any task, any number of readers
+void ecu_data_get_copy(ecu_data_t *data_copy);
+uint32_t ecu_data_get_sequence(void); // Changes whenever new data is published
+// Writer side: record that the signals in mask (1 << ecu_signal_t) were written at timestamp_us
+void ecu_data_mark_updated(uint32_t mask, int64_t timestamp_us);
+// Reader side: consistent copy of data and/or freshness (either may be NULL)
+void ecu_data_get_snapshot(ecu_data_t *data, ecu_data_freshness_t *freshness);
+// Signals (bitmask) that are stale at now_us
+uint32_t ecu_data_stale_mask(const ecu_data_freshness_t *freshness, int64_t now_us);
+// Signals (bitmask) written between two snapshots
+uint32_t ecu_data_updated_mask(const ecu_data_freshness_t *before, const ecu_data_freshness_t *after);
+float* ecu_data_field(ecu_data_t *data, ecu_signal_t signal); // NULL for unknown signals
+const char* ecu_signal_name(ecu_signal_t signal); // Field name, e.g. "engine_rpm"
+ecu_signal_t ecu_signal_from_name(const char *name); // Case-insensitive, ECU_SIG_NONE if unknown
 char* ecu_data_to_json(const ecu_data_t *data);
 bool ecu_data_from_json(const char *json_str, ecu_data_t *data);
 void ecu_data_simulate(ecu_data_t *data);
@@ -0,0 +1,72 @@
+#ifndef ECU_STREAM_H
+#define ECU_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "include/ecu_data.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Binary live data stream, one frame per WebSocket binary message (little endian):
+//   u8  version        ECU_STREAM_VERSION
+//   u8  flags          ECU_STREAM_FLAG_*
+//   u16 sequence       Per client, +1 per frame
+//   u32 timestamp_ms   ecu_data timestamp
+//   u16 stale_mask     Bit n set: signal n has not been updated recently
+//   u8  count          Number of entries
+//   count x { u8 signal (ecu_signal_t), varint zigzag(value) }
+// value is the signal divided by ecu_stream_signal_step() and rounded. In a keyframe
+// it is absolute, otherwise the change since the previous frame sent to this client.
+// Signals that did not change are left out of delta frames.
+#define ECU_STREAM_VERSION          1
+#define ECU_STREAM_FLAG_KEYFRAME    0x01
+
+#define ECU_STREAM_HEADER_SIZE      11
+#define ECU_STREAM_MAX_FRAME_SIZE   (ECU_STREAM_HEADER_SIZE + ECU_SIG_COUNT * 6)
+
+// Per client encoder state: what the client has been sent so far
+typedef struct {
+    int32_t sent[ECU_SIG_COUNT];
+    uint16_t sequence;
+    uint16_t stale_mask;
+    bool keyframe_sent;
+} ecu_stream_encoder_t;
+
+// Decoder state (host tests and clients written in C)
+typedef struct {
+    int32_t value[ECU_SIG_COUNT];
+    uint16_t sequence;
+    uint32_t timestamp_ms;
+    uint16_t stale_mask;
+    bool synced;                 // A keyframe has been received
+} ecu_stream_decoder_t;
+
+// Quantization step of a signal (e.g. 1 rpm, 0.1 %)
+float ecu_stream_signal_step(ecu_signal_t signal);
+
+void ecu_stream_encoder_reset(ecu_stream_encoder_t *encoder);
+
+// Encode the data for one client. The first frame after a reset, and every frame with
+// keyframe set, carries all signals. Returns the frame size, or 0 if neither a value
+// nor the stale mask changed since the previous frame (or buf is too small).
+size_t ecu_stream_encode(ecu_stream_encoder_t *encoder, const ecu_data_t *data, uint16_t stale_mask,
+                         bool keyframe, uint8_t *buf, size_t size);
+
+void ecu_stream_decoder_reset(ecu_stream_decoder_t *decoder);
+
+// Apply one frame. Returns ESP_ERR_INVALID_STATE for a delta before the first keyframe or
+// a sequence gap, ESP_ERR_INVALID_SIZE / ESP_ERR_INVALID_ARG for malformed frames.
+esp_err_t ecu_stream_decode(ecu_stream_decoder_t *decoder, const uint8_t *frame, size_t len);
+
+// Decoded value of a signal in signal units
+float ecu_stream_decoder_value(const ecu_stream_decoder_t *decoder, ecu_signal_t signal);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ECU_STREAM_H
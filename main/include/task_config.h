@@ -0,0 +1,38 @@
+#ifndef TASK_CONFIG_H
+#define TASK_CONFIG_H
+
+// Where the application tasks run and at which priority.
+//
+// Core 0, ingest: the TWAI interrupt (the driver is installed from app_main, which runs
+// on core 0), the CAN task and the tasks taking frames from it. Wi-Fi, lwIP, the HTTP
+// servers and background work share the core below the CAN task; only the Wi-Fi (23)
+// and esp_timer (22) tasks are above it.
+// Core 1, render: LVGL, the flush task, the gauge updates and the RGB panel interrupts
+// (display() runs on this core). Drawing from PSRAM keeps to this core and cannot
+// delay the CAN interrupt or the CAN task.
+//
+// Stack sizes stay with the code creating each task.
+
+#define TASK_CORE_INGEST                0
+#define TASK_CORE_RENDER                1
+#define TASK_CORE_BACKGROUND            TASK_CORE_INGEST    // Networking and slow work
+
+// Ingest
+#define TASK_CAN_PRIORITY               20      // Above lwIP (18): the driver queue is short
+#define TASK_CAN_LOG_DRAIN_PRIORITY     8
+
+// Render
+#define TASK_UI_UPDATE_PRIORITY         5
+#define TASK_LVGL_FLUSH_PRIORITY        3
+#define TASK_LVGL_PRIORITY              2
+
+// Networking and background
+#define TASK_HTTPD_PRIORITY             5
+#define TASK_WS_BROADCAST_PRIORITY      5
+#define TASK_BACKGROUND_PRIORITY        3
+#define TASK_SETTINGS_LOAD_PRIORITY     3
+#define TASK_CONSOLE_PRIORITY           3
+#define TASK_CAN_LOG_WRITER_PRIORITY    2
+#define TASK_MONITOR_PRIORITY           1
+
+#endif // TASK_CONFIG_H
@@ -0,0 +1,54 @@
+#ifndef TASK_MONITOR_H
+#define TASK_MONITOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Runtime check of the task plan in include/task_config.h: CPU share of every task and
+// core per measurement window, and the scheduling latency the CAN task sees. A probe
+// timer interrupt on the ingest core wakes a task at the CAN task priority, like the
+// TWAI interrupt does; its wake-up delay is what a frame waits before the CAN task runs.
+
+#define TASK_MONITOR_MAX_TASKS  32
+#define TASK_MONITOR_NAME_LEN   16
+
+typedef struct {
+    char name[TASK_MONITOR_NAME_LEN];
+    uint8_t priority;
+    int8_t core;                    // -1 if not pinned
+    uint16_t cpu_permille;          // Of one core, over the window
+    uint32_t stack_free;            // Least free stack since start, bytes
+} task_monitor_task_t;
+
+typedef struct {
+    uint32_t window_ms;
+    uint32_t windows;               // Windows measured since start
+    uint16_t core_load_permille[2]; // Not idle
+    uint32_t wake_avg_us;           // Probe interrupt to probe task running, this window
+    uint32_t wake_max_us;
+    uint32_t wake_worst_us;         // Since start
+    uint32_t irq_jitter_max_us;     // Probe interrupt period deviation, this window
+    uint32_t irq_jitter_worst_us;
+    uint32_t can_overruns;          // TWAI FIFO overruns and driver queue drops, this window
+    uint32_t can_overruns_total;
+    size_t task_count;
+    task_monitor_task_t tasks[TASK_MONITOR_MAX_TASKS];  // Busiest first
+} task_monitor_report_t;
+
+// Start the latency probe and the monitor task (CONFIG_TASK_MONITOR_ENABLE)
+esp_err_t task_monitor_start(void);
+
+// Last complete window. ESP_ERR_INVALID_STATE until the first one is measured.
+esp_err_t task_monitor_get_report(task_monitor_report_t *report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TASK_MONITOR_H
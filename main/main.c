@@ -70,6 +70,10 @@
 #include "include/canbus.h"
 #include "include/can_websocket.h"
 #include "include/ecu_data.h"
+#include "include/dbc_loader.h"
+#include "include/can_log.h"
+#include "include/task_config.h"
+#include "include/task_monitor.h"
 
 // Display driver
 #include "../components/espressif__esp_lcd_touch/display.h"
@@ -84,6 +88,15 @@ static const char *TAG = "ECU_DASHBOARD";
 void ui_update_task_handler(void *pvParameters);
 void delayed_settings_load_task(void *pvParameters);
 
+// Runs display() on the render core: the RGB panel and touch interrupts are allocated on
+// the core that installs them, and they belong with LVGL rather than with the TWAI one.
+static void display_init_task(void *pvParameters)
+{
+    display();
+    xTaskNotifyGive((TaskHandle_t)pvParameters);
+    vTaskDelete(NULL);
+}
+
 // Task to initialize and run the console - RE-ENABLED
 // I2C API conflict resolved with shared bus approach
 void console_task(void *pvParameters)
@@ -205,8 +218,8 @@ void app_main(void)
         if (can_ret == ESP_OK) {
             ESP_LOGI(TAG, "CAN bus started successfully!");
 
-            // Create CAN task
-            xTaskCreate(canbus_task, "can_task", 4096, NULL, 10, NULL);
+            // Create CAN task, on the core that took the TWAI interrupt in canbus_init()
+            xTaskCreatePinnedToCore(canbus_task, "can_task", 4096, NULL, TASK_CAN_PRIORITY, NULL, TASK_CORE_INGEST);
             ESP_LOGI(TAG, "CAN task created");
 
             // Start WebSocket server for CAN data (port 8080)
@@ -214,7 +227,8 @@ void app_main(void)
             if (ws_ret == ESP_OK) {
                 ESP_LOGI(TAG, "WebSocket server for CAN started successfully!");
                 // Create WebSocket broadcast task
-                xTaskCreate(websocket_broadcast_task, "ws_broadcast", 4096, NULL, 5, NULL);
+                xTaskCreatePinnedToCore(websocket_broadcast_task, "ws_broadcast", 4096, NULL,
+                                        TASK_WS_BROADCAST_PRIORITY, NULL, TASK_CORE_BACKGROUND);
             } else {
                 ESP_LOGE(TAG, "Failed to start WebSocket server: %s", esp_err_to_name(ws_ret));
             }
@@ -226,7 +240,9 @@ void app_main(void)
     }
     
     /* Initialize display and UI */
-    display();
+    xTaskCreatePinnedToCore(display_init_task, "display_init", 8192, xTaskGetCurrentTaskHandle(),
+                            TASK_UI_UPDATE_PRIORITY, NULL, TASK_CORE_RENDER);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
     // NOW initialize SD Card after I2C bus is available from display driver
     ESP_LOGI(TAG, "Initializing SD Card (after I2C bus setup)...");
@@ -244,6 +260,15 @@ void app_main(void)
         ESP_LOGI(TAG, "Running SD card diagnostic test...");
         waveshare_sd_card_test();
 
+#if CONFIG_CAN_LOG_ENABLE
+        can_log_config_t log_config;
+        can_log_default_config(&log_config, CAN_LOG_DEFAULT_DIR);
+        esp_err_t log_result = can_log_start(&log_config);
+        if (log_result != ESP_OK) {
+            ESP_LOGW(TAG, "CAN trace logger not started: %s", esp_err_to_name(log_result));
+        }
+#endif
+
         // Settings will be loaded AFTER UI is fully initialized (2 second delay)
         ESP_LOGI(TAG, "Settings will be loaded after UI initialization (2 sec delay)");
         
@@ -265,13 +290,19 @@ void app_main(void)
     // This prevents I2C conflicts during UI initialization and settings loading
 
     // Create the UI update task
-    xTaskCreate(ui_update_task_handler, "ui_update_task", 4096, NULL, 5, NULL);
+    xTaskCreatePinnedToCore(ui_update_task_handler, "ui_update_task", 4096, NULL,
+                            TASK_UI_UPDATE_PRIORITY, NULL, TASK_CORE_RENDER);
 
     // Create delayed settings load task (waits 2 seconds after UI init)
-    xTaskCreate(delayed_settings_load_task, "settings_load", 4096, NULL, 5, NULL);
+    xTaskCreatePinnedToCore(delayed_settings_load_task, "settings_load", 4096, NULL,
+                            TASK_SETTINGS_LOAD_PRIORITY, NULL, TASK_CORE_BACKGROUND);
 
     // Console task re-enabled - I2C API conflict resolved with shared bus
-    xTaskCreate(console_task, "console_task", 4096, NULL, 10, NULL);
+    xTaskCreatePinnedToCore(console_task, "console_task", 4096, NULL,
+                            TASK_CONSOLE_PRIORITY, NULL, TASK_CORE_BACKGROUND);
+
+    // CPU share per task and CAN task latency (/sys/tasks)
+    task_monitor_start();
 
     // Проверяем границы всех экранов - все элементы должны быть внутри 800x480
     ESP_LOGI(TAG, "🔍 Проверка границ всех экранов...");
@@ -314,6 +345,9 @@ void delayed_settings_load_task(void *pvParameters) {
     } else {
         ESP_LOGW(TAG, "⚠️ Failed to load settings, using defaults");
     }
+
+    // Load DBC files from the SD card root; the built-in VW signals stay active otherwise
+    dbc_loader_load_dir(DBC_DEFAULT_DIR);
     
     // Resume GT911 polling AFTER all I2C-intensive operations are complete
     extern volatile bool g_gt911_polling_suspended;
@@ -336,15 +370,32 @@ void delayed_settings_load_task(void *pvParameters) {
     vTaskDelete(NULL);
 }
 
-// Task to update the UI gauges periodically
+// Gauge refresh without new data (statistics, staleness, missed screen changes)
+#define UI_UPDATE_IDLE_MS  500
+
+// Task to update the UI gauges. Sleeps until the CAN task reports changed signals,
+// then redraws at most once per LVGL refresh period so bursts of frames coalesce.
 void ui_update_task_handler(void *pvParameters) {
+    const TickType_t refresh_period = pdMS_TO_TICKS(CONFIG_LV_DISP_DEF_REFR_PERIOD) ?
+                                      pdMS_TO_TICKS(CONFIG_LV_DISP_DEF_REFR_PERIOD) : 1;
+    TickType_t last_update = xTaskGetTickCount();
+
+    ui_updates_register_task();
     while(1) {
+        xTaskNotifyWait(0, UINT32_MAX, NULL, pdMS_TO_TICKS(UI_UPDATE_IDLE_MS));
+
+        // Frames arriving while we wait out the refresh period only add notification bits
+        TickType_t since_update = xTaskGetTickCount() - last_update;
+        if (since_update < refresh_period) {
+            vTaskDelay(refresh_period - since_update);
+        }
+        xTaskNotifyStateClear(NULL);
+
         // Lock the LVGL mutex before touching UI elements
         if (example_lvgl_lock(-1)) {
             update_all_gauges();
             example_lvgl_unlock();
         }
-        // Run this task at a reasonable rate, e.g., every 50ms (20 FPS)
-        vTaskDelay(pdMS_TO_TICKS(50));
+        last_update = xTaskGetTickCount();
     }
 }
\ No newline at end of file
@@ -0,0 +1,302 @@
+/*
+ * Task CPU share and CAN task scheduling latency, see include/task_monitor.h
+ * Needs CONFIG_FREERTOS_USE_TRACE_FACILITY and CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+ * (run time counted in esp_timer microseconds).
+ */
+
+#include "include/task_monitor.h"
+#include "include/task_config.h"
+#include "include/canbus.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "TASK_MONITOR";
+
+#if CONFIG_TASK_MONITOR_ENABLE
+
+#if !CONFIG_FREERTOS_USE_TRACE_FACILITY || !CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+#error "The task monitor needs CONFIG_FREERTOS_USE_TRACE_FACILITY and CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS"
+#endif
+
+// With ISR dispatch the probe measures from the interrupt, as the TWAI interrupt wakes
+// the CAN task; otherwise from the esp_timer task, which runs at 22 on the same core.
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+#define PROBE_DISPATCH      ESP_TIMER_ISR
+#else
+#define PROBE_DISPATCH      ESP_TIMER_TASK
+#endif
+
+#define PROBE_PERIOD_US     (CONFIG_TASK_MONITOR_PROBE_MS * 1000)
+
+// Run time of a task at the start of the window
+typedef struct {
+    TaskHandle_t handle;
+    configRUN_TIME_COUNTER_TYPE run_time;
+} task_sample_t;
+
+static TaskHandle_t s_probe_task = NULL;
+static esp_timer_handle_t s_probe_timer = NULL;
+static volatile int64_t s_probe_fired_us = 0;
+static volatile int64_t s_probe_last_fired_us = 0;
+static volatile uint32_t s_irq_jitter_max_us = 0;
+
+// Probe results of the window, reset by the monitor task
+static portMUX_TYPE s_probe_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_wake_count = 0;
+static uint64_t s_wake_total_us = 0;
+static uint32_t s_wake_max_us = 0;
+
+static SemaphoreHandle_t s_report_lock = NULL;
+static task_monitor_report_t s_report;
+static bool s_report_valid = false;
+
+static void IRAM_ATTR probe_timer_cb(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+    if (s_probe_last_fired_us) {
+        int64_t deviation = now - s_probe_last_fired_us - PROBE_PERIOD_US;
+        uint32_t jitter = (uint32_t)(deviation < 0 ? -deviation : deviation);
+        if (jitter > s_irq_jitter_max_us) {
+            s_irq_jitter_max_us = jitter;
+        }
+    }
+    s_probe_last_fired_us = now;
+    s_probe_fired_us = now;
+
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s_probe_task, &woken);
+    if (woken) {
+        esp_timer_isr_dispatch_need_yield();
+    }
+#else
+    xTaskNotifyGive(s_probe_task);
+#endif
+}
+
+// Same core and priority as the CAN task: its wake-up delay is the CAN task's
+static void probe_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint32_t latency = (uint32_t)(esp_timer_get_time() - s_probe_fired_us);
+
+        taskENTER_CRITICAL(&s_probe_lock);
+        s_wake_count++;
+        s_wake_total_us += latency;
+        if (latency > s_wake_max_us) {
+            s_wake_max_us = latency;
+        }
+        taskEXIT_CRITICAL(&s_probe_lock);
+    }
+}
+
+static int compare_cpu(const void *a, const void *b)
+{
+    const task_monitor_task_t *ta = a, *tb = b;
+    return (int)tb->cpu_permille - (int)ta->cpu_permille;
+}
+
+static void log_report(const task_monitor_report_t *report)
+{
+    char top[160];
+    int len = 0;
+    for (size_t i = 0; i < report->task_count && i < 5 && len < (int)sizeof(top); i++) {
+        const task_monitor_task_t *task = &report->tasks[i];
+        len += snprintf(top + len, sizeof(top) - len, "%s%s %u.%u%%", i ? ", " : "", task->name,
+                        task->cpu_permille / 10, task->cpu_permille % 10);
+    }
+    ESP_LOGI(TAG, "CPU %u.%u%% / %u.%u%%, CAN task wake avg %lu us max %lu us (worst %lu), "
+             "IRQ jitter max %lu us, CAN overruns %lu; %s",
+             report->core_load_permille[0] / 10, report->core_load_permille[0] % 10,
+             report->core_load_permille[1] / 10, report->core_load_permille[1] % 10,
+             (unsigned long)report->wake_avg_us, (unsigned long)report->wake_max_us,
+             (unsigned long)report->wake_worst_us, (unsigned long)report->irq_jitter_max_us,
+             (unsigned long)report->can_overruns, len ? top : "-");
+}
+
+static void monitor_task(void *arg)
+{
+    static TaskStatus_t status[TASK_MONITOR_MAX_TASKS];
+    static task_sample_t previous[TASK_MONITOR_MAX_TASKS];
+    static task_monitor_report_t report;
+    size_t previous_count = 0;
+    configRUN_TIME_COUNTER_TYPE previous_total = 0;
+    uint32_t previous_overruns = 0;
+    bool have_previous = false;
+    TickType_t last_wake = xTaskGetTickCount();
+    const uint32_t log_windows = CONFIG_TASK_MONITOR_LOG_S * 1000 / CONFIG_TASK_MONITOR_PERIOD_MS;
+
+    memset(&report, 0, sizeof(report));
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(CONFIG_TASK_MONITOR_PERIOD_MS));
+
+        configRUN_TIME_COUNTER_TYPE total = 0;
+        size_t count = uxTaskGetSystemState(status, TASK_MONITOR_MAX_TASKS, &total);
+        if (count == 0) {
+            ESP_LOGW(TAG, "More than %d tasks, CPU share not measured", TASK_MONITOR_MAX_TASKS);
+        }
+
+        taskENTER_CRITICAL(&s_probe_lock);
+        uint32_t wake_count = s_wake_count;
+        uint64_t wake_total = s_wake_total_us;
+        uint32_t wake_max = s_wake_max_us;
+        uint32_t jitter_max = s_irq_jitter_max_us;
+        s_wake_count = 0;
+        s_wake_total_us = 0;
+        s_wake_max_us = 0;
+        s_irq_jitter_max_us = 0;
+        taskEXIT_CRITICAL(&s_probe_lock);
+
+        uint32_t overruns = previous_overruns;
+        canbus_stats_t can_stats;
+        if (canbus_get_stats(&can_stats) == ESP_OK) {
+            overruns = can_stats.rx_overrun + can_stats.rx_missed;
+        }
+
+        uint32_t window = (uint32_t)(total - previous_total);
+        if (have_previous && window > 0) {
+            TaskHandle_t idle[2] = { xTaskGetIdleTaskHandleForCore(0), xTaskGetIdleTaskHandleForCore(1) };
+            report.window_ms = window / 1000;
+            report.windows++;
+            report.core_load_permille[0] = report.core_load_permille[1] = 1000;
+            report.task_count = 0;
+            for (size_t i = 0; i < count; i++) {
+                // Tasks created during the window count from their start
+                configRUN_TIME_COUNTER_TYPE start = 0;
+                for (size_t p = 0; p < previous_count; p++) {
+                    if (previous[p].handle == status[i].xHandle) {
+                        start = previous[p].run_time;
+                        break;
+                    }
+                }
+                uint64_t permille = (uint64_t)(status[i].ulRunTimeCounter - start) * 1000 / window;
+                if (permille > 1000) {
+                    permille = 1000;
+                }
+                for (int core = 0; core < 2; core++) {
+                    if (status[i].xHandle == idle[core]) {
+                        report.core_load_permille[core] = (uint16_t)(1000 - permille);
+                    }
+                }
+
+                task_monitor_task_t *task = &report.tasks[report.task_count++];
+                BaseType_t core = xTaskGetCoreID(status[i].xHandle);
+                strlcpy(task->name, status[i].pcTaskName, sizeof(task->name));
+                task->priority = (uint8_t)status[i].uxCurrentPriority;
+                task->core = core == tskNO_AFFINITY ? -1 : (int8_t)core;
+                task->cpu_permille = (uint16_t)permille;
+                task->stack_free = status[i].usStackHighWaterMark;
+            }
+            qsort(report.tasks, report.task_count, sizeof(report.tasks[0]), compare_cpu);
+
+            report.wake_avg_us = wake_count ? (uint32_t)(wake_total / wake_count) : 0;
+            report.wake_max_us = wake_max;
+            report.irq_jitter_max_us = jitter_max;
+            if (wake_max > report.wake_worst_us) {
+                report.wake_worst_us = wake_max;
+            }
+            if (jitter_max > report.irq_jitter_worst_us) {
+                report.irq_jitter_worst_us = jitter_max;
+            }
+            report.can_overruns = overruns - previous_overruns;
+            report.can_overruns_total += report.can_overruns;
+
+            xSemaphoreTake(s_report_lock, portMAX_DELAY);
+            s_report = report;
+            s_report_valid = true;
+            xSemaphoreGive(s_report_lock);
+
+            if (log_windows && report.windows % log_windows == 0) {
+                log_report(&report);
+            }
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            previous[i].handle = status[i].xHandle;
+            previous[i].run_time = status[i].ulRunTimeCounter;
+        }
+        previous_count = count;
+        previous_total = total;
+        previous_overruns = overruns;
+        have_previous = count > 0;
+    }
+}
+
+esp_err_t task_monitor_start(void)
+{
+    if (s_report_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_report_lock = xSemaphoreCreateMutex();
+    if (!s_report_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreatePinnedToCore(probe_task, "sched_probe", 2048, NULL, TASK_CAN_PRIORITY,
+                                &s_probe_task, TASK_CORE_INGEST) != pdPASS ||
+        xTaskCreatePinnedToCore(monitor_task, "task_monitor", 3072, NULL, TASK_MONITOR_PRIORITY,
+                                NULL, TASK_CORE_BACKGROUND) != pdPASS) {
+        ESP_LOGE(TAG, "Cannot create the monitor tasks");
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_timer_create_args_t probe_args = {
+        .callback = probe_timer_cb,
+        .dispatch_method = PROBE_DISPATCH,
+        .name = "sched_probe",
+        .skip_unhandled_events = true,
+    };
+    esp_err_t ret = esp_timer_create(&probe_args, &s_probe_timer);
+    if (ret == ESP_OK) {
+        ret = esp_timer_start_periodic(s_probe_timer, PROBE_PERIOD_US);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot start the latency probe: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ESP_LOGI(TAG, "Measuring every %d ms, latency probe every %d ms at priority %d on core %d (%s dispatch)",
+             CONFIG_TASK_MONITOR_PERIOD_MS, CONFIG_TASK_MONITOR_PROBE_MS, TASK_CAN_PRIORITY, TASK_CORE_INGEST,
+             PROBE_DISPATCH == ESP_TIMER_ISR ? "ISR" : "task");
+    return ESP_OK;
+}
+
+esp_err_t task_monitor_get_report(task_monitor_report_t *report)
+{
+    if (!report) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_report_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_report_lock, portMAX_DELAY);
+    bool valid = s_report_valid;
+    if (valid) {
+        *report = s_report;
+    }
+    xSemaphoreGive(s_report_lock);
+    return valid ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+#else // !CONFIG_TASK_MONITOR_ENABLE
+
+esp_err_t task_monitor_start(void)
+{
+    ESP_LOGI(TAG, "Task monitor disabled");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t task_monitor_get_report(task_monitor_report_t *report)
+{
+    (void)report;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // CONFIG_TASK_MONITOR_ENABLE
@@ -0,0 +1,295 @@
+// Numeric value labels drawn from a pre-blended glyph atlas
+
+#include "ui_comp_digits.h"
+#include "src/draw/sw/lv_draw_sw.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "UI_DIGITS";
+
+#define DIGITS_CHARSET_LEN  (sizeof(UI_DIGITS_CHARSET) - 1)
+
+struct ui_digits_atlas_t {
+    const lv_font_t * font;
+    lv_color_t fg;
+    lv_color_t bg;
+    lv_coord_t cell_w;           // Widest character: every cell has the same width
+    lv_coord_t cell_h;           // Line height of the font
+    lv_color_t * cells;          // DIGITS_CHARSET_LEN cells of cell_w x cell_h, charset order
+    struct ui_digits_atlas_t * next;
+};
+
+// Per label state, the user data of its draw event callback
+typedef struct {
+    const ui_digits_atlas_t * atlas;
+    uint8_t max_chars;
+    char text[UI_DIGITS_MAX_CHARS + 1];   // The label's static text
+} ui_digits_t;
+
+static ui_digits_atlas_t * atlases = NULL;
+
+static int digits_char_index(char c)
+{
+    const char * p = c ? strchr(UI_DIGITS_CHARSET, c) : NULL;
+    return p ? (int)(p - UI_DIGITS_CHARSET) : -1;
+}
+
+// Blend one glyph of the font into its cell, centered horizontally on the baseline
+static bool digits_render_cell(const ui_digits_atlas_t * atlas, char c, lv_color_t * cell)
+{
+    for (int i = 0; i < atlas->cell_w * atlas->cell_h; i++) {
+        cell[i] = atlas->bg;
+    }
+
+    lv_font_glyph_dsc_t glyph;
+    if (!lv_font_get_glyph_dsc(atlas->font, &glyph, (uint32_t)c, '\0')) {
+        return c == ' ';
+    }
+    if (glyph.box_w == 0 || glyph.box_h == 0) {
+        return true;
+    }
+    const uint8_t * bitmap = lv_font_get_glyph_bitmap(atlas->font, (uint32_t)c);
+    uint8_t bpp = glyph.bpp == 3 ? 4 : glyph.bpp;   // As lv_draw_sw_letter: 3 bpp is stored as 4
+    if (!bitmap || (bpp != 1 && bpp != 2 && bpp != 4 && bpp != 8)) {
+        return false;
+    }
+
+    // Glyph rows are one continuous bit stream, most significant bits first
+    const uint32_t max_value = (1U << bpp) - 1;
+    lv_coord_t x0 = (atlas->cell_w - glyph.adv_w) / 2 + glyph.ofs_x;
+    lv_coord_t y0 = atlas->font->line_height - atlas->font->base_line - glyph.box_h - glyph.ofs_y;
+    uint32_t bit = 0;
+    for (lv_coord_t y = 0; y < glyph.box_h; y++) {
+        for (lv_coord_t x = 0; x < glyph.box_w; x++, bit += bpp) {
+            uint32_t value = (bitmap[bit >> 3] >> (8 - bpp - (bit & 7))) & max_value;
+            lv_coord_t px = x0 + x;
+            lv_coord_t py = y0 + y;
+            if (value && px >= 0 && px < atlas->cell_w && py >= 0 && py < atlas->cell_h) {
+                cell[py * atlas->cell_w + px] = lv_color_mix(atlas->fg, atlas->bg,
+                                                             (lv_opa_t)(value * LV_OPA_COVER / max_value));
+            }
+        }
+    }
+    return true;
+}
+
+const ui_digits_atlas_t * ui_digits_atlas_get(const lv_font_t * font, lv_color_t fg, lv_color_t bg)
+{
+    for (ui_digits_atlas_t * atlas = atlases; atlas; atlas = atlas->next) {
+        if (atlas->font == font && atlas->fg.full == fg.full && atlas->bg.full == bg.full) {
+            return atlas;
+        }
+    }
+
+    ui_digits_atlas_t * atlas = heap_caps_calloc(1, sizeof(*atlas), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!atlas) {
+        return NULL;
+    }
+    atlas->font = font;
+    atlas->fg = fg;
+    atlas->bg = bg;
+    atlas->cell_h = lv_font_get_line_height(font);
+    for (size_t i = 0; i < DIGITS_CHARSET_LEN; i++) {
+        lv_coord_t w = (lv_coord_t)lv_font_get_glyph_width(font, (uint32_t)UI_DIGITS_CHARSET[i], '\0');
+        atlas->cell_w = LV_MAX(atlas->cell_w, w);
+    }
+
+    // A few KB: internal RAM if possible, it is read on every value change
+    size_t cell_px = (size_t)atlas->cell_w * atlas->cell_h;
+    atlas->cells = heap_caps_malloc_prefer(DIGITS_CHARSET_LEN * cell_px * sizeof(lv_color_t), 2,
+                                           MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, MALLOC_CAP_SPIRAM);
+    bool ok = atlas->cells != NULL && cell_px > 0;
+    for (size_t i = 0; ok && i < DIGITS_CHARSET_LEN; i++) {
+        ok = digits_render_cell(atlas, UI_DIGITS_CHARSET[i], &atlas->cells[i * cell_px]);
+    }
+    if (!ok) {
+        ESP_LOGW(TAG, "No glyph atlas for this font, value labels drawn as text");
+        heap_caps_free(atlas->cells);
+        heap_caps_free(atlas);
+        return NULL;
+    }
+
+    ESP_LOGI(TAG, "Glyph atlas: %d x %d px cells, %u bytes",
+             atlas->cell_w, atlas->cell_h, (unsigned)(DIGITS_CHARSET_LEN * cell_px * sizeof(lv_color_t)));
+    atlas->next = atlases;
+    atlases = atlas;
+    return atlas;
+}
+
+// Area of cell i of a text of len characters, centered in the label
+static void digits_cell_area(lv_obj_t * label, const ui_digits_atlas_t * atlas, size_t len, size_t i,
+                             lv_area_t * area)
+{
+    lv_area_t content;
+    lv_obj_get_content_coords(label, &content);
+    area->x1 = content.x1 + (lv_area_get_width(&content) - (lv_coord_t)len * atlas->cell_w) / 2
+               + (lv_coord_t)i * atlas->cell_w;
+    area->y1 = content.y1 + (lv_area_get_height(&content) - atlas->cell_h) / 2;
+    area->x2 = area->x1 + atlas->cell_w - 1;
+    area->y2 = area->y1 + atlas->cell_h - 1;
+}
+
+// Runs before the label's own drawing and replaces it when every character is in the atlas
+static void digits_draw_cb(lv_event_t * e)
+{
+    lv_obj_t * label = lv_event_get_target(e);
+    const ui_digits_t * digits = lv_event_get_user_data(e);
+    const ui_digits_atlas_t * atlas = digits->atlas;
+    const char * text = lv_label_get_text(label);
+    size_t len = strlen(text);
+    if (len > digits->max_chars) {
+        return;
+    }
+    int index[UI_DIGITS_MAX_CHARS];
+    for (size_t i = 0; i < len; i++) {
+        index[i] = digits_char_index(text[i]);
+        if (index[i] < 0) {
+            return;
+        }
+    }
+
+    lv_draw_ctx_t * draw_ctx = lv_event_get_draw_ctx(e);
+    lv_area_t cell;
+    lv_draw_sw_blend_dsc_t blend_dsc;
+    lv_memset_00(&blend_dsc, sizeof(blend_dsc));
+    blend_dsc.blend_area = &cell;
+    blend_dsc.opa = LV_OPA_COVER;
+    blend_dsc.blend_mode = LV_BLEND_MODE_NORMAL;
+    for (size_t i = 0; i < len; i++) {
+        digits_cell_area(label, atlas, len, i, &cell);
+        blend_dsc.src_buf = &atlas->cells[(size_t)index[i] * atlas->cell_w * atlas->cell_h];
+        lv_draw_sw_blend(draw_ctx, &blend_dsc);
+    }
+    lv_event_stop_processing(e);
+}
+
+static void digits_delete_cb(lv_event_t * e)
+{
+    lv_mem_free(lv_event_get_user_data(e));
+}
+
+void ui_digits_attach(lv_obj_t * label, const ui_digits_atlas_t * atlas, uint8_t max_chars)
+{
+    if (!label || !atlas || lv_obj_get_event_user_data(label, digits_draw_cb)) {
+        return;
+    }
+    ui_digits_t * digits = lv_mem_alloc(sizeof(*digits));
+    if (!digits) {
+        return;
+    }
+    digits->atlas = atlas;
+    digits->max_chars = LV_MIN(max_chars, UI_DIGITS_MAX_CHARS);
+    strncpy(digits->text, lv_label_get_text(label), sizeof(digits->text));
+    digits->text[sizeof(digits->text) - 1] = '\0';
+
+    lv_obj_add_event_cb(label, digits_draw_cb, LV_EVENT_DRAW_MAIN | LV_EVENT_PREPROCESS, digits);
+    lv_obj_add_event_cb(label, digits_delete_cb, LV_EVENT_DELETE, digits);
+    lv_label_set_long_mode(label, LV_LABEL_LONG_CLIP);
+    lv_obj_set_style_text_align(label, LV_TEXT_ALIGN_CENTER, 0);
+    lv_obj_set_size(label, digits->max_chars * atlas->cell_w, atlas->cell_h);
+    lv_label_set_text_static(label, digits->text);
+}
+
+void ui_digits_set_text(lv_obj_t * label, const char * text)
+{
+    ui_digits_t * digits = lv_obj_get_event_user_data(label, digits_draw_cb);
+    if (!digits) {
+        lv_label_set_text(label, text);
+        return;
+    }
+
+    // Text set by someone else with lv_label_set_text(): take the label back in one go
+    if (lv_label_get_text(label) != digits->text) {
+        strncpy(digits->text, text, sizeof(digits->text));
+        digits->text[sizeof(digits->text) - 1] = '\0';
+        lv_label_set_text_static(label, digits->text);
+        return;
+    }
+
+    size_t old_len = strlen(digits->text);
+    size_t len = strlen(text);
+    bool cells = old_len == len && len <= digits->max_chars;
+    for (size_t i = 0; cells && i < len; i++) {
+        cells = digits_char_index(text[i]) >= 0 && digits_char_index(digits->text[i]) >= 0;
+    }
+    if (!cells) {
+        // Length change (the text is centered) or drawn as a label: the whole box
+        strncpy(digits->text, text, sizeof(digits->text));
+        digits->text[sizeof(digits->text) - 1] = '\0';
+        lv_label_set_text_static(label, digits->text);
+        return;
+    }
+
+    // Same length, atlas only: the label's size and layout cannot change
+    for (size_t i = 0; i < len; i++) {
+        if (digits->text[i] != text[i]) {
+            lv_area_t cell;
+            digits_cell_area(label, digits->atlas, len, i, &cell);
+            lv_obj_invalidate_area(label, &cell);
+            digits->text[i] = text[i];
+        }
+    }
+}
+
+bool ui_digits_benchmark(uint32_t updates, ui_digits_bench_t * result)
+{
+    const lv_font_t * font = LV_FONT_DEFAULT;
+    lv_color_t fg = lv_color_white();
+    lv_color_t bg = lv_color_hex(0x2a2a2a);
+    const ui_digits_atlas_t * atlas = ui_digits_atlas_get(font, fg, bg);
+    if (!atlas || updates == 0) {
+        return false;
+    }
+
+    // A gauge value on its card, off screen so nothing shows
+    lv_obj_t * card = lv_obj_create(lv_scr_act());
+    lv_obj_remove_style_all(card);
+    lv_obj_set_size(card, UI_DIGITS_MAX_CHARS * atlas->cell_w, atlas->cell_h);
+    lv_obj_set_pos(card, -2 * LV_HOR_RES, 0);
+    lv_obj_set_style_bg_color(card, bg, 0);
+    lv_obj_set_style_bg_opa(card, LV_OPA_COVER, 0);
+
+    uint32_t size = lv_snapshot_buf_size_needed(card, LV_IMG_CF_TRUE_COLOR);
+    void * buf = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (!buf) {
+        lv_obj_del(card);
+        return false;
+    }
+
+    int64_t elapsed_us[2];
+    for (int pass = 0; pass < 2; pass++) {
+        lv_obj_t * label = lv_label_create(card);
+        lv_obj_set_style_text_font(label, font, 0);
+        lv_obj_set_style_text_color(label, fg, 0);
+        lv_obj_center(label);
+        if (pass == 0) {
+            ui_digits_attach(label, atlas, UI_DIGITS_MAX_CHARS);
+        }
+
+        // An RPM-like sweep: several digits change on most updates
+        char text[UI_DIGITS_MAX_CHARS + 1];
+        lv_img_dsc_t dsc;
+        int64_t start = esp_timer_get_time();
+        for (uint32_t i = 0; i < updates; i++) {
+            snprintf(text, sizeof(text), "%d", (int)((i * 37) % 7000));
+            ui_digits_set_text(label, text);
+            lv_snapshot_take_to_buf(card, LV_IMG_CF_TRUE_COLOR, &dsc, buf, size);
+        }
+        elapsed_us[pass] = esp_timer_get_time() - start;
+        lv_obj_del(label);
+    }
+
+    ESP_LOGI(TAG, "%lu value updates rendered: atlas %.1f us/update, label %.1f us/update",
+             (unsigned long)updates, (double)elapsed_us[0] / updates, (double)elapsed_us[1] / updates);
+    if (result) {
+        result->updates = updates;
+        result->atlas_us = (float)elapsed_us[0] / updates;
+        result->label_us = (float)elapsed_us[1] / updates;
+    }
+    heap_caps_free(buf);
+    lv_obj_del(card);
+    return true;
+}
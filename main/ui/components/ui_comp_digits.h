@@ -0,0 +1,50 @@
+// Numeric value labels drawn from a pre-blended glyph atlas
+
+#ifndef UI_COMP_DIGITS_H
+#define UI_COMP_DIGITS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "lvgl.h"
+
+// Characters held by an atlas. A text with any other character (e.g. "60°C") is drawn
+// by the label itself.
+#define UI_DIGITS_CHARSET       "0123456789.- "
+
+// Longest text drawn from the atlas
+#define UI_DIGITS_MAX_CHARS     8
+
+typedef struct ui_digits_atlas_t ui_digits_atlas_t;
+
+// The charset of font in fg blended over bg: one opaque, fixed width RGB565 cell per
+// character. Atlases are created on first use and shared. NULL if out of memory or the
+// font format is not supported.
+const ui_digits_atlas_t * ui_digits_atlas_get(const lv_font_t * font, lv_color_t fg, lv_color_t bg);
+
+// Draw label from atlas (a straight copy per character) whenever its text allows. The label
+// gets a fixed size of max_chars cells, so text changes never resize it or move its
+// neighbours. It must lie on a background of the atlas' bg color.
+void ui_digits_attach(lv_obj_t * label, const ui_digits_atlas_t * atlas, uint8_t max_chars);
+
+// Set the text of an attached label: only the cells whose character changed are
+// invalidated, nothing is measured. Same as lv_label_set_text() on other labels.
+void ui_digits_set_text(lv_obj_t * label, const char * text);
+
+typedef struct {
+    uint32_t updates;
+    float atlas_us;     // Per update, label drawn from the atlas
+    float label_us;     // Per update, plain label
+} ui_digits_bench_t;
+
+// Render updates value changes of a gauge label off screen, once from the atlas and once
+// as a plain label, and log the time per update (LVGL lock held). Fills result (may be
+// NULL) and returns true if the benchmark ran.
+bool ui_digits_benchmark(uint32_t updates, ui_digits_bench_t * result);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif // UI_COMP_DIGITS_H
@@ -0,0 +1,262 @@
+// Arc gauge shared by Screens 1, 2, 4 and 5
+
+#include "ui_comp_gauge.h"
+#include "ui_comp_digits.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+#if UI_GAUGE_CACHE_BACKGROUND
+static const char *TAG = "UI_GAUGE";
+#endif
+
+#define GAUGE_ARC_SIZE      160
+#define GAUGE_ARC_WIDTH     15
+#define GAUGE_CARD_COLOR    0x2a2a2a
+#define GAUGE_VALUE_CHARS   6       // "-123.4", or "100°C" drawn as text
+
+// Indicator sweep invalidation: one rectangle per quadrant piece of at most
+// GAUGE_INV_MAX_DEG; sweeps needing more rectangles invalidate the whole arc
+#define GAUGE_INV_MAX_DEG   45
+#define GAUGE_INV_MAX_AREAS 4
+
+// Cached background of one gauge, freed with the gauge
+typedef struct {
+    lv_img_dsc_t dsc;
+    uint8_t *buf;
+} gauge_background_t;
+
+static void gauge_arc_init(lv_obj_t * arc, lv_color_t color, int32_t min_val, int32_t max_val)
+{
+    lv_obj_set_size(arc, GAUGE_ARC_SIZE, GAUGE_ARC_SIZE);
+    lv_arc_set_rotation(arc, 135);
+    lv_arc_set_bg_angles(arc, 0, 270);
+    lv_arc_set_range(arc, min_val, max_val);
+    lv_arc_set_value(arc, min_val);
+    lv_obj_set_style_arc_color(arc, color, LV_PART_INDICATOR);
+    lv_obj_set_style_arc_width(arc, GAUGE_ARC_WIDTH, LV_PART_INDICATOR);
+    lv_obj_set_style_arc_color(arc, lv_color_hex(0x4a4a4a), LV_PART_MAIN);
+    lv_obj_set_style_arc_width(arc, GAUGE_ARC_WIDTH, LV_PART_MAIN);
+    lv_obj_center(arc);
+    lv_obj_remove_style(arc, NULL, LV_PART_KNOB);
+    lv_obj_clear_flag(arc, LV_OBJ_FLAG_CLICKABLE);
+}
+
+static lv_obj_t * gauge_value_label_create(lv_obj_t * parent)
+{
+    lv_obj_t * label = lv_label_create(parent);
+    lv_label_set_text(label, "0");
+    lv_obj_set_style_text_color(label, lv_color_white(), 0);
+    lv_obj_align(label, LV_ALIGN_CENTER, 0, -5);
+
+    // Digits straight from the glyph atlas, pre-blended over the card
+    const ui_digits_atlas_t * atlas = ui_digits_atlas_get(lv_obj_get_style_text_font(label, LV_PART_MAIN),
+                                                          lv_color_white(), lv_color_hex(GAUGE_CARD_COLOR));
+    ui_digits_attach(label, atlas, GAUGE_VALUE_CHARS);
+    return label;
+}
+
+// The gauge as plain LVGL objects
+static lv_obj_t * gauge_create_live(lv_obj_t * parent, lv_obj_t ** arc, lv_obj_t ** label,
+                                    const char * title, const char * unit, lv_color_t color,
+                                    int32_t min_val, int32_t max_val, lv_coord_t x, lv_coord_t y,
+                                    lv_coord_t height)
+{
+    lv_obj_t * cont = lv_obj_create(parent);
+    lv_obj_set_width(cont, UI_GAUGE_WIDTH);
+    lv_obj_set_height(cont, height);
+    lv_obj_set_x(cont, x);
+    lv_obj_set_y(cont, y);
+    lv_obj_set_align(cont, LV_ALIGN_TOP_LEFT);
+    lv_obj_clear_flag(cont, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_style_bg_color(cont, lv_color_hex(GAUGE_CARD_COLOR), 0);
+    lv_obj_set_style_border_color(cont, color, 0);
+    lv_obj_set_style_border_width(cont, 2, 0);
+    lv_obj_set_style_radius(cont, 15, 0);
+    lv_obj_set_style_pad_all(cont, 10, 0);
+
+    // Title
+    lv_obj_t * label_title = lv_label_create(cont);
+    lv_label_set_text(label_title, title);
+    lv_obj_set_style_text_color(label_title, lv_color_white(), 0);
+    lv_obj_align(label_title, LV_ALIGN_BOTTOM_MID, 0, -15);
+
+    // Arc
+    *arc = lv_arc_create(cont);
+    gauge_arc_init(*arc, color, min_val, max_val);
+
+    // Value label
+    *label = gauge_value_label_create(cont);
+
+    // Unit label
+    lv_obj_t * label_unit = lv_label_create(cont);
+    lv_label_set_text(label_unit, unit);
+    lv_obj_set_style_text_color(label_unit, lv_color_hex(0xcccccc), 0);
+    lv_obj_align_to(label_unit, *label, LV_ALIGN_OUT_BOTTOM_MID, 0, 5);
+    return cont;
+}
+
+#if UI_GAUGE_CACHE_BACKGROUND
+static void gauge_background_free_cb(lv_event_t * e)
+{
+    gauge_background_t * background = lv_event_get_user_data(e);
+    heap_caps_free(background->buf);
+    heap_caps_free(background);
+}
+
+// Render the static parts of the live gauge into an image. NULL if out of memory.
+static gauge_background_t * gauge_background_render(lv_obj_t * parent, const char * title, const char * unit,
+                                                    lv_color_t color, int32_t min_val, int32_t max_val,
+                                                    lv_coord_t height)
+{
+    // Build it on a plain area of the parent's color, so the rounded corners blend
+    // into the screen exactly as when drawn live
+    lv_obj_t * area = lv_obj_create(parent);
+    lv_obj_remove_style_all(area);
+    lv_obj_set_size(area, UI_GAUGE_WIDTH, height);
+    lv_obj_set_style_bg_color(area, lv_obj_get_style_bg_color(parent, LV_PART_MAIN), 0);
+    lv_obj_set_style_bg_opa(area, LV_OPA_COVER, 0);
+
+    lv_obj_t * arc;
+    lv_obj_t * label;
+    gauge_create_live(area, &arc, &label, title, unit, color, min_val, max_val, 0, 0, height);
+    lv_obj_set_style_arc_opa(arc, LV_OPA_TRANSP, LV_PART_INDICATOR);
+    lv_obj_add_flag(label, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_update_layout(area);
+
+    uint32_t size = lv_snapshot_buf_size_needed(area, LV_IMG_CF_TRUE_COLOR);
+    gauge_background_t * background = heap_caps_calloc(1, sizeof(*background), MALLOC_CAP_SPIRAM);
+    if (background) {
+        background->buf = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    }
+    if (!background || !background->buf ||
+        lv_snapshot_take_to_buf(area, LV_IMG_CF_TRUE_COLOR, &background->dsc, background->buf, size) != LV_RES_OK) {
+        if (background) {
+            heap_caps_free(background->buf);
+            heap_caps_free(background);
+        }
+        background = NULL;
+    }
+    lv_obj_del(area);
+    return background;
+}
+#endif // UI_GAUGE_CACHE_BACKGROUND
+
+lv_obj_t * ui_gauge_create(lv_obj_t * parent, lv_obj_t ** arc, lv_obj_t ** label,
+                           const char * title, const char * unit, lv_color_t color,
+                           int32_t min_val, int32_t max_val, lv_coord_t x, lv_coord_t y,
+                           lv_coord_t height)
+{
+#if UI_GAUGE_CACHE_BACKGROUND
+    gauge_background_t * background = gauge_background_render(parent, title, unit, color,
+                                                               min_val, max_val, height);
+    if (background) {
+        // The image is opaque RGB565: drawing it is a plain copy, no masks
+        lv_obj_t * gauge = lv_img_create(parent);
+        lv_img_set_src(gauge, &background->dsc);
+        lv_obj_set_pos(gauge, x, y);
+        lv_obj_add_event_cb(gauge, gauge_background_free_cb, LV_EVENT_DELETE, background);
+
+        // Same geometry as the live gauge: centered in a card with symmetric padding.
+        // The background arc keeps its width for the layout but is not drawn.
+        *arc = lv_arc_create(gauge);
+        gauge_arc_init(*arc, color, min_val, max_val);
+        lv_obj_set_style_arc_opa(*arc, LV_OPA_TRANSP, LV_PART_MAIN);
+        *label = gauge_value_label_create(gauge);
+        return gauge;
+    }
+    ESP_LOGW(TAG, "No memory to cache the \"%s\" gauge background, drawing it live", title);
+#endif
+    return gauge_create_live(parent, arc, label, title, unit, color, min_val, max_val, x, y, height);
+}
+
+// Bounding box of the ring piece start..end (degrees, within one quadrant)
+static void gauge_sweep_piece_area(const lv_point_t * center, lv_coord_t r_in, lv_coord_t r_out,
+                                   int32_t start, int32_t end, lv_coord_t extra, lv_area_t * area)
+{
+    // Inside a quadrant x and y are monotonic in the angle: the corners are the extremes
+    const int32_t angles[2] = { start, end };
+    const lv_coord_t radii[2] = { r_in, r_out };
+    area->x1 = LV_COORD_MAX;
+    area->y1 = LV_COORD_MAX;
+    area->x2 = LV_COORD_MIN;
+    area->y2 = LV_COORD_MIN;
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2; j++) {
+            lv_coord_t x = center->x + ((lv_trigo_sin((int16_t)(angles[i] + 90)) * radii[j]) >> LV_TRIGO_SHIFT);
+            lv_coord_t y = center->y + ((lv_trigo_sin((int16_t)angles[i]) * radii[j]) >> LV_TRIGO_SHIFT);
+            area->x1 = LV_MIN(area->x1, x);
+            area->y1 = LV_MIN(area->y1, y);
+            area->x2 = LV_MAX(area->x2, x);
+            area->y2 = LV_MAX(area->y2, y);
+        }
+    }
+    lv_area_increase(area, extra, extra);
+}
+
+uint32_t ui_gauge_set_value(lv_obj_t * arc, int16_t value, uint32_t * lvgl_px)
+{
+    if (lvgl_px) {
+        *lvgl_px = 0;
+    }
+    if (lv_arc_get_mode(arc) != LV_ARC_MODE_NORMAL) {
+        lv_arc_set_value(arc, value);
+        return 0;
+    }
+
+    // Let the arc update its angles without invalidating anything itself
+    uint16_t old_end = lv_arc_get_angle_end(arc);
+    lv_disp_t * disp = lv_obj_get_disp(arc);
+    lv_disp_enable_invalidation(disp, false);
+    lv_arc_set_value(arc, value);
+    lv_disp_enable_invalidation(disp, true);
+    uint16_t new_end = lv_arc_get_angle_end(arc);
+    if (new_end == old_end || !lv_obj_is_visible(arc)) {
+        return 0;
+    }
+
+    // Indicator geometry, as lv_arc draws it
+    lv_coord_t pad_left = lv_obj_get_style_pad_left(arc, LV_PART_MAIN);
+    lv_coord_t pad_top = lv_obj_get_style_pad_top(arc, LV_PART_MAIN);
+    lv_coord_t r = LV_MIN(lv_obj_get_width(arc) - pad_left - lv_obj_get_style_pad_right(arc, LV_PART_MAIN),
+                          lv_obj_get_height(arc) - pad_top - lv_obj_get_style_pad_bottom(arc, LV_PART_MAIN)) / 2;
+    lv_point_t center = { arc->coords.x1 + r + pad_left, arc->coords.y1 + r + pad_top };
+    lv_coord_t r_out = r - LV_MAX4(lv_obj_get_style_pad_left(arc, LV_PART_INDICATOR),
+                                   lv_obj_get_style_pad_right(arc, LV_PART_INDICATOR),
+                                   lv_obj_get_style_pad_top(arc, LV_PART_INDICATOR),
+                                   lv_obj_get_style_pad_bottom(arc, LV_PART_INDICATOR));
+    lv_coord_t width = lv_obj_get_style_arc_width(arc, LV_PART_INDICATOR);
+    bool rounded = lv_obj_get_style_arc_rounded(arc, LV_PART_INDICATOR);
+    lv_coord_t extra = rounded ? width / 2 + 1 : 1;   // End cap, or truncation of the sine table
+
+    uint16_t rotation = ((lv_arc_t *)arc)->rotation;
+    int32_t start = LV_MIN(old_end, new_end) + rotation;
+    int32_t end = LV_MAX(old_end, new_end) + rotation;
+
+    if (lvgl_px) {
+        // What lv_arc_set_value() would have invalidated: one box around the whole sweep
+        uint16_t lvgl_start = start > 360 ? start - 360 : start;
+        uint16_t lvgl_end = end > 360 ? end - 360 : end;
+        lv_area_t box;
+        lv_draw_arc_get_area(center.x, center.y, r, lvgl_start, lvgl_end, width, rounded, &box);
+        *lvgl_px = lv_area_get_size(&box);
+    }
+
+    lv_area_t areas[GAUGE_INV_MAX_AREAS];
+    int count = 0;
+    for (int32_t piece = start; piece < end; count++) {
+        int32_t piece_end = LV_MIN(end, LV_MIN((piece / 90 + 1) * 90, piece + GAUGE_INV_MAX_DEG));
+        if (count == GAUGE_INV_MAX_AREAS) {
+            lv_obj_invalidate(arc);
+            return lv_area_get_size(&arc->coords);
+        }
+        gauge_sweep_piece_area(&center, r_out - width, r_out, piece, piece_end, extra, &areas[count]);
+        piece = piece_end;
+    }
+
+    uint32_t px = 0;
+    for (int i = 0; i < count; i++) {
+        lv_obj_invalidate_area(arc, &areas[i]);
+        px += lv_area_get_size(&areas[i]);
+    }
+    return px;
+}
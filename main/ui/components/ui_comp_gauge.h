@@ -0,0 +1,45 @@
+// Arc gauge used by the dashboard screens: a bordered card with title, unit,
+// a 270 degree arc and a centered value label
+
+#ifndef UI_COMP_GAUGE_H
+#define UI_COMP_GAUGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "lvgl.h"
+#include "sdkconfig.h"
+
+// Width of a gauge card; the height differs per screen
+#define UI_GAUGE_WIDTH              250
+
+// 1: render the static parts (card, background arc, title, unit) once into an RGB565
+// image in PSRAM; only the indicator arc and the value label are drawn on top of it.
+// 0: plain LVGL objects, everything redrawn wherever the indicator changes.
+// Set by CONFIG_EXAMPLE_GAUGE_CACHE_BACKGROUND.
+#ifdef CONFIG_EXAMPLE_GAUGE_CACHE_BACKGROUND
+#define UI_GAUGE_CACHE_BACKGROUND   1
+#else
+#define UI_GAUGE_CACHE_BACKGROUND   0
+#endif
+
+// Create a gauge at x/y on parent (parent's background color must be set: the card's
+// rounded corners are cached over it). Returns the gauge object; *arc and *label are the
+// widgets that change with the value.
+lv_obj_t * ui_gauge_create(lv_obj_t * parent, lv_obj_t ** arc, lv_obj_t ** label,
+                           const char * title, const char * unit, lv_color_t color,
+                           int32_t min_val, int32_t max_val, lv_coord_t x, lv_coord_t y,
+                           lv_coord_t height);
+
+// lv_arc_set_value() for gauge arcs that invalidates only the swept ring: a rectangle
+// per quadrant piece instead of one box around the whole sweep (which lv_arc widens to
+// the full arc for sweeps over three quadrants). Returns the pixels invalidated; lvgl_px
+// (optional) gets what lv_arc_set_value() would have invalidated.
+uint32_t ui_gauge_set_value(lv_obj_t * arc, int16_t value, uint32_t * lvgl_px);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif // UI_COMP_GAUGE_H
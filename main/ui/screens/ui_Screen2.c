@@ -5,12 +5,12 @@
 #include "ui_Screen2.h"
 #include "ui_Screen3.h"
 #include "../ui_screen_manager.h"
+#include "../components/ui_comp_gauge.h"
 #include "esp_log.h"
 #include <stdio.h>
+#include <stdlib.h>
 
-// Forward declarations for touch cursor animation callbacks
-static void fade_anim_cb_screen2(void * var, int32_t v);
-static void fade_ready_cb_screen2(lv_anim_t * a);
+// Forward declarations
 static void swipe_handler_screen2(lv_event_t * e);
 
 lv_obj_t * ui_Screen2 = NULL;
@@ -38,7 +38,7 @@ static lv_anim_t anim_battery_voltage; // Вернули Battery анимаци
 
 static void anim_value_cb(void * var, int32_t v)
 {
-    lv_arc_set_value((lv_obj_t *)var, v);
+    ui_gauge_set_value((lv_obj_t *)var, (int16_t)v, NULL);
     
     if(var == ui_Arc_Oil_Pressure) {
         lv_label_set_text_fmt(ui_Label_Oil_Pressure_Value, "%d", v);
@@ -58,58 +58,8 @@ static void anim_value_cb(void * var, int32_t v)
     // Coolant Temp убран, Battery Voltage возвращен
 }
 
-static void create_gauge(lv_obj_t * parent, lv_obj_t ** arc, lv_obj_t ** label,
-                        const char * title, const char * unit, lv_color_t color,
-                        int32_t min_val, int32_t max_val, int x, int y)
-{
-    // Container - такой же размер как на Screen1
-    lv_obj_t * cont = lv_obj_create(parent);
-    lv_obj_set_width(cont, 250);
-    lv_obj_set_height(cont, 225);
-    lv_obj_set_x(cont, x);
-    lv_obj_set_y(cont, y);
-    lv_obj_set_align(cont, LV_ALIGN_TOP_LEFT);
-    lv_obj_clear_flag(cont, LV_OBJ_FLAG_SCROLLABLE);
-    lv_obj_set_style_bg_color(cont, lv_color_hex(0x2a2a2a), 0);
-    lv_obj_set_style_border_color(cont, color, 0);
-    lv_obj_set_style_border_width(cont, 2, 0);
-    lv_obj_set_style_radius(cont, 15, 0);
-    lv_obj_set_style_pad_all(cont, 10, 0);
-    
-    // Title
-    lv_obj_t * label_title = lv_label_create(cont);
-    lv_label_set_text(label_title, title);
-    lv_obj_set_style_text_color(label_title, lv_color_white(), 0);
-    lv_obj_align(label_title, LV_ALIGN_BOTTOM_MID, 0, -15);
-    
-    // Arc - такой же размер как на Screen1
-    *arc = lv_arc_create(cont);
-    lv_obj_set_size(*arc, 160, 160);
-    lv_arc_set_rotation(*arc, 135);
-    lv_arc_set_bg_angles(*arc, 0, 270);
-    lv_arc_set_range(*arc, min_val, max_val);
-    lv_arc_set_value(*arc, min_val);
-    lv_obj_set_style_arc_color(*arc, color, LV_PART_INDICATOR);
-    lv_obj_set_style_arc_width(*arc, 15, LV_PART_INDICATOR);
-    lv_obj_set_style_arc_color(*arc, lv_color_hex(0x4a4a4a), LV_PART_MAIN);
-    lv_obj_set_style_arc_width(*arc, 15, LV_PART_MAIN);
-    lv_obj_center(*arc);
-    lv_obj_remove_style(*arc, NULL, LV_PART_KNOB);
-    lv_obj_clear_flag(*arc, LV_OBJ_FLAG_CLICKABLE);
-    
-    // Value label
-    *label = lv_label_create(cont);
-    lv_label_set_text(*label, "0");
-    lv_obj_set_style_text_color(*label, lv_color_white(), 0);
-    lv_obj_center(*label);
-    lv_obj_align(*label, LV_ALIGN_CENTER, 0, -5);
-    
-    // Unit label
-    lv_obj_t * label_unit = lv_label_create(cont);
-    lv_label_set_text(label_unit, unit);
-    lv_obj_set_style_text_color(label_unit, lv_color_hex(0xcccccc), 0);
-    lv_obj_align_to(label_unit, *label, LV_ALIGN_OUT_BOTTOM_MID, 0, 5);
-}
+// Gauge card height on this screen
+#define GAUGE_HEIGHT 225
 
 void ui_Screen2_screen_init(void)
 {
@@ -131,25 +81,25 @@ void ui_Screen2_screen_init(void)
     // ВСЕ ПОЗИЦИИ ПРОВЕРЕНЫ - НЕ ВЫХОДЯТ ЗА ГРАНИЦЫ 800x480
 
     // Первый ряд (y=15) - проверенные расстояния
-    create_gauge(ui_Screen2, &ui_Arc_Oil_Pressure, &ui_Label_Oil_Pressure_Value,
-                "Oil Pressure", "bar", lv_color_hex(0xFF6B35), 0, 10, 15, 15);
+    ui_gauge_create(ui_Screen2, &ui_Arc_Oil_Pressure, &ui_Label_Oil_Pressure_Value,
+                "Oil Pressure", "bar", lv_color_hex(0xFF6B35), 0, 10, 15, 15, GAUGE_HEIGHT);
                 // Датчик 1: x=15 to 265, расстояние до края: 15px ✓
 
-    create_gauge(ui_Screen2, &ui_Arc_Oil_Temp, &ui_Label_Oil_Temp_Value,
-                "Oil Temp", "°C", lv_color_hex(0xFFD700), 60, 140, 285, 15);
+    ui_gauge_create(ui_Screen2, &ui_Arc_Oil_Temp, &ui_Label_Oil_Temp_Value,
+                "Oil Temp", "°C", lv_color_hex(0xFFD700), 60, 140, 285, 15, GAUGE_HEIGHT);
                 // Датчик 2: x=285 to 535, расстояние от датчика 1: 285-265=20px ✓
 
-    create_gauge(ui_Screen2, &ui_Arc_Water_Temp, &ui_Label_Water_Temp_Value,
-                "Water Temp", "°C", lv_color_hex(0x00D4FF), 60, 120, 545, 15);
+    ui_gauge_create(ui_Screen2, &ui_Arc_Water_Temp, &ui_Label_Water_Temp_Value,
+                "Water Temp", "°C", lv_color_hex(0x00D4FF), 60, 120, 545, 15, GAUGE_HEIGHT);
                 // Датчик 3: x=545 to 795, расстояние от датчика 2: 545-535=10px ✓
 
     // Второй ряд (y=245) - исправленные координаты для соответствия Screen1
-    create_gauge(ui_Screen2, &ui_Arc_Fuel_Pressure, &ui_Label_Fuel_Pressure_Value,
-                "Fuel Pressure", "bar", lv_color_hex(0x00FF88), 0, 8, 15, 245);
+    ui_gauge_create(ui_Screen2, &ui_Arc_Fuel_Pressure, &ui_Label_Fuel_Pressure_Value,
+                "Fuel Pressure", "bar", lv_color_hex(0x00FF88), 0, 8, 15, 245, GAUGE_HEIGHT);
                 // Датчик 4: x=15 to 265, расстояние от верхнего ряда: 245-240=5px
 
-    create_gauge(ui_Screen2, &ui_Arc_Battery_Voltage, &ui_Label_Battery_Voltage_Value,
-                "Battery", "V", lv_color_hex(0xFFD700), 11, 15, 285, 245);
+    ui_gauge_create(ui_Screen2, &ui_Arc_Battery_Voltage, &ui_Label_Battery_Voltage_Value,
+                "Battery", "V", lv_color_hex(0xFFD700), 11, 15, 285, 245, GAUGE_HEIGHT);
                 // Датчик 5: x=285 to 535, расстояние от датчика 4: 285-265=20px
 
     // Всего 5 датчиков в 3x2 сетке
@@ -8,6 +8,9 @@
 #include "ui_screen_manager.h"
 #include "ui_helpers.h"
 #include "ui_events.h"
+#include "include/can_sniffer.h"
+#include "include/can_stats.h"
+#include "include/can_decoder.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
@@ -16,9 +19,10 @@
 lv_obj_t * ui_Screen3;
 
 // CAN Bus Terminal Objects
-void * ui_TextArea_CAN_Terminal;
+void * ui_Label_CAN_Terminal;
 void * ui_Label_CAN_Status;
 void * ui_Label_CAN_Count;
+void * ui_Label_CAN_Stats;
 
 // Advanced CAN Terminal Objects
 void * ui_Button_Clear;
@@ -27,20 +31,34 @@ void * ui_TextArea_Search;
 void * ui_Slider_UpdateSpeed;
 void * ui_Label_UpdateSpeed;
 
+// Rows that fit into the terminal (montserrat 12: 15 px per line, first line is the header)
+#define CAN_TERMINAL_ROWS  26
+
 // CAN Terminal state
-static int can_message_count = 0;
 static int can_sniffer_active = 1;   // Sniffer mode active
 static char search_text[64] = "";
 static int update_speed_ms = 100;    // Default update speed
 
-// Sniffer state
-static int last_can_id = 0;
-static uint8_t last_can_data[8] = {0};
-static uint8_t last_can_dlc = 0;
+// The timer drains the CAN frame queue every CAN_SNIFFER_POLL_MS and rebuilds the terminal
+// every update_speed_ms; only the visible rows are formatted
+static lv_timer_t *can_terminal_timer = NULL;
+static uint32_t can_terminal_last_render = 0;    // lv_tick_get() of the last rebuild
+static bool can_terminal_dirty = true;           // Search or clear changed what is shown
+static uint32_t can_terminal_shown_count = 0;    // can_sniffer_count() of the last render
+static char can_terminal_text[4096];             // Label text (static, the label does not copy it)
+static can_frame_t can_terminal_frames[CAN_SNIFFER_RING_SIZE];
+
+// Statistics table: the busiest identifiers of the latest snapshot
+#define CAN_STATS_ROWS 12
+static uint32_t can_stats_last_render = 0;          // lv_tick_get() of the last refresh
+static uint32_t can_stats_shown_generation = 0;
+static char can_stats_text[1024];                   // Label text (static, the label does not copy it)
+static can_stats_id_t can_stats_page[32];
+static can_stats_id_t can_stats_top[CAN_STATS_ROWS];
 
 // Function prototypes
-static void screen3_touch_handler(lv_event_t * e);
 static void swipe_handler_screen3(lv_event_t * e);
+static void screen3_visibility_cb(lv_event_t * e);
 static void clear_button_event_cb(lv_event_t * e);
 static void sniffer_button_event_cb(lv_event_t * e);
 static void search_text_event_cb(lv_event_t * e);
@@ -48,11 +66,8 @@ static void update_speed_slider_event_cb(lv_event_t * e);
 static int is_message_matches_search(const char* message);
 
 // CAN Sniffer functions
-static void can_sniffer_add_message(uint32_t id, uint8_t *data, uint8_t dlc);
-static void can_sniffer_format_message(char *buffer, size_t size, uint32_t id, uint8_t *data, uint8_t dlc);
-static int can_sniffer_is_id_filtered(uint32_t id);
-static int can_sniffer_search_in_data(uint8_t *data, uint8_t dlc, const char *search_term);
-static void can_sniffer_update_statistics(uint32_t id);
+static void can_terminal_refresh_cb(lv_timer_t * timer);
+static int can_sniffer_search_in_data(const uint8_t *data, uint8_t dlc, const char *search_term);
 
 // Swipe handler for screen switching
 static void swipe_handler_screen3(lv_event_t * e) {
@@ -133,6 +148,7 @@ static void search_text_event_cb(lv_event_t * e) {
         if (text) {
             strncpy(search_text, text, sizeof(search_text) - 1);
             search_text[sizeof(search_text) - 1] = '\0';
+            can_terminal_dirty = true;
         }
     }
 }
@@ -210,19 +226,21 @@ void ui_Screen3_screen_init(void)
     lv_obj_set_style_bg_color(terminal_title, lv_color_hex(0x2a2a2a), 0);
     lv_obj_align(terminal_title, LV_ALIGN_TOP_MID, 0, 10);
     
-    // CAN Terminal text area (main display) - LEFT SIDE
-    ui_TextArea_CAN_Terminal = lv_textarea_create(terminal_cont);
-    lv_obj_set_size((lv_obj_t*)ui_TextArea_CAN_Terminal, 450, 410);
-    lv_obj_set_pos((lv_obj_t*)ui_TextArea_CAN_Terminal, 0, 0);
-    lv_obj_set_style_bg_color((lv_obj_t*)ui_TextArea_CAN_Terminal, lv_color_hex(0x00000000), 0);
-    lv_obj_set_style_text_color((lv_obj_t*)ui_TextArea_CAN_Terminal, lv_color_hex(0x00FF88), 0);
-    lv_obj_set_style_border_color((lv_obj_t*)ui_TextArea_CAN_Terminal, lv_color_hex(0x333333), 0);
-    lv_obj_set_style_border_width((lv_obj_t*)ui_TextArea_CAN_Terminal, 1, 0);
-    lv_obj_set_style_radius((lv_obj_t*)ui_TextArea_CAN_Terminal, 5, 0);
-    lv_obj_set_style_text_font((lv_obj_t*)ui_TextArea_CAN_Terminal, &lv_font_montserrat_12, 0);
-    lv_textarea_set_placeholder_text((lv_obj_t*)ui_TextArea_CAN_Terminal, "Waiting for CAN Bus data...");
-    lv_textarea_set_text((lv_obj_t*)ui_TextArea_CAN_Terminal, "TIME         | ID  | DLC | DATA                     | ASCII    | DBC COMMENTS\n");
-    lv_obj_clear_flag((lv_obj_t*)ui_TextArea_CAN_Terminal, LV_OBJ_FLAG_CLICKABLE);
+    // CAN Terminal (main display) - LEFT SIDE
+    // A plain label showing the newest frames; rows that do not fit are clipped
+    ui_Label_CAN_Terminal = lv_label_create(terminal_cont);
+    lv_obj_set_size((lv_obj_t*)ui_Label_CAN_Terminal, 450, 410);
+    lv_obj_set_pos((lv_obj_t*)ui_Label_CAN_Terminal, 0, 0);
+    lv_label_set_long_mode((lv_obj_t*)ui_Label_CAN_Terminal, LV_LABEL_LONG_WRAP);
+    lv_obj_set_style_bg_color((lv_obj_t*)ui_Label_CAN_Terminal, lv_color_hex(0x00000000), 0);
+    lv_obj_set_style_bg_opa((lv_obj_t*)ui_Label_CAN_Terminal, LV_OPA_COVER, 0);
+    lv_obj_set_style_text_color((lv_obj_t*)ui_Label_CAN_Terminal, lv_color_hex(0x00FF88), 0);
+    lv_obj_set_style_border_color((lv_obj_t*)ui_Label_CAN_Terminal, lv_color_hex(0x333333), 0);
+    lv_obj_set_style_border_width((lv_obj_t*)ui_Label_CAN_Terminal, 1, 0);
+    lv_obj_set_style_radius((lv_obj_t*)ui_Label_CAN_Terminal, 5, 0);
+    lv_obj_set_style_pad_all((lv_obj_t*)ui_Label_CAN_Terminal, 5, 0);
+    lv_obj_set_style_text_font((lv_obj_t*)ui_Label_CAN_Terminal, &lv_font_montserrat_12, 0);
+    lv_label_set_text_static((lv_obj_t*)ui_Label_CAN_Terminal, CAN_SNIFFER_HEADER "\nWaiting for CAN Bus data...");
     
     // RIGHT SIDE PANEL - Controls and Status
     lv_obj_t * right_panel = lv_obj_create(ui_Screen3);
@@ -350,80 +368,108 @@ void ui_Screen3_screen_init(void)
     lv_obj_set_style_bg_color((lv_obj_t*)ui_Slider_UpdateSpeed, lv_color_hex(0x00D4FF), LV_PART_KNOB);
     lv_obj_add_event_cb((lv_obj_t*)ui_Slider_UpdateSpeed, update_speed_slider_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
 
+    // --- Statistics table: bus load and the busiest IDs ---
+    ui_Label_CAN_Stats = lv_label_create(right_panel);
+    lv_obj_set_width((lv_obj_t*)ui_Label_CAN_Stats, LV_PCT(100));
+    lv_obj_set_flex_grow((lv_obj_t*)ui_Label_CAN_Stats, 1);
+    lv_label_set_long_mode((lv_obj_t*)ui_Label_CAN_Stats, LV_LABEL_LONG_CLIP);
+    lv_obj_set_style_bg_color((lv_obj_t*)ui_Label_CAN_Stats, lv_color_hex(0x1a1a1a), 0);
+    lv_obj_set_style_bg_opa((lv_obj_t*)ui_Label_CAN_Stats, LV_OPA_COVER, 0);
+    lv_obj_set_style_text_color((lv_obj_t*)ui_Label_CAN_Stats, lv_color_hex(0x00D4FF), 0);
+    lv_obj_set_style_text_font((lv_obj_t*)ui_Label_CAN_Stats, &lv_font_montserrat_10, 0);
+    lv_obj_set_style_pad_all((lv_obj_t*)ui_Label_CAN_Stats, 5, 0);
+    lv_obj_set_style_radius((lv_obj_t*)ui_Label_CAN_Stats, 8, 0);
+    lv_label_set_text_static((lv_obj_t*)ui_Label_CAN_Stats, "Bus statistics: waiting for CAN data...");
+
     // Add swipe functionality for screen switching
     lv_obj_add_event_cb(ui_Screen3, swipe_handler_screen3, LV_EVENT_PRESSED, NULL);
     lv_obj_add_event_cb(ui_Screen3, swipe_handler_screen3, LV_EVENT_RELEASED, NULL);
+    lv_obj_add_event_cb(ui_Screen3, screen3_visibility_cb, LV_EVENT_SCREEN_LOADED, NULL);
+    lv_obj_add_event_cb(ui_Screen3, screen3_visibility_cb, LV_EVENT_SCREEN_UNLOADED, NULL);
     
     // Add standardized navigation buttons
     ui_create_standard_navigation_buttons(ui_Screen3);
+
+    // Frames reach the terminal through the CAN frame fan-out, drained on this (LVGL) thread
+    can_sniffer_init();
+    can_terminal_dirty = true;
+    can_terminal_timer = lv_timer_create(can_terminal_refresh_cb, CAN_SNIFFER_POLL_MS, NULL);
+}
+
+// The terminal shows the whole bus while it is on screen; elsewhere the acceptance filter
+// may drop the identifiers nothing decodes
+static void screen3_visibility_cb(lv_event_t * e)
+{
+    can_sniffer_set_all_ids(lv_event_get_code(e) == LV_EVENT_SCREEN_LOADED);
 }
 
 // Destroy Screen3
 void ui_Screen3_screen_destroy(void)
 {
+    if (can_terminal_timer) {
+        lv_timer_del(can_terminal_timer);
+        can_terminal_timer = NULL;
+    }
+    can_sniffer_set_all_ids(false);
     lv_obj_del(ui_Screen3);
+    ui_Label_CAN_Terminal = NULL;
+    ui_Label_CAN_Stats = NULL;
+    can_stats_shown_generation = 0;
 }
 
-// Add CAN message to terminal with search
-void ui_add_can_message(const char* message)
+// Runs in the LVGL task. Keeps the sniffer queue drained and rebuilds the terminal every
+// update_speed_ms; only the rows that fit on screen are formatted, however many frames arrived.
+static void can_terminal_refresh_cb(lv_timer_t * timer)
 {
-    if (ui_TextArea_CAN_Terminal) {
-        // Check search text
-        if (!is_message_matches_search(message)) {
-            return; // Message doesn't match search
+    can_sniffer_poll();
+
+    if (!ui_Label_CAN_Terminal || lv_scr_act() != ui_Screen3) {
+        return;
+    }
+    if (lv_tick_elaps(can_stats_last_render) >= CAN_STATS_SNAPSHOT_MS) {
+        can_stats_last_render = lv_tick_get();
+        ui_update_can_statistics();
+    }
+    if (!can_terminal_dirty && lv_tick_elaps(can_terminal_last_render) < (uint32_t)update_speed_ms) {
+        return;
+    }
+    can_terminal_last_render = lv_tick_get();
+    uint32_t count = can_sniffer_count();
+    if (count == can_terminal_shown_count && !can_terminal_dirty) {
+        return; // Nothing new
+    }
+
+    // With a search active, older frames may have to fill the rows
+    bool searching = search_text[0] != '\0';
+    size_t frames = can_sniffer_snapshot(can_terminal_frames, searching ? CAN_SNIFFER_RING_SIZE : CAN_TERMINAL_ROWS);
+
+    size_t len = snprintf(can_terminal_text, sizeof(can_terminal_text), "%s", CAN_SNIFFER_HEADER);
+    int rows = 0;
+    char row[256];
+    for (size_t i = 0; i < frames && rows < CAN_TERMINAL_ROWS; i++) {
+        const can_frame_t *frame = &can_terminal_frames[i];
+        if (!can_sniffer_search_in_data(frame->data, frame->dlc, search_text)) {
+            continue;
         }
-        
-        // Update message count
-        can_message_count++;
-        
-        // Statistics removed - no longer tracking message counts
-        
-        // Update message count display
-        char count_text[32];
-        snprintf(count_text, sizeof(count_text), "Messages: %d", can_message_count);
-        lv_label_set_text((lv_obj_t*)ui_Label_CAN_Count, count_text);
-        
-        // Get current text and add new message
-        const char* current_text = lv_textarea_get_text((lv_obj_t*)ui_TextArea_CAN_Terminal);
-        char new_text[4096]; // Increased buffer size
-        
-        // Find the header line to insert the new message after it
-        const char* header = strstr(current_text, "\n");
-        if (header) {
-            int header_len = (header - current_text) + 1;
-            // Copy header
-            strncpy(new_text, current_text, header_len);
-            new_text[header_len] = '\0';
-            // Append new message
-            strncat(new_text, message, sizeof(new_text) - strlen(new_text) - 1);
-            strncat(new_text, "\n", sizeof(new_text) - strlen(new_text) - 1);
-            // Append the rest of the old messages
-            strncat(new_text, header + 1, sizeof(new_text) - strlen(new_text) - 1);
-        } else {
-            // Fallback if header not found (should not happen after init)
-            snprintf(new_text, sizeof(new_text), "%s\n%s", message, current_text);
+        size_t row_len = can_sniffer_format_frame(frame, row, sizeof(row));
+        if (!is_message_matches_search(row)) {
+            continue;
         }
-        
-        // Limit text length to prevent memory issues
-        if (strlen(new_text) > 4000) {
-            // Keep header and last ~3000 chars
-            char* first_line_end = strstr(new_text, "\n");
-            if (first_line_end) {
-                char header_buf[100];
-                int header_len = first_line_end - new_text + 1;
-                strncpy(header_buf, new_text, header_len);
-                header_buf[header_len] = '\0';
-
-                char* truncated_body = new_text + strlen(new_text) - 3000;
-                char* first_msg_in_trunc = strstr(truncated_body, "\n");
-                if(first_msg_in_trunc) truncated_body = first_msg_in_trunc + 1;
-
-                snprintf(new_text, sizeof(new_text), "%s%s", header_buf, truncated_body);
-            }
+        if (len + 1 + row_len >= sizeof(can_terminal_text)) {
+            break;
         }
-        
-        lv_textarea_set_text((lv_obj_t*)ui_TextArea_CAN_Terminal, new_text);
+        can_terminal_text[len++] = '\n';
+        memcpy(&can_terminal_text[len], row, row_len + 1);
+        len += row_len;
+        rows++;
+    }
+    lv_label_set_text_static((lv_obj_t*)ui_Label_CAN_Terminal, can_terminal_text);
+
+    if (ui_Label_CAN_Count && count != can_terminal_shown_count) {
+        lv_label_set_text_fmt((lv_obj_t*)ui_Label_CAN_Count, "Messages: %lu", (unsigned long)count);
     }
+    can_terminal_shown_count = count;
+    can_terminal_dirty = false;
 }
 
 // Update CAN status and message count
@@ -460,9 +506,13 @@ void ui_update_touch_cursor_screen3(void * point)
 // Clear CAN terminal
 void ui_clear_can_terminal(void)
 {
-    if (ui_TextArea_CAN_Terminal) {
-        lv_textarea_set_text((lv_obj_t*)ui_TextArea_CAN_Terminal, "TIME         | ID  | DLC | DATA                     | ASCII    | DBC COMMENTS\n");
-        can_message_count = 0;
+    can_sniffer_clear();
+    can_terminal_shown_count = 0;
+    can_terminal_dirty = true;
+    if (ui_Label_CAN_Terminal) {
+        lv_label_set_text_static((lv_obj_t*)ui_Label_CAN_Terminal, CAN_SNIFFER_HEADER);
+    }
+    if (ui_Label_CAN_Count) {
         lv_label_set_text((lv_obj_t*)ui_Label_CAN_Count, "Messages: 0");
     }
 }
@@ -475,6 +525,7 @@ void ui_set_search_text(const char* search_text_input)
     if (search_text_input) {
         strncpy(search_text, search_text_input, sizeof(search_text) - 1);
         search_text[sizeof(search_text) - 1] = '\0';
+        can_terminal_dirty = true;
         
         if (ui_TextArea_Search) {
             lv_textarea_set_text((lv_obj_t*)ui_TextArea_Search, search_text);
@@ -496,97 +547,79 @@ void ui_set_update_speed(int speed_ms)
     }
 }
 
-// Update CAN statistics display (statistics no longer displayed)
+// Update the statistics table from the latest snapshot: bus load, then the busiest IDs
 void ui_update_can_statistics(void)
 {
-    // Statistics display removed - function kept for compatibility
-}
-
-// Reset CAN statistics (statistics no longer displayed)
-void ui_reset_can_statistics(void)
-{
-    // Statistics display removed - function kept for compatibility
-}
-
-// ============================================================================
-// CAN SNIFFER FUNCTIONS
-// ============================================================================
-
-// Add CAN message to terminal with filtering and search
-static void can_sniffer_add_message(uint32_t id, uint8_t *data, uint8_t dlc)
-{
-    if (!can_sniffer_active) return;
-
-    // Check if ID should be filtered
-    if (!can_sniffer_is_id_filtered(id)) return;
-
-    // Check if search term matches
-    if (!can_sniffer_search_in_data(data, dlc, search_text)) return;
-
-    // Format message
-    char message_buffer[256];
-    can_sniffer_format_message(message_buffer, sizeof(message_buffer), id, data, dlc);
-
-    // Add to terminal
-    ui_add_can_message(message_buffer);
-
-    // Update statistics
-    can_sniffer_update_statistics(id);
-
-    // Store last message for debugging
-    last_can_id = id;
-    last_can_dlc = dlc;
-    memcpy(last_can_data, data, dlc > 8 ? 8 : dlc);
-}
-
-// Format CAN message for display
-static void can_sniffer_format_message(char *buffer, size_t size, uint32_t id, uint8_t *data, uint8_t dlc)
-{
-    // Timestamp
-    char timestamp_str[16];
-    uint32_t tick = lv_tick_get();
-    snprintf(timestamp_str, sizeof(timestamp_str), "%lu.%03lu", tick / 1000, (tick % 1000));
+    if (!ui_Label_CAN_Stats) {
+        return;
+    }
 
-    // HEX Data
-    char data_hex_str[3 * 8 + 1] = {0};
-    for (int i = 0; i < dlc && i < 8; i++) {
-        char byte_str[4];
-        snprintf(byte_str, sizeof(byte_str), "%02X ", data[i]);
-        strncat(data_hex_str, byte_str, sizeof(data_hex_str) - strlen(data_hex_str) - 1);
+    can_stats_bus_t bus;
+    can_stats_bus_t page_bus;
+    size_t got = can_stats_snapshot(&bus, can_stats_page, 0, sizeof(can_stats_page) / sizeof(can_stats_page[0]));
+    if (bus.generation == can_stats_shown_generation) {
+        return; // Same snapshot as shown
     }
 
-    // ASCII Data
-    char data_ascii_str[9] = {0};
-    for (int i = 0; i < dlc && i < 8; i++) {
-        if (data[i] >= 32 && data[i] <= 126) { // Printable ASCII
-            data_ascii_str[i] = data[i];
-        } else {
-            data_ascii_str[i] = '.'; // Non-printable
+    // Keep the CAN_STATS_ROWS highest rates while paging through the snapshot (sorted by ID).
+    // Another reader (/can/ids) may refresh it between two pages: start over on the new one.
+    size_t top = 0;
+    for (size_t first = 0; got > 0; ) {
+        for (size_t i = 0; i < got; i++) {
+            const can_stats_id_t *entry = &can_stats_page[i];
+            size_t pos = top < CAN_STATS_ROWS ? top++ : CAN_STATS_ROWS;
+            while (pos > 0 && can_stats_top[pos - 1].rate_hz < entry->rate_hz) {
+                if (pos < CAN_STATS_ROWS) can_stats_top[pos] = can_stats_top[pos - 1];
+                pos--;
+            }
+            if (pos < CAN_STATS_ROWS) can_stats_top[pos] = *entry;
+        }
+        first += got;
+        got = can_stats_snapshot(&page_bus, can_stats_page, first, sizeof(can_stats_page) / sizeof(can_stats_page[0]));
+        if (page_bus.generation != bus.generation) {
+            got = can_stats_snapshot(&bus, can_stats_page, 0, sizeof(can_stats_page) / sizeof(can_stats_page[0]));
+            top = 0;
+            first = 0;
         }
     }
-    data_ascii_str[dlc] = '\0';
-
-    // DBC Comments (placeholder)
-    const char* dbc_comment = ""; // Placeholder for future DBC implementation
 
-    // Final formatted string
-    snprintf(buffer, size, "%-12s | %-3X | %-1d | %-24s | %-8s | %s",
-             timestamp_str,
-             (unsigned int)id,
-             dlc,
-             data_hex_str,
-             data_ascii_str,
-             dbc_comment);
+    size_t len = snprintf(can_stats_text, sizeof(can_stats_text),
+                          "Bus load %.1f%%  %.0f fr/s  %lu IDs%s\n"
+                          "ID        Hz   Period ms   Jitter   DLC", bus.bus_load_pct, bus.frames_per_s,
+                          (unsigned long)bus.ids, bus.filtered ? "  (filter on: accepted IDs only)" : "");
+    if (bus.overflow) {
+        len += snprintf(can_stats_text + len, sizeof(can_stats_text) - len, "  (%lu untracked)",
+                        (unsigned long)bus.overflow);
+    }
+    for (size_t i = 0; i < top && len < sizeof(can_stats_text); i++) {
+        const can_stats_id_t *entry = &can_stats_top[i];
+        bool ext = (entry->id & CAN_DECODER_ID_EXT_FLAG) != 0;
+        len += snprintf(can_stats_text + len, sizeof(can_stats_text) - len,
+                        ext ? "\n%08lX %5.0f %8.1f %6.2f  %u%s" : "\n%03lX      %5.0f %8.1f %6.2f  %u%s",
+                        (unsigned long)(entry->id & ~CAN_DECODER_ID_EXT_FLAG), entry->rate_hz,
+                        entry->period_mean_us / 1000.0f, entry->period_std_us / 1000.0f, entry->dlc,
+                        entry->dlc_changes ? "*" : "");
+    }
+    lv_label_set_text_static((lv_obj_t*)ui_Label_CAN_Stats, can_stats_text);
+    can_stats_shown_generation = bus.generation;
 }
 
-// Check if CAN ID should be shown (always show all messages now)
-static int can_sniffer_is_id_filtered(uint32_t id)
+// Reset CAN statistics; the CAN task clears the counters with its next batch
+void ui_reset_can_statistics(void)
 {
-    return 1; // Show all messages
+    can_stats_reset();
+    can_stats_last_render = 0;
+    if (ui_Label_CAN_Stats) {
+        lv_label_set_text_static((lv_obj_t*)ui_Label_CAN_Stats, "Bus statistics: reset");
+    }
 }
 
+// ============================================================================
+// CAN SNIFFER FUNCTIONS
+// ============================================================================
+
 // Search for text in CAN data (supports hex values and ASCII)
-static int can_sniffer_search_in_data(uint8_t *data, uint8_t dlc, const char *search_term)
+static int can_sniffer_search_in_data(const uint8_t *data, uint8_t dlc, const char *search_term)
 {
     if (!search_term || strlen(search_term) == 0) return 1; // No search term, show all
 
@@ -647,16 +680,11 @@ static int can_sniffer_search_in_data(uint8_t *data, uint8_t dlc, const char *se
     return strstr(data_ascii, search_lower) != NULL;
 }
 
-// Update statistics counters (statistics removed)
-static void can_sniffer_update_statistics(uint32_t id)
-{
-    // Statistics display removed - function simplified
-}
-
 // Enable/disable CAN sniffer
 void ui_set_can_sniffer_active(int active)
 {
     can_sniffer_active = active;
+    can_sniffer_set_enabled(active);
     if (active) {
         // Clear terminal when enabling
         ui_clear_can_terminal();
@@ -666,15 +694,9 @@ void ui_set_can_sniffer_active(int active)
 // Get last CAN message for debugging
 void ui_get_last_can_message(uint32_t *id, uint8_t *data, uint8_t *dlc)
 {
-    if (id) *id = last_can_id;
-    if (data) memcpy(data, last_can_data, 8);
-    if (dlc) *dlc = last_can_dlc;
-}
-
-// Process real CAN message from ESP32 TWAI driver
-void ui_process_real_can_message(uint32_t id, uint8_t *data, uint8_t dlc)
-{
-    if (can_sniffer_active) {
-        can_sniffer_add_message(id, data, dlc);
-    }
+    can_frame_t frame = {0};
+    can_sniffer_snapshot(&frame, 1);
+    if (id) *id = frame.id;
+    if (data) memcpy(data, frame.data, 8);
+    if (dlc) *dlc = frame.dlc;
 }
@@ -2,6 +2,7 @@
 #include "../ui.h"
 #include "ui_Screen4.h"
 #include "ui_screen_manager.h"
+#include "../components/ui_comp_gauge.h"
 #include "ui_helpers.h"
 #include <stdio.h>
 #include <esp_log.h>
@@ -38,54 +39,8 @@ static lv_anim_t anim_eng_tq_req;
 static void swipe_handler_screen4(lv_event_t * e);
 static void anim_value_cb_screen4(void * var, int32_t v);
 
-// Helper function to create a gauge
-static void create_gauge(lv_obj_t * parent, lv_obj_t ** arc, lv_obj_t ** label,
-                        const char * title, const char * unit, lv_color_t color,
-                        int32_t min_val, int32_t max_val, int x, int y)
-{
-    lv_obj_t * cont = lv_obj_create(parent);
-    lv_obj_set_width(cont, 250);
-    lv_obj_set_height(cont, 200);
-    lv_obj_set_x(cont, x);
-    lv_obj_set_y(cont, y);
-    lv_obj_set_align(cont, LV_ALIGN_TOP_LEFT);
-    lv_obj_clear_flag(cont, LV_OBJ_FLAG_SCROLLABLE);
-    lv_obj_set_style_bg_color(cont, lv_color_hex(0x2a2a2a), 0);
-    lv_obj_set_style_border_color(cont, color, 0);
-    lv_obj_set_style_border_width(cont, 2, 0);
-    lv_obj_set_style_radius(cont, 15, 0);
-    lv_obj_set_style_pad_all(cont, 10, 0);
-
-    lv_obj_t * label_title = lv_label_create(cont);
-    lv_label_set_text(label_title, title);
-    lv_obj_set_style_text_color(label_title, lv_color_white(), 0);
-    lv_obj_align(label_title, LV_ALIGN_BOTTOM_MID, 0, -15);
-
-    *arc = lv_arc_create(cont);
-    lv_obj_set_size(*arc, 160, 160);
-    lv_arc_set_rotation(*arc, 135);
-    lv_arc_set_bg_angles(*arc, 0, 270);
-    lv_arc_set_range(*arc, min_val, max_val);
-    lv_arc_set_value(*arc, min_val);
-    lv_obj_set_style_arc_color(*arc, color, LV_PART_INDICATOR);
-    lv_obj_set_style_arc_width(*arc, 15, LV_PART_INDICATOR);
-    lv_obj_set_style_arc_color(*arc, lv_color_hex(0x4a4a4a), LV_PART_MAIN);
-    lv_obj_set_style_arc_width(*arc, 15, LV_PART_MAIN);
-    lv_obj_center(*arc);
-    lv_obj_remove_style(*arc, NULL, LV_PART_KNOB);
-    lv_obj_clear_flag(*arc, LV_OBJ_FLAG_CLICKABLE);
-
-    *label = lv_label_create(cont);
-    lv_label_set_text(*label, "0");
-    lv_obj_set_style_text_color(*label, lv_color_white(), 0);
-    lv_obj_center(*label);
-    lv_obj_align(*label, LV_ALIGN_CENTER, 0, -5);
-
-    lv_obj_t * label_unit = lv_label_create(cont);
-    lv_label_set_text(label_unit, unit);
-    lv_obj_set_style_text_color(label_unit, lv_color_hex(0xcccccc), 0);
-    lv_obj_align_to(label_unit, *label, LV_ALIGN_OUT_BOTTOM_MID, 0, 5);
-}
+// Gauge card height on this screen
+#define GAUGE_HEIGHT 200
 
 
 // Main screen initialization
@@ -99,13 +54,13 @@ void ui_Screen4_screen_init(void) {
     // Title removed as per user request to provide more space.
 
     // Row 1 - Centered vertically
-    create_gauge(ui_Screen4, &ui_Arc_Abs_Pedal, &ui_Label_Abs_Pedal_Value, "Abs. Pedal Pos", "%", lv_color_hex(0x00D4FF), 0, 100, 15, 35);
-    create_gauge(ui_Screen4, &ui_Arc_WG_Pos, &ui_Label_WG_Pos_Value, "Wastegate Pos", "%", lv_color_hex(0x00FF88), 0, 100, 285, 35);
-    create_gauge(ui_Screen4, &ui_Arc_BOV, &ui_Label_BOV_Value, "BOV", "%", lv_color_hex(0xFFD700), 0, 100, 545, 35);
+    ui_gauge_create(ui_Screen4, &ui_Arc_Abs_Pedal, &ui_Label_Abs_Pedal_Value, "Abs. Pedal Pos", "%", lv_color_hex(0x00D4FF), 0, 100, 15, 35, GAUGE_HEIGHT);
+    ui_gauge_create(ui_Screen4, &ui_Arc_WG_Pos, &ui_Label_WG_Pos_Value, "Wastegate Pos", "%", lv_color_hex(0x00FF88), 0, 100, 285, 35, GAUGE_HEIGHT);
+    ui_gauge_create(ui_Screen4, &ui_Arc_BOV, &ui_Label_BOV_Value, "BOV", "%", lv_color_hex(0xFFD700), 0, 100, 545, 35, GAUGE_HEIGHT);
     // Row 2 - Centered vertically
-    create_gauge(ui_Screen4, &ui_Arc_TCU_TQ_Req, &ui_Label_TCU_TQ_Req_Value, "TCU Tq Req", "Nm", lv_color_hex(0xFF6B35), 0, 500, 15, 245);
-    create_gauge(ui_Screen4, &ui_Arc_TCU_TQ_Act, &ui_Label_TCU_TQ_Act_Value, "TCU Tq Act", "Nm", lv_color_hex(0xFF3366), 0, 500, 285, 245);
-    create_gauge(ui_Screen4, &ui_Arc_Eng_TQ_Req, &ui_Label_Eng_TQ_Req_Value, "Eng Tq Req", "Nm", lv_color_hex(0x8A2BE2), 0, 500, 545, 245);
+    ui_gauge_create(ui_Screen4, &ui_Arc_TCU_TQ_Req, &ui_Label_TCU_TQ_Req_Value, "TCU Tq Req", "Nm", lv_color_hex(0xFF6B35), 0, 500, 15, 245, GAUGE_HEIGHT);
+    ui_gauge_create(ui_Screen4, &ui_Arc_TCU_TQ_Act, &ui_Label_TCU_TQ_Act_Value, "TCU Tq Act", "Nm", lv_color_hex(0xFF3366), 0, 500, 285, 245, GAUGE_HEIGHT);
+    ui_gauge_create(ui_Screen4, &ui_Arc_Eng_TQ_Req, &ui_Label_Eng_TQ_Req_Value, "Eng Tq Req", "Nm", lv_color_hex(0x8A2BE2), 0, 500, 545, 245, GAUGE_HEIGHT);
 
     // Add standardized navigation buttons
     ui_create_standard_navigation_buttons(ui_Screen4);
@@ -172,7 +127,7 @@ void ui_Screen4_screen_init(void) {
 
 static void anim_value_cb_screen4(void * var, int32_t v)
 {
-    lv_arc_set_value((lv_obj_t *)var, v);
+    ui_gauge_set_value((lv_obj_t *)var, (int16_t)v, NULL);
 
     if (var == ui_Arc_Abs_Pedal) lv_label_set_text_fmt(ui_Label_Abs_Pedal_Value, "%d", v);
     else if (var == ui_Arc_WG_Pos) lv_label_set_text_fmt(ui_Label_WG_Pos_Value, "%d", v);
@@ -208,7 +208,7 @@ esp_err_t settings_load(void) {
         // Release mutex after file operations
         xSemaphoreGive(sd_card_mutex);
         
-        ESP_LOGI(TAG, "Read %d bytes from settings.cfg: %s", bytes_read, buffer);
+        ESP_LOGI(TAG, "Read %zu bytes from settings.cfg: %s", bytes_read, buffer);
         
         if (settings_from_json(buffer, &current_settings)) {
             ESP_LOGI(TAG, "Settings loaded from settings.cfg successfully.");
@@ -321,8 +321,11 @@ void ui_switch_to_screen(screen_id_t screen_id)
 
         default:
             ESP_LOGW("SCREEN_MANAGER", "Unknown screen ID: %d", screen_id);
-            break;
+            return;
     }
+
+    // Gauges of the new screen catch up without waiting for the next CAN frame
+    ui_updates_request_refresh();
 }
 
 // Get current screen
@@ -1,73 +1,276 @@
 #include "ui_updates.h"
 #include "ui.h"
+#include "components/ui_comp_gauge.h"
+#include "components/ui_comp_digits.h"
 #include "ecu_data.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdatomic.h>
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
 
-// This function is called periodically by the LVGL task.
-// It reads the latest data from the global ECU data struct
-// and updates all the gauge widgets on all screens.
-void update_all_gauges(void) {
-    ecu_data_t data_copy;
+static const char *TAG = "UI_UPDATES";
 
-    // Get a thread-safe copy of the latest ECU data
-    ecu_data_get_copy(&data_copy);
+// Interval of the invalidation statistics log
+#define UI_UPDATES_STATS_PERIOD_US  (10 * 1000000LL)
+
+// Label text of a gauge value, as the labels have always shown it
+typedef enum {
+    GAUGE_LABEL_INT,     // Truncated to an integer ("%d")
+    GAUGE_LABEL_0DP,     // Rounded, no decimals ("%.0f")
+    GAUGE_LABEL_1DP,     // One decimal ("%.1f")
+} gauge_label_format_t;
+
+// One gauge: arc + value label bound to an ECU signal. The screen comes first: screens are
+// deleted as a whole and their pointer nulled, so the widgets of the active screen are alive.
+typedef struct {
+    lv_obj_t **screen;
+    lv_obj_t **arc;
+    lv_obj_t **label;
+    ecu_signal_t signal;
+    float deadband;      // Minimum change (signal units) before the arc is redrawn
+    gauge_label_format_t format;
+} gauge_binding_t;
+
+// What is currently on screen for a binding
+typedef struct {
+    float value;         // Last value the arc was set to
+    int16_t arc_value;   // As stored by the arc (clamped to its range)
+    bool rendered;
+    char text[16];       // Label text last set
+} gauge_state_t;
+
+// NOTE: The "Target Boost" gauge on Screen 1 and all gauges on Screen 2 are for display only.
+// The current CAN bus specification provided by the user does not include data for these values.
+// They will animate in demo mode but will not show live data.
+static const gauge_binding_t gauge_bindings[] = {
+    // Screen 1
+    { &ui_Screen1, &ui_Arc_RPM,         &ui_Label_RPM_Value,         ECU_SIG_ENGINE_RPM,     25.0f, GAUGE_LABEL_INT },
+    { &ui_Screen1, &ui_Arc_TPS,         &ui_Label_TPS_Value,         ECU_SIG_TPS_POSITION,   0.2f,  GAUGE_LABEL_1DP },
+    { &ui_Screen1, &ui_Arc_MAP,         &ui_Label_MAP_Value,         ECU_SIG_MAP_KPA,        1.0f,  GAUGE_LABEL_0DP },
+    { &ui_Screen1, &ui_Arc_Wastegate,   &ui_Label_Wastegate_Value,   ECU_SIG_WG_POS_PERCENT, 0.2f,  GAUGE_LABEL_1DP },
+    // Screen 4
+    { &ui_Screen4, &ui_Arc_Abs_Pedal,   &ui_Label_Abs_Pedal_Value,   ECU_SIG_ABS_PEDAL_POS,  0.2f,  GAUGE_LABEL_1DP },
+    { &ui_Screen4, &ui_Arc_WG_Pos,      &ui_Label_WG_Pos_Value,      ECU_SIG_WG_POS_PERCENT, 0.2f,  GAUGE_LABEL_1DP },
+    { &ui_Screen4, &ui_Arc_BOV,         &ui_Label_BOV_Value,         ECU_SIG_BOV_PERCENT,    0.2f,  GAUGE_LABEL_1DP },
+    { &ui_Screen4, &ui_Arc_TCU_TQ_Req,  &ui_Label_TCU_TQ_Req_Value,  ECU_SIG_TCU_TQ_REQ_NM,  1.0f,  GAUGE_LABEL_0DP },
+    { &ui_Screen4, &ui_Arc_TCU_TQ_Act,  &ui_Label_TCU_TQ_Act_Value,  ECU_SIG_TCU_TQ_ACT_NM,  1.0f,  GAUGE_LABEL_0DP },
+    { &ui_Screen4, &ui_Arc_Eng_TQ_Req,  &ui_Label_Eng_TQ_Req_Value,  ECU_SIG_ENG_TRG_NM,     1.0f,  GAUGE_LABEL_0DP },
+    // Screen 5
+    { &ui_Screen5, &ui_Arc_Eng_TQ_Act,  &ui_Label_Eng_TQ_Act_Value,  ECU_SIG_ENG_ACT_NM,     1.0f,  GAUGE_LABEL_0DP },
+    { &ui_Screen5, &ui_Arc_Limit_TQ,    &ui_Label_Limit_TQ_Value,    ECU_SIG_LIMIT_TQ_NM,    1.0f,  GAUGE_LABEL_0DP },
+};
+
+#define GAUGE_BINDING_COUNT (sizeof(gauge_bindings) / sizeof(gauge_bindings[0]))
+
+static gauge_state_t gauge_states[GAUGE_BINDING_COUNT];
+
+// Change detection state
+static uint32_t last_sequence = 0;
+static lv_obj_t *last_screen = NULL;
+
+// Event wakeup. Ingest times are kept as the low 32 bits of esp_timer (wraps after
+// ~71 min, differences stay valid); 0 means "nothing pending".
+static TaskHandle_t ui_task = NULL;
+static atomic_uint_least32_t pending_ingest_us = 0;   // Oldest unrendered CAN batch
+static uint32_t drawn_ingest_us = 0;                   // Invalidated, waiting for the flush
 
-    char buffer[50];
+// Invalidation statistics
+static uint32_t stat_invalidations = 0;   // Widget updates issued this period
+static uint32_t stat_candidates = 0;      // Updates the unconditional refresh would have issued
+static uint32_t stat_passes = 0;
+static uint64_t stat_arc_px = 0;          // Arc pixels invalidated
+static uint64_t stat_arc_lvgl_px = 0;     // What lv_arc_set_value() would have invalidated
+static uint32_t stat_latency_samples = 0;
+static uint64_t stat_latency_sum_us = 0;
+static uint32_t stat_latency_max_us = 0;
+static int64_t stat_period_start = 0;
+static ui_updates_stats_t last_stats;
 
-    // --- Update Screen 1 Widgets ---
-    if (lv_obj_is_valid(ui_Arc_RPM)) {
-        lv_arc_set_value(ui_Arc_RPM, (int16_t)data_copy.engine_rpm);
-        lv_label_set_text_fmt(ui_Label_RPM_Value, "%d", (int)data_copy.engine_rpm);
+void ui_updates_register_task(void)
+{
+    ui_task = xTaskGetCurrentTaskHandle();
+}
+
+void ui_updates_notify(uint32_t changed_mask, int64_t ingest_us)
+{
+    if (!ui_task || changed_mask == 0) {
+        return;
     }
-    if (lv_obj_is_valid(ui_Arc_TPS)) {
-        lv_arc_set_value(ui_Arc_TPS, (int16_t)data_copy.tps_position);
-        lv_label_set_text_fmt(ui_Label_TPS_Value, "%.1f", data_copy.tps_position);
+    // Keep the oldest timestamp until the UI task picks it up
+    uint32_t ts = (uint32_t)ingest_us;
+    uint32_t expected = 0;
+    atomic_compare_exchange_strong(&pending_ingest_us, &expected, ts ? ts : 1);
+    xTaskNotify(ui_task, changed_mask, eSetBits);
+}
+
+void ui_updates_request_refresh(void)
+{
+    if (ui_task) {
+        xTaskNotify(ui_task, UI_UPDATES_NOTIFY_REFRESH, eSetBits);
     }
-    if (lv_obj_is_valid(ui_Arc_MAP)) {
-        lv_arc_set_value(ui_Arc_MAP, (int16_t)data_copy.map_kpa);
-        lv_label_set_text_fmt(ui_Label_MAP_Value, "%.0f", data_copy.map_kpa);
+}
+
+void ui_updates_frame_rendered(void)
+{
+    if (drawn_ingest_us == 0) {
+        return;
     }
-    if (lv_obj_is_valid(ui_Arc_Wastegate)) {
-        lv_arc_set_value(ui_Arc_Wastegate, (int16_t)data_copy.wg_pos_percent);
-        lv_label_set_text_fmt(ui_Label_Wastegate_Value, "%.1f", data_copy.wg_pos_percent);
+    uint32_t latency = (uint32_t)esp_timer_get_time() - drawn_ingest_us;
+    drawn_ingest_us = 0;
+
+    stat_latency_samples++;
+    stat_latency_sum_us += latency;
+    if (latency > stat_latency_max_us) {
+        stat_latency_max_us = latency;
     }
-    // NOTE: The "Target Boost" gauge on Screen 1 and all gauges on Screen 2 are for display only.
-    // The current CAN bus specification provided by the user does not include data for these values.
-    // They will animate in demo mode but will not show live data.
-
-    // --- Update Screen 4 Widgets ---
-    if (lv_obj_is_valid(ui_Arc_Abs_Pedal)) {
-        lv_arc_set_value(ui_Arc_Abs_Pedal, (int16_t)data_copy.abs_pedal_pos);
-        lv_label_set_text_fmt(ui_Label_Abs_Pedal_Value, "%.1f", data_copy.abs_pedal_pos);
+}
+
+static void update_statistics(void)
+{
+    // Without change detection every arc and label was set on every pass
+    stat_candidates += 2 * GAUGE_BINDING_COUNT;
+    stat_passes++;
+
+    int64_t now = esp_timer_get_time();
+    if (stat_period_start == 0) {
+        stat_period_start = now;
+        return;
     }
-    if (lv_obj_is_valid(ui_Arc_WG_Pos)) {
-        lv_arc_set_value(ui_Arc_WG_Pos, (int16_t)data_copy.wg_pos_percent);
-        lv_label_set_text_fmt(ui_Label_WG_Pos_Value, "%.1f", data_copy.wg_pos_percent);
+    int64_t elapsed = now - stat_period_start;
+    if (elapsed < UI_UPDATES_STATS_PERIOD_US) {
+        return;
     }
-    if (lv_obj_is_valid(ui_Arc_BOV)) {
-        lv_arc_set_value(ui_Arc_BOV, (int16_t)data_copy.bov_percent);
-        lv_label_set_text_fmt(ui_Label_BOV_Value, "%.1f", data_copy.bov_percent);
+
+    last_stats.invalidations_per_s = (uint32_t)((int64_t)stat_invalidations * 1000000 / elapsed);
+    last_stats.unconditional_per_s = (uint32_t)((int64_t)stat_candidates * 1000000 / elapsed);
+    last_stats.passes_per_s = (uint32_t)((int64_t)stat_passes * 1000000 / elapsed);
+    last_stats.arc_px_per_s = (uint32_t)((int64_t)stat_arc_px * 1000000 / elapsed);
+    last_stats.arc_lvgl_px_per_s = (uint32_t)((int64_t)stat_arc_lvgl_px * 1000000 / elapsed);
+    last_stats.latency_samples = stat_latency_samples;
+    last_stats.latency_avg_us = stat_latency_samples ? (uint32_t)(stat_latency_sum_us / stat_latency_samples) : 0;
+    last_stats.latency_max_us = stat_latency_max_us;
+    ESP_LOGI(TAG, "Gauge invalidations: %lu/s (unconditional refresh: %lu/s), %lu passes/s",
+             (unsigned long)last_stats.invalidations_per_s, (unsigned long)last_stats.unconditional_per_s,
+             (unsigned long)last_stats.passes_per_s);
+    ESP_LOGI(TAG, "Arc pixels invalidated: %lu/s (whole sweep box: %lu/s)",
+             (unsigned long)last_stats.arc_px_per_s, (unsigned long)last_stats.arc_lvgl_px_per_s);
+    if (stat_latency_samples) {
+        ESP_LOGI(TAG, "CAN-to-pixel latency: avg %lu us, max %lu us (%lu frames)",
+                 (unsigned long)last_stats.latency_avg_us, (unsigned long)last_stats.latency_max_us,
+                 (unsigned long)last_stats.latency_samples);
     }
-    if (lv_obj_is_valid(ui_Arc_TCU_TQ_Req)) {
-        lv_arc_set_value(ui_Arc_TCU_TQ_Req, (int16_t)data_copy.tcu_tq_req_nm);
-        lv_label_set_text_fmt(ui_Label_TCU_TQ_Req_Value, "%.0f", data_copy.tcu_tq_req_nm);
+
+    stat_invalidations = 0;
+    stat_candidates = 0;
+    stat_passes = 0;
+    stat_arc_px = 0;
+    stat_arc_lvgl_px = 0;
+    stat_latency_samples = 0;
+    stat_latency_sum_us = 0;
+    stat_latency_max_us = 0;
+    stat_period_start = now;
+}
+
+static void format_label(const gauge_binding_t *binding, float value, char *text, size_t size)
+{
+    switch (binding->format) {
+    case GAUGE_LABEL_INT:
+        snprintf(text, size, "%d", (int)value);
+        break;
+    case GAUGE_LABEL_0DP:
+        snprintf(text, size, "%.0f", value);
+        break;
+    default:
+        snprintf(text, size, "%.1f", value);
+        break;
     }
-    if (lv_obj_is_valid(ui_Arc_TCU_TQ_Act)) {
-        lv_arc_set_value(ui_Arc_TCU_TQ_Act, (int16_t)data_copy.tcu_tq_act_nm);
-        lv_label_set_text_fmt(ui_Label_TCU_TQ_Act_Value, "%.0f", data_copy.tcu_tq_act_nm);
+}
+
+static void render_arc(const gauge_binding_t *binding, gauge_state_t *state, float value)
+{
+    // Nothing is invalidated if the clamped value is unchanged, and only the swept ring otherwise
+    lv_obj_t *arc = *binding->arc;
+    int16_t shown = lv_arc_get_value(arc);
+    uint32_t lvgl_px;
+    stat_arc_px += ui_gauge_set_value(arc, (int16_t)value, &lvgl_px);
+    stat_arc_lvgl_px += lvgl_px;
+    state->arc_value = lv_arc_get_value(arc);
+    if (state->arc_value != shown) {
+        stat_invalidations++;
     }
-    if (lv_obj_is_valid(ui_Arc_Eng_TQ_Req)) {
-        lv_arc_set_value(ui_Arc_Eng_TQ_Req, (int16_t)data_copy.eng_trg_nm);
-        lv_label_set_text_fmt(ui_Label_Eng_TQ_Req_Value, "%.0f", data_copy.eng_trg_nm);
+    state->value = value;
+}
+
+static void render_label(const gauge_binding_t *binding, gauge_state_t *state, const char *text)
+{
+    // Only the digits that changed are redrawn, from the glyph atlas
+    memcpy(state->text, text, sizeof(state->text));
+    ui_digits_set_text(*binding->label, state->text);
+    stat_invalidations++;
+}
+
+// This function is called by the UI update task when it is notified.
+// It reads the latest data from the global ECU data struct and redraws the
+// labels whose text changed and the arcs that moved by more than their deadband,
+// on the active screen.
+void update_all_gauges(void) {
+    update_statistics();
+
+    uint32_t ingest_us = atomic_exchange(&pending_ingest_us, 0);
+    lv_obj_t *screen = lv_scr_act();
+    uint32_t sequence = ecu_data_get_sequence();
+    if (sequence == last_sequence && screen == last_screen) {
+        return; // Nothing new to show
     }
 
-    // --- Update Screen 5 Widgets ---
-    if (lv_obj_is_valid(ui_Arc_Eng_TQ_Act)) {
-        lv_arc_set_value(ui_Arc_Eng_TQ_Act, (int16_t)data_copy.eng_act_nm);
-        lv_label_set_text_fmt(ui_Label_Eng_TQ_Act_Value, "%.0f", data_copy.eng_act_nm);
+    ecu_data_t data_copy;
+    ecu_data_get_copy(&data_copy);
+
+    uint32_t invalidations = stat_invalidations;
+    for (size_t i = 0; i < GAUGE_BINDING_COUNT; i++) {
+        const gauge_binding_t *binding = &gauge_bindings[i];
+        gauge_state_t *state = &gauge_states[i];
+        lv_obj_t *arc = *binding->arc;
+
+        // Hidden screens keep their last rendered state and catch up when shown
+        if (*binding->screen != screen || !arc || !*binding->label) {
+            continue;
+        }
+
+        // The label always shows the latest value: a signal settling within the deadband of
+        // the last redraw must not leave it stale. The deadband only spares the arc, which
+        // moves by a fraction of a pixel there. Both are redrawn if something else (demo
+        // animations) touched them.
+        float value = *ecu_data_field(&data_copy, binding->signal);
+        char text[sizeof(state->text)];
+        format_label(binding, value, text, sizeof(text));
+        if (!state->rendered || fabsf(value - state->value) >= binding->deadband ||
+            lv_arc_get_value(arc) != state->arc_value) {
+            render_arc(binding, state, value);
+        }
+        if (!state->rendered || strcmp(text, state->text) != 0 ||
+            strcmp(lv_label_get_text(*binding->label), state->text) != 0) {
+            render_label(binding, state, text);
+        }
+        state->rendered = true;
     }
-    if (lv_obj_is_valid(ui_Arc_Limit_TQ)) {
-        lv_arc_set_value(ui_Arc_Limit_TQ, (int16_t)data_copy.limit_tq_nm);
-        lv_label_set_text_fmt(ui_Label_Limit_TQ_Value, "%.0f", data_copy.limit_tq_nm);
+
+    // Latency is measured from the oldest frame waiting for the next flush
+    if (stat_invalidations != invalidations && ingest_us != 0 && drawn_ingest_us == 0) {
+        drawn_ingest_us = ingest_us;
+    }
+
+    last_sequence = sequence;
+    last_screen = screen;
+}
+
+void ui_updates_get_stats(ui_updates_stats_t *stats)
+{
+    if (stats) {
+        *stats = last_stats;
     }
 }
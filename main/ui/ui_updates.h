@@ -1,15 +1,49 @@
 #ifndef UI_UPDATES_H
 #define UI_UPDATES_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// This function is called periodically by the LVGL task.
-// It reads the latest data from the global ECU data struct
-// and updates all the gauge widgets on all screens.
+// Gauge widget updates, measured over the last statistics period (10 s)
+typedef struct {
+    uint32_t invalidations_per_s;  // Arc/label changes actually issued
+    uint32_t unconditional_per_s;  // Changes setting every widget on every pass would issue
+    uint32_t passes_per_s;         // update_all_gauges() runs
+    uint32_t arc_px_per_s;         // Arc pixels invalidated (swept ring only)
+    uint32_t arc_lvgl_px_per_s;    // Pixels a box around each whole sweep would cover
+    uint32_t latency_samples;      // Frames that showed new CAN data
+    uint32_t latency_avg_us;       // CAN frame received -> frame containing it flushed to the panel
+    uint32_t latency_max_us;
+} ui_updates_stats_t;
+
+// Notification bit for "redraw even without new ECU data" (screen change).
+// The ECU signal mask uses the low bits.
+#define UI_UPDATES_NOTIFY_REFRESH  (1UL << 31)
+
+// Make the calling task the one woken by ui_updates_notify(). Called once by the UI task.
+void ui_updates_register_task(void);
+
+// Called by the CAN ingest path after a batch changed ECU signals.
+// ingest_us is the receive time of the oldest frame in the batch (esp_timer).
+void ui_updates_notify(uint32_t changed_mask, int64_t ingest_us);
+
+// Wake the UI task without new data, e.g. after a screen change
+void ui_updates_request_refresh(void);
+
+// Called by the display driver after LVGL flushed a frame (LVGL lock held)
+void ui_updates_frame_rendered(void);
+
+// Called by the UI task when notified (LVGL lock held).
+// It reads the latest data from the global ECU data struct and updates the
+// labels of the active screen whose text changed and the arcs that moved by more
+// than their deadband.
 void update_all_gauges(void);
 
+void ui_updates_get_stats(ui_updates_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -4,13 +4,29 @@
 
 #include "esp_http_server.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <math.h>
 #include "include/can_websocket.h"
+#include "include/canbus.h"
+#include "include/can_fanout.h"
+#include "include/can_log.h"
+#include "include/can_log_export.h"
+#include "include/can_stats.h"
+#include "include/can_decoder.h"
+#include "include/task_config.h"
+#include "include/task_monitor.h"
+#include "ui/ui_updates.h"
 #include "ui/settings_config.h"
 
 static const char *TAG = "WEB_SERVER";
 
+#define LOG_LIST_MAX_FILES      256
+#define LOG_EXPORT_CHUNK_SIZE   4096    // Per download; whole sectors per card read
+
 // Simple HTML dashboard
 const char dashboard_html[] = R"HTML(
 <!DOCTYPE html>
@@ -588,12 +604,418 @@ static esp_err_t can_data_handler(httpd_req_t *req)
     return ESP_FAIL;
 }
 
+// Handler for CAN receive counters
+static esp_err_t can_stats_handler(httpd_req_t *req)
+{
+    canbus_stats_t stats;
+    esp_err_t ret = canbus_get_stats(&stats);
+    if (ret != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "CAN driver not running");
+        return ESP_OK;
+    }
+
+    ui_updates_stats_t ui_stats;
+    ui_updates_get_stats(&ui_stats);
+
+    char json_data[2048];
+    int len = snprintf(json_data, sizeof(json_data),
+        "{\"frames_received\":%lu,\"batches\":%lu,\"max_batch\":%lu,\"rx_queued\":%lu,"
+        "\"rx_missed\":%lu,\"rx_overrun\":%lu,\"bus_errors\":%lu,\"arb_lost\":%lu,"
+        "\"rx_error_counter\":%lu,\"tx_error_counter\":%lu,\"state\":%lu,"
+        "\"ui_latency_avg_us\":%lu,\"ui_latency_max_us\":%lu,\"ui_passes_per_s\":%lu,\"subscribers\":[",
+        (unsigned long)stats.frames_received, (unsigned long)stats.batches, (unsigned long)stats.max_batch,
+        (unsigned long)stats.rx_queued, (unsigned long)stats.rx_missed, (unsigned long)stats.rx_overrun,
+        (unsigned long)stats.bus_errors, (unsigned long)stats.arb_lost,
+        (unsigned long)stats.rx_error_counter, (unsigned long)stats.tx_error_counter, (unsigned long)stats.state,
+        (unsigned long)ui_stats.latency_avg_us, (unsigned long)ui_stats.latency_max_us,
+        (unsigned long)ui_stats.passes_per_s);
+
+    // Frame fan-out consumers and the frames they lost by falling behind
+    can_fanout_stats_t subscribers[CAN_FANOUT_MAX_SUBSCRIBERS];
+    size_t subscriber_count = can_fanout_get_stats(subscribers, CAN_FANOUT_MAX_SUBSCRIBERS);
+    for (size_t i = 0; i < subscriber_count && len < (int)sizeof(json_data); i++) {
+        len += snprintf(json_data + len, sizeof(json_data) - len,
+            "%s{\"name\":\"%s\",\"delivered\":%lu,\"dropped\":%lu,\"queued\":%lu,\"capacity\":%lu}",
+            i ? "," : "", subscribers[i].name, (unsigned long)subscribers[i].delivered,
+            (unsigned long)subscribers[i].dropped, (unsigned long)subscribers[i].queued,
+            (unsigned long)subscribers[i].capacity);
+    }
+
+    // SD card trace logger
+    can_log_stats_t log_stats;
+    can_log_get_stats(&log_stats);
+    if (len < (int)sizeof(json_data)) {
+        len += snprintf(json_data + len, sizeof(json_data) - len,
+            "],\"logger\":{\"running\":%s,\"file\":\"%s\",\"frames_logged\":%lu,\"frames_dropped\":%lu,"
+            "\"files_fragmented\":%lu,\"buffer_waits\":%lu,\"write_errors\":%lu,\"write_avg_us\":%lu,\"write_max_us\":%lu,"
+            "\"sync_max_us\":%lu,\"create_max_us\":%lu}",
+            log_stats.running ? "true" : "false", log_stats.file,
+            (unsigned long)log_stats.frames_logged, (unsigned long)log_stats.frames_dropped,
+            (unsigned long)log_stats.files_fragmented,
+            (unsigned long)log_stats.buffer_waits, (unsigned long)log_stats.write_errors,
+            (unsigned long)log_stats.write_avg_us, (unsigned long)log_stats.write_max_us,
+            (unsigned long)log_stats.sync_max_us, (unsigned long)log_stats.create_max_us);
+    }
+
+    // Acceptance filter and the share of the observed bus traffic it lets through
+    // (null until there was traffic to rate it on)
+    can_filter_plan_t filter;
+    canbus_get_filter(&filter);
+    char accepted_pct[16] = "null", unwanted_pct[16] = "null";
+    if (filter.traffic_frames) {
+        snprintf(accepted_pct, sizeof(accepted_pct), "%.1f", 100.0f * filter.accepted_fraction);
+        snprintf(unwanted_pct, sizeof(unwanted_pct), "%.1f", 100.0f * filter.unwanted_fraction);
+    }
+    if (len < (int)sizeof(json_data)) {
+        snprintf(json_data + len, sizeof(json_data) - len,
+            ",\"filter\":{\"mode\":\"%s\",\"code\":\"0x%08lX\",\"mask\":\"0x%08lX\","
+            "\"accepted_pct\":%s,\"unwanted_pct\":%s,\"traffic_frames\":%lu}}",
+            filter.accept_all ? "all" : (filter.single_filter ? "single" : "dual"),
+            (unsigned long)filter.acceptance_code, (unsigned long)filter.acceptance_mask,
+            accepted_pct, unwanted_pct, (unsigned long)filter.traffic_frames);
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_send(req, json_data, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// Handler for the per-ID statistics, refreshed at most every CAN_STATS_SNAPSHOT_MS:
+// {"bus_load_pct":..,"filtered":..,"ids":[{"id":"0x280","count":..,"rate_hz":..,"period_us":{...},...}]}
+// "filtered": an acceptance filter hid part of the bus, the figures cover the accepted IDs.
+static esp_err_t can_ids_handler(httpd_req_t *req)
+{
+    // The whole snapshot in one call: chunks already sent cannot be taken back if another
+    // reader refreshed it between two pages
+    can_stats_id_t *ids = heap_caps_malloc(CAN_STATS_SLOTS * sizeof(*ids), MALLOC_CAP_SPIRAM);
+    if (!ids) {
+        ids = malloc(CAN_STATS_SLOTS * sizeof(*ids));
+    }
+    if (!ids) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_OK;
+    }
+    // Static, off the httpd stack: requests are served one at a time
+    static char chunk[4096];            // About 210 characters per ID in JSON
+
+    can_stats_bus_t bus;
+    size_t count = can_stats_snapshot(&bus, ids, 0, CAN_STATS_SLOTS);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    // One chunk per 16 IDs: up to CAN_STATS_SLOTS entries do not fit one buffer
+    int len = snprintf(chunk, sizeof(chunk),
+        "{\"frames\":%llu,\"frames_per_s\":%.1f,\"bus_load_pct\":%.2f,\"filtered\":%s,\"bitrate\":%lu,"
+        "\"id_count\":%lu,\"overflow\":%lu,\"generation\":%lu,\"ids\":[",
+        (unsigned long long)bus.frames, bus.frames_per_s, bus.bus_load_pct, bus.filtered ? "true" : "false",
+        (unsigned long)bus.bitrate, (unsigned long)bus.ids, (unsigned long)bus.overflow,
+        (unsigned long)bus.generation);
+    esp_err_t ret = ESP_OK;
+    for (size_t first = 0; first < count && ret == ESP_OK; ) {
+        size_t got = count - first < 16 ? count - first : 16;
+        for (size_t i = 0; i < got; i++) {
+            const can_stats_id_t *entry = &ids[first + i];
+            char data[17];
+            for (uint8_t b = 0; b < 8; b++) {
+                snprintf(&data[b * 2], 3, "%02X", entry->data[b]);
+            }
+            data[(entry->dlc < 8 ? entry->dlc : 8) * 2] = '\0';
+            len += snprintf(chunk + len, sizeof(chunk) - len,
+                "%s{\"id\":\"0x%lX\",\"ext\":%s,\"count\":%lu,\"rate_hz\":%.1f,"
+                "\"period_us\":{\"mean\":%.0f,\"min\":%lu,\"max\":%lu,\"std\":%.1f},"
+                "\"dlc\":%u,\"dlc_changes\":%lu,\"data\":\"%s\"}",
+                first + i ? "," : "", (unsigned long)(entry->id & ~CAN_DECODER_ID_EXT_FLAG),
+                (entry->id & CAN_DECODER_ID_EXT_FLAG) ? "true" : "false", (unsigned long)entry->count,
+                entry->rate_hz, entry->period_mean_us, (unsigned long)entry->period_min_us,
+                (unsigned long)entry->period_max_us, entry->period_std_us, entry->dlc,
+                (unsigned long)entry->dlc_changes, data);
+        }
+        ret = httpd_resp_send_chunk(req, chunk, len);
+        len = 0;
+        first += got;
+    }
+    heap_caps_free(ids);
+    if (ret == ESP_OK) {
+        len += snprintf(chunk + len, sizeof(chunk) - len, "]}");
+        ret = httpd_resp_send_chunk(req, chunk, len);
+    }
+    if (ret == ESP_OK) {
+        ret = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    return ret;
+}
+
+// Handler for the trace replay state
+static esp_err_t can_replay_status_handler(httpd_req_t *req)
+{
+    can_replay_stats_t stats;
+    bool running = canbus_replay_get_status(&stats);
+    char json_data[384];
+    snprintf(json_data, sizeof(json_data),
+        "{\"running\":%s,\"format\":\"%s\",\"speed\":%.2f,\"loop\":%s,\"finished\":%s,\"frames\":%lu,"
+        "\"skipped\":%lu,\"recorder_lost\":%lu,\"loops\":%lu,\"late_max_us\":%lu,\"trace_ms\":%lld}",
+        running ? "true" : "false", can_replay_format_name(stats.format), stats.speed,
+        stats.loop ? "true" : "false", stats.finished ? "true" : "false", (unsigned long)stats.frames,
+        (unsigned long)stats.skipped, (unsigned long)stats.recorder_lost, (unsigned long)stats.loops,
+        (unsigned long)stats.late_max_us, (long long)(stats.trace_us / 1000));
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_send(req, json_data, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// Trace file names taken from requests: one name in the log directory
+static bool replay_name_valid(const char *name)
+{
+    if (!name[0] || name[0] == '.') {
+        return false;
+    }
+    for (const char *p = name; *p; p++) {
+        if (!isalnum((unsigned char)*p) && *p != '.' && *p != '_' && *p != '-') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Handler to start and stop a replay:
+// POST /can/replay?file=<name in the log directory>[&speed=<x, 0 = full speed>][&loop=1], POST /can/replay?stop=1
+static esp_err_t can_replay_control_handler(httpd_req_t *req)
+{
+    char query[96];
+    char name[40];
+    char value[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected file=<trace> or stop=1");
+        return ESP_OK;
+    }
+    if (httpd_query_key_value(query, "stop", value, sizeof(value)) == ESP_OK) {
+        canbus_replay_stop();
+        return can_replay_status_handler(req);
+    }
+    if (httpd_query_key_value(query, "file", name, sizeof(name)) != ESP_OK || !replay_name_valid(name)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected file=<trace> or stop=1");
+        return ESP_OK;
+    }
+
+    can_replay_config_t config = { .format = CAN_REPLAY_FORMAT_AUTO, .speed = 1.0f, .loop = false };
+    if (httpd_query_key_value(query, "speed", value, sizeof(value)) == ESP_OK) {
+        config.speed = strtof(value, NULL);
+    }
+    if (httpd_query_key_value(query, "loop", value, sizeof(value)) == ESP_OK) {
+        config.loop = strcmp(value, "1") == 0 || strcmp(value, "true") == 0;
+    }
+    if (config.speed < 0.0f) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "speed is 0 (full speed) or more");
+        return ESP_OK;
+    }
+
+    char path[72];
+    snprintf(path, sizeof(path), "%s/%s", CAN_LOG_DEFAULT_DIR, name);
+    esp_err_t ret = canbus_replay_start(path, &config);
+    if (ret == ESP_ERR_NOT_FOUND) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such trace file");
+        return ESP_OK;
+    }
+    if (ret != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                            ret == ESP_ERR_INVALID_STATE ? "A replay is running" : "Not a readable trace file");
+        return ESP_OK;
+    }
+    return can_replay_status_handler(req);
+}
+
+// Handler for the task plan check: CPU share per task and core, CAN task wake-up latency
+static esp_err_t sys_tasks_handler(httpd_req_t *req)
+{
+    // Static, off the httpd stack: requests are served one at a time
+    static task_monitor_report_t report;
+    static char json_data[2560];
+    if (task_monitor_get_report(&report) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Task monitor not running");
+        return ESP_OK;
+    }
+
+    int len = snprintf(json_data, sizeof(json_data),
+        "{\"window_ms\":%lu,\"core_load_pct\":[%.1f,%.1f],\"can_wake_avg_us\":%lu,\"can_wake_max_us\":%lu,"
+        "\"can_wake_worst_us\":%lu,\"irq_jitter_max_us\":%lu,\"irq_jitter_worst_us\":%lu,"
+        "\"can_overruns\":%lu,\"can_overruns_total\":%lu,\"tasks\":[",
+        (unsigned long)report.window_ms, report.core_load_permille[0] / 10.0, report.core_load_permille[1] / 10.0,
+        (unsigned long)report.wake_avg_us, (unsigned long)report.wake_max_us, (unsigned long)report.wake_worst_us,
+        (unsigned long)report.irq_jitter_max_us, (unsigned long)report.irq_jitter_worst_us,
+        (unsigned long)report.can_overruns, (unsigned long)report.can_overruns_total);
+    for (size_t i = 0; i < report.task_count && len < (int)sizeof(json_data); i++) {
+        const task_monitor_task_t *task = &report.tasks[i];
+        len += snprintf(json_data + len, sizeof(json_data) - len,
+            "%s{\"name\":\"%s\",\"core\":%d,\"priority\":%u,\"cpu_pct\":%.1f,\"stack_free\":%lu}",
+            i ? "," : "", task->name, task->core, task->priority, task->cpu_permille / 10.0,
+            (unsigned long)task->stack_free);
+    }
+    if (len < (int)sizeof(json_data)) {
+        snprintf(json_data + len, sizeof(json_data) - len, "]}");
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_send(req, json_data, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// Handler for the CAN trace sessions on the SD card:
+// {"active":"<file being written>","sessions":[{"session":1,"files":[{"name":...,"bytes":...,"start_us":...}]}]}
+static esp_err_t log_list_handler(httpd_req_t *req)
+{
+    can_log_file_info_t *files = malloc(LOG_LIST_MAX_FILES * sizeof(*files));
+    if (!files) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_OK;
+    }
+    size_t count = can_log_list_files(CAN_LOG_DEFAULT_DIR, files, LOG_LIST_MAX_FILES);
+    can_log_stats_t log_stats;
+    can_log_get_stats(&log_stats);
+    const char *active = strrchr(log_stats.file, '/');
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    // One chunk per file: the list can be longer than any buffer we want to keep
+    char line[160];
+    snprintf(line, sizeof(line), "{\"active\":\"%s\",\"sessions\":[", active ? active + 1 : "");
+    esp_err_t ret = httpd_resp_send_chunk(req, line, HTTPD_RESP_USE_STRLEN);
+    for (size_t i = 0; i < count && ret == ESP_OK; i++) {
+        bool first_of_session = i == 0 || files[i].session != files[i - 1].session;
+        bool last_of_session = i + 1 == count || files[i + 1].session != files[i].session;
+        int len = 0;
+        if (first_of_session) {
+            len = snprintf(line, sizeof(line), "%s{\"session\":%u,\"files\":[", i ? "," : "", files[i].session);
+        }
+        snprintf(line + len, sizeof(line) - len, "%s{\"name\":\"%s\",\"bytes\":%lu,\"start_us\":%lld}%s",
+                 first_of_session ? "" : ",", files[i].name, (unsigned long)files[i].bytes,
+                 (long long)files[i].start_us, last_of_session ? "]}" : "");
+        ret = httpd_resp_send_chunk(req, line, HTTPD_RESP_USE_STRLEN);
+    }
+    free(files);
+    if (ret == ESP_OK) {
+        ret = httpd_resp_send_chunk(req, "]}", HTTPD_RESP_USE_STRLEN);
+    }
+    if (ret == ESP_OK) {
+        ret = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    return ret;
+}
+
+// Handler for trace file downloads: /logs/file?name=SSSSFFFF.CAN[&format=csv]
+// Raw files support a single byte range (Range: bytes=a-b) to resume a download; CSV is
+// converted on the fly and always sent whole. The file is streamed in chunks from one
+// fixed buffer, so memory use does not depend on the file size.
+static esp_err_t log_file_handler(httpd_req_t *req)
+{
+    char query[64];
+    char name[16];
+    char format[8] = "raw";
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "name", name, sizeof(name)) != ESP_OK ||
+        !can_log_parse_name(name, NULL, NULL)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected name=SSSSFFFF.CAN");
+        return ESP_OK;
+    }
+    httpd_query_key_value(query, "format", format, sizeof(format));
+    bool csv = strcmp(format, "csv") == 0;
+    if (!csv && strcmp(format, "raw") != 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "format is raw or csv");
+        return ESP_OK;
+    }
+
+    can_log_export_t *exp = malloc(sizeof(*exp));
+    char *chunk = malloc(LOG_EXPORT_CHUNK_SIZE);
+    if (!exp || !chunk) {
+        free(exp);
+        free(chunk);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_OK;
+    }
+
+    char path[48];
+    snprintf(path, sizeof(path), "%s/%s", CAN_LOG_DEFAULT_DIR, name);
+    esp_err_t ret = can_log_export_open(exp, path, csv ? CAN_LOG_EXPORT_CSV : CAN_LOG_EXPORT_RAW);
+    if (ret != ESP_OK) {
+        free(exp);
+        free(chunk);
+        httpd_resp_send_err(req, ret == ESP_ERR_NOT_FOUND ? HTTPD_404_NOT_FOUND : HTTPD_500_INTERNAL_SERVER_ERROR,
+                            ret == ESP_ERR_NOT_FOUND ? "No such trace file" : "Not a readable trace file");
+        return ESP_OK;
+    }
+
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    char disposition[64];
+    snprintf(disposition, sizeof(disposition), "attachment; filename=\"%.8s.%s\"", name, csv ? "csv" : "can");
+    httpd_resp_set_hdr(req, "Content-Disposition", disposition);
+    httpd_resp_set_type(req, csv ? "text/csv" : "application/octet-stream");
+
+    char range[48];
+    char content_range[48];
+    if (!csv) {
+        httpd_resp_set_hdr(req, "Accept-Ranges", "bytes");
+        uint32_t start, end;
+        if (httpd_req_get_hdr_value_str(req, "Range", range, sizeof(range)) == ESP_OK) {
+            ret = can_log_export_parse_range(range, exp->length, &start, &end);
+            if (ret == ESP_OK) {
+                can_log_export_set_range(exp, start, end);
+                snprintf(content_range, sizeof(content_range), "bytes %lu-%lu/%lu",
+                         (unsigned long)start, (unsigned long)end, (unsigned long)exp->length);
+                httpd_resp_set_status(req, "206 Partial Content");
+                httpd_resp_set_hdr(req, "Content-Range", content_range);
+            } else if (ret == ESP_ERR_INVALID_SIZE) {
+                snprintf(content_range, sizeof(content_range), "bytes */%lu", (unsigned long)exp->length);
+                httpd_resp_set_status(req, "416 Range Not Satisfiable");
+                httpd_resp_set_hdr(req, "Content-Range", content_range);
+                httpd_resp_send(req, NULL, 0);
+                can_log_export_close(exp);
+                free(exp);
+                free(chunk);
+                return ESP_OK;
+            }
+            // Other range forms: the whole file
+        }
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    uint64_t sent = 0;
+    size_t len;
+    while ((ret = can_log_export_read(exp, chunk, LOG_EXPORT_CHUNK_SIZE, &len)) == ESP_OK && len > 0) {
+        ret = httpd_resp_send_chunk(req, chunk, len);
+        if (ret != ESP_OK) {
+            break;
+        }
+        sent += len;
+    }
+    can_log_export_close(exp);
+    free(exp);
+    free(chunk);
+
+    if (ret != ESP_OK) {
+        // Headers are out: closing the connection is the only way to report it
+        ESP_LOGW(TAG, "Download of %s aborted after %llu bytes: %s", name, (unsigned long long)sent, esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
+    int64_t us = esp_timer_get_time() - start_us;
+    ESP_LOGI(TAG, "Sent %s (%s): %llu bytes in %lld ms, %lu KB/s", name, format, (unsigned long long)sent,
+             (long long)(us / 1000), (unsigned long)(us > 0 ? sent * 1000000 / us / 1024 : 0));
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
 // Start dashboard web server
 esp_err_t start_dashboard_web_server(void)
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = 80;
     config.max_open_sockets = 7;
+    config.task_priority = TASK_HTTPD_PRIORITY;
+    config.core_id = TASK_CORE_BACKGROUND;
+    config.max_uri_handlers = 12;
     
     httpd_handle_t server = NULL;
     
@@ -626,6 +1048,67 @@ esp_err_t start_dashboard_web_server(void)
             .user_ctx = NULL
         };
         httpd_register_uri_handler(server, &can_data_uri);
+
+        // CAN receive counters (frames, lost frames, bus errors)
+        httpd_uri_t can_stats_uri = {
+            .uri = "/can/stats",
+            .method = HTTP_GET,
+            .handler = can_stats_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &can_stats_uri);
+
+        // Per-ID rates, periods and jitter, bus load
+        httpd_uri_t can_ids_uri = {
+            .uri = "/can/ids",
+            .method = HTTP_GET,
+            .handler = can_ids_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &can_ids_uri);
+
+        // Recorded trace replay in place of the bus
+        httpd_uri_t can_replay_uri = {
+            .uri = "/can/replay",
+            .method = HTTP_GET,
+            .handler = can_replay_status_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &can_replay_uri);
+
+        httpd_uri_t can_replay_control_uri = {
+            .uri = "/can/replay",
+            .method = HTTP_POST,
+            .handler = can_replay_control_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &can_replay_control_uri);
+
+        // Task CPU share and CAN task latency
+        httpd_uri_t sys_tasks_uri = {
+            .uri = "/sys/tasks",
+            .method = HTTP_GET,
+            .handler = sys_tasks_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &sys_tasks_uri);
+
+        // CAN trace files on the SD card
+        httpd_uri_t log_list_uri = {
+            .uri = "/logs",
+            .method = HTTP_GET,
+            .handler = log_list_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &log_list_uri);
+
+        httpd_uri_t log_file_uri = {
+            .uri = "/logs/file",
+            .method = HTTP_GET,
+            .handler = log_file_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &log_file_uri);
         
         ESP_LOGI(TAG, "Dashboard web server started successfully");
         return ESP_OK;
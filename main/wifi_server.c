@@ -221,7 +221,9 @@ esp_err_t handle_api_ecu_data(httpd_req_t *req)
     httpd_resp_set_hdr(req, "Access-Control-Allow-Methods", "GET, POST, OPTIONS");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Headers", "Content-Type");
     
-    char* json_str = ecu_data_to_string(ecu_data_get());
+    ecu_data_t data;
+    ecu_data_get_copy(&data);
+    char* json_str = ecu_data_to_string(&data);
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, json_str, strlen(json_str));
     return ESP_OK;
@@ -573,9 +575,10 @@ esp_err_t wifi_server_stop(void)
 void wifi_server_broadcast_ecu_data(void)
 {
     // For now, just log the data since we removed WebSocket
-    ecu_data_t *data = ecu_data_get();
+    ecu_data_t data;
+    ecu_data_get_copy(&data);
     ESP_LOGI(WIFI_TAG, "ECU Data: RPM=%.1f, MAP=%.1f, TPS=%.1f", 
-              data->engine_rpm, data->map_kpa, data->tps_position);
+              data.engine_rpm, data.map_kpa, data.tps_position);
 }
 
 bool wifi_is_connected(void)